@@ -27,19 +27,23 @@ class GlobalState {
   void Update(absl::Span<const float> samples, float dt);
 
   // Accessors for global state properties.
-  float t() { return properties_.time; }
-  float dt() { return properties_.dt; }
-  float power() { return properties_.power; }
-  float average_power() { return properties_.average_power; }
+  float t() const { return properties_.time; }
+  float dt() const { return properties_.dt; }
+  float power() const { return properties_.power; }
+  float average_power() const { return properties_.average_power; }
   Accumulator<float>& energy() { return properties_.energy; }
+  const Accumulator<float>& energy() const { return properties_.energy; }
   Accumulator<float>& normalized_energy() {
     return properties_.normalized_energy;
   }
+  const Accumulator<float>& normalized_energy() const {
+    return properties_.normalized_energy;
+  }
 
   int sampling_rate() const { return options_.sampling_rate; }
 
-  absl::Span<const float> left_channel() { return channels_[0]; }
-  absl::Span<const float> right_channel() { return channels_[1]; }
+  absl::Span<const float> left_channel() const { return channels_[0]; }
+  absl::Span<const float> right_channel() const { return channels_[1]; }
 
   float bass_left() const { return channel_bands_[0][0]; }
   float bass_right() const { return channel_bands_[1][0]; }
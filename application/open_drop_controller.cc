@@ -4,10 +4,12 @@
 #include <cstdint>
 #include <iostream>
 
+#include "debug/control_injector.h"
 #include "shader/blit.fsh.h"
 #include "shader/blit.vsh.h"
 #include "primitive/rectangle.h"
 #include "third_party/gl_helper.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "util/logging/logging.h"
 
@@ -29,7 +31,8 @@ OpenDropController::OpenDropController(Options options)
           {.gl_interface = options.gl_interface,
            .sampling_rate = options.sampling_rate,
            .audio_buffer_size = options.audio_buffer_size}),
-      options_(std::move(options)) {
+      options_(std::move(options)),
+      draw_output_to_quad_(options_.draw_output_to_quad) {
   UpdateGeometry(options_.width, options_.height);
 
   global_state_ = std::make_shared<GlobalState>(
@@ -51,9 +54,35 @@ OpenDropController::OpenDropController(Options options)
   preset_blender_ =
       std::make_shared<PresetBlender>(options_.width, options_.height);
   CHECK_NULL(preset_blender_) << "Failed to create preset blender";
+
+  for (int i = 0; i < options_.views.size(); ++i) {
+    View view{.options = options_.views[i]};
+    CHECK(view.options.context != nullptr)
+        << "View " << i << " has no GL context";
+    if (i == 0) {
+      view.preset_blender = preset_blender_;
+      view.output_render_target = output_render_target_;
+    } else if (!options_.share_presets) {
+      auto activation = view.options.context->Activate();
+      auto status_or_view_render_target = gl::GlRenderTarget::MakeShared(
+          options_.width, options_.height, view.options.texture_manager);
+      CHECK(status_or_view_render_target.ok())
+          << "Failed to create output render target for view " << i;
+      view.output_render_target = *status_or_view_render_target;
+      view.preset_blender =
+          std::make_shared<PresetBlender>(options_.width, options_.height);
+    }
+    views_.push_back(std::move(view));
+  }
 }
 
 void OpenDropController::UpdateGeometry(int width, int height) {
+  // Resizing reallocates the storage of every render target, so skip it when
+  // the geometry has not changed.
+  if (width == width_ && height == height_) {
+    return;
+  }
+
   width_ = width;
   height_ = height;
   if (preset_blender_) {
@@ -65,34 +94,112 @@ void OpenDropController::UpdateGeometry(int width, int height) {
   }
 }
 
-void OpenDropController::DrawFrame(float dt) {
+bool OpenDropController::UpdateState(float dt) {
   samples_interleaved_.resize(0x10000 *
                               audio_processor().channels_per_sample());
   auto samples_view = absl::Span<float>(samples_interleaved_);
   if (!audio_processor().GetSamples(samples_view)) {
     LOG(ERROR) << "Failed to get samples";
-    return;
+    return false;
   }
 
   samples_view_ = samples_view;
 
   normalizer_->Normalize(samples_view, dt, samples_view);
   global_state_->Update(samples_view, dt);
+  return true;
+}
+
+void OpenDropController::BlitToFramebuffer(
+    std::shared_ptr<gl::GlRenderTarget> render_target, int width, int height,
+    int x_offset) {
+  gl::GlStateCache::Current().Viewport(x_offset, 0, width, height);
+  blit_program_->Use();
+  gl::GlBindRenderTargetTextureToUniform(blit_program_, "source_texture",
+                                         render_target,
+                                         gl::GlTextureBindingOptions());
+  gl::GlBindUniform(blit_program_, "alpha", 1.0f);
+
+  static Rectangle rectangle;
+  rectangle.Draw();
+}
+
+void OpenDropController::DrawFrame(float dt) {
+  if (!UpdateState(dt)) {
+    return;
+  }
 
   if (preset_blender_) {
-    preset_blender_->DrawFrame(samples_view, global_state_,
+    preset_blender_->DrawFrame(samples_view_, global_state_,
                                output_render_target_);
-    if (options_.draw_output_to_quad) {
-      blit_program_->Use();
-      gl::GlBindRenderTargetTextureToUniform(blit_program_, "source_texture",
-                                             output_render_target_,
-                                             gl::GlTextureBindingOptions());
-      glUniform1f(
-          glGetUniformLocation(blit_program_->program_handle(), "alpha"), 1.0f);
-
-      static Rectangle rectangle;
-      rectangle.Draw();
+    if (draw_output_to_quad_) {
+      BlitToFramebuffer(output_render_target_, width_, height_, 0);
+    }
+  }
+}
+
+void OpenDropController::DrawViews(float dt) {
+  if (!UpdateState(dt)) {
+    return;
+  }
+
+  for (View& view : views_) {
+    auto activation = view.options.context->Activate();
+    ControlInjector::SelectInstance(view.options.control_instance);
+
+    const glm::ivec2 drawable_size = view.options.gl_interface->DrawableSize();
+    const int width = drawable_size.x, height = drawable_size.y;
+    if (view.preset_blender) {
+      if (view.preset_blender == preset_blender_) {
+        UpdateGeometry(width, height);
+      } else {
+        view.preset_blender->UpdateGeometry(width, height);
+        view.output_render_target->UpdateGeometry(width, height);
+      }
+      view.preset_blender->DrawFrame(samples_view_, global_state_,
+                                     view.output_render_target);
+    }
+
+    // With shared presets, every view presents the output of the first.
+    std::shared_ptr<gl::GlRenderTarget> output =
+        view.output_render_target ? view.output_render_target
+                                  : output_render_target_;
+    gl::GlStateCache::Current().BindFramebuffer(0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    BlitToFramebuffer(output, width, height,
+                      static_cast<int>(view.options.eye_offset * width));
+
+    // Views are presented without the debug UI, so there is no ImGui context
+    // to draw the input mapper into.
+    ControlInjector::ReadControls();
+
+    // Ensure this view's rendering is submitted before another context samples
+    // from its output.
+    glFlush();
+  }
+  ControlInjector::SelectInstance(0);
+
+  for (View& view : views_) {
+    auto activation = view.options.context->Activate();
+    view.options.gl_interface->SwapBuffers();
+    gl::GlStateCache::Current().gpu_timer().EndFrame();
+  }
+}
+
+void OpenDropController::ForEachPresetBlender(
+    const std::function<void(PresetBlender&,
+                             std::shared_ptr<gl::GlTextureManager>)>& fn) {
+  if (views_.empty()) {
+    fn(*preset_blender_, options_.texture_manager);
+    return;
+  }
+
+  for (View& view : views_) {
+    if (!view.preset_blender) {
+      continue;
     }
+    auto activation = view.options.context->Activate();
+    fn(*view.preset_blender, view.options.texture_manager);
   }
 }
 
@@ -1,7 +1,9 @@
 #ifndef APPLICATION_OPEN_DROP_CONTROLLER_H_
 #define APPLICATION_OPEN_DROP_CONTROLLER_H_
 
+#include <functional>
 #include <memory>
+#include <vector>
 
 #include "util/graphics/gl_interface.h"
 #include "util/graphics/gl_render_target.h"
@@ -15,6 +17,23 @@ namespace opendrop {
 
 class OpenDropController : public OpenDropControllerInterface {
  public:
+  // Options for a single output view. Each view presents to its own window
+  // through its own GL context.
+  struct ViewOptions {
+    std::shared_ptr<gl::GlInterface> gl_interface;
+    // Context used to render this view. All view contexts must share object
+    // namespaces with each other.
+    std::shared_ptr<gl::GlContext> context;
+    // Texture manager for the texture units of `context`.
+    std::shared_ptr<gl::GlTextureManager> texture_manager;
+    // Index of the `ControlInjector` instance selected while this view is
+    // drawn.
+    int control_instance = 0;
+    // Horizontal offset of the presented output, as a fraction of the view
+    // width.
+    float eye_offset = 0.0f;
+  };
+
   struct Options {
     std::shared_ptr<gl::GlInterface> gl_interface;
     std::shared_ptr<gl::GlTextureManager> texture_manager;
@@ -23,12 +42,35 @@ class OpenDropController : public OpenDropControllerInterface {
     int width;
     int height;
     bool draw_output_to_quad;
+    // Output views. When empty, the controller renders only to
+    // `render_target()`. Otherwise, the first view uses the controller's own
+    // `preset_blender()` and `render_target()`, and its context must be
+    // current when the controller is constructed.
+    std::vector<ViewOptions> views = {};
+    // Whether or not all views present the output of a single set of presets
+    // rendered by the first view, instead of each view rendering its own.
+    bool share_presets = false;
   };
 
   OpenDropController(Options options);
   void UpdateGeometry(int width, int height) override;
   void DrawFrame(float dt) override;
 
+  // Draws a single frame to each view and swaps all of their buffers in
+  // lockstep. Audio is analyzed once per frame and shared by all views. The
+  // `ControlInjector` instance of each view is selected and injected while the
+  // view is drawn, and its GPU timer frame is ended after the swap.
+  void DrawViews(float dt);
+
+  // Invokes `fn` with every distinct `PresetBlender` owned by this controller
+  // and the texture manager that presets added to it should allocate from.
+  // The context of the owning view is active for the duration of each call.
+  void ForEachPresetBlender(
+      const std::function<void(PresetBlender&,
+                               std::shared_ptr<gl::GlTextureManager>)>& fn);
+
+  int num_views() const { return views_.size(); }
+
   // Returns the `PresetBlender` associated with this `OpenDropController`
   // instance.
   std::shared_ptr<PresetBlender> preset_blender() { return preset_blender_; }
@@ -44,10 +86,34 @@ class OpenDropController : public OpenDropControllerInterface {
   int width() const { return width_; }
   int height() const { return height_; }
 
+  // Sets whether or not `DrawFrame` blits the output render target to the
+  // currently bound framebuffer after rendering.
+  void set_draw_output_to_quad(bool draw_output_to_quad) {
+    draw_output_to_quad_ = draw_output_to_quad;
+  }
+
  private:
+  struct View {
+    ViewOptions options;
+    // The preset blender and output of this view. When presets are shared,
+    // these are null for every view but the first.
+    std::shared_ptr<PresetBlender> preset_blender;
+    std::shared_ptr<gl::GlRenderTarget> output_render_target;
+  };
+
+  // Pulls the current audio samples and updates the global state. Returns
+  // false if no samples could be read.
+  bool UpdateState(float dt);
+
+  // Blits `render_target` to the currently bound framebuffer, offset
+  // horizontally by `x_offset` pixels.
+  void BlitToFramebuffer(std::shared_ptr<gl::GlRenderTarget> render_target,
+                         int width, int height, int x_offset);
+
   const Options options_;
 
-  int width_, height_;
+  int width_ = 0, height_ = 0;
+  bool draw_output_to_quad_;
 
   std::shared_ptr<PresetBlender> preset_blender_;
   std::shared_ptr<GlobalState> global_state_;
@@ -55,6 +121,8 @@ class OpenDropController : public OpenDropControllerInterface {
   std::shared_ptr<gl::GlRenderTarget> output_render_target_;
   std::shared_ptr<gl::GlProgram> blit_program_;
 
+  std::vector<View> views_;
+
   std::vector<float> samples_interleaved_;
   absl::Span<const float> samples_view_{};
 };
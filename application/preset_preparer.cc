@@ -0,0 +1,162 @@
+#include "application/preset_preparer.h"
+
+#include <chrono>
+#include <vector>
+
+#include "third_party/gl_helper.h"
+#include "util/logging/logging.h"
+#include "util/math/coefficients.h"
+#include "util/status/status_macros.h"
+
+namespace opendrop {
+
+namespace {
+// Delay before retrying after a preset fails to prepare, e.g. because all
+// texture units are in use.
+constexpr std::chrono::seconds kRetryDelay(1);
+}  // namespace
+
+absl::StatusOr<std::shared_ptr<PresetPreparer>> PresetPreparer::MakeShared(
+    Options options) {
+  if (options.preset_factory == nullptr) {
+    return absl::InvalidArgumentError("A preset factory is required.");
+  }
+  if (options.ready_queue_size <= 0) {
+    return absl::InvalidArgumentError("Ready queue size must be positive.");
+  }
+
+  std::shared_ptr<gl::GlContext> loader_context;
+  {
+    // Contexts share objects with the context that is current when they are
+    // allocated.
+    auto render_activation = options.render_context->Activate();
+    loader_context = options.gl_interface->AllocateSharedContext();
+  }
+  if (loader_context == nullptr) {
+    return absl::InternalError("Failed to allocate loader context.");
+  }
+
+  return std::shared_ptr<PresetPreparer>(
+      new PresetPreparer(std::move(options), std::move(loader_context)));
+}
+
+PresetPreparer::PresetPreparer(Options options,
+                               std::shared_ptr<gl::GlContext> context)
+    : options_(std::move(options)),
+      loader_context_(std::move(context)),
+      width_(0),
+      height_(0),
+      random_stream_(Random::Stream("preset_loader").NextUint64()) {
+  loader_thread_ = std::thread([this] { Run(); });
+}
+
+PresetPreparer::~PresetPreparer() {
+  {
+    std::unique_lock<std::mutex> lock(ready_mu_);
+    stopping_ = true;
+  }
+  ready_cv_.notify_all();
+  loader_thread_.join();
+
+  // Presets that were never taken are destroyed in the render context, which
+  // owns any framebuffers generated for them.
+  auto render_activation = options_.render_context->Activate();
+  ready_.clear();
+}
+
+std::optional<PresetPreparer::PreparedPreset> PresetPreparer::TakeReady(
+    const std::function<bool(const Preset&)>& accept) {
+  std::optional<PreparedPreset> prepared;
+  // Destroyed after the lock is released.
+  std::vector<PreparedPreset> rejected;
+  {
+    std::unique_lock<std::mutex> lock(ready_mu_);
+    while (!ready_.empty()) {
+      PreparedPreset front = std::move(ready_.front());
+      ready_.pop_front();
+      if (accept(*front.preset)) {
+        prepared = std::move(front);
+        break;
+      }
+      LOG(INFO) << "Discarding prepared preset " << front.preset->name();
+      rejected.push_back(std::move(front));
+    }
+    if (prepared.has_value() || !rejected.empty()) ready_cv_.notify_all();
+  }
+  return prepared;
+}
+
+std::optional<PresetPreparer::PreparedPreset> PresetPreparer::WaitAndTake(
+    std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(ready_mu_);
+  if (!ready_cv_.wait_for(lock, timeout,
+                          [&] { return stopping_ || !ready_.empty(); }) ||
+      ready_.empty()) {
+    return std::nullopt;
+  }
+  PreparedPreset prepared = std::move(ready_.front());
+  ready_.pop_front();
+  ready_cv_.notify_all();
+  return prepared;
+}
+
+void PresetPreparer::UpdateGeometry(int width, int height) {
+  width_ = width;
+  height_ = height;
+}
+
+size_t PresetPreparer::NumReady() {
+  std::unique_lock<std::mutex> lock(ready_mu_);
+  return ready_.size();
+}
+
+absl::StatusOr<PresetPreparer::PreparedPreset> PresetPreparer::Prepare() {
+  ASSIGN_OR_RETURN(std::shared_ptr<Preset> preset,
+                   options_.preset_factory(options_.texture_manager));
+  ASSIGN_OR_RETURN(std::shared_ptr<gl::GlRenderTarget> render_target,
+                   gl::GlRenderTarget::MakeShared(0, 0,
+                                                  options_.texture_manager));
+
+  const int width = width_, height = height_;
+  if (width != 0 && height != 0) {
+    preset->UpdateGeometry(width, height);
+    render_target->UpdateGeometry(width, height);
+  }
+
+  // Shared objects are not guaranteed to be complete in other contexts until
+  // the commands that created them have finished.
+  glFinish();
+
+  return PreparedPreset{.preset = std::move(preset),
+                        .render_target = std::move(render_target)};
+}
+
+void PresetPreparer::Run() {
+  auto loader_activation = loader_context_->Activate();
+  Coefficients::ScopedStream scoped_stream(random_stream_);
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(ready_mu_);
+      ready_cv_.wait(lock, [&] {
+        return stopping_ || ready_.size() < options_.ready_queue_size;
+      });
+      if (stopping_) break;
+    }
+
+    auto status_or_prepared = Prepare();
+    std::unique_lock<std::mutex> lock(ready_mu_);
+    if (!status_or_prepared.ok()) {
+      LOG(ERROR) << "Failed to prepare preset: "
+                 << status_or_prepared.status();
+      ready_cv_.wait_for(lock, kRetryDelay, [&] { return stopping_; });
+      continue;
+    }
+
+    LOG(INFO) << "Prepared preset " << status_or_prepared->preset->name();
+    ready_.push_back(*std::move(status_or_prepared));
+    ready_cv_.notify_all();
+  }
+}
+
+}  // namespace opendrop
@@ -0,0 +1,116 @@
+#ifndef APPLICATION_PRESET_PREPARER_H_
+#define APPLICATION_PRESET_PREPARER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "absl/status/statusor.h"
+#include "preset/preset.h"
+#include "util/graphics/gl_interface.h"
+#include "util/graphics/gl_render_target.h"
+#include "util/graphics/gl_texture_manager.h"
+#include "util/math/random.h"
+
+namespace opendrop {
+
+// Builds presets ahead of time on a background thread, so that compiling
+// shaders and allocating render targets does not stall the render thread.
+//
+// The loader thread owns a GL context that shares objects with the render
+// context. It keeps a small queue of presets that are fully constructed,
+// linked and sized, from which the render thread takes presets without doing
+// any GL work. This class is thread-safe.
+class PresetPreparer {
+ public:
+  using PresetFactory =
+      std::function<absl::StatusOr<std::shared_ptr<Preset>>(
+          std::shared_ptr<gl::GlTextureManager>)>;
+
+  struct Options {
+    // Interface used to allocate the loader context, which is made current on
+    // its surface. A surface may only be current on one thread at a time, so
+    // this must not be the interface of the render window; a hidden window
+    // serves.
+    std::shared_ptr<gl::GlInterface> gl_interface;
+    // Context that presets are rendered with. The loader context shares its
+    // object namespaces with this context.
+    std::shared_ptr<gl::GlContext> render_context;
+    // Texture manager that prepared presets allocate texture units from.
+    std::shared_ptr<gl::GlTextureManager> texture_manager;
+    // Constructs a new preset. Only ever invoked on the loader thread, where
+    // `Coefficients::Stream()` is a stream of the preparer's own.
+    PresetFactory preset_factory;
+    // Number of prepared presets to keep ready.
+    int ready_queue_size = 2;
+  };
+
+  // A preset and the render target it should be drawn to.
+  struct PreparedPreset {
+    std::shared_ptr<Preset> preset;
+    std::shared_ptr<gl::GlRenderTarget> render_target;
+  };
+
+  // Constructs a `PresetPreparer` and starts its loader thread. The render
+  // context is made current for the duration of this call.
+  static absl::StatusOr<std::shared_ptr<PresetPreparer>> MakeShared(
+      Options options);
+  ~PresetPreparer();
+
+  // Removes and returns the oldest prepared preset for which `accept` returns
+  // true, or `std::nullopt` if there is no such preset. Older presets that
+  // `accept` rejects are discarded, so that the queue cannot fill with presets
+  // that are never taken; the loader thread prepares others in their place.
+  // Never blocks on the loader thread. Must be called on the render thread,
+  // since discarded presets are destroyed in the calling context.
+  std::optional<PreparedPreset> TakeReady(
+      const std::function<bool(const Preset&)>& accept);
+
+  // Removes and returns the oldest prepared preset, blocking until one is
+  // available. Returns `std::nullopt` if none becomes available within
+  // `timeout`, e.g. because presets keep failing to prepare.
+  std::optional<PreparedPreset> WaitAndTake(std::chrono::milliseconds timeout);
+
+  // Sets the geometry that presets are prepared at. Presets prepared at the
+  // geometry of the blender they are added to need not be resized on the
+  // render thread.
+  void UpdateGeometry(int width, int height);
+
+  size_t NumReady();
+
+ private:
+  PresetPreparer(Options options, std::shared_ptr<gl::GlContext> context);
+
+  // Body of the loader thread.
+  void Run();
+
+  // Constructs and sizes a single preset and its render target.
+  absl::StatusOr<PreparedPreset> Prepare();
+
+  const Options options_;
+  std::shared_ptr<gl::GlContext> loader_context_;
+
+  std::atomic<int> width_, height_;
+
+  // Stream that the loader thread draws from, seeded from the "preset_loader"
+  // stream when the preparer is constructed, so that the loader does not
+  // interleave its draws with those of the render thread.
+  RandomStream random_stream_;
+
+  std::mutex ready_mu_;
+  std::condition_variable ready_cv_;
+  std::deque<PreparedPreset> ready_;
+  bool stopping_ = false;
+
+  std::thread loader_thread_;
+};
+
+}  // namespace opendrop
+
+#endif  // APPLICATION_PRESET_PREPARER_H_
@@ -1,8 +1,11 @@
 #ifndef DEBUG_CONTROL_INJECTOR_H_
 #define DEBUG_CONTROL_INJECTOR_H_
 
+#include <atomic>
 #include <fstream>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <vector>
 
@@ -22,9 +25,20 @@ namespace opendrop {
 
 class ControlInjector {
  public:
-  static void Inject() { instance().InjectHelper(); }
+  static void Inject() {
+    std::unique_lock<std::recursive_mutex> lock(mu());
+    instance().InjectHelper();
+  }
+
+  // Applies the controls received on the control port, without drawing the
+  // input mapper. Safe to call without an ImGui context.
+  static void ReadControls() {
+    std::unique_lock<std::recursive_mutex> lock(mu());
+    instance().ReadControlsHelper();
+  }
 
   static void UpdateControl(absl::string_view name, float value) {
+    std::unique_lock<std::recursive_mutex> lock(mu());
     auto& ss = instance();
     auto iter = ss.controls_by_name_.find(name);
     if (iter == ss.controls_by_name_.end()) {
@@ -43,16 +57,19 @@ class ControlInjector {
   }
 
   static bool InjectTrigger(absl::string_view name) {
+    std::unique_lock<std::recursive_mutex> lock(mu());
     return instance().InjectTriggerInternal(name);
   }
 
   template <typename V, typename L, typename H>
   static V InjectCounter(absl::string_view name, V value, L low, H high) {
+    std::unique_lock<std::recursive_mutex> lock(mu());
     return instance().InjectCounterInternal(name, value, low, high);
   }
 
   template <typename V>
   static V InjectSignal(absl::string_view name, V value) {
+    std::unique_lock<std::recursive_mutex> lock(mu());
     return instance().InjectSignalInternal(name, value);
   }
 
@@ -60,6 +77,7 @@ class ControlInjector {
   static V InjectSignalClamp(absl::string_view name, V value, L low, H high) {
     const float interpolator_clamped =
         MapValue<float, /*clamp=*/true>(value, low, high, 0.0f, 1.0f);
+    std::unique_lock<std::recursive_mutex> lock(mu());
     return MapValue<float>(
         instance().InjectSignalInternal(name, interpolator_clamped), 0.0f, 1.0f,
         low, high);
@@ -68,17 +86,23 @@ class ControlInjector {
   template <typename V, typename L, typename H>
   static V InjectSignalOverride(absl::string_view name, V value, L low,
                                 H high) {
+    std::unique_lock<std::recursive_mutex> lock(mu());
     return static_cast<V>(
         instance().InjectSignalInternal(name, value, low, high));
   }
 
-  static void SetStatePath(std::string path) { instance().state_path_ = path; }
+  static void SetStatePath(std::string path) {
+    std::unique_lock<std::recursive_mutex> lock(mu());
+    instance().state_path_ = path;
+  }
 
   static void SetEnableImgui(bool enable_imgui) {
+    std::unique_lock<std::recursive_mutex> lock(mu());
     instance().enable_imgui_ = enable_imgui;
   }
 
   static void Save() {
+    std::unique_lock<std::recursive_mutex> lock(mu());
     if (instance().state_path_ == "") return;
     std::ofstream output_proto(instance().state_path_.c_str());
     if (!output_proto.good()) return;
@@ -89,6 +113,7 @@ class ControlInjector {
   }
 
   static void Load() {
+    std::unique_lock<std::recursive_mutex> lock(mu());
     if (instance().state_path_ == "") return;
     std::ifstream input_proto(instance().state_path_.c_str());
     if (!input_proto.good()) return;
@@ -100,12 +125,25 @@ class ControlInjector {
     instance().LoadFromProto(control_state);
   }
 
-  static void SetPort(int port) { instance().SetPortHelper(port); }
+  static void SetPort(int port) {
+    std::unique_lock<std::recursive_mutex> lock(mu());
+    instance().SetPortHelper(port);
+  }
 
   static void EnableInjection(bool inject) {
+    std::unique_lock<std::recursive_mutex> lock(mu());
     instance().enable_injection_ = inject;
   }
 
+  // Selects the injector instance that subsequent calls operate on. Instances
+  // are created on first selection. Applications driving multiple views keep
+  // one instance per view, so that each view can load its own control state
+  // and listen on its own port.
+  static void SelectInstance(int index) {
+    CHECK(index >= 0) << "Instance index must be nonnegative.";
+    active_instance_index().store(index);
+  }
+
  private:
   static constexpr size_t kDefaultHistorySize = 1024;
   static constexpr int kDefaultControlPort = 9944;
@@ -150,14 +188,33 @@ class ControlInjector {
     }
   };
 
-  ControlInjector() : control_port_(kDefaultControlPort) {}
+  explicit ControlInjector(int port) : control_port_number_(port) {}
+
+  // Guards every instance, so that signals may be injected from preset
+  // update threads.
+  static std::recursive_mutex& mu() {
+    static std::recursive_mutex* mu = new std::recursive_mutex();
+    return *mu;
+  }
+
+  // Atomic, since preset update threads read it while injecting signals.
+  static std::atomic<int>& active_instance_index() {
+    static std::atomic<int> active_instance_index{0};
+    return active_instance_index;
+  }
 
+  // Returns the selected instance. Must be called with `mu()` held.
   static ControlInjector& instance() {
-    static ControlInjector* instance = nullptr;
+    static std::vector<ControlInjector*>* instances =
+        new std::vector<ControlInjector*>();
+
+    const int index = active_instance_index().load();
+    if (index >= instances->size()) instances->resize(index + 1, nullptr);
 
+    ControlInjector*& instance = (*instances)[index];
     if (instance != nullptr) return *instance;
 
-    instance = new ControlInjector();
+    instance = new ControlInjector(kDefaultControlPort + index);
     return *instance;
   }
 
@@ -248,12 +305,23 @@ class ControlInjector {
 
   void SetPortHelper(int port) {
     LOG(INFO) << "Set control port to " << port;
-    control_port_ = ProtoPort<Control>(port);
+    control_port_number_ = port;
+    // Close the previous port before binding the new one, which may be the
+    // same port.
+    control_port_.reset();
+    control_port_ = std::make_unique<ProtoPort<Control>>(port);
   }
 
-  void InjectHelper() {
+  void ReadControlsHelper() {
+    // Ports are bound on first use rather than on construction, so that an
+    // instance whose port is set before it is read binds only that port.
+    if (control_port_ == nullptr) {
+      control_port_ =
+          std::make_unique<ProtoPort<Control>>(control_port_number_);
+    }
+
     Control control{};
-    while (control_port_.Read(&control)) {
+    while (control_port_->Read(&control)) {
       for (auto& [control_name, control_value] : control.control()) {
         controls_by_name_[control_name] = control_value;
         SignalScope::PlotSignal(control_name, control_value);
@@ -276,6 +344,10 @@ class ControlInjector {
       google::protobuf::TextFormat::PrintToString(control, &control_str);
       LOG(DEBUG) << control_str;
     }
+  }
+
+  void InjectHelper() {
+    ReadControlsHelper();
 
     if (!enable_imgui_) return;
 
@@ -404,7 +476,9 @@ class ControlInjector {
   }
 
   bool enable_injection_ = false;
-  bool enable_imgui_ = true;
+  // Instances only draw the input mapper once enabled, since views other than
+  // the first never have an ImGui context.
+  bool enable_imgui_ = false;
 
   std::set<int> buttons_{};
   std::vector<int> buttons_as_ints_{};
@@ -417,7 +491,8 @@ class ControlInjector {
 
   std::string state_path_ = "";
 
-  ProtoPort<Control> control_port_;
+  int control_port_number_;
+  std::unique_ptr<ProtoPort<Control>> control_port_;
 };
 
 // Injects a signal named `name` of the time history of `value`.
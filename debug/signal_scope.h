@@ -1,6 +1,8 @@
 #ifndef DEBUG_SIGNAL_SCOPE_H_
 #define DEBUG_SIGNAL_SCOPE_H_
 
+#include <mutex>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "implot.h"
@@ -12,6 +14,7 @@ namespace opendrop {
 class SignalScope {
  public:
   static void Plot() {
+    std::unique_lock<std::mutex> lock(mu());
     auto& ss = instance();
     ImPlot::SetNextAxisToFit(ImAxis_X1);
     ImPlot::SetNextAxisLimits(ImAxis_Y1, -1.0f, 1.0f);
@@ -30,24 +33,28 @@ class SignalScope {
 
   template <typename T>
   static T PlotSignal(absl::string_view name, T value) {
+    std::unique_lock<std::mutex> lock(mu());
     instance().PlotSignalInternal(name, value);
     return value;
   }
 
   template <typename T>
   static T PlotSignalOn(absl::string_view name, T value) {
+    std::unique_lock<std::mutex> lock(mu());
     instance().PlotSignalInternal(name, value, true);
     return value;
   }
 
   template <typename T>
   static T PlotSignalClamp(absl::string_view name, T value, T low, T high) {
+    std::unique_lock<std::mutex> lock(mu());
     instance().PlotSignalInternal(name, std::clamp(value, low, high));
     return value;
   }
 
   template <typename T>
   static T PlotSignalWrap(absl::string_view name, T value, T low, T high) {
+    std::unique_lock<std::mutex> lock(mu());
     instance().PlotSignalInternal(name, WrapToRange(value, low, high));
     return value;
   }
@@ -60,6 +67,13 @@ class SignalScope {
     bool draw_by_default = false;
   };
 
+  // Guards the instance, so that signals may be plotted from preset update
+  // threads.
+  static std::mutex& mu() {
+    static std::mutex* mu = new std::mutex();
+    return *mu;
+  }
+
   static SignalScope& instance() {
     static SignalScope* instance = nullptr;
 
@@ -21,11 +21,15 @@
 #include <SDL2/SDL.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <string>
 #include <utility>
@@ -34,25 +38,36 @@
 #include "absl/debugging/failure_signal_handler.h"
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
 #include "absl/time/clock.h"
 #include "absl/types/span.h"
 #include "application/open_drop_controller.h"
 #include "application/open_drop_controller_interface.h"
+#include "application/preset_preparer.h"
 #include "backends/imgui_impl_opengl2.h"
 #include "backends/imgui_impl_sdl.h"
 #include "debug/control_injector.h"
 #include "debug/signal_scope.h"
 #include "imgui.h"
 #include "implot.h"
-#include "preset/preset_list.h"
+#include "preset/plugin/preset_plugin_loader.h"
+#include "preset/preset_pool.h"
+#include "preset/preset_registry.h"
 #include "third_party/gl_helper.h"
 #include "util/audio/pulseaudio_interface.h"
 #include "util/cleanup.h"
+#include "util/graphics/gl_capabilities.h"
+#include "util/graphics/gl_gpu_timer.h"
 #include "util/graphics/gl_interface.h"
+#include "util/graphics/gl_program_cache.h"
+#include "util/graphics/gl_state_cache.h"
+#include "util/graphics/gl_texture_format.h"
 #include "util/graphics/gl_texture_manager.h"
 #include "util/graphics/sdl/sdl_gl_interface.h"
 #include "util/logging/logging.h"
 #include "util/math/coefficients.h"
+#include "util/math/random.h"
 #include "util/time/performance_timer.h"
 #include "util/time/rate_limiter.h"
 
@@ -97,6 +112,63 @@ ABSL_FLAG(bool, inject, false,
           "Whether or not to start injecting control immediately at startup");
 ABSL_FLAG(bool, draw_signal_viewer, true,
           "Whether or not to draw the signal viewer");
+ABSL_FLAG(bool, kiosk, false,
+          "Whether or not to start in kiosk mode. In kiosk mode, the "
+          "visualizer output is blitted directly to the window, and no ImGui "
+          "context is created or rendered until the debug UI is toggled on "
+          "with F1.");
+ABSL_FLAG(std::string, program_cache_dir, "",
+          "Directory to persist linked shader program binaries to, so that "
+          "programs are not recompiled on subsequent runs. If empty, programs "
+          "are compiled from source on every run.");
+ABSL_FLAG(int, preset_pool_memory_mb, 64,
+          "Estimated memory, in MiB, that retired presets may hold on to so "
+          "that they can be reused instead of reconstructed. If 0, retired "
+          "presets are destroyed.");
+ABSL_FLAG(int, prepared_presets, 2,
+          "Number of presets to prepare ahead of time on a background thread. "
+          "If 0, presets are prepared on the render thread when transitioning, "
+          "which stalls rendering.");
+ABSL_FLAG(int, num_views, 1,
+          "Number of output windows to drive from a single process. Each view "
+          "gets its own window and GL context, sharing audio analysis and GL "
+          "objects. More than one view implies --kiosk.");
+ABSL_FLAG(std::vector<std::string>, view_control_states, {},
+          "Comma-separated paths to .textproto ControlStates, one per view. "
+          "Views without an entry use --control_state.");
+ABSL_FLAG(std::vector<std::string>, view_control_ports, {},
+          "Comma-separated UDP control ports, one per view. Views without an "
+          "entry listen on --control_port plus the view index.");
+ABSL_FLAG(std::vector<std::string>, view_eye_offsets, {},
+          "Comma-separated horizontal output offsets, as fractions of the view "
+          "width, one per view. Used to offset stereo eye views.");
+ABSL_FLAG(bool, share_presets, false,
+          "Whether or not all views present a single set of presets, instead "
+          "of each view running its own.");
+ABSL_FLAG(std::string, playlist, "",
+          "Comma-separated preset names or tags to select presets from, each "
+          "optionally followed by =weight, e.g. \"Pills=2,2d\". Presets not "
+          "listed are not selected. If empty, the default rotation is used.");
+ABSL_FLAG(std::string, preset_plugin_dir, "",
+          "Directory to load preset plugins (.so files built with the "
+          "preset_plugin Bazel macro) from. The directory is rescanned on "
+          "each preset transition, so plugins may be added, replaced or "
+          "removed while running. If empty, no plugins are loaded.");
+ABSL_FLAG(std::string, seed, "",
+          "Seed for every source of randomness, e.g. preset selection and "
+          "preset coefficients. Runs with the same seed and input make the "
+          "same choices when presets are prepared on the render thread "
+          "(--prepared_presets=0); otherwise, which prepared preset is ready "
+          "at a transition depends on timing. If empty, a seed is drawn at "
+          "startup and logged.");
+ABSL_FLAG(bool, vertex_array_objects, false,
+          "Whether to stream vertices with a vertex array object bound, where "
+          "supported. Required to render with a core profile context.");
+ABSL_FLAG(bool, high_precision_feedback, false,
+          "Whether presets that accumulate a fading image keep it in half "
+          "float render targets, where supported, to avoid banding. Doubles "
+          "the video memory of those targets, so leave disabled on devices "
+          "short on video memory, such as the Raspberry Pi.");
 
 namespace opendrop {
 
@@ -112,24 +184,108 @@ constexpr int kTargetFrameTimeLateToleranceUs = 100000;
 constexpr int kAudioBufferSize = 256;
 // Minimum number of milliseconds that should be delayed.
 constexpr int kMinimumDelayUs = 2000;
+// Time to wait for a prepared preset when there is no other preset to show,
+// before preparing one on the render thread instead.
+constexpr std::chrono::seconds kPreparedPresetTimeout(5);
+
+// Returns the registry of preset preparers, keyed by the texture manager that
+// each preparer allocates from.
+std::map<gl::GlTextureManager *, std::shared_ptr<PresetPreparer>> &
+PresetPreparers() {
+  static auto *preset_preparers =
+      new std::map<gl::GlTextureManager *, std::shared_ptr<PresetPreparer>>();
+  return *preset_preparers;
+}
+
+// Loader for `--preset_plugin_dir`, or null if plugins are disabled.
+std::unique_ptr<PresetPluginLoader> &PluginLoader() {
+  static auto *plugin_loader = new std::unique_ptr<PresetPluginLoader>();
+  return *plugin_loader;
+}
 
-void NextPreset(OpenDropController *controller,
-                std::shared_ptr<gl::GlTextureManager> texture_manager,
-                bool force = false) {
-  static RateLimiter<float> solo_rate_limiter{
-      absl::GetFlag(FLAGS_solo_cooldown_period)};
-  // How many times to attempt to find a preset to add before giving up.
-  constexpr int kAttempts = 3;
+// Constructs a randomly selected preset, taking it from `pool` if possible.
+absl::StatusOr<std::shared_ptr<Preset>> MakeRandomPreset(
+    PresetPool *pool, std::shared_ptr<gl::GlTextureManager> texture_manager) {
+  // Only invoked on a loader thread, whose stream keeps its selections from
+  // interleaving with those made on the render thread.
+  std::optional<PresetRegistry::Entry> entry =
+      PresetRegistry::Get().Select(nullptr, &Coefficients::Stream());
+  if (!entry.has_value()) {
+    return absl::NotFoundError("No preset is selectable");
+  }
+  return PresetRegistry::Make(*entry, pool, std::move(texture_manager));
+}
+
+// Adds a preset that was prepared ahead of time by `preset_preparer` to
+// `preset_blender`. Returns false if no suitable preset was ready.
+bool NextPreparedPresetForBlender(OpenDropController *controller,
+                                  PresetBlender &preset_blender,
+                                  PresetPreparer &preset_preparer,
+                                  RateLimiter<float> &solo_rate_limiter,
+                                  bool force, float duration,
+                                  float ramp_duration) {
+  preset_preparer.UpdateGeometry(preset_blender.width(),
+                                 preset_blender.height());
+
+  std::optional<PresetPreparer::PreparedPreset> prepared;
+  if (preset_blender.NumPresets() == 0) {
+    // There is nothing on the screen to hide a stall behind, so wait for the
+    // loader thread.
+    prepared = preset_preparer.WaitAndTake(kPreparedPresetTimeout);
+  } else {
+    prepared = preset_preparer.TakeReady([&](const Preset &preset) {
+      if (preset_blender.QueryPresetCount(preset.name()) >=
+          preset.max_count()) {
+        return false;
+      }
+      return force || !preset.should_solo() ||
+             solo_rate_limiter.Permitted(controller->global_state().t());
+    });
+  }
+  if (!prepared.has_value()) {
+    return false;
+  }
+
+  if (force) preset_blender.TransitionOutAll();
+  preset_blender.AddPreset(prepared->preset, prepared->render_target,
+                           duration + ramp_duration * 2, ramp_duration);
+  return true;
+}
+
+// Adds a new preset to `preset_blender`, allocating its resources from
+// `texture_manager`.
+void NextPresetForBlender(OpenDropController *controller,
+                          PresetBlender &preset_blender,
+                          std::shared_ptr<gl::GlTextureManager> texture_manager,
+                          RateLimiter<float> &solo_rate_limiter, bool force) {
   int max_presets = absl::GetFlag(FLAGS_max_presets);
   if (!force && max_presets > 0) {
-    if (controller->preset_blender()->NumPresets() >= max_presets) {
+    if (preset_blender.NumPresets() >= max_presets) {
       return;
     }
   }
   // TODO: Refactor such that preset geometry is configured after attaching to
   // the preset blender.
   float duration = 10;  // Coefficients::Random<1>(5.0f, 10.0f)[0];
-  float ramp_duration = Coefficients::Random<1>(1.0f, 2.0f)[0];
+  static RandomStream *transition_stream = &Random::Stream("transitions");
+  float ramp_duration = transition_stream->Uniform(1.0f, 2.0f);
+
+  auto preset_preparer = PresetPreparers().find(texture_manager.get());
+  if (preset_preparer != PresetPreparers().end()) {
+    if (NextPreparedPresetForBlender(controller, preset_blender,
+                                     *preset_preparer->second,
+                                     solo_rate_limiter, force, duration,
+                                     ramp_duration)) {
+      return;
+    }
+    if (preset_blender.NumPresets() > 0) {
+      LOG(INFO) << "No prepared preset is ready; skipping transition.";
+      return;
+    }
+    LOG(INFO) << "No prepared preset is ready; preparing one on the render "
+                 "thread.";
+  }
+
   auto status_or_render_target =
       gl::GlRenderTarget::MakeShared(0, 0, texture_manager);
   if (!status_or_render_target.ok()) {
@@ -137,36 +293,109 @@ void NextPreset(OpenDropController *controller,
               << status_or_render_target.status();
     return;
   }
-  absl::StatusOr<std::shared_ptr<Preset>> status_or_preset{};
-  int attempts = kAttempts;
-  while (attempts--) {
-    status_or_preset = GetRandomPresetFromList(texture_manager);
-    if (!status_or_preset.ok()) {
-      LOG(INFO) << "Failed to create preset: " << status_or_preset.status();
-      return;
-    }
-    std::shared_ptr<Preset> preset = status_or_preset.value();
-    if (controller->preset_blender()->QueryPresetCount(preset->name()) <
-        preset->max_count())
-      break;
-    LOG(INFO) << "Too many " << preset->name() << "; trying again...";
-  }
-  if (attempts < 0) {
-    LOG(INFO) << "Failed to add preset after " << kAttempts << " attempts.";
+  // Honor the preset's limits before constructing it, rather than
+  // constructing presets only to discard them.
+  std::optional<PresetRegistry::Entry> entry =
+      PresetRegistry::Get().Select([&](const PresetRegistry::Entry &entry) {
+        if (preset_blender.QueryPresetCount(entry.name) >= entry.max_count) {
+          LOG(INFO) << "Too many " << entry.name << "; trying again...";
+          return false;
+        }
+        if (!force && entry.should_solo &&
+            !solo_rate_limiter.Permitted(controller->global_state().t())) {
+          LOG(INFO) << "Blocking preset " << entry.name
+                    << " to keep it from hogging the screen.";
+          return false;
+        }
+        return true;
+      });
+  if (!entry.has_value()) {
+    LOG(INFO) << "Failed to select a preset to add.";
     return;
   }
 
-  if (!force && status_or_preset.value()->should_solo() &&
-      !solo_rate_limiter.Permitted(controller->global_state().t())) {
-    LOG(INFO) << "Blocking preset " << status_or_preset.value()->name()
-              << " to keep it from hogging the screen.";
+  absl::StatusOr<std::shared_ptr<Preset>> status_or_preset =
+      PresetRegistry::Make(*entry, preset_blender.preset_pool().get(),
+                           texture_manager);
+  if (!status_or_preset.ok()) {
+    LOG(INFO) << "Failed to create preset: " << status_or_preset.status();
     return;
   }
 
-  if (force) controller->preset_blender()->TransitionOutAll();
-  controller->preset_blender()->AddPreset(
-      *status_or_preset, *status_or_render_target, duration + ramp_duration * 2,
-      ramp_duration);
+  if (force) preset_blender.TransitionOutAll();
+  preset_blender.AddPreset(*status_or_preset, *status_or_render_target,
+                           duration + ramp_duration * 2, ramp_duration);
+}
+
+// Adds a new preset to every preset blender driven by `controller`.
+void NextPreset(OpenDropController *controller, bool force = false) {
+  // Pick up plugin changes between activations.
+  if (PluginLoader() != nullptr) {
+    if (absl::Status status = PluginLoader()->Scan(); !status.ok()) {
+      LOG(ERROR) << "Failed to scan for preset plugins: " << status;
+    }
+  }
+
+  // One solo rate limiter per preset blender, so that views solo
+  // independently.
+  static std::vector<RateLimiter<float>> solo_rate_limiters;
+  int blender_index = 0;
+  controller->ForEachPresetBlender(
+      [&](PresetBlender &preset_blender,
+          std::shared_ptr<gl::GlTextureManager> texture_manager) {
+        if (blender_index >= solo_rate_limiters.size()) {
+          solo_rate_limiters.emplace_back(
+              absl::GetFlag(FLAGS_solo_cooldown_period));
+        }
+        NextPresetForBlender(controller, preset_blender, texture_manager,
+                             solo_rate_limiters[blender_index++], force);
+      });
+}
+
+// Returns the number of presets on the blender with the fewest presets.
+int MinNumPresets(OpenDropController *controller) {
+  int min_num_presets = std::numeric_limits<int>::max();
+  controller->ForEachPresetBlender(
+      [&](PresetBlender &preset_blender,
+          std::shared_ptr<gl::GlTextureManager> texture_manager) {
+        min_num_presets = std::min(
+            min_num_presets, static_cast<int>(preset_blender.NumPresets()));
+      });
+  return min_num_presets;
+}
+
+// Draws a single frame with `controller`, and adds a new preset if the audio
+// input calls for a transition or if there are no presets left on the screen.
+void DrawFrameAndMaybeTransition(OpenDropController *controller, float dt,
+                                 bool auto_transition) {
+  if (controller->num_views() > 0) {
+    controller->DrawViews(dt);
+  } else {
+    controller->DrawFrame(dt);
+  }
+  if (auto_transition) {
+    static float fire_time = 0.0f;
+    if ((controller->global_state().t() - fire_time) > 0.5f) {
+      // rho is the automatic transition instantaneous power threshold
+      // coefficient, or the ratio between the instantaneous power and the
+      // average power of the signal required for the `NextPreset` function to
+      // be called.
+      const static float rho = absl::GetFlag(FLAGS_transition_threshold);
+      if (std::abs(controller->global_state().power() /
+                   controller->global_state().average_power()) > rho) {
+        fire_time = controller->global_state().t();
+        static RateLimiter<float> next_preset_limiter(
+            absl::GetFlag(FLAGS_transition_cooldown_period));
+        if (next_preset_limiter.Permitted(fire_time)) {
+          NextPreset(controller);
+        }
+      }
+    }
+  }
+
+  if (MinNumPresets(controller) == 0) {
+    NextPreset(controller);
+  }
 }
 }  // namespace
 
@@ -175,6 +404,36 @@ extern "C" int main(int argc, char *argv[]) {
 
   absl::InstallFailureSignalHandler(absl::FailureSignalHandlerOptions());
 
+  if (const std::string seed_flag = absl::GetFlag(FLAGS_seed);
+      !seed_flag.empty()) {
+    uint64_t seed;
+    if (!absl::SimpleAtoi(seed_flag, &seed)) {
+      LOG(ERROR) << "Invalid --seed: " << seed_flag;
+      return 1;
+    }
+    Random::SetSeed(seed);
+  }
+
+  if (const std::string plugin_dir = absl::GetFlag(FLAGS_preset_plugin_dir);
+      !plugin_dir.empty()) {
+    PluginLoader() = std::make_unique<PresetPluginLoader>(
+        plugin_dir, &PresetRegistry::Get());
+    if (absl::Status status = PluginLoader()->Scan(); !status.ok()) {
+      LOG(ERROR) << "Failed to load preset plugins: " << status;
+      return 1;
+    }
+  }
+  auto plugin_loader_cleanup = MakeCleanup([] { PluginLoader().reset(); });
+
+  if (const std::string playlist = absl::GetFlag(FLAGS_playlist);
+      !playlist.empty()) {
+    if (absl::Status status = PresetRegistry::Get().SetPlaylist(playlist);
+        !status.ok()) {
+      LOG(ERROR) << "Invalid --playlist: " << status;
+      return 1;
+    }
+  }
+
   ControlInjector::SetPort(absl::GetFlag(FLAGS_control_port));
   ControlInjector::SetStatePath(absl::GetFlag(FLAGS_control_state));
   ControlInjector::Load();
@@ -195,9 +454,22 @@ extern "C" int main(int argc, char *argv[]) {
                           : absl::GetFlag(FLAGS_window_y);
 
     const bool draw_signal_viewer = absl::GetFlag(FLAGS_draw_signal_viewer);
-
-    ControlInjector::SetEnableImgui(draw_signal_viewer);
-
+    const int num_views = std::max(1, absl::GetFlag(FLAGS_num_views));
+    // Multiple views are always presented without the debug UI.
+    const bool multi_view = num_views > 1;
+    const bool kiosk = absl::GetFlag(FLAGS_kiosk) || multi_view;
+
+    // Whether or not the ImGui debug UI is currently drawn. In kiosk mode,
+    // this starts out disabled and the ImGui contexts are only created once
+    // the UI is first toggled on.
+    bool debug_ui_enabled = !kiosk;
+    bool debug_ui_initialized = false;
+
+    ControlInjector::SetEnableImgui(debug_ui_enabled && draw_signal_viewer);
+
+    gl::GlStateCache::EnableVertexArrayObjects(
+        absl::GetFlag(FLAGS_vertex_array_objects));
+    gl::SetHighPrecisionFeedback(absl::GetFlag(FLAGS_high_precision_feedback));
     auto sdl_gl_interface = std::make_shared<gl::SdlGlInterface>(
         SDL_CreateWindow("OpenDrop", position_x, position_y,
                          absl::GetFlag(FLAGS_window_width),
@@ -209,22 +481,99 @@ extern "C" int main(int argc, char *argv[]) {
 
     auto main_context = sdl_gl_interface->AllocateSharedContext();
 
-    ImGui::CreateContext();
-    ImPlot::CreateContext();
-    ImGuiIO &io = ImGui::GetIO();
-    io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
-    io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
-    // io.Fonts->AddFontFromFileTTF("Ubuntu Sans Mono", 12.0f, nullptr,
-    // nullptr);
-    ImGui_ImplSDL2_InitForOpenGL(sdl_gl_interface->GetWindow().get(),
-                                 main_context.get());
-    ImGui_ImplOpenGL2_Init();
+    // Additional view windows. Their contexts are allocated while the main
+    // context is current, so that all views share GL objects.
+    std::vector<std::shared_ptr<gl::SdlGlInterface>> view_gl_interfaces = {
+        sdl_gl_interface};
+    std::vector<std::shared_ptr<gl::GlContext>> view_contexts = {main_context};
+    for (int i = 1; i < num_views; ++i) {
+      auto main_context_activation = main_context->Activate();
+      view_gl_interfaces.push_back(std::make_shared<gl::SdlGlInterface>(
+          SDL_CreateWindow(absl::StrCat("OpenDrop ", i).c_str(),
+                           SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                           absl::GetFlag(FLAGS_window_width),
+                           absl::GetFlag(FLAGS_window_height),
+                           SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN |
+                               SDL_WINDOW_ALLOW_HIGHDPI |
+                               SDL_WINDOW_RESIZABLE)));
+      view_contexts.push_back(
+          view_gl_interfaces.back()->AllocateSharedContext());
+    }
+
+    auto initialize_debug_ui = [&] {
+      if (debug_ui_initialized) return;
+      debug_ui_initialized = true;
+      ImGui::CreateContext();
+      ImPlot::CreateContext();
+      ImGuiIO &io = ImGui::GetIO();
+      io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
+      io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+      // io.Fonts->AddFontFromFileTTF("Ubuntu Sans Mono", 12.0f, nullptr,
+      // nullptr);
+      ImGui_ImplSDL2_InitForOpenGL(sdl_gl_interface->GetWindow().get(),
+                                   main_context.get());
+      ImGui_ImplOpenGL2_Init();
+    };
+    if (debug_ui_enabled) initialize_debug_ui();
 
     LOG(INFO) << "Initializing OpenDrop...";
 
+    auto setup_activation = main_context->Activate();
+    gl::GlProgramCache::Get().SetDiskCacheDirectory(
+        absl::GetFlag(FLAGS_program_cache_dir));
     auto texture_manager = std::make_shared<gl::GlTextureManager>();
     const int sampling_rate = absl::GetFlag(FLAGS_sampling_rate);
 
+    std::vector<std::shared_ptr<gl::GlTextureManager>> view_texture_managers = {
+        texture_manager};
+    std::vector<OpenDropController::ViewOptions> views;
+    if (multi_view) {
+      const auto view_control_states =
+          absl::GetFlag(FLAGS_view_control_states);
+      const auto view_control_ports = absl::GetFlag(FLAGS_view_control_ports);
+      const auto view_eye_offsets = absl::GetFlag(FLAGS_view_eye_offsets);
+      for (int i = 0; i < num_views; ++i) {
+        std::shared_ptr<gl::GlTextureManager> view_texture_manager =
+            texture_manager;
+        if (i > 0) {
+          auto view_activation = view_contexts[i]->Activate();
+          view_texture_manager = std::make_shared<gl::GlTextureManager>();
+          view_texture_managers.push_back(view_texture_manager);
+        }
+
+        int control_port = absl::GetFlag(FLAGS_control_port) + i;
+        if (i < view_control_ports.size() &&
+            !absl::SimpleAtoi(view_control_ports[i], &control_port)) {
+          LOG(ERROR) << "Invalid control port for view " << i << ": "
+                     << view_control_ports[i];
+          return 1;
+        }
+        float eye_offset = 0.0f;
+        if (i < view_eye_offsets.size() &&
+            !absl::SimpleAtof(view_eye_offsets[i], &eye_offset)) {
+          LOG(ERROR) << "Invalid eye offset for view " << i << ": "
+                     << view_eye_offsets[i];
+          return 1;
+        }
+
+        ControlInjector::SelectInstance(i);
+        ControlInjector::SetEnableImgui(false);
+        ControlInjector::SetPort(control_port);
+        ControlInjector::SetStatePath(i < view_control_states.size()
+                                          ? view_control_states[i]
+                                          : absl::GetFlag(FLAGS_control_state));
+        ControlInjector::Load();
+        ControlInjector::EnableInjection(absl::GetFlag(FLAGS_inject));
+
+        views.push_back({.gl_interface = view_gl_interfaces[i],
+                         .context = view_contexts[i],
+                         .texture_manager = view_texture_manager,
+                         .control_instance = i,
+                         .eye_offset = eye_offset});
+      }
+      ControlInjector::SelectInstance(0);
+    }
+
     std::shared_ptr<OpenDropController> open_drop_controller =
         std::make_shared<OpenDropController>(OpenDropController::Options{
             .gl_interface = sdl_gl_interface,
@@ -233,10 +582,79 @@ extern "C" int main(int argc, char *argv[]) {
             .audio_buffer_size = kAudioBufferSize,
             .width = absl::GetFlag(FLAGS_window_width),
             .height = absl::GetFlag(FLAGS_window_height),
-            .draw_output_to_quad = false});
+            .draw_output_to_quad = !debug_ui_enabled,
+            .views = std::move(views),
+            .share_presets = absl::GetFlag(FLAGS_share_presets)});
     std::shared_ptr<OpenDropControllerInterface>
         open_drop_controller_interface = open_drop_controller;
 
+    open_drop_controller->ForEachPresetBlender(
+        [](PresetBlender &preset_blender,
+           std::shared_ptr<gl::GlTextureManager> texture_manager) {
+          preset_blender.set_frame_budget(1.0f / kFps);
+        });
+
+    // Retired presets are pooled per preset blender, since each view renders
+    // in its own context, and framebuffers are not shared between contexts.
+    const int preset_pool_memory_mb =
+        absl::GetFlag(FLAGS_preset_pool_memory_mb);
+    std::map<gl::GlTextureManager *, std::shared_ptr<PresetPool>> preset_pools;
+    if (preset_pool_memory_mb > 0) {
+      open_drop_controller->ForEachPresetBlender(
+          [&](PresetBlender &preset_blender,
+              std::shared_ptr<gl::GlTextureManager> texture_manager) {
+            auto preset_pool = std::make_shared<PresetPool>(PresetPool::Options{
+                .max_memory_bytes = static_cast<size_t>(preset_pool_memory_mb)
+                                    << 20});
+            preset_blender.set_preset_pool(preset_pool);
+            preset_pools[texture_manager.get()] = preset_pool;
+          });
+    }
+
+    const int prepared_presets = absl::GetFlag(FLAGS_prepared_presets);
+    auto preset_preparers_cleanup =
+        MakeCleanup([] { PresetPreparers().clear(); });
+    if (prepared_presets > 0) {
+      // With shared presets, only the first view owns a preset blender.
+      const int num_preparers =
+          absl::GetFlag(FLAGS_share_presets) ? 1 : view_texture_managers.size();
+      for (int i = 0; i < num_preparers; ++i) {
+        std::shared_ptr<PresetPool> preset_pool =
+            preset_pools[view_texture_managers[i].get()];
+        // The loader context is made current on a hidden window of its own,
+        // since the view's window is current on the render thread.
+        SDL_Window *loader_window = SDL_CreateWindow(
+            "OpenDrop Loader", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+            1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+        if (loader_window == nullptr) {
+          LOG(ERROR) << "Failed to create loader window: " << SDL_GetError()
+                     << "; presets will be prepared on the render thread.";
+          continue;
+        }
+        auto status_or_preset_preparer =
+            PresetPreparer::MakeShared(PresetPreparer::Options{
+                .gl_interface =
+                    std::make_shared<gl::SdlGlInterface>(loader_window),
+                .render_context = view_contexts[i],
+                .texture_manager = view_texture_managers[i],
+                .preset_factory =
+                    [preset_pool](
+                        std::shared_ptr<gl::GlTextureManager> texture_manager) {
+                      return MakeRandomPreset(preset_pool.get(),
+                                              texture_manager);
+                    },
+                .ready_queue_size = prepared_presets});
+        if (!status_or_preset_preparer.ok()) {
+          LOG(ERROR) << "Failed to create preset preparer: "
+                     << status_or_preset_preparer.status()
+                     << "; presets will be prepared on the render thread.";
+          continue;
+        }
+        PresetPreparers()[view_texture_managers[i].get()] =
+            *status_or_preset_preparer;
+      }
+    }
+
     int channel_count = absl::GetFlag(FLAGS_channel_count);
 
     if (channel_count > 2 || channel_count < 0) {
@@ -298,7 +716,7 @@ extern "C" int main(int argc, char *argv[]) {
 
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
-          ImGui_ImplSDL2_ProcessEvent(&event);
+          if (debug_ui_enabled) ImGui_ImplSDL2_ProcessEvent(&event);
           switch (event.type) {
             case SDL_WINDOWEVENT:
               switch (event.window.event) {
@@ -312,9 +730,7 @@ extern "C" int main(int argc, char *argv[]) {
               switch (event.key.keysym.sym) {
                 case SDLK_n:
                   LOG(INFO) << "Next";
-                  NextPreset(dynamic_cast<OpenDropController *>(
-                                 open_drop_controller.get()),
-                             texture_manager, false);
+                  NextPreset(open_drop_controller.get(), false);
                   break;
                 case SDLK_p:
                   LOG(INFO) << "Previous";
@@ -328,6 +744,21 @@ extern "C" int main(int argc, char *argv[]) {
                 case SDLK_w:
                   LOG(INFO) << "Whitelist";
                   break;
+                case SDLK_F1:
+                  if (multi_view) break;
+                  debug_ui_enabled = !debug_ui_enabled;
+                  LOG(INFO) << "Debug UI "
+                            << (debug_ui_enabled ? "enabled" : "disabled");
+                  if (debug_ui_enabled) {
+                    initialize_debug_ui();
+                  } else {
+                    ImGui::DestroyPlatformWindows();
+                  }
+                  ControlInjector::SetEnableImgui(debug_ui_enabled &&
+                                                  draw_signal_viewer);
+                  open_drop_controller->set_draw_output_to_quad(
+                      !debug_ui_enabled);
+                  break;
               }
               break;
             case SDL_MOUSEMOTION:
@@ -341,104 +772,110 @@ extern "C" int main(int argc, char *argv[]) {
         }
 
         if (SIGINJECT_TRIGGER("next_preset")) {
-          NextPreset(
-              dynamic_cast<OpenDropController *>(open_drop_controller.get()),
-              texture_manager, false);
+          NextPreset(open_drop_controller.get(), false);
         }
 
         glClear(GL_COLOR_BUFFER_BIT);
 
-        ImGui_ImplOpenGL2_NewFrame();
-        ImGui_ImplSDL2_NewFrame();
-        ImGui::NewFrame();
-
-        ImGui::Begin(
-            "OpenDrop Visualizer View", nullptr,
-            ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoScrollbar);
-        ImVec2 wsize = ImGui::GetWindowSize();
-        open_drop_controller->UpdateGeometry(wsize.x, wsize.y);
-
-        {
-          open_drop_controller->DrawFrame(prev_dt);
-          if (auto_transition) {
-            static float fire_time = 0.0f;
-            if ((open_drop_controller->global_state().t() - fire_time) > 0.5f) {
-              // rho is the automatic transition instantaneous power threshold
-              // coefficient, or the ratio between the instantaneous power and
-              // the average power of the signal required for the `NextPreset`
-              // function to be called.
-              const static float rho =
-                  absl::GetFlag(FLAGS_transition_threshold);
-              if (std::abs(
-                      open_drop_controller->global_state().power() /
-                      open_drop_controller->global_state().average_power()) >
-                  rho) {
-                fire_time = open_drop_controller->global_state().t();
-                static RateLimiter<float> next_preset_limiter(
-                    absl::GetFlag(FLAGS_transition_cooldown_period));
-                if (next_preset_limiter.Permitted(fire_time)) {
-                  NextPreset(open_drop_controller.get(), texture_manager);
-                }
-              }
-            }
+        if (!debug_ui_enabled) {
+          // Kiosk fast-path: the controller blits its output straight to the
+          // default framebuffer, and ImGui is skipped entirely. With multiple
+          // views, the controller resizes, injects and swaps each view itself.
+          if (!multi_view) {
+            glm::ivec2 drawable_size = sdl_gl_interface->DrawableSize();
+            open_drop_controller->UpdateGeometry(drawable_size.x,
+                                                 drawable_size.y);
           }
+          DrawFrameAndMaybeTransition(open_drop_controller.get(), prev_dt,
+                                      auto_transition);
+          if (!multi_view) ControlInjector::Inject();
+        } else {
+          ImGui_ImplOpenGL2_NewFrame();
+          ImGui_ImplSDL2_NewFrame();
+          ImGui::NewFrame();
+          ImGuiIO &io = ImGui::GetIO();
 
-          if (open_drop_controller->preset_blender()->NumPresets() == 0) {
-            NextPreset(open_drop_controller.get(), texture_manager);
-          }
-        }
+          ImGui::Begin(
+              "OpenDrop Visualizer View", nullptr,
+              ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoScrollbar);
+          ImVec2 wsize = ImGui::GetWindowSize();
+          open_drop_controller->UpdateGeometry(wsize.x, wsize.y);
+
+          DrawFrameAndMaybeTransition(open_drop_controller.get(), prev_dt,
+                                      auto_transition);
 
-        ImGui::Image(
-            reinterpret_cast<ImTextureID>(static_cast<intptr_t>(
-                open_drop_controller->render_target()->texture_handle())),
-            wsize, ImVec2(0, 1), ImVec2(1, 0));
-
-        ImGui::End();
-
-        {
-          ImGui::Begin("OpenDrop Image Viewer", nullptr, 0);
-          const int width = open_drop_controller->width();
-          const int height = open_drop_controller->height();
-
-          const auto [x_scale, y_scale] =
-              width > height
-                  ? std::make_tuple(
-                        ImVec2(0, 1),
-                        ImVec2(static_cast<float>(height) / width, 0))
-                  : std::make_tuple(
-                        ImVec2(0, static_cast<float>(width) / height),
-                        ImVec2(1, 0));
           ImGui::Image(
               reinterpret_cast<ImTextureID>(static_cast<intptr_t>(
                   open_drop_controller->render_target()->texture_handle())),
-              ImVec2(900, 900), x_scale, y_scale);
+              wsize, ImVec2(0, 1), ImVec2(1, 0));
+
           ImGui::End();
-        }
 
-        ImGui::Begin("OpenDrop Input Mapper", nullptr, 0);
-        ControlInjector::Inject();
-        ImGui::End();
-
-        if (draw_signal_viewer) {
-          ImGui::Begin("OpenDrop Signals Viewer", nullptr, 0);
-          ImPlot::SetNextAxisLimits(ImAxis_Y1, -1.0f, 1.0f);
-          if (ImPlot::BeginPlot("samples")) {
-            auto &processor = open_drop_controller->audio_processor();
-            interleaved_samples.resize(0x10000 *
-                                       processor.channels_per_sample());
-            auto samples_view = open_drop_controller->GetCurrentFrameSamples();
-            ImPlot::PlotLine("Interleaved Samples", samples_view.data(),
-                             samples_view.size());
-            ImPlot::EndPlot();
+          {
+            ImGui::Begin("OpenDrop Image Viewer", nullptr, 0);
+            const int width = open_drop_controller->width();
+            const int height = open_drop_controller->height();
+
+            const auto [x_scale, y_scale] =
+                width > height
+                    ? std::make_tuple(
+                          ImVec2(0, 1),
+                          ImVec2(static_cast<float>(height) / width, 0))
+                    : std::make_tuple(
+                          ImVec2(0, static_cast<float>(width) / height),
+                          ImVec2(1, 0));
+            ImGui::Image(
+                reinterpret_cast<ImTextureID>(static_cast<intptr_t>(
+                    open_drop_controller->render_target()->texture_handle())),
+                ImVec2(900, 900), x_scale, y_scale);
+            ImGui::End();
           }
-          SignalScope::Plot();
-          ImGui::End();
-        } else {
+
+          ImGui::Begin("OpenDrop Input Mapper", nullptr, 0);
           ControlInjector::Inject();
-        }
+          ImGui::End();
+
+          if (draw_signal_viewer) {
+            ImGui::Begin("OpenDrop Signals Viewer", nullptr, 0);
+            ImPlot::SetNextAxisLimits(ImAxis_Y1, -1.0f, 1.0f);
+            if (ImPlot::BeginPlot("samples")) {
+              auto &processor = open_drop_controller->audio_processor();
+              interleaved_samples.resize(0x10000 *
+                                         processor.channels_per_sample());
+              auto samples_view =
+                  open_drop_controller->GetCurrentFrameSamples();
+              ImPlot::PlotLine("Interleaved Samples", samples_view.data(),
+                               samples_view.size());
+              ImPlot::EndPlot();
+            }
+            SignalScope::Plot();
+            ImGui::End();
+          } else {
+            ControlInjector::Inject();
+          }
 
-        ImGui::Render();
-        ImGui_ImplOpenGL2_RenderDrawData(ImGui::GetDrawData());
+          ImGui::Render();
+          // ImGui draws from client arrays, and samples its font texture on
+          // the first texture unit with the texture's own parameters, which a
+          // bound sampler object would override.
+          gl::GlStateCache &state_cache = gl::GlStateCache::Current();
+          state_cache.UseClientArrays();
+          state_cache.ActiveTexture(0);
+          if (gl::GlCapabilities::Get().sampler_objects()) {
+            state_cache.BindSampler(0, 0);
+          }
+          ImGui_ImplOpenGL2_RenderDrawData(ImGui::GetDrawData());
+          // ImGui changes GL state behind the state cache's back.
+          state_cache.Invalidate();
+
+          if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
+            SDL_Window *backup_current_window = SDL_GL_GetCurrentWindow();
+            SDL_GLContext backup_current_context = SDL_GL_GetCurrentContext();
+            ImGui::UpdatePlatformWindows();
+            ImGui::RenderPlatformWindowsDefault();
+            SDL_GL_MakeCurrent(backup_current_window, backup_current_context);
+          }
+        }
 
         // Handle mouse events
 
@@ -459,25 +896,37 @@ extern "C" int main(int argc, char *argv[]) {
         }
         // End handle mouse events
 
-        if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
-          SDL_Window *backup_current_window = SDL_GL_GetCurrentWindow();
-          SDL_GLContext backup_current_context = SDL_GL_GetCurrentContext();
-          ImGui::UpdatePlatformWindows();
-          ImGui::RenderPlatformWindowsDefault();
-          SDL_GL_MakeCurrent(backup_current_window, backup_current_context);
+        // In multi-view mode DrawViews swaps and ends the frame of every
+        // view context, including the main one.
+        if (!multi_view) {
+          sdl_gl_interface->SwapBuffers();
+          gl::GlStateCache::Current().gpu_timer().EndFrame();
         }
-
-        sdl_gl_interface->SwapBuffers();
       }
 
       // Record the end of the draw operations.
       uint32_t draw_time = draw_timer.End(absl::GetCurrentTimeNanos() / 1000);
+      const gl::GlStateCache::Stats state_stats =
+          gl::GlStateCache::TakeStats();
 
       static int counter = 0;
       ++counter;
       if (counter == 1000) {
         LOG(INFO) << "Draw time: " << draw_time
-                  << "\tFrame time: " << frame_time << "\tFPS: " << 1 / prev_dt;
+                  << "\tFrame time: " << frame_time << "\tFPS: " << 1 / prev_dt
+                  << "\tGL state calls: " << state_stats.issued_calls
+                  << " (avoided " << state_stats.avoided_calls << ")";
+        if (std::optional<gl::GlGpuTimer::FrameTimings> timings =
+                gl::GlGpuTimer::LatestFrameTimings()) {
+          std::string sections;
+          for (const gl::GlGpuTimer::Section &section : timings->sections) {
+            if (section.depth > 0) continue;
+            absl::StrAppend(&sections, " ", section.name, "=",
+                            section.milliseconds, "ms");
+          }
+          LOG(INFO) << (timings->gpu ? "GPU" : "CPU")
+                    << " section times:" << sections;
+        }
         counter = 0;
       }
       if (draw_time >= kTargetFrameTimeUs) {
@@ -506,8 +955,10 @@ extern "C" int main(int argc, char *argv[]) {
       }
     }
 
-    ImPlot::DestroyContext();
-    ImGui::DestroyContext();
+    if (debug_ui_initialized) {
+      ImPlot::DestroyContext();
+      ImGui::DestroyContext();
+    }
   }
   return 0;
 }
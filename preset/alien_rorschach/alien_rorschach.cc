@@ -6,8 +6,10 @@
 #include "preset/alien_rorschach/composite.fsh.h"
 #include "preset/alien_rorschach/passthrough.vsh.h"
 #include "preset/alien_rorschach/warp.fsh.h"
+#include "preset/preset_registry.h"
 #include "util/graphics/colors.h"
 #include "third_party/gl_helper.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "util/logging/logging.h"
 #include "util/math/math.h"
@@ -50,13 +52,9 @@ absl::StatusOr<std::shared_ptr<Preset>> AlienRorschach::MakeShared(
 }
 
 void AlienRorschach::OnUpdateGeometry() {
-  glViewport(0, 0, width(), height());
-  if (front_render_target_ != nullptr) {
-    front_render_target_->UpdateGeometry(width(), height());
-  }
-  if (back_render_target_ != nullptr) {
-    back_render_target_->UpdateGeometry(width(), height());
-  }
+  ResizeRenderTarget(&front_render_target_, width(), height());
+  ResizeRenderTarget(&back_render_target_, width(), height());
+  gl::GlStateCache::Current().Viewport(0, 0, width(), height());
 }
 
 void AlienRorschach::OnDrawFrame(
@@ -127,11 +125,20 @@ void AlienRorschach::OnDrawFrame(
                                        back_render_target_,
                                        gl::GlTextureBindingOptions());
 
-    glViewport(0, 0, width(), height());
+    gl::GlStateCache::Current().Viewport(0, 0, width(), height());
     rectangle_.Draw();
 
     back_render_target_->swap_texture_unit(front_render_target_.get());
   }
 }
 
+namespace {
+// Not in the default rotation; select with --playlist.
+const PresetRegistration<AlienRorschach> kRegistration(
+    {.name = "AlienRorschach",
+     .weight = 0.0f,
+     .tags = {"2d", "feedback"},
+     .cost = 2});
+}  // namespace
+
 }  // namespace opendrop
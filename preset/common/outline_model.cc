@@ -1,6 +1,11 @@
 #include "preset/common/outline_model.h"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
 
 #include "debug/control_injector.h"
 // #include "preset/common/alpaca.obj.h"
@@ -13,6 +18,8 @@
 #include "preset/common/eyeball_pupil.obj.h"
 #include "preset/common/head_inner.obj.h"
 #include "preset/common/head_outer.obj.h"
+#include "preset/common/instanced_model.fsh.h"
+#include "preset/common/instanced_vert.vsh.h"
 #include "preset/common/jaw_inner.obj.h"
 #include "preset/common/jaw_outer.obj.h"
 #include "preset/common/lo_x.obj.h"
@@ -22,18 +29,42 @@
 #include "preset/common/pill_end_bottom.obj.h"
 #include "preset/common/pill_end_top.obj.h"
 #include "preset/common/pill_shadow.obj.h"
+#include "preset/common/pseudo_instanced_vert.vsh.h"
 #include "preset/common/star.obj.h"
 #include "preset/common/star_outline.obj.h"
 #include "third_party/gl_helper.h"
 #include "third_party/glm_helper.h"
+#include "util/graphics/gl_capabilities.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "util/math/vector.h"
 #include "util/status/status_macros.h"
 
 namespace opendrop {
 
-OutlineModel::OutlineModel(std::shared_ptr<gl::GlProgram> model_program)
+namespace {
+// Distance outlines extend beyond the model, in pixels of the viewport.
+constexpr float kOutlineWidthPixels = 25.0f;
+
+// Returns the outline width for the current viewport, in clip space.
+glm::vec2 OutlineWidth() {
+  glm::ivec4 viewport = gl::GlStateCache::Current().viewport();
+  return glm::vec2(2.0f * kOutlineWidthPixels) /
+         glm::vec2(viewport[2], viewport[3]);
+}
+
+const void* OffsetPointer(const void* pointer, size_t offset) {
+  return reinterpret_cast<const void*>(reinterpret_cast<uintptr_t>(pointer) +
+                                       offset);
+}
+}  // namespace
+
+OutlineModel::OutlineModel(std::shared_ptr<gl::GlProgram> model_program,
+                           std::shared_ptr<gl::GlProgram> instanced_program,
+                           bool instanced_arrays)
     : model_program_(model_program),
+      instanced_program_(instanced_program),
+      instanced_arrays_(instanced_arrays),
       pill_end_top_(pill_end_top_obj::Vertices(), pill_end_top_obj::Normals(),
                     pill_end_top_obj::Uvs(), pill_end_top_obj::Triangles()),
       pill_end_bottom_(
@@ -74,35 +105,66 @@ OutlineModel::OutlineModel(std::shared_ptr<gl::GlProgram> model_program)
       jaw_inner_(jaw_inner_obj::Vertices(), jaw_inner_obj::Normals(),
                  jaw_inner_obj::Uvs(), jaw_inner_obj::Triangles()),
       camp_therapy_(camp_therapy_obj::Vertices(), camp_therapy_obj::Normals(),
-                    camp_therapy_obj::Uvs(), camp_therapy_obj::Triangles())
-
-{}
+                    camp_therapy_obj::Uvs(), camp_therapy_obj::Triangles()) {
+  if (instanced_arrays_) {
+    const unsigned int program_handle = instanced_program_->program_handle();
+    instance_transform_location_ =
+        glGetAttribLocation(program_handle, "instance_transform");
+    instance_color_a_location_ =
+        glGetAttribLocation(program_handle, "instance_color_a");
+    instance_color_b_location_ =
+        glGetAttribLocation(program_handle, "instance_color_b");
+  } else {
+    instance_transforms_ = gl::GlUniformHandle<glm::mat4>(
+        instanced_program_, "instance_transforms");
+    instance_colors_a_ =
+        gl::GlUniformHandle<glm::vec4>(instanced_program_, "instance_colors_a");
+    instance_colors_b_ =
+        gl::GlUniformHandle<glm::vec4>(instanced_program_, "instance_colors_b");
+    instance_index_ =
+        gl::GlUniformHandle<int>(instanced_program_, "instance_index");
+  }
+}
 
 absl::StatusOr<std::shared_ptr<OutlineModel>> OutlineModel::MakeShared() {
   ASSIGN_OR_RETURN(auto model_program,
                    gl::GlProgram::MakeShared(passthrough_vert_vsh::Code(),
                                              model_fsh::Code()));
-  return std::shared_ptr<OutlineModel>(new OutlineModel(model_program));
+  const bool instanced_arrays = gl::GlCapabilities::Get().instanced_arrays();
+  ASSIGN_OR_RETURN(
+      auto instanced_program,
+      gl::GlProgram::MakeShared(instanced_arrays
+                                    ? instanced_vert_vsh::Code()
+                                    : pseudo_instanced_vert_vsh::Code(),
+                                instanced_model_fsh::Code()));
+  return std::shared_ptr<OutlineModel>(
+      new OutlineModel(model_program, instanced_program, instanced_arrays));
 }
 
-void OutlineModel::Draw(const Params& params) {
-  auto program_activation = model_program_->Activate();
-
-  GlBindUniform(model_program_, "render_target_size",
+void OutlineModel::BindSharedUniforms(
+    const std::shared_ptr<gl::GlProgram>& program, const Params& params) {
+  GlBindUniform(program, "render_target_size",
                 glm::ivec2(params.render_target->width(),
                            params.render_target->height()));
-  GlBindUniform(model_program_, "alpha", params.alpha);
-  GlBindRenderTargetTextureToUniform(model_program_, "render_target",
+  GlBindUniform(program, "alpha", params.alpha);
+  GlBindRenderTargetTextureToUniform(program, "render_target",
                                      params.render_target,
                                      gl::GlTextureBindingOptions());
-  GlBindRenderTargetTextureToUniform(model_program_, "black_render_target",
+  GlBindRenderTargetTextureToUniform(program, "black_render_target",
                                      params.black_render_target,
                                      gl::GlTextureBindingOptions());
 
-  GlBindUniform(model_program_, "energy", params.energy);
-  GlBindUniform(model_program_, "blend_coeff", params.blend_coeff);
+  GlBindUniform(program, "energy", params.energy);
+  GlBindUniform(program, "blend_coeff", params.blend_coeff);
+  GlBindUniform(program, "black_alpha", 0.0f);
+  GlBindUniform(program, "outline_width", glm::vec2(0.0f));
+}
+
+void OutlineModel::Draw(const Params& params) {
+  auto program_activation = model_program_->Activate();
+  BindSharedUniforms(model_program_, params);
   GlBindUniform(model_program_, "model_transform", params.model_transform);
-  GlBindUniform(model_program_, "black_alpha", 0.0f);
+  const glm::vec2 outline_width = OutlineWidth();
 
   auto model_to_draw = SIGINJECT_ENUM("model_to_draw", params.model_to_draw);
   switch (model_to_draw) {
@@ -149,24 +211,19 @@ void OutlineModel::Draw(const Params& params) {
       pill_end_bottom_.Draw();
       break;
     case kLoX:
-      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-      glLineWidth(50);
+      GlBindUniform(model_program_, "outline_width", outline_width);
       GlBindUniform(model_program_, "black", true);
       GlBindUniform(model_program_, "max_negative_z", true);
       lo_x_.Draw();
-      glPolygonMode(GL_FRONT_AND_BACK, GL_POINTS);
-      glPointSize(50);
-      lo_x_.Draw();
       GlBindUniform(model_program_, "max_negative_z", false);
       GlBindUniform(model_program_, "black", false);
-      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+      GlBindUniform(model_program_, "outline_width", glm::vec2(0.0f));
       GlBindUniform(model_program_, "light_color_a", params.color_a);
       GlBindUniform(model_program_, "light_color_b", params.color_b);
       lo_x_.Draw();
       break;
     case kEyeball:
-      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-      glLineWidth(50);
+      GlBindUniform(model_program_, "outline_width", outline_width);
       GlBindUniform(model_program_, "black", true);
       GlBindUniform(model_program_, "max_negative_z", true);
       // GlBindUniform(
@@ -178,7 +235,7 @@ void OutlineModel::Draw(const Params& params) {
       // params.model_transform);
       eyeball_iris_.Draw();
       eyeball_ball_.Draw();
-      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+      GlBindUniform(model_program_, "outline_width", glm::vec2(0.0f));
       GlBindUniform(model_program_, "max_negative_z", false);
       GlBindUniform(model_program_, "black", true);
       GlBindUniform(
@@ -204,12 +261,11 @@ void OutlineModel::Draw(const Params& params) {
     case kHead:
       GlBindUniform(model_program_, "blend_coeff", 0.0f);
 
-      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-      glLineWidth(50);
+      GlBindUniform(model_program_, "outline_width", outline_width);
       GlBindUniform(model_program_, "black", true);
       GlBindUniform(model_program_, "max_negative_z", true);
       head_outer_.Draw();
-      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+      GlBindUniform(model_program_, "outline_width", glm::vec2(0.0f));
       GlBindUniform(model_program_, "max_negative_z", false);
       head_inner_.Draw();
       GlBindUniform(model_program_, "black", false);
@@ -225,12 +281,11 @@ void OutlineModel::Draw(const Params& params) {
           model_program_, "model_transform",
           params.model_transform *
               RotateAround(glm::vec3(1, 0, 0), kPi / 2 * params.mouth_open));
-      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-      glLineWidth(50);
+      GlBindUniform(model_program_, "outline_width", outline_width);
       GlBindUniform(model_program_, "black", true);
       GlBindUniform(model_program_, "max_negative_z", true);
       jaw_outer_.Draw();
-      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+      GlBindUniform(model_program_, "outline_width", glm::vec2(0.0f));
       GlBindUniform(model_program_, "max_negative_z", false);
       jaw_inner_.Draw();
       GlBindUniform(model_program_, "black", false);
@@ -242,17 +297,13 @@ void OutlineModel::Draw(const Params& params) {
           glm::mix(params.color_b, params.bias_color, params.bias_coeff));
       jaw_outer_.Draw();
     case kCampTherapy:
-      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-      glLineWidth(50);
+      GlBindUniform(model_program_, "outline_width", outline_width);
       GlBindUniform(model_program_, "black", true);
       GlBindUniform(model_program_, "max_negative_z", true);
       camp_therapy_.Draw();
-      glPolygonMode(GL_FRONT_AND_BACK, GL_POINTS);
-      glPointSize(50);
-      camp_therapy_.Draw();
       GlBindUniform(model_program_, "max_negative_z", false);
       GlBindUniform(model_program_, "black", false);
-      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+      GlBindUniform(model_program_, "outline_width", glm::vec2(0.0f));
       GlBindUniform(model_program_, "light_color_a", params.color_a);
       GlBindUniform(model_program_, "light_color_b", params.color_b);
       camp_therapy_.Draw();
@@ -263,4 +314,156 @@ void OutlineModel::Draw(const Params& params) {
   }
 }
 
+void OutlineModel::DrawInstanced(const Params& params,
+                                 absl::Span<const Instance> instances) {
+  if (instances.empty()) return;
+  auto model_to_draw = SIGINJECT_ENUM("model_to_draw", params.model_to_draw);
+  if (model_to_draw == kEyeball || model_to_draw == kHead) {
+    Params instance_params = params;
+    for (const Instance& instance : instances) {
+      instance_params.model_transform = instance.model_transform;
+      instance_params.color_a = instance.color_a;
+      instance_params.color_b = instance.color_b;
+      Draw(instance_params);
+    }
+    return;
+  }
+
+  auto program_activation = instanced_program_->Activate();
+  BindSharedUniforms(instanced_program_, params);
+  if (instanced_arrays_) {
+    DrawWithInstancedArrays(model_to_draw, instances);
+  } else {
+    DrawPseudoInstanced(model_to_draw, instances);
+  }
+}
+
+void OutlineModel::DrawInstancedPasses(
+    ModelToDraw model_to_draw, const std::function<void(Model&)>& draw) {
+  auto draw_outlined = [&](Model& model) {
+    GlBindUniform(instanced_program_, "outline_width", OutlineWidth());
+    GlBindUniform(instanced_program_, "black", true);
+    GlBindUniform(instanced_program_, "max_negative_z", true);
+    draw(model);
+    GlBindUniform(instanced_program_, "max_negative_z", false);
+    GlBindUniform(instanced_program_, "black", false);
+    GlBindUniform(instanced_program_, "outline_width", glm::vec2(0.0f));
+    GlBindUniform(instanced_program_, "light_color_mix", glm::vec2(0, 1));
+    draw(model);
+  };
+
+  switch (model_to_draw) {
+    case kCube:
+      GlBindUniform(instanced_program_, "black", true);
+      draw(cube_outline_);
+      GlBindUniform(instanced_program_, "black", false);
+      GlBindUniform(instanced_program_, "light_color_mix", glm::vec2(0, 1));
+      draw(cube_);
+      break;
+    case kStar:
+      GlBindUniform(instanced_program_, "black", true);
+      draw(star_outline_);
+      GlBindUniform(instanced_program_, "black", false);
+      GlBindUniform(instanced_program_, "light_color_mix", glm::vec2(0, 1));
+      draw(star_);
+      break;
+    case kPill:
+      GlBindUniform(instanced_program_, "black", true);
+      GlBindUniform(instanced_program_, "max_negative_z", true);
+      draw(pill_shadow_);
+      GlBindUniform(instanced_program_, "max_negative_z", false);
+      draw(pill_center_);
+      GlBindUniform(instanced_program_, "black", false);
+      GlBindUniform(instanced_program_, "light_color_mix",
+                    glm::vec2(0.7f, 1.0f));
+      draw(pill_end_top_);
+      GlBindUniform(instanced_program_, "light_color_mix",
+                    glm::vec2(0.3f, 0.0f));
+      draw(pill_end_bottom_);
+      break;
+    case kLoX:
+      draw_outlined(lo_x_);
+      break;
+    case kCampTherapy:
+      draw_outlined(camp_therapy_);
+      break;
+    case kAlpaca:
+      break;
+    default:
+      LOG(INFO) << "Unknown model to draw instanced: " << model_to_draw;
+      break;
+  }
+}
+
+void OutlineModel::DrawWithInstancedArrays(
+    ModelToDraw model_to_draw, absl::Span<const Instance> instances) {
+  gl::GlStateCache& state_cache = gl::GlStateCache::Current();
+  // Attribute pointers are part of the vertex array object, which the model
+  // binds again before drawing.
+  state_cache.BindOwnVertexArray();
+  const void* instance_data = state_cache.StreamVertices(
+      instances.data(), instances.size() * sizeof(Instance));
+
+  // Location and offset of each attribute. Matrix attributes take one
+  // location per column. Attributes the program optimized out are at -1.
+  std::array<std::pair<int, size_t>, 6> attributes;
+  for (int column = 0; column < 4; ++column) {
+    const int location = instance_transform_location_ < 0
+                             ? -1
+                             : instance_transform_location_ + column;
+    attributes[column] = {location, offsetof(Instance, model_transform) +
+                                        column * sizeof(glm::vec4)};
+  }
+  attributes[4] = {instance_color_a_location_, offsetof(Instance, color_a)};
+  attributes[5] = {instance_color_b_location_, offsetof(Instance, color_b)};
+  for (const auto& [location, offset] : attributes) {
+    if (location < 0) continue;
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                          OffsetPointer(instance_data, offset));
+    glVertexAttribDivisor(location, 1);
+  }
+
+  const int num_instances = instances.size();
+  DrawInstancedPasses(model_to_draw, [num_instances](Model& model) {
+    model.DrawInstanced(num_instances);
+  });
+
+  for (const auto& [location, offset] : attributes) {
+    if (location < 0) continue;
+    glVertexAttribDivisor(location, 0);
+    glDisableVertexAttribArray(location);
+  }
+}
+
+void OutlineModel::DrawPseudoInstanced(ModelToDraw model_to_draw,
+                                       absl::Span<const Instance> instances) {
+  std::array<glm::mat4, kMaxPseudoInstances> transforms;
+  std::array<glm::vec4, kMaxPseudoInstances> colors_a;
+  std::array<glm::vec4, kMaxPseudoInstances> colors_b;
+  for (size_t begin = 0; begin < instances.size();
+       begin += kMaxPseudoInstances) {
+    const int batch_size =
+        std::min<size_t>(instances.size() - begin, kMaxPseudoInstances);
+    for (int i = 0; i < batch_size; ++i) {
+      transforms[i] = instances[begin + i].model_transform;
+      colors_a[i] = instances[begin + i].color_a;
+      colors_b[i] = instances[begin + i].color_b;
+    }
+    instance_transforms_.Set(
+        absl::Span<const glm::mat4>(transforms.data(), batch_size));
+    instance_colors_a_.Set(
+        absl::Span<const glm::vec4>(colors_a.data(), batch_size));
+    instance_colors_b_.Set(
+        absl::Span<const glm::vec4>(colors_b.data(), batch_size));
+
+    DrawInstancedPasses(model_to_draw, [&](Model& model) {
+      for (int i = 0; i < batch_size; ++i) {
+        instance_index_.Set(i);
+        model.Draw();
+      }
+    });
+  }
+}
+
 }  // namespace opendrop
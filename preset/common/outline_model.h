@@ -1,12 +1,15 @@
 #ifndef PRESET_COMMON_OUTLINE_MODEL_H_
 #define PRESET_COMMON_OUTLINE_MODEL_H_
 
+#include <functional>
 #include <memory>
 
+#include "absl/types/span.h"
 #include "primitive/model.h"
 #include "third_party/glm_helper.h"
 #include "util/graphics/gl_interface.h"
 #include "util/graphics/gl_render_target.h"
+#include "util/graphics/gl_util.h"
 
 namespace opendrop {
 
@@ -47,15 +50,60 @@ class OutlineModel {
     float bias_coeff = 0.0f;
   };
 
+  // Parameters of one of the copies drawn by `DrawInstanced`.
+  struct Instance {
+    glm::mat4 model_transform;
+    glm::vec4 color_a;
+    glm::vec4 color_b;
+  };
+
   static absl::StatusOr<std::shared_ptr<OutlineModel>> MakeShared();
 
   void Draw(const Params& params);
+  // Draws a copy of the model for each of `instances`, which take the place
+  // of the `model_transform`, `color_a` and `color_b` of `params`. Where
+  // instanced arrays are supported, each pass over the model is one draw call
+  // for all instances. Elsewhere, instances are drawn in batches from uniform
+  // arrays, which only leaves one uniform update per instance and pass.
+  // `kEyeball` and `kHead`, which transform their parts separately, are drawn
+  // with `Draw` per instance.
+  void DrawInstanced(const Params& params,
+                     absl::Span<const Instance> instances);
 
  protected:
-  OutlineModel(std::shared_ptr<gl::GlProgram> model_program);
+  OutlineModel(std::shared_ptr<gl::GlProgram> model_program,
+               std::shared_ptr<gl::GlProgram> instanced_program,
+               bool instanced_arrays);
 
  private:
+  // Number of instances in a batch of the pseudo-instanced program, which
+  // sizes its uniform arrays.
+  static constexpr int kMaxPseudoInstances = 16;
+
+  // Binds the uniforms of `params` that apply to every instance.
+  void BindSharedUniforms(const std::shared_ptr<gl::GlProgram>& program,
+                          const Params& params);
+  // Draws the passes of `model_to_draw` with `instanced_program_`, which must
+  // be in use, calling `draw` to draw all instances of each part.
+  void DrawInstancedPasses(ModelToDraw model_to_draw,
+                           const std::function<void(Model&)>& draw);
+  void DrawWithInstancedArrays(ModelToDraw model_to_draw,
+                               absl::Span<const Instance> instances);
+  void DrawPseudoInstanced(ModelToDraw model_to_draw,
+                           absl::Span<const Instance> instances);
+
   std::shared_ptr<gl::GlProgram> model_program_;
+  // Reads instances from instanced arrays if `instanced_arrays_`, and from
+  // uniform arrays otherwise.
+  std::shared_ptr<gl::GlProgram> instanced_program_;
+  const bool instanced_arrays_;
+  int instance_transform_location_ = -1;
+  int instance_color_a_location_ = -1;
+  int instance_color_b_location_ = -1;
+  gl::GlUniformHandle<glm::mat4> instance_transforms_;
+  gl::GlUniformHandle<glm::vec4> instance_colors_a_;
+  gl::GlUniformHandle<glm::vec4> instance_colors_b_;
+  gl::GlUniformHandle<int> instance_index_;
 
   Model pill_end_top_;
   Model pill_end_bottom_;
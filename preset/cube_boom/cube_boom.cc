@@ -10,8 +10,10 @@
 #include "preset/cube_boom/passthrough.vsh.h"
 #include "preset/cube_boom/shrek.obj.h"
 #include "preset/cube_boom/warp.fsh.h"
+#include "preset/preset_registry.h"
 #include "util/graphics/colors.h"
 #include "third_party/gl_helper.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "third_party/glm_helper.h"
 #include "util/logging/logging.h"
@@ -58,9 +60,12 @@ absl::StatusOr<std::shared_ptr<Preset>> CubeBoom::MakeShared(
                    gl::GlRenderTarget::MakeShared(0, 0, texture_manager));
   ASSIGN_OR_RETURN(auto back_render_target,
                    gl::GlRenderTarget::MakeShared(0, 0, texture_manager));
-  ASSIGN_OR_RETURN(auto depth_output_target,
-                   gl::GlRenderTarget::MakeShared(0, 0, texture_manager,
-                                                  {.enable_depth = true}));
+  // Nothing uses stencil, so the depth is 16-bit.
+  ASSIGN_OR_RETURN(
+      auto depth_output_target,
+      gl::GlRenderTarget::MakeShared(
+          0, 0, texture_manager,
+          {.enable_depth = true, .depth_format = gl::GlDepthFormat::kDepth16}));
 
   return std::shared_ptr<CubeBoom>(new CubeBoom(
       warp_program, composite_program, model_program, front_render_target,
@@ -68,16 +73,10 @@ absl::StatusOr<std::shared_ptr<Preset>> CubeBoom::MakeShared(
 }
 
 void CubeBoom::OnUpdateGeometry() {
-  glViewport(0, 0, width(), height());
-  if (front_render_target_ != nullptr) {
-    front_render_target_->UpdateGeometry(width(), height());
-  }
-  if (back_render_target_ != nullptr) {
-    back_render_target_->UpdateGeometry(width(), height());
-  }
-  if (depth_output_target_ != nullptr) {
-    depth_output_target_->UpdateGeometry(width(), height());
-  }
+  ResizeRenderTarget(&front_render_target_, width(), height());
+  ResizeRenderTarget(&back_render_target_, width(), height());
+  ResizeRenderTarget(&depth_output_target_, width(), height());
+  gl::GlStateCache::Current().Viewport(0, 0, width(), height());
 }
 
 void CubeBoom::OnDrawFrame(
@@ -152,16 +151,16 @@ void CubeBoom::OnDrawFrame(
         glm::rotate(glm::mat4(1.0f), energy * 15, glm::vec3(1.0f, 0.0f, 0.0f));
     GlBindUniform(model_program_, "model_transform", model_transform);
 
-    glViewport(0, 0, width(), height());
+    gl::GlStateCache::Current().Viewport(0, 0, width(), height());
     glClearColor(0, 0, 0, 0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glDepthRange(0, 10);
-    glEnable(GL_DEPTH_TEST);
+    gl::GlStateCache::Current().Enable(GL_DEPTH_TEST);
     // Enable one of these at a time.
     // shrek_.Draw();
     cube_.Draw();
     // monkey_.Draw();
-    glDisable(GL_DEPTH_TEST);
+    gl::GlStateCache::Current().Disable(GL_DEPTH_TEST);
 
     back_render_target_->swap_texture_unit(front_render_target_.get());
   }
@@ -178,9 +177,19 @@ void CubeBoom::OnDrawFrame(
                                        depth_output_target_,
                                        gl::GlTextureBindingOptions());
 
-    glViewport(0, 0, width(), height());
+    gl::GlStateCache::Current().Viewport(0, 0, width(), height());
     rectangle_.Draw();
   }
 }
 
+namespace {
+// Not in the default rotation; select with --playlist.
+const PresetRegistration<CubeBoom> kRegistration(
+    {.name = "CubeBoom",
+     .weight = 0.0f,
+     .tags = {"3d", "feedback"},
+     .max_count = 1,
+     .cost = 3});
+}  // namespace
+
 }  // namespace opendrop
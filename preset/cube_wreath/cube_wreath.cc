@@ -9,9 +9,11 @@
 #include "preset/cube_wreath/passthrough_frag.fsh.h"
 #include "preset/cube_wreath/passthrough_vert.vsh.h"
 #include "preset/cube_wreath/warp.fsh.h"
+#include "preset/preset_registry.h"
 #include "util/graphics/colors.h"
 #include "util/enums.h"
 #include "third_party/gl_helper.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "third_party/glm_helper.h"
 #include "util/logging/logging.h"
@@ -27,7 +29,6 @@ CubeWreath::CubeWreath(std::shared_ptr<gl::GlProgram> warp_program,
                        std::shared_ptr<gl::GlRenderTarget> model_texture_target,
                        std::shared_ptr<gl::GlRenderTarget> front_render_target,
                        std::shared_ptr<gl::GlRenderTarget> back_render_target,
-                       std::shared_ptr<gl::GlRenderTarget> depth_output_target,
                        std::shared_ptr<OutlineModel> outline_model,
                        std::shared_ptr<gl::GlTextureManager> texture_manager)
     : Preset(texture_manager),
@@ -37,7 +38,6 @@ CubeWreath::CubeWreath(std::shared_ptr<gl::GlProgram> warp_program,
       model_texture_target_(model_texture_target),
       front_render_target_(front_render_target),
       back_render_target_(back_render_target),
-      depth_output_target_(depth_output_target),
       outline_model_(outline_model) {}
 
 absl::StatusOr<std::shared_ptr<Preset>> CubeWreath::MakeShared(
@@ -55,38 +55,35 @@ absl::StatusOr<std::shared_ptr<Preset>> CubeWreath::MakeShared(
                    gl::GlRenderTarget::MakeShared(0, 0, texture_manager));
   ASSIGN_OR_RETURN(auto back_render_target,
                    gl::GlRenderTarget::MakeShared(0, 0, texture_manager));
-  ASSIGN_OR_RETURN(auto depth_output_target,
-                   gl::GlRenderTarget::MakeShared(0, 0, texture_manager,
-                                                  {.enable_depth = true}));
   ASSIGN_OR_RETURN(auto outline_model, OutlineModel::MakeShared());
 
   return std::shared_ptr<CubeWreath>(
       new CubeWreath(warp_program, composite_program, passthrough_program,
                      nullptr, front_render_target, back_render_target,
-                     depth_output_target, outline_model, texture_manager));
+                     outline_model, texture_manager));
 }
 
 void CubeWreath::OnUpdateGeometry() {
-  glViewport(0, 0, width(), height());
-  if (model_texture_target_ != nullptr) {
-    model_texture_target_->UpdateGeometry(longer_dimension(),
-                                          longer_dimension());
-  }
-  if (front_render_target_ != nullptr) {
-    front_render_target_->UpdateGeometry(longer_dimension(),
-                                         longer_dimension());
-  }
-  if (back_render_target_ != nullptr) {
-    back_render_target_->UpdateGeometry(longer_dimension(), longer_dimension());
-  }
-  if (depth_output_target_ != nullptr) {
-    depth_output_target_->UpdateGeometry(longer_dimension(),
-                                         longer_dimension());
-  }
+  ResizeRenderTarget(&model_texture_target_, longer_dimension(),
+                     longer_dimension());
+  ResizeRenderTarget(&front_render_target_, longer_dimension(),
+                     longer_dimension());
+  ResizeRenderTarget(&back_render_target_, longer_dimension(),
+                     longer_dimension());
+  // The frame already prepared by `OnUpdate` must sample the resized target.
+  cube_params_.render_target = back_render_target_;
+  gl::GlStateCache::Current().Viewport(0, 0, width(), height());
 }
 
-void CubeWreath::DrawCubes(float power, float energy, glm::vec3 zoom_vec,
-                           int num_cubes) {
+void CubeWreath::OnReset() {
+  ClearRenderTarget(front_render_target_);
+  ClearRenderTarget(back_render_target_);
+  rot_arg_ = 0.0f;
+  texture_trigger_ = false;
+}
+
+void CubeWreath::UpdateCubes(float power, float energy, glm::vec3 zoom_vec,
+                             int num_cubes) {
   float cube_scale =
       SIGINJECT_OVERRIDE("cube_wreath_model_scale",
                          static_cast<float>(std::clamp(
@@ -99,7 +96,19 @@ void CubeWreath::DrawCubes(float power, float energy, glm::vec3 zoom_vec,
   rot_arg_ += rot_speed_coeff * power / 50;
 
   glm::mat3x3 look_rotation = OrientTowards(zoom_vec);
+  const glm::mat4 cube_rotation =
+      glm::rotate(glm::mat4(1.0f), rot_arg_ * 10,
+                  glm::vec3(0.0f, 0.0f, 1.0f)) *
+      glm::rotate(glm::mat4(1.0f), rot_arg_ * 7, glm::vec3(0.0f, 1.0f, 0.0f)) *
+      glm::rotate(glm::mat4(1.0f), rot_arg_ * 15, glm::vec3(1.0f, 0.0f, 0.0f));
+  glm::vec4 color_a = glm::vec4(HsvToRgb(glm::vec3(energy, 1, 1)), 1);
+  glm::vec4 color_b = glm::vec4(HsvToRgb(glm::vec3(energy + 0.5, 1, 1)), 1);
+
+  if (SIGINJECT_TRIGGER("cube_wreath_texture_enable")) {
+    texture_trigger_ = !texture_trigger_;
+  }
 
+  cube_instances_.clear();
   glm::mat4 model_transform;
   for (int i = 0; i < num_cubes; ++i) {
     model_transform =
@@ -119,38 +128,27 @@ void CubeWreath::DrawCubes(float power, float energy, glm::vec3 zoom_vec,
                     0, 0, cube_scale, 0,  // Row 3
                     0, 0, 0, 1            // Row 4
                     ) *
-        glm::rotate(glm::mat4(1.0f), rot_arg_ * 10,
-                    glm::vec3(0.0f, 0.0f, 1.0f)) *
-        glm::rotate(glm::mat4(1.0f), rot_arg_ * 7,
-                    glm::vec3(0.0f, 1.0f, 0.0f)) *
-        glm::rotate(glm::mat4(1.0f), rot_arg_ * 15,
-                    glm::vec3(1.0f, 0.0f, 0.0f));
-    glm::vec4 color_a = glm::vec4(HsvToRgb(glm::vec3(energy, 1, 1)), 1);
-    glm::vec4 color_b = glm::vec4(HsvToRgb(glm::vec3(energy + 0.5, 1, 1)), 1);
-
-    if (SIGINJECT_TRIGGER("cube_wreath_texture_enable")) {
-      texture_trigger_ = !texture_trigger_;
-    }
-
-    outline_model_->Draw({
+        cube_rotation;
+    cube_instances_.push_back({
         .model_transform = model_transform,
         .color_a = color_a,
         .color_b = color_b,
-        .render_target = back_render_target_,
-        .alpha = 1,
-        .energy = energy,
-        .blend_coeff = texture_trigger_ ? 0.3f : 0.0f,
-        .model_to_draw = InterpolateEnum<OutlineModel::ModelToDraw>(
-            std::fmod(energy, 1.0f)),
     });
   }
+
+  cube_params_ = {
+      .render_target = back_render_target_,
+      .alpha = 1,
+      .energy = energy,
+      .blend_coeff = texture_trigger_ ? 0.3f : 0.0f,
+      .model_to_draw =
+          InterpolateEnum<OutlineModel::ModelToDraw>(std::fmod(energy, 1.0f)),
+  };
 }
 
-void CubeWreath::OnDrawFrame(
-    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
-    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
-  float energy = state->energy();
-  float power = state->power();
+void CubeWreath::OnUpdate(const GlobalState& state, float dt) {
+  float energy = state.energy();
+  float power = state.power();
 
   glm::vec3 zoom_vec =
       glm::vec3(UnitVectorAtAngle(energy * 2) *
@@ -166,16 +164,49 @@ void CubeWreath::OnDrawFrame(
 
   int num_cubes = SIGINJECT_OVERRIDE("cube_wreath_num_cubes", 16, 0, 32);
 
+  UpdateCubes(power, energy, cube_orient_vec, num_cubes);
+
+  background_hue_ +=
+      power *
+      SIGINJECT_OVERRIDE("cube_wreath_border_hue_coeff", 0.1f, 0.0f, 0.5f);
+  warp_params_ = {
+      .power = power,
+      .energy = energy,
+      .zoom_speed = zoom_speed,
+      .zoom_vec = zoom_vec,
+      .border_color = glm::vec4(
+          HsvToRgb(glm::vec3(
+              background_hue_, 1,
+              SIGINJECT_OVERRIDE("cube_wreath_border_value_coeff", 1.0f, 0.0f,
+                                 1.0f))),
+          1),
+  };
+}
+
+void CubeWreath::OnDrawFrame(
+    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
+    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
+  // The depth target is only read within this frame, so it is leased from the
+  // pool shared with the other presets in the blend. Nothing uses stencil, so
+  // its depth is 16-bit.
+  std::shared_ptr<gl::GlRenderTarget> depth_output_target =
+      LeaseScratchRenderTarget({.enable_depth = true,
+                                .depth_format = gl::GlDepthFormat::kDepth16});
+  if (depth_output_target == nullptr) {
+    return;
+  }
+
   {
-    auto depth_output_activation = depth_output_target_->Activate();
+    auto depth_output_activation = depth_output_target->Activate();
 
-    glViewport(0, 0, longer_dimension(), longer_dimension());
+    gl::GlStateCache::Current().Viewport(0, 0, longer_dimension(),
+                                         longer_dimension());
     glClearColor(0, 0, 0, 0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glDepthRange(0, 10);
-    glEnable(GL_DEPTH_TEST);
-    DrawCubes(power, energy, cube_orient_vec, num_cubes);
-    glDisable(GL_DEPTH_TEST);
+    gl::GlStateCache::Current().Enable(GL_DEPTH_TEST);
+    outline_model_->DrawInstanced(cube_params_, cube_instances_);
+    gl::GlStateCache::Current().Disable(GL_DEPTH_TEST);
   }
 
   {
@@ -184,28 +215,21 @@ void CubeWreath::OnDrawFrame(
     auto program_activation = warp_program_->Activate();
 
     GlBindUniform(warp_program_, "frame_size", glm::ivec2(width(), height()));
-    GlBindUniform(warp_program_, "power", power);
-    GlBindUniform(warp_program_, "energy", energy);
-    GlBindUniform(warp_program_, "zoom_vec", zoom_vec);
-    GlBindUniform(warp_program_, "zoom_speed", zoom_speed);
+    GlBindUniform(warp_program_, "power", warp_params_.power);
+    GlBindUniform(warp_program_, "energy", warp_params_.energy);
+    GlBindUniform(warp_program_, "zoom_vec", warp_params_.zoom_vec);
+    GlBindUniform(warp_program_, "zoom_speed", warp_params_.zoom_speed);
     GlBindUniform(warp_program_, "model_transform", glm::mat4(1.0f));
     auto binding_options = gl::GlTextureBindingOptions();
-
-    background_hue_ +=
-        power *
-        SIGINJECT_OVERRIDE("cube_wreath_border_hue_coeff", 0.1f, 0.0f, 0.5f);
-    binding_options.border_color = glm::vec4(
-        HsvToRgb(glm::vec3(background_hue_, 1,
-                           SIGINJECT_OVERRIDE("cube_wreath_border_value_coeff",
-                                              1.0f, 0.0f, 1.0f))),
-        1);
+    binding_options.border_color = warp_params_.border_color;
     binding_options.sampling_mode = gl::GlTextureSamplingMode::kClampToBorder;
     GlBindRenderTargetTextureToUniform(warp_program_, "last_frame",
                                        back_render_target_, binding_options);
     GlBindRenderTargetTextureToUniform(warp_program_, "input",
-                                       depth_output_target_, binding_options);
+                                       depth_output_target, binding_options);
 
-    glViewport(0, 0, longer_dimension(), longer_dimension());
+    gl::GlStateCache::Current().Viewport(0, 0, longer_dimension(),
+                                         longer_dimension());
     rectangle_.Draw();
   }
 
@@ -227,4 +251,13 @@ void CubeWreath::OnDrawFrame(
   }
 }
 
+namespace {
+const PresetRegistration<CubeWreath> kRegistration(
+    {.name = "CubeWreath",
+     .poolable = true,
+     .tags = {"3d", "feedback"},
+     .max_count = 1,
+     .cost = 5});
+}  // namespace
+
 }  // namespace opendrop
@@ -31,18 +31,31 @@ class CubeWreath : public Preset {
              std::shared_ptr<gl::GlRenderTarget> model_texture_target,
              std::shared_ptr<gl::GlRenderTarget> front_render_target,
              std::shared_ptr<gl::GlRenderTarget> back_render_target,
-             std::shared_ptr<gl::GlRenderTarget> depth_output_target,
              std::shared_ptr<OutlineModel> outline_model,
              std::shared_ptr<gl::GlTextureManager> texture_manager);
 
+  void OnUpdate(const GlobalState& state, float dt) override;
   void OnDrawFrame(
       absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
       float alpha,
       std::shared_ptr<gl::GlRenderTarget> output_render_target) override;
   void OnUpdateGeometry() override;
+  void OnReset() override;
 
  private:
-  void DrawCubes(float power, float energy, glm::vec3 zoom_vec, int num_cubes);
+  // Parameters of the warp shader.
+  struct WarpParams {
+    float power = 0.0f;
+    float energy = 0.0f;
+    float zoom_speed = 1.0f;
+    glm::vec3 zoom_vec = glm::vec3(0.0f);
+    glm::vec4 border_color = glm::vec4(0.0f);
+  };
+
+  // Computes the parameters shared by the cubes of the next frame into
+  // `cube_params_`, and the placement of each cube into `cube_instances_`.
+  void UpdateCubes(float power, float energy, glm::vec3 zoom_vec,
+                   int num_cubes);
 
   std::shared_ptr<gl::GlProgram> warp_program_;
   std::shared_ptr<gl::GlProgram> composite_program_;
@@ -50,9 +63,13 @@ class CubeWreath : public Preset {
   std::shared_ptr<gl::GlRenderTarget> model_texture_target_;
   std::shared_ptr<gl::GlRenderTarget> front_render_target_;
   std::shared_ptr<gl::GlRenderTarget> back_render_target_;
-  std::shared_ptr<gl::GlRenderTarget> depth_output_target_;
   std::shared_ptr<OutlineModel> outline_model_;
 
+  // Frame state prepared by `OnUpdate` for the next `OnDrawFrame`.
+  OutlineModel::Params cube_params_;
+  std::vector<OutlineModel::Instance> cube_instances_;
+  WarpParams warp_params_;
+
   std::vector<glm::vec2> vertices_;
   Rectangle rectangle_;
   Polyline polyline_;
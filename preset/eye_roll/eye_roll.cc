@@ -9,9 +9,11 @@
 #include "preset/eye_roll/ngon.fsh.h"
 #include "preset/eye_roll/passthrough.vsh.h"
 #include "preset/eye_roll/warp.fsh.h"
+#include "preset/preset_registry.h"
 #include "util/math/coefficients.h"
 #include "util/graphics/colors.h"
 #include "third_party/gl_helper.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "third_party/glm_helper.h"
 #include "util/logging/logging.h"
@@ -80,13 +82,9 @@ absl::StatusOr<std::shared_ptr<Preset>> EyeRoll::MakeShared(
 }
 
 void EyeRoll::OnUpdateGeometry() {
-  glViewport(0, 0, width(), height());
-  if (front_render_target_ != nullptr) {
-    front_render_target_->UpdateGeometry(width(), height());
-  }
-  if (back_render_target_ != nullptr) {
-    back_render_target_->UpdateGeometry(width(), height());
-  }
+  ResizeRenderTarget(&front_render_target_, width(), height());
+  ResizeRenderTarget(&back_render_target_, width(), height());
+  gl::GlStateCache::Current().Viewport(0, 0, width(), height());
 }
 
 void EyeRoll::DrawEye(glm::vec2 center, float scale, float scale_coeff,
@@ -109,56 +107,87 @@ void EyeRoll::DrawEye(glm::vec2 center, float scale, float scale_coeff,
   ngon_.Draw();
 }
 
-void EyeRoll::OnDrawFrame(
-    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
-    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
+void EyeRoll::OnUpdate(const GlobalState& state, float dt) {
   if (bass_filter_ == nullptr) {
     // TODO: Refactor into constructor. Plumb GlobalState.
-    bass_filter_ = IirBandFilter(30.0f / state->sampling_rate(),
-                                 20.0f / state->sampling_rate(),
+    bass_filter_ = IirBandFilter(30.0f / state.sampling_rate(),
+                                 20.0f / state.sampling_rate(),
                                  IirBandFilterType::kBandpass);
     bass_power_filter_ = std::make_shared<HystereticMapFilter>(
-        IirSinglePoleFilter(1.0f / state->sampling_rate(),
+        IirSinglePoleFilter(1.0f / state.sampling_rate(),
                             IirSinglePoleFilterType::kLowpass),
         0.999f);
     // TODO: Refactor into constructor. Plumb GlobalState.
-    treble_filter_ = IirBandFilter(600.0f / state->sampling_rate(),
-                                   100.0f / state->sampling_rate(),
+    treble_filter_ = IirBandFilter(600.0f / state.sampling_rate(),
+                                   100.0f / state.sampling_rate(),
                                    IirBandFilterType::kBandpass);
     treble_power_filter_ = std::make_shared<HystereticMapFilter>(
-        IirSinglePoleFilter(1.0f / state->sampling_rate(),
+        IirSinglePoleFilter(1.0f / state.sampling_rate(),
                             IirSinglePoleFilterType::kLowpass),
         0.999f);
   }
-  float energy = state->energy();
-  float power = state->power();
+  float energy = state.energy();
+  float power = state.power();
 
-  line_energy_ += sin(energy * 5) * sin(energy * 17) * 10 * state->dt();
+  line_energy_ += sin(energy * 5) * sin(energy * 17) * 10 * dt;
 
-  const float bass_power = bass_filter_->ComputePower(state->left_channel());
+  const float bass_power = bass_filter_->ComputePower(state.left_channel());
   const float mapped_bass_power = bass_power_filter_->ProcessSample(bass_power);
-  const float treble_power =
-      treble_filter_->ComputePower(state->left_channel());
+  const float treble_power = treble_filter_->ComputePower(state.left_channel());
   const float mapped_treble_power =
       treble_power_filter_->ProcessSample(treble_power);
 
-  rotary_velocity_l_ += mapped_treble_power * 50 * state->dt() *
-                        sin(energy * 3.15) * sin(energy * 8.75);
+  rotary_velocity_l_ += mapped_treble_power * 50 * dt * sin(energy * 3.15) *
+                        sin(energy * 8.75);
   rotary_velocity_l_ *= 0.9;
-  rotary_velocity_r_ += mapped_treble_power * 50 * state->dt() *
-                        sin(energy * 3.51) * sin(energy * 8.57);
+  rotary_velocity_r_ += mapped_treble_power * 50 * dt * sin(energy * 3.51) *
+                        sin(energy * 8.57);
   rotary_velocity_r_ *= 0.9;
 
-  eye_angle_l_ += rotary_velocity_l_ * state->dt();
-  eye_angle_r_ += rotary_velocity_r_ * state->dt();
+  eye_angle_l_ += rotary_velocity_l_ * dt;
+  eye_angle_r_ += rotary_velocity_r_ * dt;
 
-  line_points_.resize(state->left_channel().size());
-  for (int i = 0; i < state->left_channel().size(); ++i) {
+  line_points_.resize(state.left_channel().size());
+  for (int i = 0; i < state.left_channel().size(); ++i) {
     line_points_[i] = {
-        MapValue<float>(i, 0, state->left_channel().size() - 1, -1, 1),
-        state->left_channel()[i] / 10};
+        MapValue<float>(i, 0, state.left_channel().size() - 1, -1, 1),
+        state.left_channel()[i] / 10};
   }
 
+  power_ = power;
+  energy_ = energy;
+  mapped_bass_power_ = mapped_bass_power;
+  left_eyelid_pos_ = SineEase(left_eye_tweener_.Value(state.t()));
+  right_eyelid_pos_ = SineEase(right_eye_tweener_.Value(state.t()));
+
+  if (blink_event_.IsDue(state.t())) {
+    left_eye_tweener_.Start(state.t());
+    right_eye_tweener_.Start(state.t());
+  }
+  if (wink_event_.IsDue(state.t())) {
+    if (Coefficients::Random<1>(-1, 1)[0] < 0) {
+      left_eye_tweener_.Start(state.t());
+    } else {
+      right_eye_tweener_.Start(state.t());
+    }
+  }
+  if constexpr (kEnableWinkDebugging) {
+    LOG(INFO) << absl::StrFormat(
+        "Blink: %1.3f, Wink: %1.3f (L: %1.3f, R: %1.3f)",
+        blink_event_.oneshot().FractionDue(state.t()),
+        wink_event_.oneshot().FractionDue(state.t()),
+        left_eye_tweener_.Value(state.t()),
+        right_eye_tweener_.Value(state.t()));
+  }
+}
+
+void EyeRoll::OnDrawFrame(
+    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
+    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
+  const float energy = energy_;
+  const float power = power_;
+  const float mapped_bass_power = mapped_bass_power_;
+
   {
     auto back_activation = back_render_target_->Activate();
 
@@ -219,38 +248,29 @@ void EyeRoll::OnDrawFrame(
                                        gl::GlTextureBindingOptions());
     GlBindUniform(composite_program_, "model_transform", glm::mat4(1.0f));
 
-    glViewport(0, 0, width(), height());
+    gl::GlStateCache::Current().Viewport(0, 0, width(), height());
     rectangle_.Draw();
 
     ngon_program_->Use();
-    glViewport(0, 0, width(), height());
+    gl::GlStateCache::Current().Viewport(0, 0, width(), height());
     DrawEye({-0.4583, -0.5936}, 0.4, mapped_bass_power, eye_angle_l_,
-            SineEase(left_eye_tweener_.Value(state->t())));
+            left_eyelid_pos_);
     DrawEye({0.4583, -0.5936}, 0.4, mapped_bass_power, eye_angle_r_,
-            SineEase(right_eye_tweener_.Value(state->t())));
+            right_eyelid_pos_);
   }
 
   back_render_target_->swap_texture_unit(front_render_target_.get());
-
-  if (blink_event_.IsDue(state->t())) {
-    left_eye_tweener_.Start(state->t());
-    right_eye_tweener_.Start(state->t());
-  }
-  if (wink_event_.IsDue(state->t())) {
-    if (Coefficients::Random<1>(-1, 1)[0] < 0) {
-      left_eye_tweener_.Start(state->t());
-    } else {
-      right_eye_tweener_.Start(state->t());
-    }
-  }
-  if constexpr (kEnableWinkDebugging) {
-    LOG(INFO) << absl::StrFormat(
-        "Blink: %1.3f, Wink: %1.3f (L: %1.3f, R: %1.3f)",
-        blink_event_.oneshot().FractionDue(state->t()),
-        wink_event_.oneshot().FractionDue(state->t()),
-        left_eye_tweener_.Value(state->t()),
-        right_eye_tweener_.Value(state->t()));
-  }
 }
 
+namespace {
+// Not in the default rotation; select with --playlist.
+const PresetRegistration<EyeRoll> kRegistration(
+    {.name = "EyeRoll",
+     .weight = 0.0f,
+     .tags = {"2d", "feedback"},
+     .max_count = 1,
+     .should_solo = true,
+     .cost = 2});
+}  // namespace
+
 }  // namespace opendrop
@@ -36,6 +36,7 @@ class EyeRoll : public Preset {
           std::shared_ptr<gl::GlRenderTarget> back_render_target,
           std::shared_ptr<gl::GlTextureManager> texture_manager, int n);
 
+  void OnUpdate(const GlobalState& state, float dt) override;
   void OnDrawFrame(
       absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
       float alpha,
@@ -67,6 +68,13 @@ class EyeRoll : public Preset {
 
   float line_energy_ = 0;
 
+  // Frame state prepared by `OnUpdate` for the next `OnDrawFrame`.
+  float power_ = 0;
+  float energy_ = 0;
+  float mapped_bass_power_ = 0;
+  float left_eyelid_pos_ = 0;
+  float right_eyelid_pos_ = 0;
+
   RandomEvent blink_event_;
   RandomEvent wink_event_;
   RampTweener left_eye_tweener_;
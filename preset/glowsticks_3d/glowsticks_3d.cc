@@ -9,8 +9,10 @@
 #include "preset/glowsticks_3d/passthrough.vsh.h"
 #include "preset/glowsticks_3d/ribbon.fsh.h"
 #include "preset/glowsticks_3d/warp.fsh.h"
+#include "preset/preset_registry.h"
 #include "third_party/gl_helper.h"
 #include "util/graphics/colors.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "util/logging/logging.h"
 #include "util/math/coefficients.h"
@@ -105,23 +107,18 @@ absl::StatusOr<std::shared_ptr<Preset>> Glowsticks3d::MakeShared(
 }
 
 void Glowsticks3d::OnUpdateGeometry() {
-  glViewport(0, 0, width(), height());
-
   const auto square_dimension = std::max(width(), height());
-  if (front_render_target_ != nullptr) {
-    front_render_target_->UpdateGeometry(square_dimension, square_dimension);
-  }
-  if (back_render_target_ != nullptr) {
-    back_render_target_->UpdateGeometry(square_dimension, square_dimension);
-  }
+  ResizeRenderTarget(&front_render_target_, square_dimension, square_dimension);
+  ResizeRenderTarget(&back_render_target_, square_dimension, square_dimension);
+  gl::GlStateCache::Current().Viewport(0, 0, width(), height());
 }
 
 void Glowsticks3d::UpdateArmatureSegmentAngles(
-    std::shared_ptr<GlobalState> state,
+    const GlobalState& state,
     std::array<Accumulator<float>, kNumSegments>* segment_angles) {
-  float average_power = state->average_power();
-  float energy = state->energy();
-  float power = state->power();
+  float average_power = state.average_power();
+  float energy = state.energy();
+  float power = state.power();
 
   for (int i = 0; i < segment_angles->size(); ++i) {
     (*segment_angles)[i] +=
@@ -131,10 +128,10 @@ void Glowsticks3d::UpdateArmatureSegmentAngles(
 }
 
 std::pair<glm::vec2, glm::vec2> Glowsticks3d::ComputeRibbonSegment(
-    std::shared_ptr<GlobalState> state,
+    const GlobalState& state,
     const std::array<float, kNumSegments> segment_angles,
     std::array<glm::vec2, kNumSegments + 1>* debug_segment_points) {
-  float energy = state->energy();
+  float energy = state.energy();
 
   constexpr float kRibbonSegmentOffset = 0.12f;
   std::array<glm::vec2, kNumSegments> segments;
@@ -145,7 +142,7 @@ std::pair<glm::vec2, glm::vec2> Glowsticks3d::ComputeRibbonSegment(
 
   float ribbon_width = 0.2 + 0.034 * sin(energy * 10);
   if (kEnableRibbonWidthPowerScaling) {
-    ribbon_width += state->power() / 10;
+    ribbon_width += state.power() / 10;
   }
 
   *debug_segment_points = {base_position_, base_position_ + segments[0],
@@ -159,14 +156,10 @@ std::pair<glm::vec2, glm::vec2> Glowsticks3d::ComputeRibbonSegment(
               segments[2] * (kRibbonSegmentOffset + ribbon_width)};
 }
 
-void Glowsticks3d::OnDrawFrame(
-    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
-    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
-  float average_power = state->average_power();
-  float normalized_energy = state->normalized_energy();
-  float power = state->power();
-
-  std::array<glm::vec2, 4> debug_segment_points;
+void Glowsticks3d::OnUpdate(const GlobalState& state, float dt) {
+  power_ = state.power();
+  normalized_power_ = SafeDivide(power_, state.average_power());
+  normalized_energy_ = state.normalized_energy();
 
   UpdateArmatureSegmentAngles(state, &segment_angle_accumulators_);
   // Determine how many steps to divide the arc into, by finding the minumum
@@ -197,7 +190,7 @@ void Glowsticks3d::OnDrawFrame(
     segment_angle_iterators_[i] = segment_angle_interpolators_[i].begin();
   }
 
-  flip_oneshot_.Update(state->dt());
+  flip_oneshot_.Update(dt);
 
   for (int i = 0; i < num_steps; ++i) {
     std::array<float, kNumSegments> segment_angles;
@@ -207,7 +200,7 @@ void Glowsticks3d::OnDrawFrame(
     }
 
     auto segment_2d =
-        ComputeRibbonSegment(state, segment_angles, &debug_segment_points);
+        ComputeRibbonSegment(state, segment_angles, &debug_segment_points_);
     std::pair<glm::vec3, glm::vec3> segment;
     segment.first = glm::vec3(segment_2d.first, 0.1);
     segment.second = glm::vec3(segment_2d.second, 0.1);
@@ -244,6 +237,19 @@ void Glowsticks3d::OnDrawFrame(
     ribbon2_.AppendSegment(segment);
   }
 
+  ribbon_.UpdateColor(
+      HsvToRgb(glm::vec3(normalized_energy_ * color_rate_coefficients_[0] +
+                             color_phase_coefficients_[0],
+                         1, 0.5)));
+  ribbon2_.UpdateColor(
+      HsvToRgb(glm::vec3(normalized_energy_ * color_rate_coefficients_[1] +
+                             color_phase_coefficients_[1],
+                         1, 0.5)));
+}
+
+void Glowsticks3d::OnDrawFrame(
+    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
+    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
   {
     auto back_activation = back_render_target_->Activate();
 
@@ -251,9 +257,8 @@ void Glowsticks3d::OnDrawFrame(
 
     GlBindUniform(warp_program_, "last_frame_size",
                   glm::ivec2(width(), height()));
-    GlBindUniform(warp_program_, "normalized_power",
-                  SafeDivide(power, average_power));
-    GlBindUniform(warp_program_, "normalized_energy", normalized_energy);
+    GlBindUniform(warp_program_, "normalized_power", normalized_power_);
+    GlBindUniform(warp_program_, "normalized_energy", normalized_energy_);
     GlBindUniform(warp_program_, "framerate_scale", kFramerateScale);
     GlBindRenderTargetTextureToUniform(
         warp_program_, "last_frame", front_render_target_,
@@ -265,21 +270,12 @@ void Glowsticks3d::OnDrawFrame(
     rectangle_.Draw();
 
     // Draw the waveform.
-    ribbon_.UpdateColor(
-        HsvToRgb(glm::vec3(normalized_energy * color_rate_coefficients_[0] +
-                               color_phase_coefficients_[0],
-                           1, 0.5)));
-    ribbon2_.UpdateColor(
-        HsvToRgb(glm::vec3(normalized_energy * color_rate_coefficients_[1] +
-                               color_phase_coefficients_[1],
-                           1, 0.5)));
-
-    glEnable(GL_DEPTH_TEST);
+    gl::GlStateCache::Current().Enable(GL_DEPTH_TEST);
     ribbon_.Draw();
     // TODO: Have the second ribbon split off of and rejoin the first ribbon at
     // intervals.
     ribbon2_.Draw();
-    glEnable(GL_DEPTH_TEST);
+    gl::GlStateCache::Current().Enable(GL_DEPTH_TEST);
   }
 
   {
@@ -288,8 +284,8 @@ void Glowsticks3d::OnDrawFrame(
 
     GlBindUniform(composite_program_, "render_target_size",
                   glm::ivec2(width(), height()));
-    GlBindUniform(composite_program_, "power", power);
-    GlBindUniform(composite_program_, "normalized_energy", normalized_energy);
+    GlBindUniform(composite_program_, "power", power_);
+    GlBindUniform(composite_program_, "normalized_energy", normalized_energy_);
     GlBindUniform(composite_program_, "alpha", alpha);
     GlBindRenderTargetTextureToUniform(composite_program_, "render_target",
                                        back_render_target_,
@@ -298,11 +294,12 @@ void Glowsticks3d::OnDrawFrame(
     const auto square_dimension = std::max(width(), height());
     const int offset_x = -(square_dimension - width()) / 2;
     const int offset_y = -(square_dimension - height()) / 2;
-    glViewport(offset_x, offset_y, square_dimension, square_dimension);
+    gl::GlStateCache::Current().Viewport(offset_x, offset_y, square_dimension,
+                                         square_dimension);
     rectangle_.Draw();
 
     if (kDrawDebugSegments) {
-      debug_segments_.UpdateVertices(debug_segment_points);
+      debug_segments_.UpdateVertices(debug_segment_points_);
       debug_segments_.UpdateColor(glm::vec3(1, 1, 1));
       debug_segments_.UpdateWidth(1);
       debug_segments_.Draw();
@@ -312,4 +309,13 @@ void Glowsticks3d::OnDrawFrame(
   }
 }
 
+namespace {
+// Not in the default rotation; select with --playlist.
+const PresetRegistration<Glowsticks3d> kRegistration(
+    {.name = "Glowsticks3d",
+     .weight = 0.0f,
+     .tags = {"3d", "feedback"},
+     .cost = 2});
+}  // namespace
+
 }  // namespace opendrop
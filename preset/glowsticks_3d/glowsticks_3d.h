@@ -32,6 +32,7 @@ class Glowsticks3d : public Preset {
                std::shared_ptr<gl::GlRenderTarget> back_render_target,
                std::shared_ptr<gl::GlTextureManager> texture_manager);
 
+  void OnUpdate(const GlobalState& state, float dt) override;
   void OnDrawFrame(
       absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
       float alpha,
@@ -45,7 +46,7 @@ class Glowsticks3d : public Preset {
   // Updates the angles of the rotating armatures that describe the motion of
   // the ribbon from the state for the current frame.
   void UpdateArmatureSegmentAngles(
-      std::shared_ptr<GlobalState> state,
+      const GlobalState& state,
       std::array<Accumulator<float>, kNumSegments>* segment_angles);
 
   // Computes a new segment of the ribbon based upon the state for the current
@@ -53,7 +54,7 @@ class Glowsticks3d : public Preset {
   // `debug_segment_points` that can be used to render a visualization of the
   // rotating armatures.
   std::pair<glm::vec2, glm::vec2> ComputeRibbonSegment(
-      std::shared_ptr<GlobalState> state,
+      const GlobalState& state,
       const std::array<float, kNumSegments> segment_angles,
       std::array<glm::vec2, kNumSegments + 1>* debug_segment_points);
 
@@ -81,6 +82,12 @@ class Glowsticks3d : public Preset {
   Polyline debug_segments_;
   bool flip_y_;
   OneshotIncremental<float> flip_oneshot_;
+
+  // Frame state prepared by `OnUpdate` for the next `OnDrawFrame`.
+  float power_ = 0.0f;
+  float normalized_power_ = 0.0f;
+  float normalized_energy_ = 0.0f;
+  std::array<glm::vec2, kNumSegments + 1> debug_segment_points_;
 };
 
 }  // namespace opendrop
@@ -13,9 +13,11 @@
 #include "preset/glowsticks_3d_zoom/passthrough.vsh.h"
 #include "preset/glowsticks_3d_zoom/ribbon.fsh.h"
 #include "preset/glowsticks_3d_zoom/warp.fsh.h"
+#include "preset/preset_registry.h"
 #include "third_party/gl_helper.h"
 #include "third_party/glm_helper.h"
 #include "util/graphics/colors.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "util/logging/logging.h"
 #include "util/math/coefficients.h"
@@ -106,23 +108,30 @@ absl::StatusOr<std::shared_ptr<Preset>> Glowsticks3dZoom::MakeShared(
 }
 
 void Glowsticks3dZoom::OnUpdateGeometry() {
-  glViewport(0, 0, width(), height());
-
   const auto square_dimension = std::max(width(), height());
-  if (front_render_target_ != nullptr) {
-    front_render_target_->UpdateGeometry(square_dimension, square_dimension);
-  }
-  if (back_render_target_ != nullptr) {
-    back_render_target_->UpdateGeometry(square_dimension, square_dimension);
-  }
+  ResizeRenderTarget(&front_render_target_, square_dimension, square_dimension);
+  ResizeRenderTarget(&back_render_target_, square_dimension, square_dimension);
+  gl::GlStateCache::Current().Viewport(0, 0, width(), height());
+}
+
+void Glowsticks3dZoom::OnReset() {
+  ClearRenderTarget(front_render_target_);
+  ClearRenderTarget(back_render_target_);
+  segment_angle_accumulators_ = {};
+  ribbon_ = Ribbon<glm::vec3>(glm::vec3(), kRibbonSegmentCount);
+  ribbon2_ = Ribbon<glm::vec3>(glm::vec3(), kRibbonSegmentCount);
+  flip_y_ = false;
+  flip_oneshot_.Reset();
+  zoom_angle_ = 0;
+  frame_params_ = FrameParams();
 }
 
 void Glowsticks3dZoom::UpdateArmatureSegmentAngles(
-    std::shared_ptr<GlobalState> state,
+    const GlobalState& state,
     std::array<Accumulator<float>, kNumSegments>* segment_angles) {
-  float average_power = state->average_power();
-  float energy = state->energy();
-  float power = state->power();
+  float average_power = state.average_power();
+  float energy = state.energy();
+  float power = state.power();
 
   for (int i = 0; i < segment_angles->size(); ++i) {
     (*segment_angles)[i] += rotational_rate_coefficients_[i] *
@@ -132,10 +141,10 @@ void Glowsticks3dZoom::UpdateArmatureSegmentAngles(
 }
 
 std::pair<glm::vec2, glm::vec2> Glowsticks3dZoom::ComputeRibbonSegment(
-    std::shared_ptr<GlobalState> state,
+    const GlobalState& state,
     const std::array<float, kNumSegments> segment_angles,
     std::array<glm::vec2, kNumSegments + 1>* debug_segment_points) {
-  float energy = state->energy();
+  float energy = state.energy();
 
   constexpr float kRibbonSegmentOffset = 0.12f;
   std::array<glm::vec2, kNumSegments> segments;
@@ -146,7 +155,7 @@ std::pair<glm::vec2, glm::vec2> Glowsticks3dZoom::ComputeRibbonSegment(
 
   float ribbon_width = 0.1 + 0.034 * sin(energy * 10);
   if (kEnableRibbonWidthPowerScaling) {
-    ribbon_width += state->power() / 10;
+    ribbon_width += state.power() / 10;
   }
 
   *debug_segment_points = {base_position_, base_position_ + segments[0],
@@ -160,14 +169,8 @@ std::pair<glm::vec2, glm::vec2> Glowsticks3dZoom::ComputeRibbonSegment(
               segments[2] * (kRibbonSegmentOffset + ribbon_width)};
 }
 
-void Glowsticks3dZoom::OnDrawFrame(
-    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
-    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
-  float energy = state->energy();
-  float normalized_energy = state->normalized_energy();
-  float power = state->power();
-
-  std::array<glm::vec2, 4> debug_segment_points;
+void Glowsticks3dZoom::OnUpdate(const GlobalState& state, float dt) {
+  float energy = state.energy();
 
   UpdateArmatureSegmentAngles(state, &segment_angle_accumulators_);
   // Determine how many steps to divide the arc into, by finding the minumum
@@ -198,7 +201,7 @@ void Glowsticks3dZoom::OnDrawFrame(
     segment_angle_iterators_[i] = segment_angle_interpolators_[i].begin();
   }
 
-  flip_oneshot_.Update(state->dt());
+  flip_oneshot_.Update(dt);
 
   for (int i = 0; i < num_steps; ++i) {
     std::array<float, kNumSegments> segment_angles;
@@ -208,7 +211,8 @@ void Glowsticks3dZoom::OnDrawFrame(
     }
 
     auto segment_2d =
-        ComputeRibbonSegment(state, segment_angles, &debug_segment_points);
+        ComputeRibbonSegment(state, segment_angles,
+                             &frame_params_.debug_segment_points);
     std::pair<glm::vec3, glm::vec3> segment;
     segment.first = glm::vec3(segment_2d.first, 0.1);
     segment.second = glm::vec3(segment_2d.second, 0.1);
@@ -248,37 +252,61 @@ void Glowsticks3dZoom::OnDrawFrame(
   float zoom_speed =
       SIGPLOT("zoom_speed",
               SIGINJECT_OVERRIDE("glowsticks_zoom_speed",
-                                 1.05f + state->bass() / 10, 0.95f, 1.15f));
+                                 1.05f + state.bass() / 10, 0.95f, 1.15f));
 
-  zoom_angle_ += sin(state->bass_energy() * state->dt() * 10) * state->bass() *
-                 state->dt() * 10;
+  zoom_angle_ += sin(state.bass_energy() * dt * 10) * state.bass() * dt * 10;
 
   glm::vec2 zoom_vec = -UnitVectorAtAngle(zoom_angle_) *
                        static_cast<float>(1.5f + sin(energy * 3.0f));
 
+  glm::vec3 look_vec_3d(zoom_vec / 2.0f, zoom_speed);
+  glm::vec3 axis = glm::cross(glm::vec3(0, 0, 1), look_vec_3d);
+  float angle = glm::angle(glm::vec3(0, 0, 1), glm::normalize(look_vec_3d));
+
+  ribbon_.UpdateColor(
+      HsvToRgb(glm::vec3(energy * color_coefficients_[0], 1, 0.5)));
+  ribbon2_.UpdateColor(
+      HsvToRgb(glm::vec3(energy * color_coefficients_[1], 1, 0.5)));
+
+  frame_params_.ribbon_transform =
+      glm::rotate(angle, glm::normalize(axis)) *
+      glm::rotate(zoom_angle_ * -2, glm::vec3(0, 0, 1));
+  frame_params_.zoom_vec = zoom_vec;
+  frame_params_.zoom_speed = zoom_speed;
+  frame_params_.bass = state.bass();
+  frame_params_.bass_energy = state.bass_energy();
+  frame_params_.power = state.power();
+  frame_params_.normalized_energy = state.normalized_energy();
+  frame_params_.framerate_scale = dt * 5;
+  frame_params_.border_color = glm::vec4(
+      HsvToRgb({state.bass_energy() *
+                    SIGINJECT_OVERRIDE("glowsticks_border_hue_coeff", 2.0f,
+                                       0.0f, 10.0f),
+                1,
+                std::clamp(state.bass() *
+                               SIGINJECT_OVERRIDE(
+                                   "glowsticks_border_value_coeff", 2.0f,
+                                   0.0f, 10.0f),
+                           0.0f, 1.0f)}),
+      0.5);
+}
+
+void Glowsticks3dZoom::OnDrawFrame(
+    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
+    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
   {
     auto front_activation = front_render_target_->Activate();
     ribbon_program_->Use();
 
-    glm::vec3 look_vec_3d(zoom_vec / 2.0f, zoom_speed);
-    glm::vec3 axis = glm::cross(glm::vec3(0, 0, 1), look_vec_3d);
-    float angle = glm::angle(glm::vec3(0, 0, 1), glm::normalize(look_vec_3d));
-
     // Draw the waveform.
-    ribbon_.UpdateColor(
-        HsvToRgb(glm::vec3(energy * color_coefficients_[0], 1, 0.5)));
-    ribbon2_.UpdateColor(
-        HsvToRgb(glm::vec3(energy * color_coefficients_[1], 1, 0.5)));
-
-    glm::mat4 rotation = glm::rotate(angle, glm::normalize(axis)) *
-                         glm::rotate(zoom_angle_ * -2, glm::vec3(0, 0, 1));
-    GlBindUniform(ribbon_program_, "model_transform", rotation);
-    glEnable(GL_DEPTH_TEST);
+    GlBindUniform(ribbon_program_, "model_transform",
+                  frame_params_.ribbon_transform);
+    gl::GlStateCache::Current().Enable(GL_DEPTH_TEST);
     ribbon_.Draw();
     // TODO: Have the second ribbon split off of and rejoin the first ribbon at
     // intervals.
     ribbon2_.Draw();
-    glDisable(GL_DEPTH_TEST);
+    gl::GlStateCache::Current().Disable(GL_DEPTH_TEST);
   }
 
   {
@@ -288,27 +316,18 @@ void Glowsticks3dZoom::OnDrawFrame(
 
     GlBindUniform(warp_program_, "last_frame_size",
                   glm::ivec2(width(), height()));
-    GlBindUniform(warp_program_, "power", state->bass());
-    GlBindUniform(warp_program_, "energy", state->bass_energy());
-    GlBindUniform(warp_program_, "zoom_vec", zoom_vec);
-    GlBindUniform(warp_program_, "zoom_speed", zoom_speed);
-    GlBindUniform(warp_program_, "framerate_scale", state->dt() * 5);
+    GlBindUniform(warp_program_, "power", frame_params_.bass);
+    GlBindUniform(warp_program_, "energy", frame_params_.bass_energy);
+    GlBindUniform(warp_program_, "zoom_vec", frame_params_.zoom_vec);
+    GlBindUniform(warp_program_, "zoom_speed", frame_params_.zoom_speed);
+    GlBindUniform(warp_program_, "framerate_scale",
+                  frame_params_.framerate_scale);
     GlBindUniform(warp_program_, "model_transform", glm::mat4(1.0f));
     GlBindRenderTargetTextureToUniform(
         warp_program_, "last_frame", front_render_target_,
         gl::GlTextureBindingOptions(
             {.sampling_mode = gl::GlTextureSamplingMode::kClampToBorder,
-             .border_color = glm::vec4(
-                 HsvToRgb({state->bass_energy() *
-                               SIGINJECT_OVERRIDE("glowsticks_border_hue_coeff",
-                                                  2.0f, 0.0f, 10.0f),
-                           1,
-                           std::clamp(state->bass() *
-                                          SIGINJECT_OVERRIDE(
-                                              "glowsticks_border_value_coeff",
-                                              2.0f, 0.0f, 10.0f),
-                                      0.0f, 1.0f)}),
-                 0.5)}));
+             .border_color = frame_params_.border_color}));
 
     // Force all fragments to draw with a full-screen rectangle.
     rectangle_.Draw();
@@ -320,8 +339,9 @@ void Glowsticks3dZoom::OnDrawFrame(
 
     GlBindUniform(composite_program_, "render_target_size",
                   glm::ivec2(width(), height()));
-    GlBindUniform(composite_program_, "power", power);
-    GlBindUniform(composite_program_, "normalized_energy", normalized_energy);
+    GlBindUniform(composite_program_, "power", frame_params_.power);
+    GlBindUniform(composite_program_, "normalized_energy",
+                  frame_params_.normalized_energy);
     GlBindUniform(composite_program_, "alpha", 1.0f);
     GlBindRenderTargetTextureToUniform(composite_program_, "render_target",
                                        front_render_target_,
@@ -330,11 +350,12 @@ void Glowsticks3dZoom::OnDrawFrame(
     const auto square_dimension = std::max(width(), height());
     const int offset_x = -(square_dimension - width()) / 2;
     const int offset_y = -(square_dimension - height()) / 2;
-    glViewport(offset_x, offset_y, square_dimension, square_dimension);
+    gl::GlStateCache::Current().Viewport(offset_x, offset_y, square_dimension,
+                                         square_dimension);
     rectangle_.Draw();
 
     if (kDrawDebugSegments) {
-      debug_segments_.UpdateVertices(debug_segment_points);
+      debug_segments_.UpdateVertices(frame_params_.debug_segment_points);
       debug_segments_.UpdateColor(glm::vec3(1, 1, 1));
       debug_segments_.UpdateWidth(1);
       debug_segments_.Draw();
@@ -344,4 +365,12 @@ void Glowsticks3dZoom::OnDrawFrame(
   }
 }
 
+namespace {
+const PresetRegistration<Glowsticks3dZoom> kRegistration(
+    {.name = "Glowsticks3dZoom",
+     .poolable = true,
+     .tags = {"3d", "feedback"},
+     .cost = 3});
+}  // namespace
+
 }  // namespace opendrop
@@ -32,11 +32,13 @@ class Glowsticks3dZoom : public Preset {
                    std::shared_ptr<gl::GlRenderTarget> back_render_target,
                    std::shared_ptr<gl::GlTextureManager> texture_manager);
 
+  void OnUpdate(const GlobalState& state, float dt) override;
   void OnDrawFrame(
       absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
       float alpha,
       std::shared_ptr<gl::GlRenderTarget> output_render_target) override;
   void OnUpdateGeometry() override;
+  void OnReset() override;
 
  private:
   // Number of segments on the armature that describes the motion of the ribbon.
@@ -45,7 +47,7 @@ class Glowsticks3dZoom : public Preset {
   // Updates the angles of the rotating armatures that describe the motion of
   // the ribbon from the state for the current frame.
   void UpdateArmatureSegmentAngles(
-      std::shared_ptr<GlobalState> state,
+      const GlobalState& state,
       std::array<Accumulator<float>, kNumSegments>* segment_angles);
 
   // Computes a new segment of the ribbon based upon the state for the current
@@ -53,7 +55,7 @@ class Glowsticks3dZoom : public Preset {
   // `debug_segment_points` that can be used to render a visualization of the
   // rotating armatures.
   std::pair<glm::vec2, glm::vec2> ComputeRibbonSegment(
-      std::shared_ptr<GlobalState> state,
+      const GlobalState& state,
       const std::array<float, kNumSegments> segment_angles,
       std::array<glm::vec2, kNumSegments + 1>* debug_segment_points);
 
@@ -81,6 +83,23 @@ class Glowsticks3dZoom : public Preset {
   bool flip_y_;
   OneshotIncremental<float> flip_oneshot_;
   float zoom_angle_ = 0;
+
+  // Parameters of the next frame, computed by `OnUpdate`.
+  struct FrameParams {
+    glm::mat4 ribbon_transform = glm::mat4(1.0f);
+    glm::vec2 zoom_vec = glm::vec2(0.0f);
+    float zoom_speed = 1.0f;
+    float bass = 0.0f;
+    float bass_energy = 0.0f;
+    float power = 0.0f;
+    float normalized_energy = 0.0f;
+    float framerate_scale = 0.0f;
+    glm::vec4 border_color = glm::vec4(0.0f);
+    std::array<glm::vec2, kNumSegments + 1> debug_segment_points;
+  };
+
+  // Frame state prepared by `OnUpdate` for the next `OnDrawFrame`.
+  FrameParams frame_params_;
 };
 
 }  // namespace opendrop
@@ -10,6 +10,7 @@
 #include "preset/graph_preset/passthrough_vert.vsh.h"
 #include "preset/graph_preset/tile_frag.fsh.h"
 #include "preset/graph_preset/zoom_frag.fsh.h"
+#include "preset/preset_registry.h"
 #include "third_party/gl_helper.h"
 #include "third_party/glm_helper.h"
 #include "util/graph/graph.h"
@@ -21,6 +22,7 @@
 #include "util/graph/types/types.h"
 #include "util/graph/types/unitary.h"
 #include "util/graphics/colors.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "util/logging/logging.h"
 #include "util/math/coefficients.h"
@@ -328,7 +330,9 @@ absl::StatusOr<std::shared_ptr<Preset>> GraphPreset::MakeShared(
   return std::shared_ptr<GraphPreset>(new GraphPreset(texture_manager));
 }
 
-void GraphPreset::OnUpdateGeometry() { glViewport(0, 0, width(), height()); }
+void GraphPreset::OnUpdateGeometry() {
+  gl::GlStateCache::Current().Viewport(0, 0, width(), height());
+}
 
 void GraphPreset::OnDrawFrame(
     absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
@@ -371,4 +375,13 @@ void GraphPreset::OnDrawFrame(
   ImGui::End();
 }
 
+namespace {
+// Not in the default rotation; select with --playlist.
+const PresetRegistration<GraphPreset> kRegistration(
+    {.name = "GraphPreset",
+     .weight = 0.0f,
+     .tags = {"experimental"},
+     .cost = 4});
+}  // namespace
+
 }  // namespace opendrop
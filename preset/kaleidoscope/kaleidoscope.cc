@@ -8,8 +8,10 @@
 #include "preset/kaleidoscope/passthrough.vsh.h"
 #include "preset/kaleidoscope/warp.fsh.h"
 #include "preset/kaleidoscope/waveform.fsh.h"
+#include "preset/preset_registry.h"
 #include "third_party/gl_helper.h"
 #include "util/graphics/colors.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "util/logging/logging.h"
 #include "util/math/math.h"
@@ -57,26 +59,83 @@ absl::StatusOr<std::shared_ptr<Preset>> Kaleidoscope::MakeShared(
 }
 
 void Kaleidoscope::OnUpdateGeometry() {
-  if (front_render_target_ != nullptr) {
-    front_render_target_->UpdateGeometry(longer_dimension(),
-                                         longer_dimension());
-  }
-  if (back_render_target_ != nullptr) {
-    back_render_target_->UpdateGeometry(longer_dimension(), longer_dimension());
+  ResizeRenderTarget(&front_render_target_, longer_dimension(),
+                     longer_dimension());
+  ResizeRenderTarget(&back_render_target_, longer_dimension(),
+                     longer_dimension());
+}
+
+void Kaleidoscope::OnReset() {
+  ClearRenderTarget(front_render_target_);
+  ClearRenderTarget(back_render_target_);
+  sample_rot_coeff_accum_ = 0.0f;
+  wiggle_accum_ = 0.0f;
+}
+
+void Kaleidoscope::OnUpdate(const GlobalState& state, float dt) {
+  float energy = state.energy() / 10;
+  float power = state.power();
+  float average_power = state.average_power();
+  float normalized_power = SafeDivide(power, average_power);
+
+  absl::Span<const float> left_channel = state.left_channel();
+  absl::Span<const float> right_channel = state.right_channel();
+
+  wiggle_accum_ += SIGINJECT_OVERRIDE("kaleidoscope_wiggle_coeff", sin(energy) / 10, 0.0f, 2.0f * power);
+
+  for (int j = 0; j < kNumRings; j++) {
+    std::vector<glm::vec2>& ring = rings_[j];
+    ring.resize(left_channel.size());
+    for (int i = 0; i < ring.size(); ++i) {
+      float c3 = cos(wiggle_accum_ * 10 + power * 2);
+      float s3 = sin(wiggle_accum_ * 10 + power * 2);
+      float x_int = left_channel[i] * kScaleFactor;
+      float y_int = right_channel[i] * kScaleFactor;
+
+      float x_pos = x_int * c3 - y_int * s3;
+      float y_pos = x_int * s3 + y_int * c3;
+
+      x_pos += cos(sin(2 * wiggle_accum_) * wiggle_accum_ * 10 / 1.25 + power) / 5;
+      x_pos += cos(sin(2 * wiggle_accum_) * wiggle_accum_ * 10 / 5.23 + 0.5) / 20;
+      y_pos += sin(sin(2 * wiggle_accum_) * wiggle_accum_ * 10 / 1.25 + power) / 5;
+      y_pos += sin(sin(2 * wiggle_accum_) * wiggle_accum_ * 10 / 5.23 + 0.5) / 20;
+
+      x_pos += cos(wiggle_accum_ / 10 + (j / 4.0 * kPi * 2)) / 2;
+      y_pos += sin(wiggle_accum_ / 10 + (j / 4.0 * kPi * 2)) / 2;
+
+      ring[i] = glm::vec2(x_pos, y_pos);
+    }
   }
+  line_width_ = std::clamp(normalized_power * 10.0f, 1.0f, 5.0f);
+  line_color_ = HsvToRgb(glm::vec3(wiggle_accum_ * 10, 1, 0.5));
+
+  warp_params_.blur_distance = SIGINJECT_OVERRIDE(
+      "kaleidoscope_blur_distance", 0.1f * sin(energy * 3), -0.1f, 0.1f);
+  warp_params_.warp_zoom_coeff =
+      SIGINJECT_OVERRIDE("kaleidoscope_warp_zoom_coeff",
+                         1.0f + 0.5f * sin(energy * 5), 0.95f, 1.05f);
+  warp_params_.warp_rot_coeff = SIGINJECT_OVERRIDE(
+      "kaleidoscope_warp_rot_coeff", 0.1f * sin(energy * 5), -0.1f, 0.1f);
+  warp_params_.sample_rot_coeff =
+      (sample_rot_coeff_accum_ += SIGINJECT_OVERRIDE(
+           "kaleidoscope_sample_rot_coeff", kPi * 2.0f * sin(energy * 5),
+           -kPi / 5.0f, kPi / 5.0f));
+  warp_params_.sample_scale_coeff = SIGINJECT_OVERRIDE(
+      "kaleidoscope_sample_scale_coeff", 0.5f * sin(energy * 5), -0.3f, 0.3f);
+  warp_params_.color_coeff = SIGINJECT_OVERRIDE(
+      "kaleidoscope_color_coeff", 1.0f + 0.1f * sin(energy * 10), 0.3f, 1.2f);
+  warp_params_.num_divisions = SIGINJECT_OVERRIDE(
+      "kaleidoscope_num_divisions",
+      1.0f + (UnitarySin(energy * 20.0f) * 5.0f), 1.0f, 6.0f);
+  warp_params_.blur_offset =
+      glm::vec2(1.0f, 1.0f) *
+      SIGINJECT_OVERRIDE("kaleidoscope_blur", UnitarySin(energy * 5) * 0.2f,
+                         0.0f, 0.3f);
 }
 
 void Kaleidoscope::OnDrawFrame(
     absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
     float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
-  float energy = state->energy() / 10;
-  float power = state->power();
-  float average_power = state->average_power();
-  float normalized_power = SafeDivide(power, average_power);
-
-  auto buffer_size = samples.size() / 2;
-  vertices_.resize(buffer_size);
-
   auto binding_options = gl::GlTextureBindingOptions();
   binding_options.sampling_mode = gl::GlTextureSamplingMode::kClampToBorder;
   binding_options.border_color = glm::vec4(0);
@@ -84,37 +143,16 @@ void Kaleidoscope::OnDrawFrame(
   {
     auto back_activation = back_render_target_->Activate();
     waveform_program_->Use();
-    glViewport(0, 0, longer_dimension(), longer_dimension());
+    gl::GlStateCache::Current().Viewport(0, 0, longer_dimension(),
+                                         longer_dimension());
 
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    wiggle_accum_ += SIGINJECT_OVERRIDE("kaleidoscope_wiggle_coeff", sin(energy) / 10, 0.0f, 2.0f * power);
-
-    for (int j = 0; j < 4; j++) {
-      for (int i = 0; i < buffer_size; ++i) {
-        float c3 = cos(wiggle_accum_ * 10 + power * 2);
-        float s3 = sin(wiggle_accum_ * 10 + power * 2);
-        float x_int = samples[i * 2] * kScaleFactor;
-        float y_int = samples[i * 2 + 1] * kScaleFactor;
-
-        float x_pos = x_int * c3 - y_int * s3;
-        float y_pos = x_int * s3 + y_int * c3;
-
-        x_pos += cos(sin(2 * wiggle_accum_) * wiggle_accum_ * 10 / 1.25 + power) / 5;
-        x_pos += cos(sin(2 * wiggle_accum_) * wiggle_accum_ * 10 / 5.23 + 0.5) / 20;
-        y_pos += sin(sin(2 * wiggle_accum_) * wiggle_accum_ * 10 / 1.25 + power) / 5;
-        y_pos += sin(sin(2 * wiggle_accum_) * wiggle_accum_ * 10 / 5.23 + 0.5) / 20;
-
-        x_pos += cos(wiggle_accum_ / 10 + (j / 4.0 * kPi * 2)) / 2;
-        y_pos += sin(wiggle_accum_ / 10 + (j / 4.0 * kPi * 2)) / 2;
-
-        vertices_[i] = glm::vec2(x_pos, y_pos);
-      }
-
-      polyline_.UpdateVertices(vertices_);
-      polyline_.UpdateWidth(std::clamp(normalized_power * 10.0f, 1.0f, 5.0f));
-      polyline_.UpdateColor(HsvToRgb(glm::vec3(wiggle_accum_ * 10, 1, 0.5)));
+    for (const std::vector<glm::vec2>& ring : rings_) {
+      polyline_.UpdateVertices(ring);
+      polyline_.UpdateWidth(line_width_);
+      polyline_.UpdateColor(line_color_);
       polyline_.Draw();
     }
   }
@@ -129,40 +167,20 @@ void Kaleidoscope::OnDrawFrame(
     GlBindRenderTargetTextureToUniform(warp_program_, "last_frame",
                                        back_render_target_, binding_options);
 
-    float blur_distance = SIGINJECT_OVERRIDE(
-        "kaleidoscope_blur_distance", 0.1f * sin(energy * 3), -0.1f, 0.1f);
-    float warp_zoom_coeff =
-        SIGINJECT_OVERRIDE("kaleidoscope_warp_zoom_coeff",
-                           1.0f + 0.5f * sin(energy * 5), 0.95f, 1.05f);
-    float warp_rot_coeff = SIGINJECT_OVERRIDE(
-        "kaleidoscope_warp_rot_coeff", 0.1f * sin(energy * 5), -0.1f, 0.1f);
-    float sample_rot_coeff =
-        (sample_rot_coeff_accum_ += SIGINJECT_OVERRIDE(
-             "kaleidoscope_sample_rot_coeff", kPi * 2.0f * sin(energy * 5),
-             -kPi / 5.0f, kPi / 5.0f));
-    float sample_scale_coeff = SIGINJECT_OVERRIDE(
-        "kaleidoscope_sample_scale_coeff", 0.5f * sin(energy * 5), -0.3f, 0.3f);
-    float color_coeff = SIGINJECT_OVERRIDE(
-        "kaleidoscope_color_coeff", 1.0f + 0.1f * sin(energy * 10), 0.3f, 1.2f);
-    int num_divisions = SIGINJECT_OVERRIDE(
-        "kaleidoscope_num_divisions",
-        1.0f + (UnitarySin(energy * 20.0f) * 5.0f), 1.0f, 6.0f);
-
-    glm::vec2 blur_offset =
-        glm::vec2(1.0f, 1.0f) *
-        SIGINJECT_OVERRIDE("kaleidoscope_blur", UnitarySin(energy * 5) * 0.2f,
-                           0.0f, 0.3f);
-
-    GL_BIND_LOCAL(warp_program_, blur_distance);
-    GL_BIND_LOCAL(warp_program_, warp_zoom_coeff);
-    GL_BIND_LOCAL(warp_program_, warp_rot_coeff);
-    GL_BIND_LOCAL(warp_program_, sample_rot_coeff);
-    GL_BIND_LOCAL(warp_program_, sample_scale_coeff);
-    GL_BIND_LOCAL(warp_program_, color_coeff);
-    GL_BIND_LOCAL(warp_program_, blur_offset);
-    GL_BIND_LOCAL(warp_program_, num_divisions);
-
-    glViewport(0, 0, longer_dimension(), longer_dimension());
+    GlBindUniform(warp_program_, "blur_distance", warp_params_.blur_distance);
+    GlBindUniform(warp_program_, "warp_zoom_coeff",
+                  warp_params_.warp_zoom_coeff);
+    GlBindUniform(warp_program_, "warp_rot_coeff", warp_params_.warp_rot_coeff);
+    GlBindUniform(warp_program_, "sample_rot_coeff",
+                  warp_params_.sample_rot_coeff);
+    GlBindUniform(warp_program_, "sample_scale_coeff",
+                  warp_params_.sample_scale_coeff);
+    GlBindUniform(warp_program_, "color_coeff", warp_params_.color_coeff);
+    GlBindUniform(warp_program_, "blur_offset", warp_params_.blur_offset);
+    GlBindUniform(warp_program_, "num_divisions", warp_params_.num_divisions);
+
+    gl::GlStateCache::Current().Viewport(0, 0, longer_dimension(),
+                                         longer_dimension());
     rectangle_.Draw();
   }
 
@@ -182,4 +200,12 @@ void Kaleidoscope::OnDrawFrame(
   }
 }
 
+namespace {
+const PresetRegistration<Kaleidoscope> kRegistration(
+    {.name = "Kaleidoscope",
+     .poolable = true,
+     .tags = {"2d", "feedback"},
+     .cost = 3});
+}  // namespace
+
 }  // namespace opendrop
@@ -1,6 +1,7 @@
 #ifndef PRESET_KALEIDOSCOPE_KALEIDOSCOPE_H_
 #define PRESET_KALEIDOSCOPE_KALEIDOSCOPE_H_
 
+#include <array>
 #include <vector>
 
 #include "absl/status/statusor.h"
@@ -30,11 +31,13 @@ class Kaleidoscope : public Preset {
                std::shared_ptr<gl::GlRenderTarget> back_render_target,
                std::shared_ptr<gl::GlTextureManager> texture_manager);
 
+  void OnUpdate(const GlobalState& state, float dt) override;
   void OnDrawFrame(
       absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
       float alpha,
       std::shared_ptr<gl::GlRenderTarget> output_render_target) override;
   void OnUpdateGeometry() override;
+  void OnReset() override;
 
  private:
   std::shared_ptr<gl::GlProgram> waveform_program_;
@@ -43,7 +46,26 @@ class Kaleidoscope : public Preset {
   std::shared_ptr<gl::GlRenderTarget> front_render_target_;
   std::shared_ptr<gl::GlRenderTarget> back_render_target_;
 
-  std::vector<glm::vec2> vertices_;
+  static constexpr int kNumRings = 4;
+
+  // Parameters of the warp shader.
+  struct WarpParams {
+    float blur_distance = 0.0f;
+    float warp_zoom_coeff = 1.0f;
+    float warp_rot_coeff = 0.0f;
+    float sample_rot_coeff = 0.0f;
+    float sample_scale_coeff = 0.0f;
+    float color_coeff = 1.0f;
+    glm::vec2 blur_offset = glm::vec2(0.0f);
+    int num_divisions = 1;
+  };
+
+  // Frame state prepared by `OnUpdate` for the next `OnDrawFrame`.
+  std::array<std::vector<glm::vec2>, kNumRings> rings_;
+  float line_width_ = 1.0f;
+  glm::vec3 line_color_ = glm::vec3(0.0f);
+  WarpParams warp_params_;
+
   Rectangle rectangle_;
   Polyline polyline_;
 
@@ -10,10 +10,13 @@
 #include "preset/pills/passthrough_frag.fsh.h"
 #include "preset/pills/passthrough_vert.vsh.h"
 #include "preset/pills/warp.fsh.h"
+#include "preset/preset_registry.h"
 #include "third_party/gl_helper.h"
 #include "third_party/glm_helper.h"
 #include "util/enums.h"
 #include "util/graphics/colors.h"
+#include "util/graphics/gl_render_graph.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "util/logging/logging.h"
 #include "util/math/math.h"
@@ -38,7 +41,6 @@ Pills::Pills(std::shared_ptr<gl::GlProgram> warp_program,
              std::shared_ptr<gl::GlRenderTarget> model_texture_target,
              std::shared_ptr<gl::GlRenderTarget> front_render_target,
              std::shared_ptr<gl::GlRenderTarget> back_render_target,
-             std::shared_ptr<gl::GlRenderTarget> depth_output_target,
              std::shared_ptr<OutlineModel> outline_model,
              std::shared_ptr<gl::GlTextureManager> texture_manager)
     : Preset(texture_manager),
@@ -48,7 +50,6 @@ Pills::Pills(std::shared_ptr<gl::GlProgram> warp_program,
       model_texture_target_(model_texture_target),
       front_render_target_(front_render_target),
       back_render_target_(back_render_target),
-      depth_output_target_(depth_output_target),
       outline_model_(outline_model)
 
 {}
@@ -68,39 +69,38 @@ absl::StatusOr<std::shared_ptr<Preset>> Pills::MakeShared(
                    gl::GlRenderTarget::MakeShared(0, 0, texture_manager));
   ASSIGN_OR_RETURN(auto back_render_target,
                    gl::GlRenderTarget::MakeShared(0, 0, texture_manager));
-  ASSIGN_OR_RETURN(auto depth_output_target,
-                   gl::GlRenderTarget::MakeShared(0, 0, texture_manager,
-                                                  {.enable_depth = true}));
   ASSIGN_OR_RETURN(auto outline_model, OutlineModel::MakeShared());
 
   return std::shared_ptr<Pills>(
       new Pills(warp_program, composite_program, passthrough_program, nullptr,
-                front_render_target, back_render_target, depth_output_target,
-                outline_model, texture_manager));
+                front_render_target, back_render_target, outline_model,
+                texture_manager));
 }
 
 void Pills::OnUpdateGeometry() {
-  glViewport(0, 0, width(), height());
-  if (model_texture_target_ != nullptr) {
-    model_texture_target_->UpdateGeometry(longer_dimension(),
-                                          longer_dimension());
-  }
-  if (front_render_target_ != nullptr) {
-    front_render_target_->UpdateGeometry(longer_dimension(),
-                                         longer_dimension());
-  }
-  if (back_render_target_ != nullptr) {
-    back_render_target_->UpdateGeometry(longer_dimension(), longer_dimension());
-  }
-  if (depth_output_target_ != nullptr) {
-    depth_output_target_->UpdateGeometry(longer_dimension(),
-                                         longer_dimension());
-  }
+  ResizeRenderTarget(&model_texture_target_, longer_dimension(),
+                     longer_dimension());
+  ResizeRenderTarget(&front_render_target_, longer_dimension(),
+                     longer_dimension());
+  ResizeRenderTarget(&back_render_target_, longer_dimension(),
+                     longer_dimension());
+  // The frame already prepared by `OnUpdate` must sample the resized target.
+  cube_params_.render_target = back_render_target_;
+  gl::GlStateCache::Current().Viewport(0, 0, width(), height());
 }
 
-void Pills::DrawCubes(float power, float bass, float energy, float dt,
-                      float time, float zoom_coeff, glm::vec3 zoom_vec,
-                      int num_cubes) {
+void Pills::OnReset() {
+  ClearRenderTarget(front_render_target_);
+  ClearRenderTarget(back_render_target_);
+  position_accum_ = 0.0f;
+  rot_arg_ = 0.0f;
+  texture_trigger_ = false;
+}
+
+void Pills::UpdateCubes(float power, float bass, float energy, float dt,
+                        float time, float zoom_coeff, glm::vec3 zoom_vec,
+                        int num_cubes) {
+  cube_instances_.clear();
   float cube_scale = SIGINJECT_OVERRIDE(
       "pills_model_scale",
       static_cast<float>(
@@ -121,6 +121,30 @@ void Pills::DrawCubes(float power, float bass, float energy, float dt,
   SIGPLOT_ON("cluster_scale", cluster_scale);
   SIGPLOT_ON("maybe_sign", Sign(cos(time / 3 * kPi)));
 
+  const glm::mat4 cube_rotation =
+      glm::rotate(glm::mat4(1.0f), rot_arg_ * 1.0f,
+                  glm::vec3(0.0f, 0.0f, 1.0f)) *
+      glm::rotate(glm::mat4(1.0f), rot_arg_ * 0.7f,
+                  glm::vec3(0.0f, 1.0f, 0.0f)) *
+      glm::rotate(glm::mat4(1.0f), rot_arg_ * 1.5f,
+                  glm::vec3(1.0f, 0.0f, 0.0f));
+  const glm::vec4 color_a = glm::vec4(HsvToRgb(glm::vec3(energy, 1, 1)), 1);
+  const glm::vec4 color_b =
+      glm::vec4(HsvToRgb(glm::vec3(energy + 0.5, 1, 1)), 1);
+
+  if (SIGINJECT_TRIGGER("pills_texture_enable")) {
+    texture_trigger_ = !texture_trigger_;
+  }
+
+  cube_params_ = {
+      .render_target = back_render_target_,
+      .alpha = 1,
+      .energy = energy,
+      .blend_coeff = texture_trigger_ ? 0.3f : 0.0f,
+      .model_to_draw =
+          InterpolateEnum<OutlineModel::ModelToDraw>(std::fmod(energy, 1.0f)),
+  };
+
   glm::mat4 model_transform;
   for (int i = 0; i < num_cubes; ++i) {
     float cluster_coeff = 0.0f;
@@ -163,45 +187,25 @@ void Pills::DrawCubes(float power, float bass, float energy, float dt,
                                   0, 0, cube_scale * 0.7, 0,  // Row 3
                                   0, 0, 0, 1                  // Row 4
                                   ) *
-                      glm::rotate(glm::mat4(1.0f), rot_arg_ * 1.0f,
-                                  glm::vec3(0.0f, 0.0f, 1.0f)) *
-                      glm::rotate(glm::mat4(1.0f), rot_arg_ * 0.7f,
-                                  glm::vec3(0.0f, 1.0f, 0.0f)) *
-                      glm::rotate(glm::mat4(1.0f), rot_arg_ * 1.5f,
-                                  glm::vec3(1.0f, 0.0f, 0.0f));
-    const glm::vec4 color_a = glm::vec4(HsvToRgb(glm::vec3(energy, 1, 1)), 1);
-    const glm::vec4 color_b =
-        glm::vec4(HsvToRgb(glm::vec3(energy + 0.5, 1, 1)), 1);
-
-    if (SIGINJECT_TRIGGER("pills_texture_enable")) {
-      texture_trigger_ = !texture_trigger_;
-    }
-
-    outline_model_->Draw({
+                      cube_rotation;
+
+    cube_instances_.push_back({
         .model_transform = model_transform,
         .color_a = color_a,
         .color_b = color_b,
-        .render_target = back_render_target_,
-        .alpha = 1,
-        .energy = energy,
-        .blend_coeff = texture_trigger_ ? 0.3f : 0.0f,
-        .model_to_draw =
-            InterpolateEnum<OutlineModel::ModelToDraw>(std::fmod(energy, 1.0f)),
     });
   }
 }
 
-void Pills::OnDrawFrame(
-    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
-    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
-  float bass = SIGPLOT("bass power", state->bass());
-  SIGPLOT("mid power", state->mid());
-  SIGPLOT("treble power", state->treble());
+void Pills::OnUpdate(const GlobalState& state, float dt) {
+  float bass = SIGPLOT("bass power", state.bass());
+  SIGPLOT("mid power", state.mid());
+  SIGPLOT("treble power", state.treble());
 
-  float SIGPLOT_ASSIGN_WRAP(energy, static_cast<float>(state->energy()), 0.0f,
+  float SIGPLOT_ASSIGN_WRAP(energy, static_cast<float>(state.energy()), 0.0f,
                             1.0f);
   energy *= 0.1;
-  float SIGPLOT_ASSIGN(power, state->power());
+  float SIGPLOT_ASSIGN(power, state.power());
 
   float SIGPLOT_ASSIGN(
       zoom_coeff,
@@ -223,74 +227,133 @@ void Pills::OnDrawFrame(
   cube_orient_vec.x /= 2;
   cube_orient_vec.y /= 2;
 
-  {
-    auto depth_output_activation = depth_output_target_->Activate();
-    glViewport(0, 0, longer_dimension(), longer_dimension());
-    glClearColor(0, 0, 0, 0);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glDepthRange(0, 10);
-    glEnable(GL_DEPTH_TEST);
-    DrawCubes(power, bass, energy, state->dt(), state->t(), zoom_coeff,
-              cube_orient_vec, num_cubes);
-    glDisable(GL_DEPTH_TEST);
-  }
-
-  {
-    auto front_activation = front_render_target_->Activate();
-
-    auto program_activation = warp_program_->Activate();
-
-    zoom_coeff =
-        (SineEase(MapValue<float, /*clamp=*/true>(
-             (zoom_coeff - 1.0f / 3.0f) * 2.0f, -1.0f, 1.0f, 0.0f, 1.0f)) *
-             2.0f -
-         1.0f) *
-            0.1 +
-        1.05;
-    SIGPLOT("shader zoom coeff", zoom_coeff);
-
-    GlBindUniform(warp_program_, "frame_size", glm::ivec2(width(), height()));
-    GlBindUniform(warp_program_, "power", power);
-    GlBindUniform(warp_program_, "energy", energy);
-    // Figure out how to keep it from zooming towards the viewer when the line
-    // is moving
-    GlBindUniform(warp_program_, "zoom_coeff", zoom_coeff);
-    GlBindUniform(warp_program_, "zoom_vec", zoom_vec);
-    GlBindUniform(warp_program_, "model_transform", glm::mat4(1.0f));
-    auto binding_options = gl::GlTextureBindingOptions();
-    background_hue_ +=
-        power * SIGINJECT_OVERRIDE("pills_border_hue_coeff", 0.1f, 0.0f, 0.5f);
-    binding_options.border_color = glm::vec4(
-        HsvToRgb(glm::vec3(
-            background_hue_, 1,
-            SIGINJECT_OVERRIDE("pills_border_value_coeff", 1.0f, 0.0f, 1.0f))),
-        1);
-    binding_options.sampling_mode = gl::GlTextureSamplingMode::kClampToBorder;
-    GlBindRenderTargetTextureToUniform(warp_program_, "last_frame",
-                                       back_render_target_, binding_options);
-    GlBindRenderTargetTextureToUniform(warp_program_, "input",
-                                       depth_output_target_, binding_options);
-
-    glViewport(0, 0, longer_dimension(), longer_dimension());
-    rectangle_.Draw();
-  }
-
-  {
-    auto output_activation = output_render_target->Activate();
-    auto program_activation = composite_program_->Activate();
-
-    GlBindUniform(composite_program_, "render_target_size",
-                  glm::ivec2(width(), height()));
-    GlBindUniform(composite_program_, "model_transform", glm::mat4(1.0f));
-    GlBindRenderTargetTextureToUniform(composite_program_, "render_target",
-                                       front_render_target_,
-                                       gl::GlTextureBindingOptions());
-
-    SquareViewport();
-    rectangle_.Draw();
+  UpdateCubes(power, bass, energy, dt, state.t(), zoom_coeff, cube_orient_vec,
+              num_cubes);
+
+  float shader_zoom_coeff =
+      (SineEase(MapValue<float, /*clamp=*/true>(
+           (zoom_coeff - 1.0f / 3.0f) * 2.0f, -1.0f, 1.0f, 0.0f, 1.0f)) *
+           2.0f -
+       1.0f) *
+          0.1 +
+      1.05;
+  SIGPLOT("shader zoom coeff", shader_zoom_coeff);
+
+  background_hue_ +=
+      power * SIGINJECT_OVERRIDE("pills_border_hue_coeff", 0.1f, 0.0f, 0.5f);
+  warp_params_ = {
+      .power = power,
+      .energy = energy,
+      .zoom_coeff = shader_zoom_coeff,
+      .zoom_vec = zoom_vec,
+      .border_color = glm::vec4(
+          HsvToRgb(glm::vec3(background_hue_, 1,
+                             SIGINJECT_OVERRIDE("pills_border_value_coeff",
+                                                1.0f, 0.0f, 1.0f))),
+          1),
+  };
+}
 
-    back_render_target_->swap_texture_unit(front_render_target_.get());
+void Pills::OnDrawFrame(
+    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
+    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
+  gl::GlRenderGraph graph(render_target_pool());
+  // The depth target is only read within this frame, so it is leased from the
+  // pool shared with the other presets in the blend. Nothing uses stencil, so
+  // its depth is 16-bit.
+  auto depth_output = graph.CreateTransient(
+      "depth_output", longer_dimension(), longer_dimension(),
+      {.enable_depth = true, .depth_format = gl::GlDepthFormat::kDepth16});
+  auto front = graph.Import("front", front_render_target_);
+  auto back = graph.Import("back", back_render_target_);
+  auto output = graph.Import("output", output_render_target);
+
+  // The cubes sample `back` through `cube_params_`, but no pass in this graph
+  // writes it, so it is not declared as a read. The warp pass reads the
+  // depth output, which keeps the cubes ahead of the swap of `back`.
+  graph.AddPass({
+      .name = "cubes",
+      .write = depth_output,
+      .clear_color = glm::vec4(0, 0, 0, 0),
+      .execute =
+          [&](const gl::GlRenderGraph::PassResources&) {
+            gl::GlStateCache::Current().Viewport(0, 0, longer_dimension(),
+                                                 longer_dimension());
+            glDepthRange(0, 10);
+            gl::GlStateCache::Current().Enable(GL_DEPTH_TEST);
+            outline_model_->DrawInstanced(cube_params_, cube_instances_);
+            gl::GlStateCache::Current().Disable(GL_DEPTH_TEST);
+          },
+  });
+
+  graph.AddPass({
+      .name = "warp",
+      .reads = {back, depth_output},
+      .write = front,
+      .program = warp_program_,
+      .execute =
+          [&](const gl::GlRenderGraph::PassResources& resources) {
+            GlBindUniform(warp_program_, "frame_size",
+                          glm::ivec2(width(), height()));
+            GlBindUniform(warp_program_, "power", warp_params_.power);
+            GlBindUniform(warp_program_, "energy", warp_params_.energy);
+            // Figure out how to keep it from zooming towards the viewer when
+            // the line is moving
+            GlBindUniform(warp_program_, "zoom_coeff", warp_params_.zoom_coeff);
+            GlBindUniform(warp_program_, "zoom_vec", warp_params_.zoom_vec);
+            GlBindUniform(warp_program_, "model_transform", glm::mat4(1.0f));
+            auto binding_options = gl::GlTextureBindingOptions();
+            binding_options.border_color = warp_params_.border_color;
+            binding_options.sampling_mode =
+                gl::GlTextureSamplingMode::kClampToBorder;
+            GlBindRenderTargetTextureToUniform(
+                warp_program_, "last_frame", resources.Get(back),
+                binding_options);
+            GlBindRenderTargetTextureToUniform(
+                warp_program_, "input", resources.Get(depth_output),
+                binding_options);
+
+            gl::GlStateCache::Current().Viewport(0, 0, longer_dimension(),
+                                                 longer_dimension());
+            rectangle_.Draw();
+          },
+  });
+
+  graph.AddPass({
+      .name = "composite",
+      .reads = {front},
+      .write = output,
+      .program = composite_program_,
+      .execute =
+          [&](const gl::GlRenderGraph::PassResources& resources) {
+            GlBindUniform(composite_program_, "render_target_size",
+                          glm::ivec2(width(), height()));
+            GlBindUniform(composite_program_, "model_transform",
+                          glm::mat4(1.0f));
+            GlBindRenderTargetTextureToUniform(
+                composite_program_, "render_target", resources.Get(front),
+                gl::GlTextureBindingOptions());
+
+            SquareViewport();
+            rectangle_.Draw();
+          },
+  });
+
+  graph.AddSwap(back, front);
+
+  auto status = graph.Execute();
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to draw " << name() << ": " << status;
   }
 }
 
+namespace {
+const PresetRegistration<Pills> kRegistration(
+    {.name = "Pills",
+     .poolable = true,
+     .tags = {"3d", "feedback"},
+     .max_count = 1,
+     .cost = 3});
+}  // namespace
+
 }  // namespace opendrop
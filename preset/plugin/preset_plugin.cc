@@ -0,0 +1,18 @@
+#include "preset/plugin/preset_plugin.h"
+
+namespace opendrop {
+
+PresetPluginInfo ExpectedPresetPluginInfo() {
+  return PresetPluginInfo{.abi_version = kPresetPluginAbiVersion,
+                          .preset_size = sizeof(Preset),
+                          .texture_manager_size = sizeof(gl::GlTextureManager),
+                          .entry_size = sizeof(PresetRegistry::Entry),
+                          .state_cache_size = sizeof(gl::GlStateCache),
+                          .get_presets = nullptr,
+                          .set_state_cache_function = nullptr,
+                          .set_coefficients_stream_function = nullptr,
+                          .set_program_cache_function = nullptr,
+                          .set_render_target_pool_function = nullptr};
+}
+
+}  // namespace opendrop
@@ -0,0 +1,72 @@
+#ifndef PRESET_PLUGIN_PRESET_PLUGIN_H_
+#define PRESET_PLUGIN_PRESET_PLUGIN_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "preset/preset.h"
+#include "preset/preset_registry.h"
+#include "util/graphics/gl_program_cache.h"
+#include "util/graphics/gl_render_target_pool.h"
+#include "util/graphics/gl_state_cache.h"
+#include "util/graphics/gl_texture_manager.h"
+#include "util/math/coefficients.h"
+#include "util/math/random.h"
+
+namespace opendrop {
+
+// Version of the interface between the host and preset plugins. Must be
+// incremented whenever a change to `Preset`, `GlTextureManager`,
+// `GlStateCache`, `PresetRegistry::Entry` or `PresetPluginInfo` alters their
+// layout, their virtual methods or the meaning of their members.
+//
+// Plugins share C++ objects with the host, so they must be built with the
+// same compiler and standard library as the host, from a tree with the same
+// ABI version. The version and the sizes below catch the common ways of
+// getting this wrong before any plugin code runs.
+constexpr int kPresetPluginAbiVersion = 9;
+
+// Describes a preset plugin to the host.
+struct PresetPluginInfo {
+  int abi_version;
+  size_t preset_size;
+  size_t texture_manager_size;
+  size_t entry_size;
+  size_t state_cache_size;
+  // Returns the presets the plugin provides. The entries' factories remain
+  // valid for as long as the plugin is loaded.
+  std::vector<PresetRegistry::Entry> (*get_presets)();
+  // Point the plugin's copies of process-wide singletons at the host's.
+  // Called by the host before any of the plugin's presets are created.
+  //
+  // Other singletons are not forwarded, so a plugin has its own copies of
+  // them: its `ControlInjector` neither reads the control ports nor shows
+  // controls in the host's ImGui window, and `Random` streams other than the
+  // one `Coefficients` draws from are seeded independently of the host's.
+  void (*set_state_cache_function)(gl::GlStateCache& (*current)());
+  void (*set_coefficients_stream_function)(RandomStream& (*stream)());
+  void (*set_program_cache_function)(gl::GlProgramCache& (*get)());
+  void (*set_render_target_pool_function)(
+      std::shared_ptr<gl::GlRenderTargetPool> (*for_texture_manager)(
+          std::shared_ptr<gl::GlTextureManager>));
+};
+
+// Name of the function a plugin exports to describe itself, which has the
+// signature of `OpenDropPresetPluginInfo`.
+constexpr char kPresetPluginEntryPoint[] = "OpenDropPresetPluginInfo";
+
+// Returns the `PresetPluginInfo` this build would expect a plugin to report,
+// with its function pointers unset.
+PresetPluginInfo ExpectedPresetPluginInfo();
+
+}  // namespace opendrop
+
+extern "C" {
+// Defined by `//preset/plugin:preset_plugin_main`, which every plugin links.
+// The presets reported are those that registered themselves with the
+// plugin's own copy of `PresetRegistry`.
+const opendrop::PresetPluginInfo* OpenDropPresetPluginInfo();
+}
+
+#endif  // PRESET_PLUGIN_PRESET_PLUGIN_H_
@@ -0,0 +1,239 @@
+#include "preset/plugin/preset_plugin_loader.h"
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <utility>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "preset/plugin/preset_plugin.h"
+#include "util/graphics/gl_interface.h"
+#include "util/graphics/gl_render_target_pool.h"
+#include "util/graphics/gl_state_cache.h"
+#include "util/logging/logging.h"
+#include "util/math/coefficients.h"
+#include "util/status/status_macros.h"
+
+namespace opendrop {
+
+namespace {
+using PluginInfoFunction = const PresetPluginInfo* (*)();
+
+// A plugin factory, together with the handle keeping its code loaded. The
+// factory is declared last so that it is destroyed before the handle is
+// released.
+struct PluginFactory {
+  std::shared_ptr<void> handle;
+  PresetRegistry::Factory factory;
+};
+
+// Copies `path` to a new temporary file and returns the copy's path. Loading
+// from a copy both keeps the loaded image immune to the original being
+// rewritten, and keeps `dlopen` from returning the old image when a modified
+// plugin is reloaded while instances of the old version are still alive.
+absl::StatusOr<std::string> CopyToTemporaryFile(const std::string& path) {
+  const char* temporary_directory = std::getenv("TMPDIR");
+  if (temporary_directory == nullptr || *temporary_directory == '\0') {
+    temporary_directory = "/tmp";
+  }
+  std::string copy_path =
+      absl::StrCat(temporary_directory, "/opendrop_preset_plugin_XXXXXX");
+  const int fd = mkstemp(copy_path.data());
+  if (fd < 0) {
+    return absl::InternalError(absl::StrCat(
+        "Failed to create temporary file: ", std::strerror(errno)));
+  }
+  close(fd);
+
+  std::ifstream source(path, std::ios::binary);
+  std::ofstream destination(copy_path, std::ios::binary | std::ios::trunc);
+  destination << source.rdbuf();
+  if (!source || !destination) {
+    unlink(copy_path.c_str());
+    return absl::InternalError(absl::StrCat("Failed to copy ", path));
+  }
+  return copy_path;
+}
+
+absl::Status CheckAbi(const PresetPluginInfo& info) {
+  const PresetPluginInfo expected = ExpectedPresetPluginInfo();
+  if (info.abi_version != expected.abi_version) {
+    return absl::FailedPreconditionError(
+        absl::StrCat("Plugin ABI version ", info.abi_version,
+                     " does not match host ABI version ",
+                     expected.abi_version));
+  }
+  if (info.preset_size != expected.preset_size ||
+      info.texture_manager_size != expected.texture_manager_size ||
+      info.entry_size != expected.entry_size ||
+      info.state_cache_size != expected.state_cache_size) {
+    return absl::FailedPreconditionError(
+        "Plugin was built from a tree with a different preset ABI");
+  }
+  if (info.get_presets == nullptr) {
+    return absl::FailedPreconditionError("Plugin provides no presets");
+  }
+  if (info.set_state_cache_function == nullptr ||
+      info.set_coefficients_stream_function == nullptr ||
+      info.set_program_cache_function == nullptr ||
+      info.set_render_target_pool_function == nullptr) {
+    return absl::FailedPreconditionError("Plugin cannot share GL state");
+  }
+  return absl::OkStatus();
+}
+}  // namespace
+
+PresetPluginLoader::PresetPluginLoader(std::string directory,
+                                       PresetRegistry* registry)
+    : directory_(std::move(directory)), registry_(registry) {}
+
+PresetPluginLoader::~PresetPluginLoader() {
+  for (const auto& [path, plugin] : plugins_) {
+    Unload(path, plugin);
+  }
+}
+
+absl::Status PresetPluginLoader::Scan() {
+  DIR* dir = opendir(directory_.c_str());
+  if (dir == nullptr) {
+    return absl::NotFoundError(absl::StrCat("Failed to open plugin directory ",
+                                            directory_, ": ",
+                                            std::strerror(errno)));
+  }
+  std::set<std::string> present;
+  while (dirent* dir_entry = readdir(dir)) {
+    if (absl::EndsWith(dir_entry->d_name, ".so")) {
+      present.insert(absl::StrCat(directory_, "/", dir_entry->d_name));
+    }
+  }
+  closedir(dir);
+
+  for (auto iter = plugins_.begin(); iter != plugins_.end();) {
+    if (present.count(iter->first) == 0) {
+      LOG(INFO) << "Unloading removed preset plugin " << iter->first;
+      Unload(iter->first, iter->second);
+      iter = plugins_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+
+  for (const std::string& path : present) {
+    struct stat file_stat;
+    if (stat(path.c_str(), &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+      continue;
+    }
+
+    auto iter = plugins_.find(path);
+    if (iter != plugins_.end()) {
+      if (iter->second.modification_time == file_stat.st_mtime &&
+          iter->second.size == file_stat.st_size) {
+        continue;
+      }
+      LOG(INFO) << "Reloading modified preset plugin " << path;
+      Unload(path, iter->second);
+      plugins_.erase(iter);
+    }
+
+    absl::StatusOr<Plugin> status_or_plugin = Load(path);
+    if (!status_or_plugin.ok()) {
+      LOG(ERROR) << "Failed to load preset plugin " << path << ": "
+                 << status_or_plugin.status();
+      continue;
+    }
+    status_or_plugin->modification_time = file_stat.st_mtime;
+    status_or_plugin->size = file_stat.st_size;
+    plugins_.emplace(path, *std::move(status_or_plugin));
+  }
+  return absl::OkStatus();
+}
+
+std::vector<std::string> PresetPluginLoader::loaded_plugins() const {
+  std::vector<std::string> paths;
+  for (const auto& [path, plugin] : plugins_) {
+    paths.push_back(path);
+  }
+  return paths;
+}
+
+absl::StatusOr<PresetPluginLoader::Plugin> PresetPluginLoader::Load(
+    const std::string& path) {
+  ASSIGN_OR_RETURN(const std::string copy_path, CopyToTemporaryFile(path));
+  void* raw_handle = dlopen(copy_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  // The mapping outlives the file.
+  unlink(copy_path.c_str());
+  if (raw_handle == nullptr) {
+    return absl::InternalError(absl::StrCat("dlopen failed: ", dlerror()));
+  }
+  std::shared_ptr<void> handle(raw_handle,
+                               [](void* handle) { dlclose(handle); });
+
+  auto info_function = reinterpret_cast<PluginInfoFunction>(
+      dlsym(raw_handle, kPresetPluginEntryPoint));
+  if (info_function == nullptr) {
+    return absl::NotFoundError(
+        absl::StrCat("Plugin does not export ", kPresetPluginEntryPoint));
+  }
+  const PresetPluginInfo* info = info_function();
+  RETURN_IF_ERROR(CheckAbi(*info));
+  info->set_state_cache_function(&gl::GlStateCache::Current);
+  info->set_coefficients_stream_function(&Coefficients::Stream);
+  info->set_program_cache_function(&gl::GlProgramCache::Get);
+  info->set_render_target_pool_function(
+      &gl::GlRenderTargetPool::ForTextureManager);
+
+  Plugin plugin;
+  for (PresetRegistry::Entry& entry : info->get_presets()) {
+    auto plugin_factory = std::make_shared<PluginFactory>(
+        PluginFactory{.handle = handle, .factory = std::move(entry.factory)});
+    entry.factory = [plugin_factory](
+                        std::shared_ptr<gl::GlTextureManager> texture_manager)
+        -> absl::StatusOr<std::shared_ptr<Preset>> {
+      ASSIGN_OR_RETURN(std::shared_ptr<Preset> preset,
+                       plugin_factory->factory(std::move(texture_manager)));
+      // Keep the plugin loaded for as long as the preset is alive.
+      Preset* raw_preset = preset.get();
+      return std::shared_ptr<Preset>(
+          raw_preset, [preset = std::move(preset),
+                       handle = plugin_factory->handle](Preset*) mutable {
+            preset.reset();
+            handle.reset();
+          });
+    };
+    entry.poolable = false;
+
+    const std::string name = entry.name;
+    if (absl::Status status = registry_->TryRegister(std::move(entry));
+        !status.ok()) {
+      LOG(ERROR) << "Skipping preset " << name << " from plugin " << path
+                 << ": " << status;
+      continue;
+    }
+    plugin.preset_names.push_back(name);
+  }
+
+  LOG(INFO) << "Loaded preset plugin " << path << " with "
+            << plugin.preset_names.size() << " presets";
+  return plugin;
+}
+
+void PresetPluginLoader::Unload(const std::string& path,
+                                const Plugin& plugin) {
+  for (const std::string& name : plugin.preset_names) {
+    if (absl::Status status = registry_->Unregister(name); !status.ok()) {
+      LOG(ERROR) << "Failed to unregister preset " << name << " from plugin "
+                 << path << ": " << status;
+    }
+  }
+}
+
+}  // namespace opendrop
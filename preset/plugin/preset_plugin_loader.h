@@ -0,0 +1,63 @@
+#ifndef PRESET_PLUGIN_PRESET_PLUGIN_LOADER_H_
+#define PRESET_PLUGIN_PRESET_PLUGIN_LOADER_H_
+
+#include <ctime>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "preset/preset_registry.h"
+
+namespace opendrop {
+
+// Loads preset plugins, shared libraries built with the `preset_plugin` macro,
+// from a directory and registers their presets with a `PresetRegistry`.
+//
+// `Scan` loads plugins added to the directory since the last scan, reloads
+// those that have been modified and unloads those that have been removed.
+// Unloading a plugin unregisters its presets immediately, but its code stays
+// mapped until the last instance of its presets is destroyed, so scanning is
+// safe while presets are running; presets constructed after a scan use the
+// latest version of their plugin. Plugin presets are never taken from a
+// `PresetPool`, since a reloaded preset type is indistinguishable from the
+// type it replaces. This class is not thread-safe.
+class PresetPluginLoader {
+ public:
+  PresetPluginLoader(std::string directory, PresetRegistry* registry);
+  // Unregisters the presets of every loaded plugin.
+  ~PresetPluginLoader();
+
+  // Synchronizes the loaded plugins with the contents of the directory.
+  // Plugins which fail to load are logged and skipped; an error is only
+  // returned if the directory cannot be read.
+  absl::Status Scan();
+
+  // Paths of the currently loaded plugins.
+  std::vector<std::string> loaded_plugins() const;
+
+ private:
+  struct Plugin {
+    // Modification time and size of the file the plugin was loaded from, for
+    // detecting changes.
+    time_t modification_time;
+    off_t size;
+    std::vector<std::string> preset_names;
+  };
+
+  // Loads the plugin at `path` and registers its presets.
+  absl::StatusOr<Plugin> Load(const std::string& path);
+  // Unregisters the presets of `plugin`.
+  void Unload(const std::string& path, const Plugin& plugin);
+
+  const std::string directory_;
+  PresetRegistry* const registry_;
+  // Loaded plugins, keyed by path.
+  std::map<std::string, Plugin> plugins_;
+};
+
+}  // namespace opendrop
+
+#endif  // PRESET_PLUGIN_PRESET_PLUGIN_LOADER_H_
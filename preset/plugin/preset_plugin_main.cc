@@ -0,0 +1,26 @@
+// Entry point linked into every preset plugin. See `preset_plugin.h`.
+
+#include "preset/plugin/preset_plugin.h"
+
+namespace {
+std::vector<opendrop::PresetRegistry::Entry> GetPresets() {
+  // The plugin is linked with `-Bsymbolic`, so this is the plugin's registry,
+  // which only the presets linked into the plugin have registered with.
+  return opendrop::PresetRegistry::Get().entries();
+}
+}  // namespace
+
+extern "C" const opendrop::PresetPluginInfo* OpenDropPresetPluginInfo() {
+  static const opendrop::PresetPluginInfo info = [] {
+    opendrop::PresetPluginInfo info = opendrop::ExpectedPresetPluginInfo();
+    info.get_presets = &GetPresets;
+    info.set_state_cache_function = &gl::GlStateCache::SetCurrentFunction;
+    info.set_coefficients_stream_function =
+        &opendrop::Coefficients::SetStreamFunction;
+    info.set_program_cache_function = &gl::GlProgramCache::SetGetFunction;
+    info.set_render_target_pool_function =
+        &gl::GlRenderTargetPool::SetForTextureManagerFunction;
+    return info;
+  }();
+  return &info;
+}
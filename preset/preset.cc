@@ -1,32 +1,123 @@
 #include "preset/preset.h"
 
 #include "third_party/gl_helper.h"
+#include "util/graphics/gl_gpu_timer_scope.h"
+#include "util/graphics/gl_state_cache.h"
+#include "util/graphics/gl_util.h"
+#include "util/logging/logging.h"
 
 namespace opendrop {
 
-void Preset::DrawFrame(
+void Preset::Update(const GlobalState& state, float dt) {
+  std::unique_lock<std::mutex> lock(state_mu_);
+  Coefficients::ScopedStream scoped_stream(random_stream_);
+  OnUpdate(state, dt);
+}
+
+void Preset::Render(
     absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
     float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
   std::unique_lock<std::mutex> lock(state_mu_);
+  Coefficients::ScopedStream scoped_stream(random_stream_);
   if (width_ == 0 || height_ == 0) {
     // Don't draw.
     return;
   }
+  gl::GlGpuTimerScope timer_scope(name());
   OnDrawFrame(samples, state, alpha, output_render_target);
 }
 
+void Preset::DrawFrame(
+    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
+    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
+  Update(*state, state->dt());
+  Render(samples, state, alpha, output_render_target);
+}
+
+void Preset::SkipFrame(absl::Span<const float> samples,
+                       std::shared_ptr<GlobalState> state) {
+  std::unique_lock<std::mutex> lock(state_mu_);
+  Coefficients::ScopedStream scoped_stream(random_stream_);
+  OnSkipFrame(samples, state);
+}
+
 void Preset::UpdateGeometry(int width, int height) {
   std::unique_lock<std::mutex> lock(state_mu_);
+  Coefficients::ScopedStream scoped_stream(random_stream_);
+  if (width == width_ && height == height_) {
+    return;
+  }
   width_ = width;
   height_ = height;
   longer_dimension_ = std::max(width_, height_);
   OnUpdateGeometry();
 }
 
+void Preset::Reset() {
+  std::unique_lock<std::mutex> lock(state_mu_);
+  Coefficients::ScopedStream scoped_stream(random_stream_);
+  OnReset();
+}
+
+size_t Preset::EstimateMemoryUsage() const {
+  constexpr size_t kBytesPerPixel = 4;
+  constexpr size_t kFeedbackRenderTargets = 2;
+  return kFeedbackRenderTargets * kBytesPerPixel * longer_dimension_ *
+         longer_dimension_;
+}
+
+void Preset::ClearRenderTarget(
+    const std::shared_ptr<gl::GlRenderTarget>& render_target) {
+  if (render_target == nullptr || render_target->width() == 0 ||
+      render_target->height() == 0) {
+    return;
+  }
+  auto activation = render_target->Activate();
+  gl::GlClear(glm::vec4(0, 0, 0, 0));
+}
+
+void Preset::ResizeRenderTarget(
+    std::shared_ptr<gl::GlRenderTarget>* render_target, int width,
+    int height) {
+  if (*render_target == nullptr ||
+      (*render_target)->size() == glm::ivec2(width, height)) {
+    return;
+  }
+  // Empty targets hold no storage worth pooling.
+  if (width == 0 || height == 0) {
+    (*render_target)->UpdateGeometry(width, height);
+    return;
+  }
+
+  auto status_or_render_target = render_target_pool_->LeasePersistent(
+      width, height, (*render_target)->options());
+  if (!status_or_render_target.ok()) {
+    LOG(ERROR) << "Failed to lease render target for " << name() << ": "
+               << status_or_render_target.status();
+    (*render_target)->UpdateGeometry(width, height);
+  } else {
+    *render_target = *std::move(status_or_render_target);
+  }
+  ClearRenderTarget(*render_target);
+}
+
+std::shared_ptr<gl::GlRenderTarget> Preset::LeaseScratchRenderTarget(
+    gl::GlRenderTarget::Options options) {
+  auto status_or_render_target = render_target_pool_->LeaseTransient(
+      longer_dimension_, longer_dimension_, options);
+  if (!status_or_render_target.ok()) {
+    LOG(ERROR) << "Failed to lease scratch render target for " << name()
+               << ": " << status_or_render_target.status();
+    return nullptr;
+  }
+  return *std::move(status_or_render_target);
+}
+
 void Preset::SquareViewport() const {
   const int x_offset = -(longer_dimension_ - width_) / 2;
   const int y_offset = -(longer_dimension_ - height_) / 2;
-  glViewport(x_offset, y_offset, longer_dimension_, longer_dimension_);
+  gl::GlStateCache::Current().Viewport(x_offset, y_offset, longer_dimension_,
+                                       longer_dimension_);
 }
 
 }  // namespace opendrop
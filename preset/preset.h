@@ -8,6 +8,9 @@
 #include "absl/types/span.h"
 #include "util/graphics/gl_interface.h"
 #include "util/graphics/gl_render_target.h"
+#include "util/graphics/gl_render_target_pool.h"
+#include "util/math/coefficients.h"
+#include "util/math/random.h"
 #include "application/global_state.h"
 
 namespace opendrop {
@@ -23,23 +26,49 @@ class Preset {
   }
   virtual ~Preset() {}
 
-  // Draws a single frame of this preset. `samples` is a buffer of interleaved
-  // audio samples. `state` is the current global libopendrop state. `alpha` is
-  // the alpha that should be premultiplied when rendering the output of the
-  // preset. `output_render_target` is the render target to render the preset
-  // output to.
+  // Advances the simulation state of this preset by `dt` seconds, given the
+  // current global libopendrop state. Issues no GL calls, so the updates of
+  // different presets may run concurrently.
+  void Update(const GlobalState& state, float dt);
+
+  // Renders the frame prepared by the last call to `Update`. `samples` is a
+  // buffer of interleaved audio samples. `state` is the current global
+  // libopendrop state. `alpha` is the alpha that should be premultiplied when
+  // rendering the output of the preset. `output_render_target` is the render
+  // target to render the preset output to.
+  void Render(absl::Span<const float> samples,
+              std::shared_ptr<GlobalState> state, float alpha,
+              std::shared_ptr<gl::GlRenderTarget> output_render_target);
+
+  // Updates and renders a single frame of this preset. Arguments are as for
+  // `Render`.
   void DrawFrame(absl::Span<const float> samples,
                  std::shared_ptr<GlobalState> state, float alpha,
                  std::shared_ptr<gl::GlRenderTarget> output_render_target);
 
+  // Advances the state of this preset for a frame in which its output is not
+  // visible, without issuing any draw calls. `samples` and `state` are as for
+  // `DrawFrame`.
+  void SkipFrame(absl::Span<const float> samples,
+                 std::shared_ptr<GlobalState> state);
+
   // Updates the preset render geometry. Subsequent calls to `DrawFrame` will
-  // render at these dimensions.
+  // render at these dimensions. Does nothing if the geometry is unchanged.
   void UpdateGeometry(int width, int height);
 
   // Configures glViewport() for sampling a square raster and outputting it to a
   // rectangular raster.
   void SquareViewport() const;
 
+  // Reinitializes the per-run state of this preset, so that a retired instance
+  // can be reused for a new activation without reallocating its resources.
+  void Reset();
+
+  // Returns an estimate of the GPU memory held by this preset, in bytes. The
+  // default assumes a pair of RGBA feedback render targets at the longer
+  // dimension, as most presets have.
+  virtual size_t EstimateMemoryUsage() const;
+
   virtual std::string name() const = 0;
 
   virtual int max_count() const { return kDefaultMaxPresetCount; }
@@ -49,6 +78,9 @@ class Preset {
   // Constructs a preset which renders to a raster of the given dimensions.
   Preset(std::shared_ptr<gl::GlTextureManager> texture_manager)
       : texture_manager_(texture_manager),
+        render_target_pool_(
+            gl::GlRenderTargetPool::ForTextureManager(texture_manager)),
+        random_stream_(Coefficients::Stream().NextUint64()),
         width_(0),
         height_(0),
         longer_dimension_(0) {}
@@ -60,22 +92,65 @@ class Preset {
   float aspect_ratio() const { return static_cast<float>(height_) / width_; }
 
   // Callbacks for subclass implementations.
-  // Invoked by `DrawFrame` with lock held.
+  // Invoked by `Update` with lock held, possibly off the render thread.
+  // Implementations must not issue GL calls. Presets that have not split their
+  // simulation out of `OnDrawFrame` need not implement this.
+  virtual void OnUpdate(const GlobalState& state, float dt) {}
+  // Invoked by `Render` with lock held.
   virtual void OnDrawFrame(
       absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
       float alpha,
       std::shared_ptr<gl::GlRenderTarget> output_render_target) = 0;
+  // Invoked by `SkipFrame` with lock held. Implementations whose simulation
+  // state must stay coherent while hidden should advance it here.
+  virtual void OnSkipFrame(absl::Span<const float> samples,
+                           std::shared_ptr<GlobalState> state) {}
   // Invoked by `UpdateGeometry` with lock held.
   virtual void OnUpdateGeometry() = 0;
+  // Invoked by `Reset` with lock held. Implementations should clear feedback
+  // render targets and accumulated state.
+  virtual void OnReset() {}
+
+  // Clears `render_target` to transparent black, if it has been sized.
+  static void ClearRenderTarget(
+      const std::shared_ptr<gl::GlRenderTarget>& render_target);
+
+  // Resizes the persistent render target `*render_target`, such as a feedback
+  // buffer, to `width` by `height`. Instead of reallocating its storage, the
+  // target is replaced by a lease with the same options from the shared pool,
+  // and the old target is returned to the pool for later presets to lease.
+  // The resized target is cleared. Does nothing if `*render_target` is null or
+  // already has that size.
+  void ResizeRenderTarget(std::shared_ptr<gl::GlRenderTarget>* render_target,
+                          int width, int height);
+
+  // Leases a scratch render target at the longer dimension, for use within
+  // the current frame only. Presets drawn in the same blend share scratch
+  // targets, so the returned target must be dropped before `OnDrawFrame`
+  // returns. Returns null if no target could be allocated.
+  std::shared_ptr<gl::GlRenderTarget> LeaseScratchRenderTarget(
+      gl::GlRenderTarget::Options options);
 
   // Getter for texture manager.
   std::shared_ptr<gl::GlTextureManager> texture_manager() {
     return texture_manager_;
   }
 
+  // Getter for the render target pool shared with other presets.
+  std::shared_ptr<gl::GlRenderTargetPool> render_target_pool() {
+    return render_target_pool_;
+  }
+
  private:
-  // the GlTextureManager providing texture units for this preset.
+  // The GlTextureManager tracking the textures of this preset.
   std::shared_ptr<gl::GlTextureManager> texture_manager_;
+  // Pool that persistent and scratch render targets are leased from, shared by
+  // every preset using the same texture manager.
+  std::shared_ptr<gl::GlRenderTargetPool> render_target_pool_;
+  // Stream that coefficients are drawn from while any callback runs, seeded
+  // from the stream current at construction. Presets update in parallel, so
+  // a shared stream would hand out values in an arbitrary order.
+  RandomStream random_stream_;
   // Mutex protecting preset state.
   std::mutex state_mu_;
   // Preset render dimensions.
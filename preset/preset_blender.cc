@@ -1,15 +1,45 @@
 #include "preset/preset_blender.h"
 
+#include <algorithm>
+#include <optional>
 #include <sstream>
+#include <thread>
 
+#include "absl/strings/str_cat.h"
+#include "preset/preset_registry.h"
 #include "shader/blit.fsh.h"
 #include "shader/blit.vsh.h"
+#include "shader/composite.fsh.h"
 #include "primitive/rectangle.h"
 #include "third_party/gl_helper.h"
+#include "util/graphics/gl_gpu_timer_scope.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "util/logging/logging.h"
 
 namespace opendrop {
+
+namespace {
+// Mixing coefficients below which presets that are transitioning out are
+// rendered at half and quarter quality.
+constexpr float kHalfQualityCoefficient = 0.5f;
+constexpr float kQuarterQualityCoefficient = 0.25f;
+
+// Factor by which a frame must exceed the frame budget to be considered over
+// budget. Frame times jitter around the budget when running at the target
+// rate.
+constexpr float kFrameBudgetTolerance = 1.25f;
+
+// Upper bound on the number of threads updating presets in addition to the
+// render thread. Blends rarely have more than a handful of presets active.
+constexpr int kMaxUpdateThreads = 3;
+
+int NumUpdateThreads() {
+  const int num_cores = std::thread::hardware_concurrency();
+  return std::clamp(num_cores - 1, 0, kMaxUpdateThreads);
+}
+}  // namespace
+
 PresetActivation::PresetActivation(
     std::shared_ptr<Preset> preset,
     std::shared_ptr<gl::GlRenderTarget> render_target, float minimum_duration_s,
@@ -63,6 +93,32 @@ void PresetActivation::TriggerTransitionOut() {
   transition_timer_.Reset();
 }
 
+void PresetActivation::SetQuality(QualityLevel quality, int width,
+                                  int height) {
+  const bool resize = quality.resolution_divisor != quality_.resolution_divisor;
+  quality_ = quality;
+  if (resize) {
+    UpdateGeometry(width, height);
+  }
+}
+
+void PresetActivation::UpdateGeometry(int width, int height) {
+  const int divisor = quality_.resolution_divisor;
+  const int reduced_width = std::max(1, width / divisor);
+  const int reduced_height = std::max(1, height / divisor);
+  preset_->UpdateGeometry(reduced_width, reduced_height);
+  render_target_->UpdateGeometry(reduced_width, reduced_height);
+  // The reallocated render target holds no image yet, so the next
+  // `ConsumeFrame` must draw rather than reuse it.
+  frame_counter_ = 0;
+}
+
+bool PresetActivation::ConsumeFrame() {
+  const bool draw = (frame_counter_ % quality_.frame_interval) == 0;
+  ++frame_counter_;
+  return draw;
+}
+
 float PresetActivation::GetMixingCoefficient() const {
   switch (state_) {
     case PresetActivationState::kTransitionIn:
@@ -81,79 +137,183 @@ float PresetActivation::GetMixingCoefficient() const {
 }
 
 PresetBlender::PresetBlender(int width, int height)
-    : width_(width), height_(height) {
+    : width_(width),
+      height_(height),
+      update_pool_(std::make_unique<ThreadPool>(NumUpdateThreads())) {
   absl::StatusOr<std::shared_ptr<gl::GlProgram>> status_or_blit_program =
       gl::GlProgram::MakeShared(blit_vsh::Code(), blit_fsh::Code());
   CHECK(status_or_blit_program.ok()) << "Failed to create blit program";
   blit_program_ = *status_or_blit_program;
+  blit_source_texture_ =
+      gl::GlUniformHandle<int>(blit_program_, "source_texture");
+  blit_alpha_ = gl::GlUniformHandle<float>(blit_program_, "alpha");
+
+  absl::StatusOr<std::shared_ptr<gl::GlProgram>> status_or_composite_program =
+      gl::GlProgram::MakeShared(blit_vsh::Code(), composite_fsh::Code());
+  CHECK(status_or_composite_program.ok())
+      << "Failed to create composite program";
+  composite_program_ = *status_or_composite_program;
+  for (int i = 0; i < kMaxCompositeLayers; ++i) {
+    composite_source_textures_[i] = gl::GlUniformHandle<int>(
+        composite_program_, absl::StrCat("source_texture_", i));
+  }
+  composite_alphas_ = gl::GlUniformHandle<float>(composite_program_, "alphas");
 }
 
 // Draws a single frame of blended preset output.
 void PresetBlender::DrawFrame(
     absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
     std::shared_ptr<gl::GlRenderTarget> output_render_target) {
+  gl::GlGpuTimerScope timer_scope("PresetBlender");
   Update(state->dt());
 
   {
     std::stringstream print_stream;
-    for (auto activation : preset_activations_) {
+    for (PresetActivation& activation : preset_activations_) {
       print_stream << activation.GetMixingCoefficient() << ", ";
     }
     LOG(DEBUG) << "mixing coefficients: " << print_stream.str();
   }
 
-  for (auto activation : preset_activations_) {
-    if (activation.GetMixingCoefficient() == 0) {
+  // Advance the simulation of every preset, drawn this frame or not. Updates
+  // issue no GL calls, so they run in parallel; only the GL submission below
+  // is serialized on the render thread.
+  updating_presets_.clear();
+  for (PresetActivation& activation : preset_activations_) {
+    updating_presets_.push_back(activation.preset().get());
+  }
+  update_pool_->ParallelFor(updating_presets_.size(), [&](int i) {
+    updating_presets_[i]->Update(*state, state->dt());
+  });
+
+  // Cull layers that do not visibly contribute to the output.
+  visible_activations_.clear();
+  for (PresetActivation& activation : preset_activations_) {
+    if (activation.GetMixingCoefficient() < kCullingEpsilon) {
+      activation.preset()->SkipFrame(samples, state);
       continue;
     }
+    visible_activations_.push_back(&activation);
+  }
 
-    activation.preset()->DrawFrame(samples, state, 1.0f,
-                                   activation.render_target());
+  for (PresetActivation* activation : visible_activations_) {
+    activation->SetQuality(SelectQuality(*activation, state->dt()), width_,
+                           height_);
+    if (activation->ConsumeFrame()) {
+      activation->preset()->Render(samples, state, 1.0f,
+                                   activation->render_target());
+    } else {
+      activation->preset()->SkipFrame(samples, state);
+    }
   }
 
   {
+    gl::GlGpuTimerScope composite_timer_scope("composite");
     auto output_activation = output_render_target->Activate();
 
-    unsigned int black_color[4] = {0, 0, 0, 0};
-    glClearBufferuiv(GL_COLOR, 0, black_color);
-
-    glBlendEquation(GL_FUNC_ADD);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND);
+    if (visible_activations_.empty()) {
+      unsigned int black_color[4] = {0, 0, 0, 0};
+      glClearBufferuiv(GL_COLOR, 0, black_color);
+      return;
+    }
 
-    for (auto activation : preset_activations_) {
-      // If the mixing coefficient is 0, skip blitting the preset output.
-      if (activation.GetMixingCoefficient() == 0) {
-        continue;
+    // The composite pass overwrites every pixel of the output, so the output
+    // need not be cleared first.
+    gl::GlStateCache::Current().Disable(GL_BLEND);
+    const int num_composited = std::min<int>(visible_activations_.size(),
+                                             kMaxCompositeLayers);
+    CompositeLayers(absl::MakeConstSpan(visible_activations_)
+                        .subspan(0, num_composited));
+
+    // Fall back to blending any remaining layers one pass at a time.
+    if (num_composited < visible_activations_.size()) {
+      glBlendEquation(GL_FUNC_ADD);
+      gl::GlStateCache::Current().BlendFunc(GL_SRC_ALPHA,
+                                            GL_ONE_MINUS_SRC_ALPHA);
+      gl::GlStateCache::Current().Enable(GL_BLEND);
+
+      for (int i = num_composited; i < visible_activations_.size(); ++i) {
+        BlitLayer(*visible_activations_[i]);
       }
 
-      blit_program_->Use();
-      // Bind the source texture and alpha value.
-      GlBindRenderTargetTextureToUniform(blit_program_, "source_texture",
-                                         activation.render_target(),
-                                         gl::GlTextureBindingOptions());
-      glUniform1f(
-          glGetUniformLocation(blit_program_->program_handle(), "alpha"),
-          activation.GetMixingCoefficient());
-
-      rectangle_.Draw();
+      gl::GlStateCache::Current().Disable(GL_BLEND);
     }
+  }
+}
 
-    glDisable(GL_BLEND);
+void PresetBlender::CompositeLayers(
+    absl::Span<PresetActivation* const> layers) {
+  CHECK(!layers.empty() && layers.size() <= kMaxCompositeLayers)
+      << "Invalid composite layer count: " << layers.size();
+
+  composite_program_->Use();
+  std::array<float, kMaxCompositeLayers> alphas{};
+  for (int i = 0; i < kMaxCompositeLayers; ++i) {
+    // Unused layers sample the first layer's texture with an alpha of 0, which
+    // leaves the composited color unchanged.
+    PresetActivation& layer = *layers[i < layers.size() ? i : 0];
+    GlBindRenderTargetTextureToUniform(composite_source_textures_[i],
+                                       layer.render_target(),
+                                       gl::GlTextureBindingOptions());
+    if (i < layers.size()) alphas[i] = layer.GetMixingCoefficient();
   }
+  composite_alphas_.Set(absl::MakeConstSpan(alphas));
+
+  rectangle_.Draw();
+}
+
+void PresetBlender::BlitLayer(PresetActivation& layer) {
+  blit_program_->Use();
+  // Bind the source texture and alpha value.
+  GlBindRenderTargetTextureToUniform(blit_source_texture_,
+                                     layer.render_target(),
+                                     gl::GlTextureBindingOptions());
+  blit_alpha_.Set(layer.GetMixingCoefficient());
+
+  rectangle_.Draw();
 }
 
 void PresetBlender::UpdateGeometry(int width, int height) {
   width_ = width;
   height_ = height;
-  for (auto activation : preset_activations_) {
+  for (PresetActivation& activation : preset_activations_) {
     LOG(DEBUG) << "UpdateGeometry on activation for preset "
                << activation.preset()->name();
-    activation.preset()->UpdateGeometry(width_, height_);
-    activation.render_target()->UpdateGeometry(width_, height_);
+    activation.UpdateGeometry(width_, height_);
   }
 }
 
+PresetActivation::QualityLevel PresetBlender::SelectQuality(
+    const PresetActivation& activation, float dt) const {
+  // Only presets that are fading out are degraded. Changing the resolution
+  // discards a preset's feedback state, which is only acceptable once its
+  // output is on its way out.
+  if (activation.state() != PresetActivationState::kTransitionOut) {
+    return activation.quality();
+  }
+
+  const bool over_budget =
+      frame_budget_ > 0 && dt > frame_budget_ * kFrameBudgetTolerance;
+  const float mixing_coefficient = activation.GetMixingCoefficient();
+
+  PresetActivation::QualityLevel quality;
+  if (mixing_coefficient < kQuarterQualityCoefficient ||
+      (over_budget && mixing_coefficient < kHalfQualityCoefficient)) {
+    quality = {.frame_interval = 2, .resolution_divisor = 4};
+  } else if (mixing_coefficient < kHalfQualityCoefficient || over_budget) {
+    quality = {.frame_interval = 1, .resolution_divisor = 2};
+  }
+
+  // Never raise the quality of a fading preset, so that its resolution does
+  // not oscillate as the frame time fluctuates.
+  const PresetActivation::QualityLevel& current = activation.quality();
+  quality.frame_interval =
+      std::max(quality.frame_interval, current.frame_interval);
+  quality.resolution_divisor =
+      std::max(quality.resolution_divisor, current.resolution_divisor);
+  return quality;
+}
+
 void PresetBlender::Update(float dt) {
   static std::vector<PresetActivation*> activations_waiting;
   activations_waiting.clear();
@@ -169,6 +329,12 @@ void PresetBlender::Update(float dt) {
 
     // If the preset is already transitioned out, clean it up.
     if (state == PresetActivationState::kOut) {
+      // Presets that cannot be taken from the pool would only occupy it.
+      std::optional<PresetRegistry::Entry> entry =
+          PresetRegistry::Get().Find(activation_iter->preset()->name());
+      if (preset_pool_ != nullptr && entry.has_value() && entry->poolable) {
+        preset_pool_->Retire(activation_iter->preset());
+      }
       activation_iter = preset_activations_.erase(activation_iter);
       continue;
     }
@@ -1,6 +1,7 @@
 #ifndef PRESET_PRESET_BLENDER_H_
 #define PRESET_PRESET_BLENDER_H_
 
+#include <array>
 #include <list>
 #include <memory>
 #include <string_view>
@@ -8,7 +9,10 @@
 #include <vector>
 
 #include "preset/preset.h"
+#include "preset/preset_pool.h"
 #include "primitive/rectangle.h"
+#include "util/concurrency/thread_pool.h"
+#include "util/graphics/gl_util.h"
 #include "util/logging/logging.h"
 #include "util/time/oneshot.h"
 
@@ -23,6 +27,17 @@ enum PresetActivationState {
 
 class PresetActivation {
  public:
+  // Rendering quality of an activation. Reduced levels trade the fidelity of a
+  // preset's output for render time.
+  struct QualityLevel {
+    // The preset is drawn on every `frame_interval`th frame. On other frames,
+    // its last output is reused.
+    int frame_interval = 1;
+    // The preset is drawn at `1 / resolution_divisor` of the blender
+    // resolution in each dimension.
+    int resolution_divisor = 1;
+  };
+
   PresetActivation(std::shared_ptr<Preset> preset,
                    std::shared_ptr<gl::GlRenderTarget> render_target,
                    float minimum_duration_s, float transition_duration_s);
@@ -38,6 +53,21 @@ class PresetActivation {
 
   PresetActivationState state() const { return state_; }
 
+  // Sets the quality level of this activation, resizing the preset and its
+  // render target if the resolution changes. `width` and `height` are the full
+  // blender resolution.
+  void SetQuality(QualityLevel quality, int width, int height);
+  const QualityLevel& quality() const { return quality_; }
+
+  // Resizes the preset and its render target to the given full resolution,
+  // reduced according to the current quality level.
+  void UpdateGeometry(int width, int height);
+
+  // Returns whether or not the preset should be drawn this frame, according
+  // to the frame interval of the current quality level. Always true for the
+  // first frame after a resize. Must be invoked once per frame.
+  bool ConsumeFrame();
+
  private:
   std::shared_ptr<Preset> preset_;
   std::shared_ptr<gl::GlRenderTarget> render_target_;
@@ -45,10 +75,21 @@ class PresetActivation {
   OneshotIncremental<float> expiry_timer_, transition_timer_;
 
   float maximal_mix_coeff_ = 1.0f;
+
+  QualityLevel quality_;
+  int frame_counter_ = 0;
 };
 
 class PresetBlender {
  public:
+  // Maximum number of preset outputs mixed in a single compositing pass. Must
+  // match the number of layers in composite.fsh.
+  static constexpr int kMaxCompositeLayers = 4;
+
+  // Mixing coefficient below which a preset's contribution to the 8-bit
+  // output is less than half of one step, and so is not rendered.
+  static constexpr float kCullingEpsilon = 1.0f / 512;
+
   PresetBlender(int width, int height);
 
   template <typename... Args>
@@ -69,8 +110,7 @@ class PresetBlender {
         activation.TriggerTransitionOut();
       }
     }
-    activation.preset()->UpdateGeometry(width_, height_);
-    activation.render_target()->UpdateGeometry(width_, height_);
+    activation.UpdateGeometry(width_, height_);
     preset_activations_.emplace_back(std::move(activation));
   }
 
@@ -81,18 +121,62 @@ class PresetBlender {
 
   void UpdateGeometry(int width, int height);
 
+  int width() const { return width_; }
+  int height() const { return height_; }
+
   size_t NumPresets() const { return preset_activations_.size(); }
 
   int QueryPresetCount(std::string_view name);
 
   void TransitionOutAll();
 
+  // Sets the target frame time, in seconds. While frames take longer than
+  // this, presets that are transitioning out are rendered at reduced quality
+  // sooner. A value of 0 disables frame time based quality reduction.
+  void set_frame_budget(float frame_budget) { frame_budget_ = frame_budget; }
+
+  // Sets the pool that presets registered as `poolable` are retired to once
+  // they have transitioned out. Other presets, and all presets if the pool is
+  // null, are destroyed.
+  void set_preset_pool(std::shared_ptr<PresetPool> preset_pool) {
+    preset_pool_ = std::move(preset_pool);
+  }
+  std::shared_ptr<PresetPool> preset_pool() const { return preset_pool_; }
+
  private:
   void Update(float dt);
 
+  // Mixes `layers` into the currently active render target in a single pass.
+  // At most `kMaxCompositeLayers` layers may be provided.
+  void CompositeLayers(absl::Span<PresetActivation* const> layers);
+
+  // Selects the quality level for `activation` given the duration of the last
+  // frame.
+  PresetActivation::QualityLevel SelectQuality(
+      const PresetActivation& activation, float dt) const;
+
+  // Blends a single layer over the currently active render target.
+  void BlitLayer(PresetActivation& layer);
+
   int width_, height_;
+  float frame_budget_ = 0;
   std::shared_ptr<gl::GlProgram> blit_program_;
+  gl::GlUniformHandle<int> blit_source_texture_;
+  gl::GlUniformHandle<float> blit_alpha_;
+  std::shared_ptr<gl::GlProgram> composite_program_;
+  std::array<gl::GlUniformHandle<int>, kMaxCompositeLayers>
+      composite_source_textures_;
+  gl::GlUniformHandle<float> composite_alphas_;
+  // Scratch storage for the activations drawn in the current frame, in
+  // compositing order.
+  std::vector<PresetActivation*> visible_activations_;
+  // Scratch storage for the presets updated in the current frame.
+  std::vector<Preset*> updating_presets_;
+  // Runs preset updates in parallel.
+  std::unique_ptr<ThreadPool> update_pool_;
+
   std::list<PresetActivation> preset_activations_;
+  std::shared_ptr<PresetPool> preset_pool_;
 
   Rectangle rectangle_;
 };
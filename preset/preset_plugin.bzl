@@ -0,0 +1,35 @@
+load(
+    "//build/toolchain:cross_compilation.bzl",
+    CROSS_COMPILATION_COPTS = "COPTS",
+    CROSS_COMPILATION_DEPS = "DEPS",
+    CROSS_COMPILATION_LINKOPTS = "LINKOPTS",
+)
+
+def preset_plugin(name, presets, **kwargs):
+    """Builds preset libraries into a plugin loadable at runtime.
+
+    Produces `lib<name>.so`, which registers every preset in `presets` when
+    copied into the directory passed to `--preset_plugin_dir`. The preset
+    libraries must self-register with `PresetRegistration` and be
+    `alwayslink`, as the presets under //preset are. The plugin must be built
+    with the same toolchain and configuration as the binary that loads it.
+
+    Args:
+      name: Name of the plugin.
+      presets: Labels of the preset libraries to include.
+      **kwargs: Passed through to the underlying `cc_binary`.
+    """
+    native.cc_binary(
+        name = "lib" + name + ".so",
+        copts = CROSS_COMPILATION_COPTS,
+        # Bind the plugin's references to its own copies of the libraries it
+        # links, e.g. its `PresetRegistry`, rather than to any the host
+        # exports.
+        linkopts = CROSS_COMPILATION_LINKOPTS + ["-Wl,-Bsymbolic"],
+        linkshared = 1,
+        linkstatic = 1,
+        deps = [
+            "//preset/plugin:preset_plugin_main",
+        ] + presets + CROSS_COMPILATION_DEPS,
+        **kwargs
+    )
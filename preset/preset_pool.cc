@@ -0,0 +1,59 @@
+#include "preset/preset_pool.h"
+
+#include <utility>
+#include <vector>
+
+#include "util/logging/logging.h"
+
+namespace opendrop {
+
+void PresetPool::Retire(std::shared_ptr<Preset> preset) {
+  preset->Reset();
+  const size_t memory_bytes = preset->EstimateMemoryUsage();
+  if (memory_bytes > options_.max_memory_bytes) {
+    return;
+  }
+
+  // Evicted presets release their GL resources when destroyed. Destroy them
+  // after releasing the lock.
+  std::vector<std::shared_ptr<Preset>> evicted;
+  {
+    std::unique_lock<std::mutex> lock(pool_mu_);
+    const std::type_index type = typeid(*preset);
+    entries_.push_front(Entry{type, std::move(preset), memory_bytes});
+    memory_usage_ += memory_bytes;
+
+    while (memory_usage_ > options_.max_memory_bytes) {
+      Entry& least_recent = entries_.back();
+      LOG(DEBUG) << "Evicting pooled preset " << least_recent.preset->name();
+      memory_usage_ -= least_recent.memory_bytes;
+      evicted.push_back(std::move(least_recent.preset));
+      entries_.pop_back();
+    }
+  }
+}
+
+std::shared_ptr<Preset> PresetPool::Take(std::type_index type) {
+  std::unique_lock<std::mutex> lock(pool_mu_);
+  for (auto iter = entries_.begin(); iter != entries_.end(); ++iter) {
+    if (iter->type != type) continue;
+    std::shared_ptr<Preset> preset = std::move(iter->preset);
+    memory_usage_ -= iter->memory_bytes;
+    entries_.erase(iter);
+    LOG(DEBUG) << "Reusing pooled preset " << preset->name();
+    return preset;
+  }
+  return nullptr;
+}
+
+size_t PresetPool::size() {
+  std::unique_lock<std::mutex> lock(pool_mu_);
+  return entries_.size();
+}
+
+size_t PresetPool::memory_usage() {
+  std::unique_lock<std::mutex> lock(pool_mu_);
+  return memory_usage_;
+}
+
+}  // namespace opendrop
@@ -0,0 +1,59 @@
+#ifndef PRESET_PRESET_POOL_H_
+#define PRESET_PRESET_POOL_H_
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <typeindex>
+
+#include "preset/preset.h"
+
+namespace opendrop {
+
+// Pool of retired preset instances. Reusing a retired instance for a new
+// activation avoids reallocating its render targets, framebuffers and
+// programs.
+//
+// Pooled presets keep the resources they were constructed with, so a pool must
+// only serve requests for presets built from the same texture manager. The
+// pool holds at most `max_memory_bytes` of estimated preset memory, evicting
+// the least recently retired presets beyond that. This class is thread-safe.
+class PresetPool {
+ public:
+  struct Options {
+    size_t max_memory_bytes = 64 << 20;
+  };
+
+  explicit PresetPool(Options options) : options_(options) {}
+
+  // Resets `preset` and adds it to the pool. Any presets evicted to stay
+  // within the memory cap are destroyed before this returns, so the context
+  // that renders the pooled presets must be current.
+  void Retire(std::shared_ptr<Preset> preset);
+
+  // Removes and returns the most recently retired instance whose dynamic type
+  // is `type`, or null if there is none.
+  std::shared_ptr<Preset> Take(std::type_index type);
+
+  size_t size();
+  size_t memory_usage();
+
+ private:
+  struct Entry {
+    std::type_index type;
+    std::shared_ptr<Preset> preset;
+    size_t memory_bytes;
+  };
+
+  const Options options_;
+
+  std::mutex pool_mu_;
+  // Pooled presets, most recently retired first.
+  std::list<Entry> entries_;
+  size_t memory_usage_ = 0;
+};
+
+}  // namespace opendrop
+
+#endif  // PRESET_PRESET_POOL_H_
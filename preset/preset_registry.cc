@@ -0,0 +1,203 @@
+#include "preset/preset_registry.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "util/logging/logging.h"
+#include "util/math/coefficients.h"
+#include "util/math/random.h"
+
+namespace opendrop {
+
+namespace {
+// Number of draws `Select` makes before giving up.
+constexpr int kSelectAttempts = 8;
+
+bool Matches(const PresetRegistry::Entry& entry,
+             absl::string_view name_or_tag) {
+  return entry.name == name_or_tag ||
+         std::find(entry.tags.begin(), entry.tags.end(), name_or_tag) !=
+             entry.tags.end();
+}
+}  // namespace
+
+PresetRegistry& PresetRegistry::Get() {
+  static PresetRegistry* registry = new PresetRegistry();
+  return *registry;
+}
+
+void PresetRegistry::Register(Entry entry) {
+  const std::string name = entry.name;
+  const absl::Status status = TryRegister(std::move(entry));
+  CHECK(status.ok()) << "Failed to register preset " << name << ": " << status;
+}
+
+absl::Status PresetRegistry::TryRegister(Entry entry) {
+  std::unique_lock<std::mutex> lock(registry_mu_);
+  for (const Entry& existing : entries_) {
+    if (existing.name == entry.name) {
+      return absl::AlreadyExistsError(
+          absl::StrCat("Preset ", entry.name, " registered twice"));
+    }
+  }
+  entries_.push_back(std::move(entry));
+  UpdateAliasTableLocked();
+  return absl::OkStatus();
+}
+
+absl::Status PresetRegistry::Unregister(absl::string_view name) {
+  std::unique_lock<std::mutex> lock(registry_mu_);
+  auto iter =
+      std::find_if(entries_.begin(), entries_.end(),
+                   [&](const Entry& entry) { return entry.name == name; });
+  if (iter == entries_.end()) {
+    return absl::NotFoundError(absl::StrCat("No preset named ", name));
+  }
+  entries_.erase(iter);
+  // Indices past the removed entry have shifted, so forget the last selection
+  // rather than risk avoiding the wrong preset.
+  last_selection_ = -1;
+  UpdateAliasTableLocked();
+  return absl::OkStatus();
+}
+
+absl::Status PresetRegistry::SetWeight(absl::string_view name_or_tag,
+                                       float weight) {
+  if (weight < 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Negative weight for ", name_or_tag));
+  }
+  std::unique_lock<std::mutex> lock(registry_mu_);
+  bool found = false;
+  for (Entry& entry : entries_) {
+    if (Matches(entry, name_or_tag)) {
+      entry.weight = weight;
+      found = true;
+    }
+  }
+  if (!found) {
+    return absl::NotFoundError(
+        absl::StrCat("No preset named or tagged ", name_or_tag));
+  }
+  UpdateAliasTableLocked();
+  return absl::OkStatus();
+}
+
+absl::Status PresetRegistry::SetPlaylist(absl::string_view playlist) {
+  std::vector<std::pair<std::string, float>> weights;
+  for (absl::string_view item :
+       absl::StrSplit(playlist, ',', absl::SkipWhitespace())) {
+    item = absl::StripAsciiWhitespace(item);
+    std::pair<absl::string_view, absl::string_view> parts =
+        absl::StrSplit(item, absl::MaxSplits('=', 1));
+    float weight = 1.0f;
+    if (!parts.second.empty() && !absl::SimpleAtof(parts.second, &weight)) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Invalid weight in playlist entry ", item));
+    }
+    weights.emplace_back(std::string(parts.first), weight);
+  }
+
+  // Validate the whole playlist before applying any of it.
+  {
+    std::unique_lock<std::mutex> lock(registry_mu_);
+    for (const auto& [name_or_tag, weight] : weights) {
+      if (weight < 0) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("Negative weight for ", name_or_tag));
+      }
+      if (std::none_of(entries_.begin(), entries_.end(),
+                       [&](const Entry& entry) {
+                         return Matches(entry, name_or_tag);
+                       })) {
+        return absl::NotFoundError(
+            absl::StrCat("No preset named or tagged ", name_or_tag));
+      }
+    }
+
+    for (Entry& entry : entries_) {
+      entry.weight = 0;
+      for (const auto& [name_or_tag, weight] : weights) {
+        if (Matches(entry, name_or_tag)) entry.weight = weight;
+      }
+    }
+    UpdateAliasTableLocked();
+  }
+  return absl::OkStatus();
+}
+
+std::optional<PresetRegistry::Entry> PresetRegistry::Find(
+    absl::string_view name) {
+  std::unique_lock<std::mutex> lock(registry_mu_);
+  for (const Entry& entry : entries_) {
+    if (entry.name == name) return entry;
+  }
+  return std::nullopt;
+}
+
+std::vector<PresetRegistry::Entry> PresetRegistry::entries() {
+  std::unique_lock<std::mutex> lock(registry_mu_);
+  return entries_;
+}
+
+std::optional<PresetRegistry::Entry> PresetRegistry::Select(
+    const std::function<bool(const Entry&)>& eligible, RandomStream* stream) {
+  static RandomStream* selection_stream = &Random::Stream("preset_selection");
+  if (stream == nullptr) stream = selection_stream;
+
+  for (int attempt = 0; attempt < kSelectAttempts; ++attempt) {
+    Entry entry;
+    int index;
+    {
+      std::unique_lock<std::mutex> lock(registry_mu_);
+      if (alias_table_.empty()) return std::nullopt;
+      index = alias_table_.Sample(*stream);
+      if (index == last_selection_ && num_selectable_ > 1) continue;
+      entry = entries_[index];
+    }
+
+    // `eligible` is called without the lock held, since it may well take
+    // locks of its own.
+    if (eligible && !eligible(entry)) {
+      LOG(DEBUG) << "Preset " << entry.name << " is not eligible; redrawing";
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(registry_mu_);
+    last_selection_ = index;
+    return entry;
+  }
+  return std::nullopt;
+}
+
+absl::StatusOr<std::shared_ptr<Preset>> PresetRegistry::Make(
+    const Entry& entry, PresetPool* pool,
+    std::shared_ptr<gl::GlTextureManager> texture_manager) {
+  if (pool != nullptr && entry.poolable) {
+    std::shared_ptr<Preset> preset = pool->Take(entry.type);
+    if (preset != nullptr) return preset;
+  }
+  // A construction draws a single value from the calling thread's stream,
+  // however many coefficients the preset draws, so later selections do not
+  // depend on which presets were constructed before them.
+  RandomStream construction_stream(Coefficients::Stream().NextUint64());
+  Coefficients::ScopedStream scoped_stream(construction_stream);
+  return entry.factory(std::move(texture_manager));
+}
+
+void PresetRegistry::UpdateAliasTableLocked() {
+  std::vector<float> weights;
+  weights.reserve(entries_.size());
+  num_selectable_ = 0;
+  for (const Entry& entry : entries_) {
+    weights.push_back(entry.weight);
+    if (entry.weight > 0) ++num_selectable_;
+  }
+  alias_table_ = AliasTable(weights);
+}
+
+}  // namespace opendrop
@@ -0,0 +1,140 @@
+#ifndef PRESET_PRESET_REGISTRY_H_
+#define PRESET_PRESET_REGISTRY_H_
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <typeindex>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "preset/preset.h"
+#include "preset/preset_pool.h"
+#include "util/graphics/gl_texture_manager.h"
+#include "util/math/alias_table.h"
+#include "util/math/random.h"
+
+namespace opendrop {
+
+// Process-wide registry of the presets available for selection.
+//
+// Presets register themselves at static initialization time with a
+// `PresetRegistration`, so linking a preset's library in is enough to make it
+// available, and the set of presets selected from (and how often) is
+// configured at runtime through weights instead of at compile time. Random
+// selection is by alias table, so it takes constant time regardless of the
+// number of registered presets. This class is thread-safe.
+class PresetRegistry {
+ public:
+  using Factory = std::function<absl::StatusOr<std::shared_ptr<Preset>>(
+      std::shared_ptr<gl::GlTextureManager>)>;
+
+  struct Entry {
+    // Must match the `name()` of the presets `factory` constructs.
+    std::string name;
+    Factory factory;
+    // Dynamic type of the presets `factory` constructs, for pooling.
+    std::type_index type = typeid(Preset);
+    // Whether or not retired instances may be taken from a `PresetPool`. Only
+    // set for presets whose `OnReset` returns them to the state of a freshly
+    // constructed instance, and never for presets whose type may be redefined
+    // at runtime, since instances of the old and new definitions share a type
+    // name.
+    bool poolable = false;
+    // Relative likelihood of being selected at random. Presets with a weight
+    // of zero are only constructed by name.
+    float weight = 1.0f;
+    // Descriptive tags, which may be used in place of names when configuring
+    // weights.
+    std::vector<std::string> tags;
+    // As for the `Preset` methods of the same names, so that selection can
+    // honor them without constructing an instance.
+    int max_count = Preset::kDefaultMaxPresetCount;
+    bool should_solo = false;
+    // Rough relative rendering cost per frame, in full screen passes.
+    float cost = 1.0f;
+  };
+
+  static PresetRegistry& Get();
+
+  // Adds `entry` to the registry. Names must be unique.
+  void Register(Entry entry);
+  // As `Register`, but returns an error instead of crashing if the name is
+  // already registered.
+  absl::Status TryRegister(Entry entry);
+  // Removes the preset named `name`. Instances already constructed are
+  // unaffected.
+  absl::Status Unregister(absl::string_view name);
+
+  // Sets the weight of every preset named or tagged `name_or_tag`. Returns an
+  // error if there is no such preset.
+  absl::Status SetWeight(absl::string_view name_or_tag, float weight);
+
+  // Replaces every weight according to `playlist`, a comma-separated list of
+  // preset names or tags, each optionally followed by `=weight`. Listed
+  // presets default to a weight of 1, and unlisted presets get a weight of 0.
+  // Later entries take precedence over earlier ones.
+  absl::Status SetPlaylist(absl::string_view playlist);
+
+  std::optional<Entry> Find(absl::string_view name);
+  std::vector<Entry> entries();
+
+  // Draws a preset at random according to the current weights. Draws for
+  // which `eligible` returns false, or which repeat the previous selection
+  // while another preset could be drawn, are retried a bounded number of
+  // times. Returns nothing if no eligible preset was drawn. Draws from
+  // `stream`, or from the shared "preset_selection" stream if it is null.
+  std::optional<Entry> Select(
+      const std::function<bool(const Entry&)>& eligible = nullptr,
+      RandomStream* stream = nullptr);
+
+  // Takes an instance of `entry`'s preset from `pool` if `pool` is non-null,
+  // the preset is poolable and `pool` holds one, or constructs a new instance
+  // otherwise. A new instance draws its coefficients from a stream of its own,
+  // seeded from the calling thread's `Coefficients::Stream()`.
+  static absl::StatusOr<std::shared_ptr<Preset>> Make(
+      const Entry& entry, PresetPool* pool,
+      std::shared_ptr<gl::GlTextureManager> texture_manager);
+
+ private:
+  PresetRegistry() = default;
+
+  // Rebuilds `alias_table_` from the entry weights. Must be called with
+  // `registry_mu_` held.
+  void UpdateAliasTableLocked();
+
+  std::mutex registry_mu_;
+  std::vector<Entry> entries_;
+  AliasTable alias_table_;
+  // Number of entries with a positive weight.
+  int num_selectable_ = 0;
+  int last_selection_ = -1;
+};
+
+// Registers `PresetT` with the global `PresetRegistry` on construction. The
+// factory and type of `entry` are filled in from `PresetT`. Intended to be
+// instantiated once per preset, at namespace scope in the preset's source
+// file:
+//
+//   const PresetRegistration<MyPreset> kRegistration(
+//       {.name = "MyPreset", .tags = {"2d"}});
+//
+// The library containing the registration must be `alwayslink`, so that the
+// linker does not drop it.
+template <typename PresetT>
+class PresetRegistration {
+ public:
+  explicit PresetRegistration(PresetRegistry::Entry entry) {
+    entry.factory = &PresetT::MakeShared;
+    entry.type = std::type_index(typeid(PresetT));
+    PresetRegistry::Get().Register(std::move(entry));
+  }
+};
+
+}  // namespace opendrop
+
+#endif  // PRESET_PRESET_REGISTRY_H_
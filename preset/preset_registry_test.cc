@@ -0,0 +1,141 @@
+#include "preset/preset_registry.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "googlemock/include/gmock/gmock.h"
+#include "googletest/include/gtest/gtest.h"
+#include "util/math/random.h"
+
+namespace opendrop {
+namespace {
+
+// Registers presets with the global registry, and removes them again when
+// the test ends. No presets are linked into this test, so the registry
+// otherwise starts out empty.
+class PresetRegistryTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    for (const std::string& name : names_) {
+      PresetRegistry::Get().Unregister(name).IgnoreError();
+    }
+  }
+
+  void Register(std::string name, std::vector<std::string> tags = {}) {
+    names_.push_back(name);
+    PresetRegistry::Get().Register(
+        {.name = std::move(name), .tags = std::move(tags)});
+  }
+
+  static float Weight(const std::string& name) {
+    std::optional<PresetRegistry::Entry> entry =
+        PresetRegistry::Get().Find(name);
+    EXPECT_TRUE(entry.has_value()) << name;
+    return entry.has_value() ? entry->weight : -1.0f;
+  }
+
+ private:
+  std::vector<std::string> names_;
+};
+
+TEST_F(PresetRegistryTest, PlaylistMatchesNamesAndTags) {
+  Register("A", {"round"});
+  Register("B", {"round", "square"});
+  Register("C", {"square"});
+
+  ASSERT_TRUE(PresetRegistry::Get().SetPlaylist("round").ok());
+  EXPECT_EQ(Weight("A"), 1.0f);
+  EXPECT_EQ(Weight("B"), 1.0f);
+  EXPECT_EQ(Weight("C"), 0.0f);
+
+  ASSERT_TRUE(PresetRegistry::Get().SetPlaylist("C").ok());
+  EXPECT_EQ(Weight("A"), 0.0f);
+  EXPECT_EQ(Weight("B"), 0.0f);
+  EXPECT_EQ(Weight("C"), 1.0f);
+}
+
+TEST_F(PresetRegistryTest, PlaylistParsesWeights) {
+  Register("A", {"round"});
+  Register("B", {"round"});
+
+  // Later entries take precedence over earlier ones.
+  ASSERT_TRUE(PresetRegistry::Get().SetPlaylist("round=0.5, A=2").ok());
+  EXPECT_EQ(Weight("A"), 2.0f);
+  EXPECT_EQ(Weight("B"), 0.5f);
+
+  EXPECT_FALSE(PresetRegistry::Get().SetPlaylist("A=heavy").ok());
+  EXPECT_FALSE(PresetRegistry::Get().SetPlaylist("A=-1").ok());
+}
+
+TEST_F(PresetRegistryTest, PlaylistWithUnknownNameChangesNothing) {
+  Register("A");
+  Register("B");
+  ASSERT_TRUE(PresetRegistry::Get().SetPlaylist("A=3,B=4").ok());
+
+  EXPECT_EQ(PresetRegistry::Get().SetPlaylist("A,Unknown").code(),
+            absl::StatusCode::kNotFound);
+  EXPECT_EQ(Weight("A"), 3.0f);
+  EXPECT_EQ(Weight("B"), 4.0f);
+}
+
+TEST_F(PresetRegistryTest, SelectAvoidsRepeats) {
+  Register("A");
+  Register("B");
+  Register("C");
+  RandomStream stream(1);
+
+  std::string last_name;
+  int num_selected = 0;
+  for (int i = 0; i < 100; ++i) {
+    std::optional<PresetRegistry::Entry> entry =
+        PresetRegistry::Get().Select(nullptr, &stream);
+    if (!entry.has_value()) continue;
+    EXPECT_NE(entry->name, last_name);
+    last_name = entry->name;
+    ++num_selected;
+  }
+  EXPECT_GT(num_selected, 90);
+}
+
+TEST_F(PresetRegistryTest, SelectRepeatsTheOnlySelectablePreset) {
+  Register("A");
+  Register("B");
+  ASSERT_TRUE(PresetRegistry::Get().SetPlaylist("A").ok());
+  RandomStream stream(2);
+
+  for (int i = 0; i < 10; ++i) {
+    std::optional<PresetRegistry::Entry> entry =
+        PresetRegistry::Get().Select(nullptr, &stream);
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->name, "A");
+  }
+}
+
+TEST_F(PresetRegistryTest, UnregisterForgetsLastSelection) {
+  Register("X");
+  Register("A");
+  Register("B");
+  RandomStream stream(3);
+
+  auto is = [](const std::string& name) {
+    return [name](const PresetRegistry::Entry& entry) {
+      return entry.name == name;
+    };
+  };
+  std::optional<PresetRegistry::Entry> entry;
+  for (int i = 0; i < 10 && !entry.has_value(); ++i) {
+    entry = PresetRegistry::Get().Select(is("A"), &stream);
+  }
+  ASSERT_TRUE(entry.has_value());
+
+  // Removing X moves B to the index A was selected at. Were the last
+  // selection remembered, B would be treated as a repeat and never drawn.
+  ASSERT_TRUE(PresetRegistry::Get().Unregister("X").ok());
+  entry = PresetRegistry::Get().Select(is("B"), &stream);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(entry->name, "B");
+}
+
+}  // namespace
+}  // namespace opendrop
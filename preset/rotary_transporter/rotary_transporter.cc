@@ -3,12 +3,14 @@
 #include <algorithm>
 #include <cmath>
 
+#include "preset/preset_registry.h"
 #include "preset/rotary_transporter/composite.fsh.h"
 #include "preset/rotary_transporter/passthrough.vsh.h"
 #include "preset/rotary_transporter/warp.fsh.h"
 #include "util/math/coefficients.h"
 #include "util/graphics/colors.h"
 #include "third_party/gl_helper.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "third_party/glm_helper.h"
 #include "util/logging/logging.h"
@@ -60,61 +62,78 @@ absl::StatusOr<std::shared_ptr<Preset>> RotaryTransporter::MakeShared(
 }
 
 void RotaryTransporter::OnUpdateGeometry() {
-  glViewport(0, 0, width(), height());
-  if (front_render_target_ != nullptr) {
-    front_render_target_->UpdateGeometry(width(), height());
-  }
-  if (back_render_target_ != nullptr) {
-    back_render_target_->UpdateGeometry(width(), height());
-  }
+  ResizeRenderTarget(&front_render_target_, width(), height());
+  ResizeRenderTarget(&back_render_target_, width(), height());
+  gl::GlStateCache::Current().Viewport(0, 0, width(), height());
 }
 
-void RotaryTransporter::OnDrawFrame(
-    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
-    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
+void RotaryTransporter::OnUpdate(const GlobalState& state, float dt) {
   if (bass_filter_ == nullptr) {
     // TODO: Refactor into constructor. Plumb GlobalState.
     constexpr float kCenterFrequency = 300.0f;
     constexpr float kBandwidth = 50.0f;
-    bass_filter_ = IirBandFilter(50.0f / state->sampling_rate(),
-                                 40.0f / state->sampling_rate(),
+    bass_filter_ = IirBandFilter(50.0f / state.sampling_rate(),
+                                 40.0f / state.sampling_rate(),
                                  IirBandFilterType::kBandpass);
-    vocal_filter_ = IirBandFilter(kCenterFrequency / state->sampling_rate(),
-                                  kBandwidth / state->sampling_rate(),
+    vocal_filter_ = IirBandFilter(kCenterFrequency / state.sampling_rate(),
+                                  kBandwidth / state.sampling_rate(),
                                   IirBandFilterType::kBandpass);
     left_vocal_filter_ = IirBandFilter(
-        kCenterFrequency / state->sampling_rate(),
-        kBandwidth / state->sampling_rate(), IirBandFilterType::kBandpass);
+        kCenterFrequency / state.sampling_rate(),
+        kBandwidth / state.sampling_rate(), IirBandFilterType::kBandpass);
     right_vocal_filter_ = IirBandFilter(
-        kCenterFrequency / state->sampling_rate(),
-        kBandwidth / state->sampling_rate(), IirBandFilterType::kBandpass);
+        kCenterFrequency / state.sampling_rate(),
+        kBandwidth / state.sampling_rate(), IirBandFilterType::kBandpass);
   }
 
-  float energy = state->energy();
-  float normalized_energy = state->normalized_energy();
-  float power = state->power();
-  float average_power = state->average_power();
+  float energy = state.energy();
+  float power = state.power();
+  float average_power = state.average_power();
   float normalized_power = SafeDivide(power, average_power);
 
-  bass_power_ = bass_filter_->ComputePower(state->left_channel());
-  bass_energy_ += bass_power_ * state->dt();
+  bass_power_ = bass_filter_->ComputePower(state.left_channel());
+  bass_energy_ += bass_power_ * dt;
 
-  auto buffer_size = samples.size() / 2;
-  vertices_.resize(buffer_size);
+  absl::Span<const float> left_channel = state.left_channel();
+  absl::Span<const float> right_channel = state.right_channel();
+  vertices_.resize(left_channel.size());
 
   float total_scale_factor =
       kScaleFactor *
       (0.7 + 0.3 * cos((energy * 10 + power * 10) * kFramerateScale));
 
-  for (int i = 0; i < buffer_size; ++i) {
+  for (int i = 0; i < vertices_.size(); ++i) {
     float x_scaled =
-        left_vocal_filter_->ProcessSample(samples[i * 2]) * total_scale_factor;
-    float y_scaled = right_vocal_filter_->ProcessSample(samples[i * 2 + 1]) *
+        left_vocal_filter_->ProcessSample(left_channel[i]) * total_scale_factor;
+    float y_scaled = right_vocal_filter_->ProcessSample(right_channel[i]) *
                      total_scale_factor;
 
     vertices_[i] = glm::vec2(x_scaled, y_scaled);
   }
 
+  frame_params_ = {
+      .energy = energy,
+      .normalized_energy = state.normalized_energy(),
+      .power = power,
+      .normalized_power = normalized_power,
+      .zoom_angle = zoom_angle_,
+      .tube_scale =
+          0.25f + vocal_filter_->ComputePower(state.left_channel()) * 20,
+  };
+
+  zoom_angle_ +=
+      sin(normalized_power * kFramerateScale) * bass_power_ * kFramerateScale;
+}
+
+void RotaryTransporter::OnDrawFrame(
+    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
+    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
+  const float energy = frame_params_.energy;
+  const float normalized_energy = frame_params_.normalized_energy;
+  const float power = frame_params_.power;
+  const float normalized_power = frame_params_.normalized_power;
+  const float zoom_angle = frame_params_.zoom_angle;
+
   {
     auto back_activation = back_render_target_->Activate();
 
@@ -124,7 +143,7 @@ void RotaryTransporter::OnDrawFrame(
 
     GlBindUniform(warp_program_, "power", bass_power_);
     GlBindUniform(warp_program_, "energy", bass_energy_);
-    GlBindUniform(warp_program_, "zoom_angle", zoom_angle_);
+    GlBindUniform(warp_program_, "zoom_angle", zoom_angle);
     GlBindUniform(warp_program_, "zoom_speed", zoom_speed);
     GlBindUniform(warp_program_, "framerate_scale", kFramerateScale);
     GlBindUniform(warp_program_, "last_frame_size",
@@ -145,14 +164,13 @@ void RotaryTransporter::OnDrawFrame(
     constexpr int kMaxSymmetry = 5;
     constexpr int kMinSymmetry = 3;
 
-    glm::vec3 look_vec_3d(-UnitVectorAtAngle(zoom_angle_) / 2.0f, zoom_speed);
+    glm::vec3 look_vec_3d(-UnitVectorAtAngle(zoom_angle) / 2.0f, zoom_speed);
     glm::mat3x3 rotation = OrientTowards(look_vec_3d);
 
     int petals =
         static_cast<int>(kMinSymmetry + (kMaxSymmetry - kMinSymmetry) *
                                             ((sin(energy * 10) + 1) / 2));
-    float tube_scale =
-        0.25f + vocal_filter_->ComputePower(state->left_channel()) * 20;
+    const float tube_scale = frame_params_.tube_scale;
     for (int i = 0; i < petals; ++i) {
       std::vector<glm::vec2> vertices_rotary(vertices_.size(), glm::vec2(0, 0));
       float angular_displacement = i * (M_PI * 2.0f / petals);
@@ -174,9 +192,6 @@ void RotaryTransporter::OnDrawFrame(
           energy * kFramerateScale + i / static_cast<float>(petals), 1, 1)));
       polyline_.Draw();
     }
-
-    zoom_angle_ +=
-        sin(normalized_power * kFramerateScale) * bass_power_ * kFramerateScale;
   }
 
   {
@@ -189,11 +204,20 @@ void RotaryTransporter::OnDrawFrame(
                                        back_render_target_,
                                        gl::GlTextureBindingOptions());
 
-    glViewport(0, 0, width(), height());
+    gl::GlStateCache::Current().Viewport(0, 0, width(), height());
     rectangle_.Draw();
 
     back_render_target_->swap_texture_unit(front_render_target_.get());
   }
 }
 
+namespace {
+// Not in the default rotation; select with --playlist.
+const PresetRegistration<RotaryTransporter> kRegistration(
+    {.name = "RotaryTransporter",
+     .weight = 0.0f,
+     .tags = {"2d", "feedback"},
+     .cost = 2});
+}  // namespace
+
 }  // namespace opendrop
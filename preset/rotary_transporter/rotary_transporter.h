@@ -29,6 +29,7 @@ class RotaryTransporter : public Preset {
                     std::shared_ptr<gl::GlRenderTarget> back_render_target,
                     std::shared_ptr<gl::GlTextureManager> texture_manager);
 
+  void OnUpdate(const GlobalState& state, float dt) override;
   void OnDrawFrame(
       absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
       float alpha,
@@ -41,7 +42,20 @@ class RotaryTransporter : public Preset {
   std::shared_ptr<gl::GlRenderTarget> front_render_target_;
   std::shared_ptr<gl::GlRenderTarget> back_render_target_;
 
+  // Parameters of the next frame, other than its waveform.
+  struct FrameParams {
+    float energy = 0.0f;
+    float normalized_energy = 0.0f;
+    float power = 0.0f;
+    float normalized_power = 0.0f;
+    float zoom_angle = 0.0f;
+    float tube_scale = 0.0f;
+  };
+
+  // Frame state prepared by `OnUpdate` for the next `OnDrawFrame`.
   std::vector<glm::vec2> vertices_;
+  FrameParams frame_params_;
+
   Rectangle rectangle_;
   Polyline polyline_;
 
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <cmath>
 
+#include "preset/preset_registry.h"
 #include "preset/shape_bounce/composite.fsh.h"
 #include "preset/shape_bounce/ngon.fsh.h"
 #include "preset/shape_bounce/passthrough.vsh.h"
@@ -10,6 +11,7 @@
 #include "util/math/coefficients.h"
 #include "util/graphics/colors.h"
 #include "third_party/gl_helper.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "third_party/glm_helper.h"
 #include "util/logging/logging.h"
@@ -56,33 +58,52 @@ absl::StatusOr<std::shared_ptr<Preset>> ShapeBounce::MakeShared(
 }
 
 void ShapeBounce::OnUpdateGeometry() {
-  glViewport(0, 0, width(), height());
-  if (front_render_target_ != nullptr) {
-    front_render_target_->UpdateGeometry(width(), height());
-  }
-  if (back_render_target_ != nullptr) {
-    back_render_target_->UpdateGeometry(width(), height());
-  }
+  ResizeRenderTarget(&front_render_target_, width(), height());
+  ResizeRenderTarget(&back_render_target_, width(), height());
+  gl::GlStateCache::Current().Viewport(0, 0, width(), height());
 }
 
-void ShapeBounce::OnDrawFrame(
-    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
-    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
+void ShapeBounce::OnUpdate(const GlobalState& state, float dt) {
   if (bass_filter_ == nullptr) {
     // TODO: Refactor into constructor. Plumb GlobalState.
-    bass_filter_ = IirBandFilter(50.0f / state->sampling_rate(),
-                                 40.0f / state->sampling_rate(),
+    bass_filter_ = IirBandFilter(50.0f / state.sampling_rate(),
+                                 40.0f / state.sampling_rate(),
                                  IirBandFilterType::kBandpass);
     bass_power_filter_ = std::make_shared<HystereticMapFilter>(
-        IirSinglePoleFilter(1.0f / state->sampling_rate(),
+        IirSinglePoleFilter(1.0f / state.sampling_rate(),
                             IirSinglePoleFilterType::kLowpass),
         0.999f);
   }
-  float energy = state->energy();
-  float power = state->power();
+  float energy = state.energy();
+  float power = state.power();
+
+  const float bass_power = bass_filter_->ComputePower(state.left_channel());
+
+  // velocity_ -= glm::vec2(0, 10) * dt;
+  position_ += velocity_ * dt;
+  velocity_ += glm::vec2(cos(energy), sin(energy)) * power * 10.0f * dt;
+
+  velocity_ = velocity_ * 0.999f;
+
+  if ((position_.x < -1 && velocity_.x < 0) ||
+      (position_.x > 1 && velocity_.x > 0)) {
+    velocity_.x = -velocity_.x;
+  }
+  if ((position_.y < -1 && velocity_.y < 0) ||
+      (position_.y > 1 && velocity_.y > 0)) {
+    velocity_.y = -velocity_.y;
+  }
+
+  power_ = power;
+  energy_ = energy;
+  mapped_bass_power_ = bass_power_filter_->ProcessSample(bass_power);
+}
 
-  const float bass_power = bass_filter_->ComputePower(state->left_channel());
-  const float mapped_bass_power = bass_power_filter_->ProcessSample(bass_power);
+void ShapeBounce::OnDrawFrame(
+    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
+    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
+  const float energy = energy_;
+  const float power = power_;
 
   {
     auto back_activation = back_render_target_->Activate();
@@ -101,25 +122,9 @@ void ShapeBounce::OnDrawFrame(
     // Force all fragments to draw with a full-screen rectangle.
     rectangle_.Draw();
 
-    // velocity_ -= glm::vec2(0, 10) * state->dt();
-    position_ += velocity_ * state->dt();
-    velocity_ +=
-        glm::vec2(cos(energy), sin(energy)) * power * 10.0f * state->dt();
-
-    velocity_ = velocity_ * 0.999f;
-
-    if ((position_.x < -1 && velocity_.x < 0) ||
-        (position_.x > 1 && velocity_.x > 0)) {
-      velocity_.x = -velocity_.x;
-    }
-    if ((position_.y < -1 && velocity_.y < 0) ||
-        (position_.y > 1 && velocity_.y > 0)) {
-      velocity_.y = -velocity_.y;
-    }
-
     ngon_program_->Use();
     glm::vec3 translation(position_.x, position_.y, 0);
-    const float scale = MapValue<float>(mapped_bass_power, 0, 1, 0.1, 0.5);
+    const float scale = MapValue<float>(mapped_bass_power_, 0, 1, 0.1, 0.5);
     glm::mat4 transform =
         glm::mat4x4(scale, 0, 0, 0,                                 // Row 1
                     0, scale, 0, 0,                                 // Row 2
@@ -148,11 +153,20 @@ void ShapeBounce::OnDrawFrame(
                                        gl::GlTextureBindingOptions());
     GlBindUniform(composite_program_, "model_transform", glm::mat4(1.0f));
 
-    glViewport(0, 0, width(), height());
+    gl::GlStateCache::Current().Viewport(0, 0, width(), height());
     rectangle_.Draw();
 
     back_render_target_->swap_texture_unit(front_render_target_.get());
   }
 }
 
+namespace {
+// Not in the default rotation; select with --playlist.
+const PresetRegistration<ShapeBounce> kRegistration(
+    {.name = "ShapeBounce",
+     .weight = 0.0f,
+     .tags = {"2d", "feedback"},
+     .cost = 2});
+}  // namespace
+
 }  // namespace opendrop
@@ -31,6 +31,7 @@ class ShapeBounce : public Preset {
               std::shared_ptr<gl::GlRenderTarget> back_render_target,
               std::shared_ptr<gl::GlTextureManager> texture_manager, int n);
 
+  void OnUpdate(const GlobalState& state, float dt) override;
   void OnDrawFrame(
       absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
       float alpha,
@@ -50,6 +51,11 @@ class ShapeBounce : public Preset {
   glm::vec2 velocity_{0, 0};
   glm::vec2 position_{0, 0};
 
+  // Frame state prepared by `OnUpdate` for the next `OnDrawFrame`.
+  float power_ = 0.0f;
+  float energy_ = 0.0f;
+  float mapped_bass_power_ = 0.0f;
+
   std::shared_ptr<IirFilter> bass_filter_;
   std::shared_ptr<HystereticMapFilter> bass_power_filter_;
 };
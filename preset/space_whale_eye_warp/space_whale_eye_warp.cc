@@ -6,6 +6,7 @@
 #include "debug/control_injector.h"
 #include "debug/signal_scope.h"
 #include "preset/common/outline_model.h"
+#include "preset/preset_registry.h"
 #include "preset/space_whale_eye_warp/composite.fsh.h"
 #include "preset/space_whale_eye_warp/passthrough_frag.fsh.h"
 #include "preset/space_whale_eye_warp/passthrough_vert.vsh.h"
@@ -14,6 +15,8 @@
 #include "third_party/glm_helper.h"
 #include "util/enums.h"
 #include "util/graphics/colors.h"
+#include "util/graphics/gl_state_cache.h"
+#include "util/graphics/gl_texture_format.h"
 #include "util/graphics/gl_util.h"
 #include "util/logging/logging.h"
 #include "util/math/math.h"
@@ -34,7 +37,6 @@ SpaceWhaleEyeWarp::SpaceWhaleEyeWarp(
     std::shared_ptr<gl::GlRenderTarget> back_render_target,
     std::shared_ptr<gl::GlRenderTarget> back_front_render_target,
     std::shared_ptr<gl::GlRenderTarget> back_back_render_target,
-    std::shared_ptr<gl::GlRenderTarget> depth_output_target,
     std::shared_ptr<OutlineModel> outline_model,
     std::shared_ptr<gl::GlTextureManager> texture_manager)
     : Preset(texture_manager),
@@ -46,7 +48,6 @@ SpaceWhaleEyeWarp::SpaceWhaleEyeWarp(
       back_render_target_(back_render_target),
       back_front_render_target_(back_front_render_target),
       back_back_render_target_(back_back_render_target),
-      depth_output_target_(depth_output_target),
       outline_model_(outline_model)
 
 {
@@ -65,51 +66,55 @@ absl::StatusOr<std::shared_ptr<Preset>> SpaceWhaleEyeWarp::MakeShared(
   ASSIGN_OR_RETURN(auto passthrough_program,
                    gl::GlProgram::MakeShared(passthrough_vert_vsh::Code(),
                                              passthrough_frag_fsh::Code()));
+  // The warp fades the accumulated image a little each frame, which bands
+  // visibly at 8 bits per channel. The four targets trade textures, so they
+  // share a format.
+  const gl::GlRenderTarget::Options feedback_options = {
+      .color_format = gl::FeedbackColorFormat()};
   ASSIGN_OR_RETURN(auto front_render_target,
-                   gl::GlRenderTarget::MakeShared(0, 0, texture_manager));
+                   gl::GlRenderTarget::MakeShared(0, 0, texture_manager,
+                                                  feedback_options));
   ASSIGN_OR_RETURN(auto back_render_target,
-                   gl::GlRenderTarget::MakeShared(0, 0, texture_manager));
+                   gl::GlRenderTarget::MakeShared(0, 0, texture_manager,
+                                                  feedback_options));
   ASSIGN_OR_RETURN(auto back_front_render_target,
-                   gl::GlRenderTarget::MakeShared(0, 0, texture_manager));
+                   gl::GlRenderTarget::MakeShared(0, 0, texture_manager,
+                                                  feedback_options));
   ASSIGN_OR_RETURN(auto back_back_render_target,
-                   gl::GlRenderTarget::MakeShared(0, 0, texture_manager));
-  ASSIGN_OR_RETURN(auto depth_output_target,
                    gl::GlRenderTarget::MakeShared(0, 0, texture_manager,
-                                                  {.enable_depth = true}));
+                                                  feedback_options));
   ASSIGN_OR_RETURN(auto outline_model, OutlineModel::MakeShared());
 
   return std::shared_ptr<SpaceWhaleEyeWarp>(new SpaceWhaleEyeWarp(
       warp_program, composite_program, passthrough_program, nullptr,
       front_render_target, back_render_target, back_front_render_target,
-      back_back_render_target, depth_output_target, outline_model,
-      texture_manager));
+      back_back_render_target, outline_model, texture_manager));
 }
 
 void SpaceWhaleEyeWarp::OnUpdateGeometry() {
-  glViewport(0, 0, width(), height());
-  if (model_texture_target_ != nullptr) {
-    model_texture_target_->UpdateGeometry(longer_dimension(),
-                                          longer_dimension());
-  }
-  if (front_render_target_ != nullptr) {
-    front_render_target_->UpdateGeometry(longer_dimension(),
-                                         longer_dimension());
-  }
-  if (back_render_target_ != nullptr) {
-    back_render_target_->UpdateGeometry(longer_dimension(), longer_dimension());
-  }
-  if (back_front_render_target_ != nullptr) {
-    back_front_render_target_->UpdateGeometry(longer_dimension(),
-                                              longer_dimension());
-  }
-  if (back_back_render_target_ != nullptr) {
-    back_back_render_target_->UpdateGeometry(longer_dimension(),
-                                             longer_dimension());
-  }
-  if (depth_output_target_ != nullptr) {
-    depth_output_target_->UpdateGeometry(longer_dimension(),
-                                         longer_dimension());
+  ResizeRenderTarget(&model_texture_target_, longer_dimension(),
+                     longer_dimension());
+  ResizeRenderTarget(&front_render_target_, longer_dimension(),
+                     longer_dimension());
+  ResizeRenderTarget(&back_render_target_, longer_dimension(),
+                     longer_dimension());
+  ResizeRenderTarget(&back_front_render_target_, longer_dimension(),
+                     longer_dimension());
+  ResizeRenderTarget(&back_back_render_target_, longer_dimension(),
+                     longer_dimension());
+  gl::GlStateCache::Current().Viewport(0, 0, width(), height());
+}
+
+size_t SpaceWhaleEyeWarp::EstimateMemoryUsage() const {
+  size_t memory_bytes = 0;
+  for (const auto& render_target :
+       {model_texture_target_, front_render_target_, back_render_target_,
+        back_front_render_target_, back_back_render_target_}) {
+    if (render_target != nullptr) {
+      memory_bytes += render_target->EstimateMemoryUsage();
+    }
   }
+  return memory_bytes;
 }
 
 void SpaceWhaleEyeWarp::DrawEyeball(GlobalState& state, glm::vec3 zoom_vec,
@@ -167,11 +172,9 @@ void SpaceWhaleEyeWarp::DrawWhale(GlobalState& state, glm::vec3 zoom_vec,
   });
 }
 
-void SpaceWhaleEyeWarp::OnDrawFrame(
-    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
-    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
+void SpaceWhaleEyeWarp::OnUpdate(const GlobalState& state, float dt) {
   for (int i = 0; i < 3; ++i) {
-    beat_estimators_[i].Estimate(state->channel_band(i), state->dt());
+    beat_estimators_[i].Estimate(state.channel_band(i), dt);
   }
   float transition_input =
       SIGINJECT_OVERRIDE("transition_input", 0.0f, -1.0f, 1.0f);
@@ -182,8 +185,7 @@ void SpaceWhaleEyeWarp::OnDrawFrame(
   SIGPLOT_ON("lead_out_value", transition_controller_.LeadOutValue());
   SIGPLOT_ON("transition_count", transition_controller_.TransitionCount());
 
-  float pupil_size =
-      0.5f + (1.0f + beat_estimators_[0].triangle_phase()) / 2.0f;
+  pupil_size_ = 0.5f + (1.0f + beat_estimators_[0].triangle_phase()) / 2.0f;
 
   glm::vec3 zoom_vec =
       glm::vec3(UnitVectorAtAngle(zoom_angle_), 0) + Directions::kIntoScreen;
@@ -199,14 +201,14 @@ void SpaceWhaleEyeWarp::OnDrawFrame(
       zoom_filters_[2]->ProcessSample(
           SIGINJECT_OVERRIDE("zoom_vec_z", zoom_vec.z, -1.0f, 1.0f)));
 
-  zoom_vec = glm::normalize(zoom_vec);
+  zoom_vec_ = glm::normalize(zoom_vec);
 
-  glm::vec3 look_zoom_vec =
-      Lerp(zoom_vec, Directions::kIntoScreen,
+  look_zoom_vec_ =
+      Lerp(zoom_vec_, Directions::kIntoScreen,
            std::min(transition_controller_.LeadOutValue() * 3.0f, 1.0f));
 
   zoom_angle_ += (0.3 + (beat_estimators_[0].triangle_phase() *
-                         sin(state->energy() * 10))) /
+                         sin(state.energy() * 10))) /
                  10;
 
   float eye_scale =
@@ -234,14 +236,71 @@ void SpaceWhaleEyeWarp::OnDrawFrame(
 
   SIGPLOT_ON("modified_eye_scale", eye_scale);
   SIGPLOT_ON("modified_whale_scale", whale_scale);
+  eye_scale_ = eye_scale;
+  whale_scale_ = whale_scale;
 
+  background_hue_ += state.power() *
+                     SIGINJECT_OVERRIDE("space_whale_eye_warp_border_hue_coeff",
+                                        0.1f, 0.0f, 0.5f);
+
+  const float background_value = SIGINJECT_OVERRIDE(
+      "space_whale_eye_warp_border_value_coeff", 1.0f, 0.0f, 1.0f);
+
+  glm::vec4 rainbow_border =
+      glm::vec4(HsvToRgb(glm::vec3(background_hue_, 1, background_value)), 1);
+
+  glm::vec4 black_and_white_border = glm::vec4(0, 0, 0, 1);
   {
-    auto depth_output_activation = depth_output_target_->Activate();
-    glViewport(0, 0, longer_dimension(), longer_dimension());
+    bool white = std::fmod(background_hue_ * 10.0f, 1.0f) > 0.5f;
+    if (white)
+      black_and_white_border =
+          glm::vec4(glm::vec3(1, 1, 1) * background_value, 1);
+  }
+
+  if (transition_controller_.Transitioned()) {
+    // Swapping twice is a no-op, so transitions that happen while the preset
+    // is hidden toggle the pending swap rather than queueing it.
+    swap_feedback_pending_ = !swap_feedback_pending_;
+
+    num_eyeballs_ = Coefficients::Random<1, int>(1, 6)[0];
+    energy_coefficient_ = Coefficients::Random<1, float>(0.05f, 1.0f)[0];
+    bias_color_ = HsvToRgb(
+        glm::vec3(Coefficients::Random<1, float>(0, 2 * kPi)[0], 1, 1));
+  }
+  if (transition_controller_.TransitionCount() % 2 == 1) {
+    front_border_ = black_and_white_border;
+    back_border_ = rainbow_border;
+  } else {
+    back_border_ = black_and_white_border;
+    front_border_ = rainbow_border;
+  }
+}
+
+void SpaceWhaleEyeWarp::OnDrawFrame(
+    absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
+    float alpha, std::shared_ptr<gl::GlRenderTarget> output_render_target) {
+  float pupil_size = pupil_size_;
+  const float eye_scale = eye_scale_;
+  const float whale_scale = whale_scale_;
+
+  // The depth target is only read within this frame, so it is leased from the
+  // pool shared with the other presets in the blend. Nothing uses stencil, so
+  // its depth is 16-bit.
+  std::shared_ptr<gl::GlRenderTarget> depth_output_target =
+      LeaseScratchRenderTarget({.enable_depth = true,
+                                .depth_format = gl::GlDepthFormat::kDepth16});
+  if (depth_output_target == nullptr) {
+    return;
+  }
+
+  {
+    auto depth_output_activation = depth_output_target->Activate();
+    gl::GlStateCache::Current().Viewport(0, 0, longer_dimension(),
+                                         longer_dimension());
     glClearColor(0, 0, 0, 0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glDepthRange(0, 10);
-    glEnable(GL_DEPTH_TEST);
+    gl::GlStateCache::Current().Enable(GL_DEPTH_TEST);
 
     if (eye_scale != 0.0f || whale_scale != 0.0f) {
       if (transition_controller_.TransitionCount() % 2 == 0) {
@@ -261,7 +320,7 @@ void SpaceWhaleEyeWarp::OnDrawFrame(
                                      UnitarySin(state->energy() * 10)));
           }
           DrawEyeball(
-              *state, look_zoom_vec, pupil_size, eye_scale * scale_modifier,
+              *state, look_zoom_vec_, pupil_size, eye_scale * scale_modifier,
               std::min(1.0f, 0.1f + transition_controller_.LeadOutValue()),
               true
               /*transition_controller_.TransitionCount() % 2 == 0*/,
@@ -271,60 +330,29 @@ void SpaceWhaleEyeWarp::OnDrawFrame(
         pupil_size =
             Lerp(pupil_size, 100.0f, transition_controller_.LeadOutValue());
         DrawEyeball(
-            *state, look_zoom_vec, pupil_size, eye_scale / 4,
+            *state, look_zoom_vec_, pupil_size, eye_scale / 4,
             std::min(1.0f, 0.1f + transition_controller_.LeadOutValue()),
             true /*transition_controller_.TransitionCount() % 2 == 0*/,
             glm::vec3(-0.2, 0.15, -0.25));
         DrawEyeball(
-            *state, look_zoom_vec, pupil_size, eye_scale / 4,
+            *state, look_zoom_vec_, pupil_size, eye_scale / 4,
             std::min(1.0f, 0.1f + transition_controller_.LeadOutValue()),
             true /*transition_controller_.TransitionCount() % 2 == 0*/,
             glm::vec3(0.2, 0.15, -0.25));
-        DrawWhale(*state, look_zoom_vec, whale_scale,
+        DrawWhale(*state, look_zoom_vec_, whale_scale,
                   std::clamp<float>((1 + sin(state->mid_energy() * 200)) / 2 +
                                         state->mid() * 3,
                                     0.0f, 1.0f));
       }
     }
 
-    glDisable(GL_DEPTH_TEST);
-  }
-
-  background_hue_ += state->power() *
-                     SIGINJECT_OVERRIDE("space_whale_eye_warp_border_hue_coeff",
-                                        0.1f, 0.0f, 0.5f);
-
-  const float background_value = SIGINJECT_OVERRIDE(
-      "space_whale_eye_warp_border_value_coeff", 1.0f, 0.0f, 1.0f);
-
-  glm::vec4 rainbow_border =
-      glm::vec4(HsvToRgb(glm::vec3(background_hue_, 1, background_value)), 1);
-
-  glm::vec4 black_and_white_border = glm::vec4(0, 0, 0, 1);
-  {
-    bool white = std::fmod(background_hue_ * 10.0f, 1.0f) > 0.5f;
-    if (white)
-      black_and_white_border =
-          glm::vec4(glm::vec3(1, 1, 1) * background_value, 1);
+    gl::GlStateCache::Current().Disable(GL_DEPTH_TEST);
   }
 
-  glm::vec4 front_border, back_border;
-  if (transition_controller_.Transitioned()) {
+  if (swap_feedback_pending_) {
     front_render_target_->swap_texture_unit(back_front_render_target_.get());
     back_back_render_target_->swap_texture_unit(back_render_target_.get());
-
-    num_eyeballs_ = Coefficients::Random<1, int>(1, 6)[0];
-    energy_coefficient_ = Coefficients::Random<1, float>(0.05f, 1.0f)[0];
-    bias_color_ = HsvToRgb(
-        glm::vec3(Coefficients::Random<1, float>(0, 2 * kPi)[0], 1, 1));
-  }
-  if (transition_controller_.TransitionCount() % 2 == 1) {
-    front_border = black_and_white_border;
-    back_border = rainbow_border;
-
-  } else {
-    back_border = black_and_white_border;
-    front_border = rainbow_border;
+    swap_feedback_pending_ = false;
   }
 
   {
@@ -337,19 +365,20 @@ void SpaceWhaleEyeWarp::OnDrawFrame(
     GlBindUniform(warp_program_, "energy", state->energy());
     // Figure out how to keep it from zooming towards the viewer when the line
     // is moving
-    GlBindUniform(warp_program_, "zoom_vec", zoom_vec);
+    GlBindUniform(warp_program_, "zoom_vec", zoom_vec_);
     GlBindUniform(warp_program_, "model_transform", glm::mat4(1.0f));
     auto binding_options = gl::GlTextureBindingOptions();
-    binding_options.border_color = front_border;
+    binding_options.border_color = front_border_;
     binding_options.sampling_mode = gl::GlTextureSamplingMode::kClampToBorder;
     GlBindRenderTargetTextureToUniform(warp_program_, "last_frame",
                                        back_render_target_, binding_options);
     GlBindRenderTargetTextureToUniform(warp_program_, "input",
-                                       depth_output_target_, binding_options);
+                                       depth_output_target, binding_options);
     GlBindUniform(warp_program_, "input_enable",
                   transition_controller_.TransitionCount() % 2 == 0);
 
-    glViewport(0, 0, longer_dimension(), longer_dimension());
+    gl::GlStateCache::Current().Viewport(0, 0, longer_dimension(),
+                                         longer_dimension());
     rectangle_.Draw();
   }
   {
@@ -362,16 +391,17 @@ void SpaceWhaleEyeWarp::OnDrawFrame(
     GlBindUniform(warp_program_, "energy", state->energy());
     // Figure out how to keep it from zooming towards the viewer when the line
     // is moving
-    GlBindUniform(warp_program_, "zoom_vec", zoom_vec);
+    GlBindUniform(warp_program_, "zoom_vec", zoom_vec_);
     GlBindUniform(warp_program_, "model_transform", glm::mat4(1.0f));
     auto binding_options = gl::GlTextureBindingOptions();
-    binding_options.border_color = back_border;
+    binding_options.border_color = back_border_;
     binding_options.sampling_mode = gl::GlTextureSamplingMode::kClampToBorder;
     GlBindRenderTargetTextureToUniform(
         warp_program_, "last_frame", back_back_render_target_, binding_options);
     GlBindUniform(warp_program_, "input_enable", false);
 
-    glViewport(0, 0, longer_dimension(), longer_dimension());
+    gl::GlStateCache::Current().Viewport(0, 0, longer_dimension(),
+                                         longer_dimension());
     rectangle_.Draw();
   }
 
@@ -386,7 +416,7 @@ void SpaceWhaleEyeWarp::OnDrawFrame(
                                        front_render_target_,
                                        gl::GlTextureBindingOptions());
     GlBindRenderTargetTextureToUniform(composite_program_, "input",
-                                       depth_output_target_,
+                                       depth_output_target,
                                        gl::GlTextureBindingOptions());
     GlBindUniform(composite_program_, "input_enable",
                   transition_controller_.TransitionCount() % 2 == 1);
@@ -400,4 +430,14 @@ void SpaceWhaleEyeWarp::OnDrawFrame(
   }
 }
 
+namespace {
+// Not in the default rotation; select with --playlist.
+const PresetRegistration<SpaceWhaleEyeWarp> kRegistration(
+    {.name = "SpaceWhaleEyeWarp",
+     .weight = 0.0f,
+     .tags = {"3d", "feedback"},
+     .max_count = 1,
+     .cost = 7});
+}  // namespace
+
 }  // namespace opendrop
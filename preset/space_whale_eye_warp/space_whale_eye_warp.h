@@ -26,6 +26,7 @@ class SpaceWhaleEyeWarp : public Preset {
   std::string name() const override { return "SpaceWhaleEyeWarp"; }
 
   int max_count() const override { return 1; }
+  size_t EstimateMemoryUsage() const override;
 
  protected:
   SpaceWhaleEyeWarp(
@@ -37,10 +38,10 @@ class SpaceWhaleEyeWarp : public Preset {
       std::shared_ptr<gl::GlRenderTarget> back_back_render_target,
       std::shared_ptr<gl::GlRenderTarget> front_render_target,
       std::shared_ptr<gl::GlRenderTarget> back_render_target,
-      std::shared_ptr<gl::GlRenderTarget> depth_output_target,
       std::shared_ptr<OutlineModel> outline_model,
       std::shared_ptr<gl::GlTextureManager> texture_manager);
 
+  void OnUpdate(const GlobalState& state, float dt) override;
   void OnDrawFrame(
       absl::Span<const float> samples, std::shared_ptr<GlobalState> state,
       float alpha,
@@ -64,7 +65,6 @@ class SpaceWhaleEyeWarp : public Preset {
   std::shared_ptr<gl::GlRenderTarget> back_render_target_;
   std::shared_ptr<gl::GlRenderTarget> back_front_render_target_;
   std::shared_ptr<gl::GlRenderTarget> back_back_render_target_;
-  std::shared_ptr<gl::GlRenderTarget> depth_output_target_;
   std::shared_ptr<OutlineModel> outline_model_;
 
   std::vector<glm::vec2> vertices_;
@@ -99,6 +99,18 @@ class SpaceWhaleEyeWarp : public Preset {
       IirSinglePoleFilter(kCutoff, IirSinglePoleFilterType::kLowpass),
       IirSinglePoleFilter(kCutoff, IirSinglePoleFilterType::kLowpass),
       IirSinglePoleFilter(kCutoff, IirSinglePoleFilterType::kLowpass)};
+
+  // Frame state prepared by `OnUpdate` for the next `OnDrawFrame`.
+  float pupil_size_ = 1.0f;
+  float eye_scale_ = 0.0f;
+  float whale_scale_ = 0.0f;
+  glm::vec3 zoom_vec_ = glm::vec3(0, 0, 1);
+  glm::vec3 look_zoom_vec_ = glm::vec3(0, 0, 1);
+  glm::vec4 front_border_ = glm::vec4(0, 0, 0, 1);
+  glm::vec4 back_border_ = glm::vec4(0, 0, 0, 1);
+  // Whether the front and back feedback layers must trade places before the
+  // next frame is drawn.
+  bool swap_feedback_pending_ = false;
 };
 
 }  // namespace opendrop
@@ -3,11 +3,13 @@
 #include <algorithm>
 #include <cmath>
 
+#include "preset/preset_registry.h"
 #include "preset/template_preset/composite.fsh.h"
 #include "preset/template_preset/passthrough.vsh.h"
 #include "preset/template_preset/warp.fsh.h"
 #include "util/graphics/colors.h"
 #include "third_party/gl_helper.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/graphics/gl_util.h"
 #include "third_party/glm_helper.h"
 #include "util/logging/logging.h"
@@ -50,13 +52,9 @@ absl::StatusOr<std::shared_ptr<Preset>> TemplatePreset::MakeShared(
 }
 
 void TemplatePreset::OnUpdateGeometry() {
-  glViewport(0, 0, width(), height());
-  if (front_render_target_ != nullptr) {
-    front_render_target_->UpdateGeometry(width(), height());
-  }
-  if (back_render_target_ != nullptr) {
-    back_render_target_->UpdateGeometry(width(), height());
-  }
+  ResizeRenderTarget(&front_render_target_, width(), height());
+  ResizeRenderTarget(&back_render_target_, width(), height());
+  gl::GlStateCache::Current().Viewport(0, 0, width(), height());
 }
 
 void TemplatePreset::OnDrawFrame(
@@ -118,11 +116,17 @@ void TemplatePreset::OnDrawFrame(
                                        back_render_target_,
                                        gl::GlTextureBindingOptions());
 
-    glViewport(0, 0, width(), height());
+    gl::GlStateCache::Current().Viewport(0, 0, width(), height());
     rectangle_.Draw();
 
     back_render_target_->swap_texture_unit(front_render_target_.get());
   }
 }
 
+namespace {
+// Not in the default rotation; select with --playlist.
+const PresetRegistration<TemplatePreset> kRegistration(
+    {.name = "TemplatePreset", .weight = 0.0f, .tags = {"example"}, .cost = 2});
+}  // namespace
+
 }  // namespace opendrop
@@ -1,10 +1,52 @@
 #include "primitive/model.h"
 
+#include <cstddef>
+#include <cstdint>
+
 #include "third_party/gl_helper.h"
+#include "util/graphics/gl_state_cache.h"
+#include "util/logging/logging.h"
 
 namespace opendrop {
 
+namespace {
+const void* BufferOffset(size_t offset) {
+  return reinterpret_cast<const void*>(static_cast<uintptr_t>(offset));
+}
+}  // namespace
+
 void Model::Draw() {
+  if (!EnableMeshArrays()) {
+    DrawClientArrays();
+    return;
+  }
+  glDrawElements(GL_TRIANGLES, mesh_->num_indices, mesh_->index_type,
+                 BufferOffset(mesh_->index_offset));
+  DisableMeshArrays();
+}
+
+void Model::DrawInstanced(int num_instances) {
+  if (!EnableMeshArrays()) {
+    LOG(ERROR) << "Instanced draws require buffer objects";
+    return;
+  }
+  glDrawElementsInstanced(GL_TRIANGLES, mesh_->num_indices, mesh_->index_type,
+                          BufferOffset(mesh_->index_offset), num_instances);
+  DisableMeshArrays();
+}
+
+bool Model::EnableMeshArrays() {
+  if (mesh_ == nullptr) {
+    mesh_ = gl::GlMeshStore::Get().FindOrUpload(vertices_, normals_, uvs_,
+                                                triangles_);
+    if (mesh_ == nullptr) return false;
+  }
+
+  gl::GlStateCache& state_cache = gl::GlStateCache::Current();
+  state_cache.BindOwnVertexArray();
+  state_cache.BindBuffer(GL_ARRAY_BUFFER, mesh_->vertex_buffer);
+  state_cache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_->index_buffer);
+
   glEnableClientState(GL_VERTEX_ARRAY);
   glEnableClientState(GL_TEXTURE_COORD_ARRAY);
   glEnableClientState(GL_NORMAL_ARRAY);
@@ -12,6 +54,32 @@ void Model::Draw() {
   // TODO: Enable depth testing. Needs an additional attachment to the render
   // context. glEnable(GL_DEPTH_TEST);
 
+  constexpr int kStride = sizeof(gl::GlMeshStore::Vertex);
+  glVertexPointer(
+      3, GL_FLOAT, kStride,
+      BufferOffset(mesh_->vertex_offset +
+                   offsetof(gl::GlMeshStore::Vertex, position)));
+  glTexCoordPointer(2, GL_FLOAT, kStride,
+                    BufferOffset(mesh_->vertex_offset +
+                                 offsetof(gl::GlMeshStore::Vertex, uv)));
+  glNormalPointer(GL_FLOAT, kStride,
+                  BufferOffset(mesh_->vertex_offset +
+                               offsetof(gl::GlMeshStore::Vertex, normal)));
+  return true;
+}
+
+void Model::DisableMeshArrays() {
+  glDisableClientState(GL_NORMAL_ARRAY);
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void Model::DrawClientArrays() {
+  gl::GlStateCache::Current().UseClientArrays();
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glEnableClientState(GL_NORMAL_ARRAY);
+
   glVertexPointer(3, GL_FLOAT, 0, vertices_.data());
   glTexCoordPointer(2, GL_FLOAT, 0, uvs_.data());
   if (normals_.size()) glNormalPointer(GL_FLOAT, 0, normals_.data());
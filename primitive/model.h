@@ -4,9 +4,12 @@
 #include "absl/types/span.h"
 #include "primitive/primitive.h"
 #include "third_party/glm_helper.h"
+#include "util/graphics/gl_mesh_store.h"
 
 namespace opendrop {
 
+// A static mesh. The mesh data must be static; it is uploaded to the
+// `gl::GlMeshStore` on first draw, and drawn from there.
 class Model : public Primitive {
  public:
   Model(absl::Span<const glm::vec3> vertices, absl::Span<const glm::vec2> uvs,
@@ -20,12 +23,25 @@ class Model : public Primitive {
         uvs_(uvs),
         triangles_(triangles) {}
   void Draw() override;
+  // Draws `num_instances` copies of the mesh in one draw call, for vertex
+  // shaders that read per-instance attributes, which the caller sets up.
+  // Requires `gl::GlCapabilities::instanced_arrays()`.
+  void DrawInstanced(int num_instances);
 
  private:
+  // Uploads the mesh if needed, and points the vertex arrays at it. Returns
+  // false where buffer objects are unsupported.
+  bool EnableMeshArrays();
+  void DisableMeshArrays();
+  // Draws from the spans, where buffer objects are unsupported.
+  void DrawClientArrays();
+
   absl::Span<const glm::vec3> vertices_;
   absl::Span<const glm::vec3> normals_;
   absl::Span<const glm::vec2> uvs_;
   absl::Span<const glm::uvec3> triangles_;
+  // Location of the mesh in the store, once uploaded.
+  const gl::GlMeshStore::Mesh* mesh_ = nullptr;
 };
 
 }  // namespace opendrop
@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "third_party/gl_helper.h"
+#include "util/graphics/gl_state_cache.h"
 
 namespace opendrop {
 
@@ -19,23 +20,23 @@ void AddNgonPoint(float theta, std::vector<float>* vertices) {
 
 Ngon::Ngon(int n) {
   vertices_ = {0.0, 0.0, kDepth};
-  indices_.push_back(0);
   for (int i = 0; i < n; ++i) {
     AddNgonPoint(2 * M_PI * i / n, &vertices_);
-    indices_.push_back(i + 1);
   }
-  // Close the polygon by adding a final triangle to vertex #1.
-  indices_.push_back(1);
+  // Close the polygon by adding a final triangle back to the first point.
+  AddNgonPoint(0, &vertices_);
 }
 
 void Ngon::Draw() {
+  gl::GlStateCache& state_cache = gl::GlStateCache::Current();
+  const void* vertices = state_cache.StreamVertices(
+      vertices_.data(), vertices_.size() * sizeof(float));
   glEnableClientState(GL_VERTEX_ARRAY);
   // TODO: Parameterize the color.
-  glDisable(GL_DEPTH_TEST);
+  state_cache.Disable(GL_DEPTH_TEST);
   glColor4f(0., 0., 0., 1.);
-  glVertexPointer(3, GL_FLOAT, 0, vertices_.data());
-  glDrawElements(GL_TRIANGLE_FAN, indices_.size(), GL_UNSIGNED_INT,
-                 indices_.data());
+  glVertexPointer(3, GL_FLOAT, 0, vertices);
+  glDrawArrays(GL_TRIANGLE_FAN, 0, vertices_.size() / 3);
   glDisableClientState(GL_VERTEX_ARRAY);
 }
 
@@ -1,8 +1,6 @@
 #ifndef PRIMITIVE_NGON_H_
 #define PRIMITIVE_NGON_H_
 
-#include <stdint.h>
-
 #include <vector>
 
 #include "primitive/primitive.h"
@@ -15,8 +13,8 @@ class Ngon : public Primitive {
   void Draw() override;
 
  private:
+  // Vertices of a triangle fan around the center, ending where it begins.
   std::vector<float> vertices_;
-  std::vector<int32_t> indices_;
 };
 
 }  // namespace opendrop
@@ -1,10 +1,10 @@
 #include "primitive/polyline.h"
 
 #include <array>
-#include <vector>
 
 #include "third_party/gl_helper.h"
 #include "third_party/glm_helper.h"
+#include "util/graphics/gl_state_cache.h"
 
 namespace opendrop {
 
@@ -24,28 +24,21 @@ Polyline::Polyline(glm::vec3 color, absl::Span<const glm::vec2> vertices,
 }
 
 void Polyline::Draw() {
+  gl::GlStateCache& state_cache = gl::GlStateCache::Current();
+  const void* vertices = state_cache.StreamVertices(
+      vertices_.data(), vertices_.size() * sizeof(glm::vec2));
   glEnableClientState(GL_VERTEX_ARRAY);
-  glLineWidth(width_);
-  glEnable(GL_LINE_SMOOTH);
-  glDisable(GL_DEPTH_TEST);
+  state_cache.LineWidth(width_);
+  state_cache.Enable(GL_LINE_SMOOTH);
+  state_cache.Disable(GL_DEPTH_TEST);
   glColor4f(color_.x, color_.y, color_.z, 1);
-  glVertexPointer(2, GL_FLOAT, 0, vertices_.data());
-  glDrawElements(GL_LINE_STRIP, indices_.size(), GL_UNSIGNED_SHORT,
-                 indices_.data());
+  glVertexPointer(2, GL_FLOAT, 0, vertices);
+  glDrawArrays(GL_LINE_STRIP, 0, vertices_.size());
   glDisableClientState(GL_VERTEX_ARRAY);
 }
 
 void Polyline::UpdateVertices(absl::Span<const glm::vec2> vertices) {
   vertices_ = vertices;
-
-  if (indices_.size() == vertices_.size()) {
-    return;
-  }
-
-  indices_.resize(vertices_.size(), 0);
-  for (int i = 0; i < vertices_.size(); ++i) {
-    indices_[i] = i;
-  }
 }
 
 void Polyline::UpdateColor(glm::vec3 color) { color_ = color; }
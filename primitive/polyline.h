@@ -1,9 +1,6 @@
 #ifndef PRIMITIVE_POLYLINE_H_
 #define PRIMITIVE_POLYLINE_H_
 
-#include <cstdint>
-#include <vector>
-
 #include "absl/types/span.h"
 #include "primitive/primitive.h"
 #include "third_party/glm_helper.h"
@@ -31,7 +28,6 @@ class Polyline : public Primitive {
   glm::vec3 color_;
   absl::Span<const glm::vec2> vertices_;
   float width_;
-  std::vector<uint16_t> indices_;
 };
 
 }  // namespace opendrop
@@ -2,32 +2,30 @@
 
 #include "third_party/gl_helper.h"
 #include "third_party/glm_helper.h"
+#include "util/graphics/gl_state_cache.h"
 
 namespace opendrop {
 
 namespace {
+// Drawn as a triangle fan.
 constexpr float kFullscreenVertices[] = {
     -1, -1, 0.1,  // Lower-left
     -1, 1,  0.1,  // Upper-left
     1,  1,  0.1,  // Upper-right
     1,  -1, 0.1,  // Lower-right
 };
-
-constexpr uint8_t kFullscreenIndices[] = {
-    0,
-    1,
-    2,
-    3,
-};
 }  // namespace
 
 void Rectangle::Draw() {
+  gl::GlStateCache& state_cache = gl::GlStateCache::Current();
+  const void* vertices = state_cache.StreamVertices(
+      kFullscreenVertices, sizeof(kFullscreenVertices));
   glEnableClientState(GL_VERTEX_ARRAY);
   // TODO: Parameterize the color.
-  glDisable(GL_DEPTH_TEST);
+  state_cache.Disable(GL_DEPTH_TEST);
   glColor4f(color_.r, color_.g, color_.b, color_.a);
-  glVertexPointer(3, GL_FLOAT, 0, kFullscreenVertices);
-  glDrawElements(GL_QUADS, 4, GL_UNSIGNED_BYTE, kFullscreenIndices);
+  glVertexPointer(3, GL_FLOAT, 0, vertices);
+  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
   glDisableClientState(GL_VERTEX_ARRAY);
 }
 
@@ -2,7 +2,7 @@
 
 #include "third_party/gl_helper.h"
 #include "third_party/glm_helper.h"
-#include "util/logging/logging.h"
+#include "util/graphics/gl_state_cache.h"
 
 namespace opendrop {
 
@@ -33,11 +33,6 @@ Ribbon<T>::Ribbon(glm::vec3 color, int num_segments)
   // Reserve an extra segment at the beginning to be able to render the ribbon
   // circular buffer in two passes.
   vertices_.resize((num_segments + 1) * kSegmentVertexCount);
-  indices_.resize((num_segments + 1) * kSegmentVertexCount);
-  int i = 0;
-  for (auto& index : indices_) {
-    index = i++;
-  }
 }
 
 template <typename T>
@@ -46,13 +41,14 @@ void Ribbon<T>::RenderTriangleStrip(absl::Span<T> vertices) {
     return;
   }
 
+  gl::GlStateCache& state_cache = gl::GlStateCache::Current();
+  const void* vertex_pointer =
+      state_cache.StreamVertices(vertices.data(), vertices.size() * sizeof(T));
   glEnableClientState(GL_VERTEX_ARRAY);
-  glDisable(GL_DEPTH_TEST);
+  state_cache.Disable(GL_DEPTH_TEST);
   glColor4f(color_.x, color_.y, color_.z, 1);
-  glVertexPointer(GetVectorFieldWidth<T>(), GL_FLOAT, 0, vertices.data());
-  CHECK(vertices.size() <= indices_.size()) << "More vertices than indices.";
-  glDrawElements(GL_TRIANGLE_STRIP, vertices.size(), GL_UNSIGNED_SHORT,
-                 indices_.data());
+  glVertexPointer(GetVectorFieldWidth<T>(), GL_FLOAT, 0, vertex_pointer);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, vertices.size());
   glDisableClientState(GL_VERTEX_ARRAY);
 }
 
@@ -54,7 +54,6 @@ class Ribbon : Primitive {
   glm::vec3 color_;
   int num_segments_;
   std::vector<T> vertices_;
-  std::vector<uint16_t> indices_;
 
   // The location where the next segment will be added.
   intptr_t head_pointer_;
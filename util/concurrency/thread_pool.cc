@@ -0,0 +1,81 @@
+#include "util/concurrency/thread_pool.h"
+
+namespace opendrop {
+
+ThreadPool::ThreadPool(int num_threads) {
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.emplace_back([this] { Run(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(pool_mu_);
+    stopping_ = true;
+  }
+  work_cv_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& fn) {
+  if (count <= 0) return;
+  if (workers_.empty() || count == 1) {
+    for (int i = 0; i < count; ++i) fn(i);
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(pool_mu_);
+    fn_ = &fn;
+    count_ = count;
+    next_index_ = 0;
+    num_outstanding_ = count;
+    ++generation_;
+  }
+  work_cv_.notify_all();
+
+  RunBatch();
+
+  std::unique_lock<std::mutex> lock(pool_mu_);
+  done_cv_.wait(lock, [&] { return num_outstanding_ == 0; });
+  fn_ = nullptr;
+}
+
+void ThreadPool::Run() {
+  int last_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(pool_mu_);
+      work_cv_.wait(lock, [&] {
+        return stopping_ || generation_ != last_generation;
+      });
+      if (stopping_) return;
+      last_generation = generation_;
+    }
+    RunBatch();
+  }
+}
+
+void ThreadPool::RunBatch() {
+  while (true) {
+    const std::function<void(int)>* fn;
+    int index;
+    {
+      std::unique_lock<std::mutex> lock(pool_mu_);
+      if (fn_ == nullptr || next_index_ >= count_) return;
+      fn = fn_;
+      index = next_index_++;
+    }
+
+    (*fn)(index);
+
+    std::unique_lock<std::mutex> lock(pool_mu_);
+    if (--num_outstanding_ == 0) {
+      done_cv_.notify_all();
+    }
+  }
+}
+
+}  // namespace opendrop
@@ -0,0 +1,57 @@
+#ifndef UTIL_CONCURRENCY_THREAD_POOL_H_
+#define UTIL_CONCURRENCY_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace opendrop {
+
+// A fixed set of worker threads for running short, independent pieces of work
+// in parallel, e.g. once per frame. `ParallelFor` may only be invoked from one
+// thread at a time.
+class ThreadPool {
+ public:
+  // Constructs a pool with `num_threads` workers. With no workers, all work
+  // runs on the calling thread.
+  explicit ThreadPool(int num_threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Invokes `fn(i)` for each `i` in `[0, count)`, distributing the calls
+  // between the workers and the calling thread. Returns once every call has
+  // returned.
+  void ParallelFor(int count, const std::function<void(int)>& fn);
+
+  int num_threads() const { return workers_.size(); }
+
+ private:
+  // Body of each worker thread.
+  void Run();
+
+  // Claims and runs indices of the current batch until none remain.
+  void RunBatch();
+
+  std::mutex pool_mu_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  bool stopping_ = false;
+
+  // The current batch. `generation_` is incremented each time a batch is
+  // posted, so that workers can tell a new batch from one they have finished.
+  const std::function<void(int)>* fn_ = nullptr;
+  int count_ = 0;
+  int next_index_ = 0;
+  int num_outstanding_ = 0;
+  int generation_ = 0;
+
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace opendrop
+
+#endif  // UTIL_CONCURRENCY_THREAD_POOL_H_
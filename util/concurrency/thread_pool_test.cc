@@ -0,0 +1,45 @@
+#include "util/concurrency/thread_pool.h"
+
+#include <atomic>
+#include <vector>
+
+#include "googlemock/include/gmock/gmock.h"
+#include "googletest/include/gtest/gtest.h"
+
+namespace opendrop {
+namespace {
+
+TEST(ThreadPoolTest, ParallelForVisitsEachIndexOnce) {
+  ThreadPool pool(3);
+  std::vector<std::atomic<int>> visits(100);
+  pool.ParallelFor(visits.size(), [&](int i) { ++visits[i]; });
+  for (const auto& count : visits) {
+    EXPECT_EQ(count.load(), 1);
+  }
+}
+
+TEST(ThreadPoolTest, ParallelForRunsInlineWithoutWorkers) {
+  ThreadPool pool(0);
+  std::vector<int> order;
+  pool.ParallelFor(4, [&](int i) { order.push_back(i); });
+  EXPECT_THAT(order, ::testing::ElementsAre(0, 1, 2, 3));
+}
+
+TEST(ThreadPoolTest, ParallelForCanBeRepeated) {
+  ThreadPool pool(2);
+  std::atomic<int> total = 0;
+  for (int batch = 0; batch < 50; ++batch) {
+    pool.ParallelFor(8, [&](int i) { total += i; });
+  }
+  EXPECT_EQ(total.load(), 50 * 28);
+}
+
+TEST(ThreadPoolTest, ParallelForWithNoWorkIsNoOp) {
+  ThreadPool pool(2);
+  bool called = false;
+  pool.ParallelFor(0, [&](int) { called = true; });
+  EXPECT_FALSE(called);
+}
+
+}  // namespace
+}  // namespace opendrop
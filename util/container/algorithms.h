@@ -1,13 +1,13 @@
 #ifndef UTIL_CONTAINER_ALGORITHMS_H_
 #define UTIL_CONTAINER_ALGORITHMS_H_
 
-#include <cstdlib>
 #include <numeric>
 #include <unordered_set>
 #include <vector>
 
 #include "absl/types/span.h"
 #include "util/logging/logging.h"
+#include "util/math/random.h"
 
 namespace opendrop {
 
@@ -37,10 +37,17 @@ const T& ModPick(const absl::Span<const T> elements, int64_t index) {
   return elements[index % elements.size()];
 }
 
+// Returns a value from `elements`, uniformly drawn from `stream`.
+template <typename T>
+const T& RandomPick(const absl::Span<const T> elements, RandomStream& stream) {
+  CHECK(!elements.empty()) << "RandomPick(): No elements to pick from.";
+  return elements[stream.Index(elements.size())];
+}
+
 // Returns a value from `elements` (uniformly drawn).
 template <typename T>
 const T& RandomPick(const absl::Span<const T> elements) {
-  return ModPick<T>(elements, std::rand());
+  return RandomPick<T>(elements, Random::Stream("pick"));
 }
 
 // Returns a value from `elements` where the probability of drawing a particular
@@ -78,7 +85,7 @@ const T& WeightedPick(const absl::Span<const T> elements,
 
 template <typename T>
 size_t RandomIndexOf(const absl::Span<const T> elements,
-                     const T& element_to_find) {
+                     const T& element_to_find, RandomStream& stream) {
   std::vector<size_t> indices{};
   for (int i = 0; i < elements.size(); ++i) {
     if (elements[i] == element_to_find) indices.push_back(i);
@@ -86,7 +93,13 @@ size_t RandomIndexOf(const absl::Span<const T> elements,
 
   CHECK(indices.size() > 0) << "RandomIndexOf(): Element not found.";
 
-  return RandomPick<size_t>(indices);
+  return RandomPick<size_t>(indices, stream);
+}
+
+template <typename T>
+size_t RandomIndexOf(const absl::Span<const T> elements,
+                     const T& element_to_find) {
+  return RandomIndexOf<T>(elements, element_to_find, Random::Stream("pick"));
 }
 
 template <typename T>
@@ -1,6 +1,7 @@
 #include "util/graph/graph.h"
 
 #include "util/container/algorithms.h"
+#include "util/math/random.h"
 
 namespace opendrop {
 
@@ -196,6 +197,10 @@ absl::StatusOr<Graph> GraphBuilder::Bridge(
         graph->input_node->PortIndex(i));
   }
 
+  // Graphs are built from their own stream, so the graph generated for a given
+  // seed does not depend on randomness consumed elsewhere.
+  RandomStream& stream = Random::Stream("graph_builder");
+
   LOG(INFO) << "Before loop";
   PrintSearchState(unsatisfied, available_by_type);
 
@@ -218,7 +223,7 @@ absl::StatusOr<Graph> GraphBuilder::Bridge(
     std::vector<Choice> choices{};
     if (Contains(available_by_type, to_satisfy_type)) {
       NodePortIndex matching_available =
-          RandomPick<NodePortIndex>(available_by_type[to_satisfy_type]);
+          RandomPick<NodePortIndex>(available_by_type[to_satisfy_type], stream);
       LOG(INFO) << "Found existing available value: " << matching_available;
       if (!graph->HasEmptyInputCells() ||
           matching_available.node.lock() == graph->input_node)
@@ -229,7 +234,7 @@ absl::StatusOr<Graph> GraphBuilder::Bridge(
     // update the `unsatisfied` and `available_by_type` lists.
     if (Contains(conversions_by_individual_output_, to_satisfy_type)) {
       auto conversion = RandomPick<std::shared_ptr<Conversion>>(
-          conversions_by_individual_output_[to_satisfy_type]);
+          conversions_by_individual_output_[to_satisfy_type], stream);
       auto [output_storage, output_tuple] =
           conversion->ConstructOutputStorageAndTuple();
       auto new_node = std::make_shared<Node>(
@@ -237,8 +242,9 @@ absl::StatusOr<Graph> GraphBuilder::Bridge(
           OpaqueTuple::EmptyFromTypes(conversion->input_types),
           /*output_tuple=*/output_tuple);
 
-      NodePortIndex matching_from_conversion = new_node->PortIndex(
-          RandomIndexOf<Type>(new_node->output_tuple.Types(), to_satisfy_type));
+      NodePortIndex matching_from_conversion =
+          new_node->PortIndex(RandomIndexOf<Type>(
+              new_node->output_tuple.Types(), to_satisfy_type, stream));
       LOG(INFO) << "Satisfying " << to_satisfy_type << " with new node "
                  << *new_node << " port " << matching_from_conversion;
       choices.push_back({.new_node_storage = output_storage,
@@ -247,7 +253,7 @@ absl::StatusOr<Graph> GraphBuilder::Bridge(
     }
 
     if (!choices.empty()) {
-      if (Satisfy(*graph.get(), to_satisfy, RandomPick<Choice>(choices),
+      if (Satisfy(*graph.get(), to_satisfy, RandomPick<Choice>(choices, stream),
                   unsatisfied, available_by_type))
         continue;
     }
@@ -38,8 +38,7 @@ void Blit(const Texture& texture) {
   GlBindRenderTargetTextureToUniform(GetBlitProgram(), "source_texture",
                                      texture.RenderTarget(),
                                      gl::GlTextureBindingOptions());
-  glUniform1f(glGetUniformLocation(GetBlitProgram()->program_handle(), "alpha"),
-              1.0f);
+  GlBindUniform(GetBlitProgram(), "alpha", 1.0f);
 
   Rectangle().Draw();
 }
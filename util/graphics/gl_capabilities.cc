@@ -0,0 +1,84 @@
+#include "util/graphics/gl_capabilities.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "absl/strings/str_split.h"
+#include "third_party/gl_helper.h"
+#include "util/logging/logging.h"
+
+namespace gl {
+
+const GlCapabilities& GlCapabilities::Get() {
+  static const GlCapabilities* capabilities = new GlCapabilities();
+  return *capabilities;
+}
+
+GlCapabilities::GlCapabilities() {
+  const char* version =
+      reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  if (version == nullptr) {
+    LOG(ERROR) << "Failed to query the GL version; is a context current?";
+    return;
+  }
+  // Desktop versions begin with the version number, and GLES versions with
+  // "OpenGL ES ".
+  if (std::sscanf(version, "%d.%d", &major_version_, &minor_version_) != 2) {
+    gles_ = true;
+    if (std::sscanf(version, "OpenGL ES %d.%d", &major_version_,
+                    &minor_version_) != 2) {
+      LOG(ERROR) << "Failed to parse GL version: " << version;
+    }
+  }
+
+  if (AtLeastVersion(3, 0)) {
+    int num_extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+    for (int i = 0; i < num_extensions; ++i) {
+      extensions_.push_back(
+          reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)));
+    }
+  } else if (const char* extensions =
+                 reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS))) {
+    extensions_ = absl::StrSplit(extensions, ' ', absl::SkipEmpty());
+  }
+  std::sort(extensions_.begin(), extensions_.end());
+
+  sampler_objects_ =
+      AtLeastVersion(3, 3) || HasExtension("GL_ARB_sampler_objects");
+  vertex_buffer_objects_ =
+      AtLeastVersion(1, 5) || HasExtension("GL_ARB_vertex_buffer_object");
+  vertex_array_objects_ =
+      AtLeastVersion(3, 0) || HasExtension("GL_ARB_vertex_array_object");
+  instanced_arrays_ = AtLeastVersion(3, 3);
+  pixel_buffer_objects_ =
+      AtLeastVersion(2, 1) || HasExtension("GL_ARB_pixel_buffer_object");
+  sync_objects_ = AtLeastVersion(3, 2) || HasExtension("GL_ARB_sync");
+  // GLES 3.0 samples from float textures but only renders to them with an
+  // extension.
+  float_render_targets_ =
+      gles_ ? HasExtension("GL_EXT_color_buffer_half_float") ||
+                  HasExtension("GL_EXT_color_buffer_float")
+            : AtLeastVersion(3, 0) ||
+                  (HasExtension("GL_ARB_texture_float") &&
+                   HasExtension("GL_ARB_color_buffer_float"));
+
+  glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &max_texture_units_);
+
+  LOG(INFO) << "GL version " << major_version_ << "." << minor_version_
+            << " (" << version << ") with " << extensions_.size()
+            << " extensions and " << max_texture_units_
+            << " texture units; sampler objects "
+            << (sampler_objects_ ? "are" : "are not") << " supported";
+}
+
+bool GlCapabilities::AtLeastVersion(int major, int minor) const {
+  return major_version_ > major ||
+         (major_version_ == major && minor_version_ >= minor);
+}
+
+bool GlCapabilities::HasExtension(absl::string_view name) const {
+  return std::binary_search(extensions_.begin(), extensions_.end(), name);
+}
+
+}  // namespace gl
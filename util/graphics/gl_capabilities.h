@@ -0,0 +1,74 @@
+#ifndef UTIL_GRAPHICS_GL_CAPABILITIES_H_
+#define UTIL_GRAPHICS_GL_CAPABILITIES_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace gl {
+
+// Optional features of the GL implementation, probed once. Every context in
+// the process is created by the same driver, so the features are assumed to
+// be the same in all of them.
+class GlCapabilities {
+ public:
+  // Returns the capabilities of the GL implementation, probing them on first
+  // use, which must happen with a context current.
+  static const GlCapabilities& Get();
+
+  int major_version() const { return major_version_; }
+  int minor_version() const { return minor_version_; }
+  // Whether the implementation is OpenGL ES, in which case the version above
+  // is the GLES version.
+  bool gles() const { return gles_; }
+  bool AtLeastVersion(int major, int minor) const;
+  bool HasExtension(absl::string_view name) const;
+
+  // Whether sampler objects are supported (GL 3.3, or ARB_sampler_objects).
+  bool sampler_objects() const { return sampler_objects_; }
+  // Whether vertex buffer objects are supported (GL 1.5, or
+  // ARB_vertex_buffer_object).
+  bool vertex_buffer_objects() const { return vertex_buffer_objects_; }
+  // Whether vertex array objects are supported (GL 3.0, or
+  // ARB_vertex_array_object).
+  bool vertex_array_objects() const { return vertex_array_objects_; }
+  // Whether instanced draws with per-instance vertex attributes are supported
+  // (GL 3.3). The ARB extensions that provide them earlier name their entry
+  // points differently, and are not used.
+  bool instanced_arrays() const { return instanced_arrays_; }
+  // Whether buffer objects can be bound as the destination of pixel reads
+  // (GL 2.1, or ARB_pixel_buffer_object).
+  bool pixel_buffer_objects() const { return pixel_buffer_objects_; }
+  // Whether fence sync objects are supported (GL 3.2, or ARB_sync).
+  bool sync_objects() const { return sync_objects_; }
+  // Whether half float color textures can be rendered to (GL 3.0, or
+  // ARB_texture_float and ARB_color_buffer_float; on GLES,
+  // EXT_color_buffer_half_float or EXT_color_buffer_float).
+  bool float_render_targets() const { return float_render_targets_; }
+
+  // Number of texture units that textures can be bound to.
+  int max_texture_units() const { return max_texture_units_; }
+
+ private:
+  GlCapabilities();
+
+  int major_version_ = 0;
+  int minor_version_ = 0;
+  bool gles_ = false;
+  // Names of the supported extensions, sorted.
+  std::vector<std::string> extensions_;
+
+  bool sampler_objects_ = false;
+  bool vertex_buffer_objects_ = false;
+  bool vertex_array_objects_ = false;
+  bool instanced_arrays_ = false;
+  bool pixel_buffer_objects_ = false;
+  bool sync_objects_ = false;
+  bool float_render_targets_ = false;
+  int max_texture_units_ = 0;
+};
+
+}  // namespace gl
+
+#endif  // UTIL_GRAPHICS_GL_CAPABILITIES_H_
@@ -0,0 +1,162 @@
+#include "util/graphics/gl_gpu_timer.h"
+
+#include <chrono>
+#include <mutex>
+#include <utility>
+
+#include "third_party/gl_helper.h"
+#include "util/graphics/gl_capabilities.h"
+#include "util/logging/logging.h"
+
+namespace gl {
+
+namespace {
+// Bounds the sections timed per frame, and so the queries in use, should a
+// caller never end its frames.
+constexpr int kMaxSectionsPerFrame = 256;
+// Frames whose queries are still in flight when another ends are dropped
+// beyond this many.
+constexpr int kMaxPendingFrames = 4;
+
+int64_t CpuNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+std::mutex& LatestFrameTimingsMutex() {
+  static std::mutex* mu = new std::mutex();
+  return *mu;
+}
+
+std::optional<GlGpuTimer::FrameTimings>& LatestFrameTimingsLocked() {
+  static auto* timings = new std::optional<GlGpuTimer::FrameTimings>();
+  return *timings;
+}
+}  // namespace
+
+void GlGpuTimer::Begin(std::string name) {
+  if (!timer_queries_.has_value()) {
+    const GlCapabilities& capabilities = GlCapabilities::Get();
+    timer_queries_ = capabilities.AtLeastVersion(3, 3) ||
+                     capabilities.HasExtension("GL_ARB_timer_query");
+    if (!*timer_queries_) {
+      LOG(INFO) << "Timer queries are unsupported; sections will be timed on "
+                   "the CPU";
+    }
+  }
+  if (current_frame_.sections.size() >=
+      static_cast<size_t>(kMaxSectionsPerFrame)) {
+    open_sections_.push_back(-1);
+    return;
+  }
+
+  PendingSection section = {.name = std::move(name),
+                            .depth = static_cast<int>(open_sections_.size())};
+  if (*timer_queries_) {
+    section.begin_query = AcquireQuery();
+    glQueryCounter(section.begin_query, GL_TIMESTAMP);
+  } else {
+    section.cpu_begin_ns = CpuNanos();
+  }
+  open_sections_.push_back(current_frame_.sections.size());
+  current_frame_.sections.push_back(std::move(section));
+}
+
+void GlGpuTimer::End() {
+  CHECK(!open_sections_.empty()) << "Ended a section that was never begun";
+  const int index = open_sections_.back();
+  open_sections_.pop_back();
+  if (index < 0) return;
+
+  PendingSection& section = current_frame_.sections[index];
+  if (*timer_queries_) {
+    section.end_query = AcquireQuery();
+    glQueryCounter(section.end_query, GL_TIMESTAMP);
+    current_frame_.last_query = section.end_query;
+  } else {
+    section.cpu_end_ns = CpuNanos();
+  }
+}
+
+void GlGpuTimer::EndFrame() {
+  if (!open_sections_.empty()) {
+    LOG(ERROR) << "Frame ended with " << open_sections_.size()
+               << " open sections";
+    while (!open_sections_.empty()) End();
+  }
+  const int64_t next_frame_index = current_frame_.frame_index + 1;
+  pending_frames_.push_back(std::move(current_frame_));
+  current_frame_ = {.frame_index = next_frame_index};
+
+  std::optional<FrameTimings> latest;
+  while (!pending_frames_.empty() && Available(pending_frames_.front())) {
+    latest = Resolve(pending_frames_.front());
+    ReleaseQueries(pending_frames_.front());
+    pending_frames_.pop_front();
+  }
+  while (pending_frames_.size() > kMaxPendingFrames) {
+    ReleaseQueries(pending_frames_.front());
+    pending_frames_.pop_front();
+  }
+
+  if (latest.has_value()) {
+    std::unique_lock<std::mutex> lock(LatestFrameTimingsMutex());
+    LatestFrameTimingsLocked() = std::move(latest);
+  }
+}
+
+std::optional<GlGpuTimer::FrameTimings> GlGpuTimer::LatestFrameTimings() {
+  std::unique_lock<std::mutex> lock(LatestFrameTimingsMutex());
+  return LatestFrameTimingsLocked();
+}
+
+bool GlGpuTimer::Available(const PendingFrame& frame) const {
+  if (frame.last_query == 0) return true;
+  // Queries complete in the order they were issued, so the frame is available
+  // once the last of its queries is.
+  int available = 0;
+  glGetQueryObjectiv(frame.last_query, GL_QUERY_RESULT_AVAILABLE, &available);
+  return available != 0;
+}
+
+GlGpuTimer::FrameTimings GlGpuTimer::Resolve(PendingFrame& frame) {
+  FrameTimings timings = {.frame_index = frame.frame_index,
+                          .gpu = timer_queries_.value_or(false)};
+  timings.sections.reserve(frame.sections.size());
+  for (PendingSection& section : frame.sections) {
+    int64_t nanoseconds = section.cpu_end_ns - section.cpu_begin_ns;
+    if (timings.gpu) {
+      GLuint64 begin = 0;
+      GLuint64 end = 0;
+      glGetQueryObjectui64v(section.begin_query, GL_QUERY_RESULT, &begin);
+      glGetQueryObjectui64v(section.end_query, GL_QUERY_RESULT, &end);
+      nanoseconds = end - begin;
+    }
+    timings.sections.push_back(
+        {.name = std::move(section.name),
+         .depth = section.depth,
+         .milliseconds = static_cast<float>(nanoseconds) / 1e6f});
+  }
+  return timings;
+}
+
+unsigned int GlGpuTimer::AcquireQuery() {
+  if (free_queries_.empty()) {
+    unsigned int query = 0;
+    glGenQueries(1, &query);
+    return query;
+  }
+  const unsigned int query = free_queries_.back();
+  free_queries_.pop_back();
+  return query;
+}
+
+void GlGpuTimer::ReleaseQueries(PendingFrame& frame) {
+  for (const PendingSection& section : frame.sections) {
+    if (section.begin_query != 0) free_queries_.push_back(section.begin_query);
+    if (section.end_query != 0) free_queries_.push_back(section.end_query);
+  }
+}
+
+}  // namespace gl
@@ -0,0 +1,96 @@
+#ifndef UTIL_GRAPHICS_GL_GPU_TIMER_H_
+#define UTIL_GRAPHICS_GL_GPU_TIMER_H_
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace gl {
+
+// Measures the GPU time spent in named sections of each frame rendered in a
+// context. Each section is bracketed by a pair of `GL_TIMESTAMP` queries
+// drawn from a pool. Results are read back on later frames, once the GPU has
+// passed them, so timing never stalls the pipeline. Sections may nest, which
+// `GL_TIME_ELAPSED` queries cannot. Where timer queries are unsupported,
+// sections are timed on the CPU, which only measures the cost of issuing
+// their commands.
+//
+// Each context has its own timer, owned by its `GlStateCache`. Sections are
+// usually timed with a `GlGpuTimerScope`. This class is not thread-safe,
+// except for `LatestFrameTimings`.
+class GlGpuTimer {
+ public:
+  // Time spent in a section of a frame.
+  struct Section {
+    std::string name;
+    // Number of sections enclosing this one.
+    int depth;
+    float milliseconds;
+  };
+
+  // Times of the sections of one frame, in the order they began.
+  struct FrameTimings {
+    // Number of frames the context had ended before this one.
+    int64_t frame_index;
+    // Whether the times were measured on the GPU, rather than the CPU.
+    bool gpu;
+    std::vector<Section> sections;
+  };
+
+  GlGpuTimer() = default;
+  GlGpuTimer(const GlGpuTimer&) = delete;
+  GlGpuTimer& operator=(const GlGpuTimer&) = delete;
+
+  // Begins and ends a section of the current frame. Calls must be balanced.
+  void Begin(std::string name);
+  void End();
+
+  // Ends the current frame, reads back the timings of earlier frames that the
+  // GPU has finished, and publishes the most recent of them. Called once per
+  // frame by the application, after the frame is submitted.
+  void EndFrame();
+
+  // Returns the most recent timings published by any context's timer, which
+  // lag rendering by a frame or two. May be called from any thread.
+  static std::optional<FrameTimings> LatestFrameTimings();
+
+ private:
+  // A section whose queries may not have completed yet.
+  struct PendingSection {
+    std::string name;
+    int depth;
+    unsigned int begin_query = 0;
+    unsigned int end_query = 0;
+    int64_t cpu_begin_ns = 0;
+    int64_t cpu_end_ns = 0;
+  };
+
+  struct PendingFrame {
+    int64_t frame_index;
+    std::vector<PendingSection> sections;
+    // The query issued last, which completes after all others.
+    unsigned int last_query = 0;
+  };
+
+  // Returns whether the queries of `frame` have completed, without waiting.
+  bool Available(const PendingFrame& frame) const;
+  FrameTimings Resolve(PendingFrame& frame);
+  unsigned int AcquireQuery();
+  void ReleaseQueries(PendingFrame& frame);
+
+  // Whether timer queries are supported, probed by the first section.
+  std::optional<bool> timer_queries_;
+  PendingFrame current_frame_ = {.frame_index = 0};
+  // Indices into `current_frame_.sections` of the open sections, innermost
+  // last. Sections beyond the per-frame limit are open at -1.
+  std::vector<int> open_sections_;
+  // Ended frames, oldest first, whose queries are still in flight.
+  std::deque<PendingFrame> pending_frames_;
+  std::vector<unsigned int> free_queries_;
+};
+
+}  // namespace gl
+
+#endif  // UTIL_GRAPHICS_GL_GPU_TIMER_H_
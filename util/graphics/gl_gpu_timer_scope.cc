@@ -0,0 +1,17 @@
+#include "util/graphics/gl_gpu_timer_scope.h"
+
+#include <utility>
+
+#include "util/graphics/gl_gpu_timer.h"
+#include "util/graphics/gl_state_cache.h"
+
+namespace gl {
+
+GlGpuTimerScope::GlGpuTimerScope(std::string name)
+    : timer_(&GlStateCache::Current().gpu_timer()) {
+  timer_->Begin(std::move(name));
+}
+
+GlGpuTimerScope::~GlGpuTimerScope() { timer_->End(); }
+
+}  // namespace gl
@@ -0,0 +1,26 @@
+#ifndef UTIL_GRAPHICS_GL_GPU_TIMER_SCOPE_H_
+#define UTIL_GRAPHICS_GL_GPU_TIMER_SCOPE_H_
+
+#include <string>
+
+namespace gl {
+
+class GlGpuTimer;
+
+// Times the GL commands issued during its lifetime as a section named `name`
+// of the current frame, with the `GlGpuTimer` of the current context. See
+// `GlGpuTimer::LatestFrameTimings` for the results.
+class GlGpuTimerScope {
+ public:
+  explicit GlGpuTimerScope(std::string name);
+  ~GlGpuTimerScope();
+  GlGpuTimerScope(const GlGpuTimerScope&) = delete;
+  GlGpuTimerScope& operator=(const GlGpuTimerScope&) = delete;
+
+ private:
+  GlGpuTimer* timer_;
+};
+
+}  // namespace gl
+
+#endif  // UTIL_GRAPHICS_GL_GPU_TIMER_SCOPE_H_
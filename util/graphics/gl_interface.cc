@@ -6,6 +6,7 @@
 
 #include "absl/strings/str_cat.h"
 #include "third_party/gl_helper.h"
+#include "util/graphics/gl_program_cache.h"
 #include "util/logging/logging.h"
 
 namespace gl {
@@ -76,22 +77,40 @@ bool GlProgram::Link(std::string* error_text) const {
   return true;
 }
 
-void GlProgram::Use() const { glUseProgram(program_handle_); }
+void GlProgram::Use() const {
+  GlStateCache::Current().UseProgram(program_handle_);
+}
 
 GlProgramActivation::GlProgramActivation(
     std::shared_ptr<const GlProgram> program) {
-  glGetIntegerv(GL_CURRENT_PROGRAM, &old_program_);
-  glUseProgram(program->program_handle());
+  GlStateCache& state_cache = GlStateCache::Current();
+  old_program_ = state_cache.program();
+  state_cache.UseProgram(program->program_handle());
 }
 
-GlProgramActivation::~GlProgramActivation() { glUseProgram(old_program_); }
+GlProgramActivation::~GlProgramActivation() {
+  GlStateCache::Current().UseProgram(old_program_);
+}
 
 std::shared_ptr<GlProgramActivation> GlProgram::Activate() const {
   return std::make_shared<GlProgramActivation>(shared_from_this());
 }
 
+GlUniformTable& GlProgram::uniforms() const {
+  std::call_once(uniforms_once_, [this] {
+    uniforms_ = std::make_unique<GlUniformTable>(program_handle_);
+  });
+  return *uniforms_;
+}
+
 absl::StatusOr<std::shared_ptr<gl::GlProgram>> GlProgram::MakeShared(
     std::string vertex_code, std::string fragment_code) {
+  return GlProgramCache::Get().GetOrLink(vertex_code, fragment_code);
+}
+
+absl::StatusOr<std::shared_ptr<gl::GlProgram>> GlProgram::CompileAndLink(
+    const std::string& vertex_code, const std::string& fragment_code,
+    bool binary_retrievable) {
   LOG(DEBUG) << "[Compiling program]\nVERTEX SHADER CODE:\n"
              << "========================================" << vertex_code
              << "========================================"
@@ -111,6 +130,11 @@ absl::StatusOr<std::shared_ptr<gl::GlProgram>> GlProgram::MakeShared(
         absl::StrCat("Failed to compile fragment shader: ", error_string));
   }
 
+  if (binary_retrievable) {
+    glProgramParameteri(gl_program->program_handle(),
+                        GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+
   if (!gl_program->Attach(vertex_shader)
            .Attach(fragment_shader)
            .Link(&error_string)) {
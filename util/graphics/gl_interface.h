@@ -2,10 +2,13 @@
 #define UTIL_GRAPHICS_GL_INTERFACE_H_
 
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include "absl/status/statusor.h"
 #include "third_party/glm_helper.h"
+#include "util/graphics/gl_state_cache.h"
+#include "util/graphics/gl_uniform_table.h"
 
 namespace gl {
 
@@ -32,14 +35,15 @@ class GlProgram;
 // Represents an active shader program. Constructing such an object caches the
 // current program index and invokes glUseProgram() with the program index to
 // which the activation corresponds. The old program index is restored on
-// destruction.
+// destruction. Both go through the current `GlStateCache`, so the driver is
+// not queried for the current program.
 class GlProgramActivation {
  public:
   GlProgramActivation(std::shared_ptr<const GlProgram> program);
   virtual ~GlProgramActivation();
 
  private:
-  int old_program_;
+  unsigned int old_program_;
   std::shared_ptr<const GlProgram> program_;
 };
 
@@ -55,13 +59,28 @@ class GlProgram : public std::enable_shared_from_this<GlProgram> {
 
   unsigned int program_handle() const { return program_handle_; }
 
+  // Returns a program linked from the given sources. Programs are shared
+  // through `GlProgramCache`, so identical sources are only compiled once.
   static absl::StatusOr<std::shared_ptr<GlProgram>> MakeShared(
       std::string vertex_code, std::string fragment_code);
 
+  // Compiles and links a new program from the given sources, bypassing the
+  // program cache. If `binary_retrievable` is true, the driver is hinted that
+  // the program binary will be retrieved after linking.
+  static absl::StatusOr<std::shared_ptr<GlProgram>> CompileAndLink(
+      const std::string& vertex_code, const std::string& fragment_code,
+      bool binary_retrievable = false);
+
   std::shared_ptr<GlProgramActivation> Activate() const;
 
+  // Returns the table of this program's active uniforms, reflecting them on
+  // first use. The program must be linked.
+  GlUniformTable& uniforms() const;
+
  private:
   unsigned int program_handle_;
+  mutable std::once_flag uniforms_once_;
+  mutable std::unique_ptr<GlUniformTable> uniforms_;
 };
 
 class GlContextActivation {
@@ -72,7 +91,14 @@ class GlContextActivation {
 class GlContext {
  public:
   virtual ~GlContext() {}
+  // Makes this context current. Implementations also make `state_cache()` the
+  // current `GlStateCache` for the lifetime of the activation.
   virtual std::shared_ptr<GlContextActivation> Activate() = 0;
+
+  GlStateCache& state_cache() { return state_cache_; }
+
+ private:
+  GlStateCache state_cache_;
 };
 
 class GlInterface {
@@ -0,0 +1,141 @@
+#include "util/graphics/gl_mesh_store.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include "third_party/gl_helper.h"
+#include "util/graphics/gl_capabilities.h"
+#include "util/graphics/gl_state_cache.h"
+#include "util/logging/logging.h"
+
+namespace gl {
+
+namespace {
+// Minimum sizes of the buffers of a page. Meshes larger than this get a page
+// of their own.
+constexpr size_t kVertexPageBytes = 1 << 20;
+constexpr size_t kIndexPageBytes = 256 << 10;
+// Offsets of meshes within a page are multiples of this.
+constexpr size_t kMeshAlignment = 16;
+
+size_t Align(size_t offset) {
+  return (offset + kMeshAlignment - 1) / kMeshAlignment * kMeshAlignment;
+}
+
+// Flattens `triangles` into indices of type `T`.
+template <typename T>
+std::vector<T> MakeIndices(absl::Span<const glm::uvec3> triangles) {
+  std::vector<T> indices;
+  indices.reserve(triangles.size() * 3);
+  for (const glm::uvec3& triangle : triangles) {
+    indices.push_back(triangle.x);
+    indices.push_back(triangle.y);
+    indices.push_back(triangle.z);
+  }
+  return indices;
+}
+}  // namespace
+
+GlMeshStore& GlMeshStore::Get() {
+  static GlMeshStore* store = new GlMeshStore();
+  return *store;
+}
+
+const GlMeshStore::Mesh* GlMeshStore::FindOrUpload(
+    absl::Span<const glm::vec3> vertices, absl::Span<const glm::vec3> normals,
+    absl::Span<const glm::vec2> uvs, absl::Span<const glm::uvec3> triangles) {
+  if (!GlCapabilities::Get().vertex_buffer_objects()) {
+    return nullptr;
+  }
+
+  std::unique_lock<std::mutex> lock(store_mu_);
+  auto [iter, inserted] = meshes_.try_emplace(
+      std::make_pair(static_cast<const void*>(vertices.data()),
+                     static_cast<const void*>(triangles.data())));
+  Mesh& mesh = iter->second;
+  if (!inserted) {
+    return &mesh;
+  }
+
+  std::vector<Vertex> packed_vertices(vertices.size());
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    packed_vertices[i] = {
+        .position = vertices[i],
+        .normal = i < normals.size() ? normals[i] : glm::vec3(0),
+        .uv = i < uvs.size() ? uvs[i] : glm::vec2(0)};
+  }
+  const size_t vertex_bytes = packed_vertices.size() * sizeof(Vertex);
+
+  // 16-bit indices halve the index data, and are all that GLES2 guarantees.
+  std::vector<uint16_t> short_indices;
+  std::vector<uint32_t> int_indices;
+  const void* index_data;
+  size_t index_bytes;
+  if (vertices.size() <= std::numeric_limits<uint16_t>::max() + size_t{1}) {
+    short_indices = MakeIndices<uint16_t>(triangles);
+    index_data = short_indices.data();
+    index_bytes = short_indices.size() * sizeof(uint16_t);
+    mesh.index_type = GL_UNSIGNED_SHORT;
+  } else {
+    int_indices = MakeIndices<uint32_t>(triangles);
+    index_data = int_indices.data();
+    index_bytes = int_indices.size() * sizeof(uint32_t);
+    mesh.index_type = GL_UNSIGNED_INT;
+  }
+
+  Page& page = FindPageLocked(vertex_bytes, index_bytes);
+  mesh.vertex_buffer = page.vertex_buffer;
+  mesh.index_buffer = page.index_buffer;
+  mesh.vertex_offset = page.vertex_size;
+  mesh.index_offset = page.index_size;
+  mesh.num_indices = triangles.size() * 3;
+  page.vertex_size = Align(page.vertex_size + vertex_bytes);
+  page.index_size = Align(page.index_size + index_bytes);
+
+  GlStateCache& state_cache = GlStateCache::Current();
+  state_cache.BindOwnVertexArray();
+  state_cache.BindBuffer(GL_ARRAY_BUFFER, mesh.vertex_buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, mesh.vertex_offset, vertex_bytes,
+                  packed_vertices.data());
+  state_cache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.index_buffer);
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, mesh.index_offset, index_bytes,
+                  index_data);
+  // Other contexts may draw the mesh as soon as the lock is released, and
+  // are only guaranteed to see the upload once it has completed.
+  glFinish();
+
+  LOG(DEBUG) << "Uploaded mesh with " << vertices.size() << " vertices and "
+             << triangles.size() << " triangles to buffers "
+             << mesh.vertex_buffer << " and " << mesh.index_buffer;
+  return &mesh;
+}
+
+GlMeshStore::Page& GlMeshStore::FindPageLocked(size_t vertex_bytes,
+                                               size_t index_bytes) {
+  for (Page& page : pages_) {
+    if (page.vertex_size + vertex_bytes <= page.vertex_capacity &&
+        page.index_size + index_bytes <= page.index_capacity) {
+      return page;
+    }
+  }
+
+  Page page{.vertex_capacity = std::max(kVertexPageBytes, vertex_bytes),
+            .index_capacity = std::max(kIndexPageBytes, index_bytes)};
+  glGenBuffers(1, &page.vertex_buffer);
+  glGenBuffers(1, &page.index_buffer);
+  GlStateCache& state_cache = GlStateCache::Current();
+  state_cache.BindOwnVertexArray();
+  state_cache.BindBuffer(GL_ARRAY_BUFFER, page.vertex_buffer);
+  glBufferData(GL_ARRAY_BUFFER, page.vertex_capacity, nullptr, GL_STATIC_DRAW);
+  state_cache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.index_buffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, page.index_capacity, nullptr,
+               GL_STATIC_DRAW);
+  LOG(INFO) << "Allocated mesh store page " << pages_.size() << " of "
+            << page.vertex_capacity << " vertex bytes and "
+            << page.index_capacity << " index bytes";
+  pages_.push_back(page);
+  return pages_.back();
+}
+
+}  // namespace gl
@@ -0,0 +1,81 @@
+#ifndef UTIL_GRAPHICS_GL_MESH_STORE_H_
+#define UTIL_GRAPHICS_GL_MESH_STORE_H_
+
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "absl/container/node_hash_map.h"
+#include "absl/types/span.h"
+#include "third_party/glm_helper.h"
+
+namespace gl {
+
+// Process-wide GPU storage for static meshes. Each mesh is uploaded once, on
+// first use, and packed with other meshes into shared vertex and index
+// buffers, so that drawing it submits no vertex data and most meshes share
+// their buffer bindings. Buffer objects are shared between contexts, so a
+// single store serves every context. This class is thread-safe.
+class GlMeshStore {
+ public:
+  // Vertex layout of the store's vertex buffers. Meshes without normals are
+  // stored with zero normals.
+  struct Vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+  };
+
+  // Location of a mesh in the store.
+  struct Mesh {
+    unsigned int vertex_buffer;
+    unsigned int index_buffer;
+    // Byte offset of the mesh's first `Vertex` in `vertex_buffer`. Indices
+    // are relative to it.
+    size_t vertex_offset;
+    // Byte offset of the mesh's first index in `index_buffer`.
+    size_t index_offset;
+    // `GL_UNSIGNED_SHORT` where the mesh has few enough vertices, and
+    // `GL_UNSIGNED_INT` otherwise.
+    unsigned int index_type;
+    int num_indices;
+  };
+
+  static GlMeshStore& Get();
+
+  // Returns the location of the mesh with the given data, uploading it on
+  // first request. Meshes are identified by the addresses of their data,
+  // which must therefore be static. Returns nullptr if buffer objects are
+  // unsupported.
+  const Mesh* FindOrUpload(absl::Span<const glm::vec3> vertices,
+                           absl::Span<const glm::vec3> normals,
+                           absl::Span<const glm::vec2> uvs,
+                           absl::Span<const glm::uvec3> triangles);
+
+ private:
+  // A pair of buffers that meshes are packed into until either is full.
+  struct Page {
+    unsigned int vertex_buffer;
+    unsigned int index_buffer;
+    size_t vertex_capacity;
+    size_t index_capacity;
+    size_t vertex_size = 0;
+    size_t index_size = 0;
+  };
+
+  GlMeshStore() = default;
+
+  // Returns a page with room for the given number of bytes, allocating one
+  // if needed.
+  Page& FindPageLocked(size_t vertex_bytes, size_t index_bytes);
+
+  std::mutex store_mu_;
+  std::vector<Page> pages_;
+  // Keyed by the addresses of the mesh's vertex and triangle data.
+  absl::node_hash_map<std::pair<const void*, const void*>, Mesh> meshes_;
+};
+
+}  // namespace gl
+
+#endif  // UTIL_GRAPHICS_GL_MESH_STORE_H_
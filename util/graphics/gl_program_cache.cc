@@ -0,0 +1,257 @@
+#include "util/graphics/gl_program_cache.h"
+
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "third_party/gl_helper.h"
+#include "util/logging/logging.h"
+#include "util/redirect.h"
+
+namespace gl {
+
+namespace {
+// 64-bit FNV-1a. Unlike `std::hash`, this is stable across builds, so it is
+// suitable for naming files that outlive the process.
+constexpr uint64_t kFnvOffsetBasis = 0xcbf29ce484222325ull;
+constexpr uint64_t kFnvPrime = 0x100000001b3ull;
+
+uint64_t Fnv1a(const std::string& data, uint64_t hash = kFnvOffsetBasis) {
+  for (unsigned char c : data) {
+    hash ^= c;
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+std::string GetGlString(unsigned int name) {
+  const unsigned char* value = glGetString(name);
+  return value == nullptr ? "" : reinterpret_cast<const char*>(value);
+}
+
+std::string MakeKey(const std::string& vertex_code,
+                    const std::string& fragment_code) {
+  return absl::StrCat(vertex_code.size(), ":", vertex_code, fragment_code);
+}
+
+GlProgramCache& (*get_function)() = nullptr;
+}  // namespace
+
+GlProgramCache& GlProgramCache::Get() {
+  if (get_function != nullptr) {
+    return get_function();
+  }
+  static GlProgramCache* cache = new GlProgramCache();
+  return *cache;
+}
+
+void GlProgramCache::SetGetFunction(GlProgramCache& (*get)()) {
+  SetRedirect(&get_function, get, &GlProgramCache::Get);
+}
+
+void GlProgramCache::SetDiskCacheDirectory(std::string directory) {
+  if (!directory.empty() && mkdir(directory.c_str(), 0755) != 0 &&
+      errno != EEXIST) {
+    LOG(ERROR) << "Failed to create program cache directory " << directory
+               << ": " << std::strerror(errno);
+    directory.clear();
+  }
+
+  std::unique_lock<std::mutex> lock(cache_mu_);
+  disk_cache_directory_ = std::move(directory);
+}
+
+absl::StatusOr<std::shared_ptr<GlProgram>> GlProgramCache::GetOrLink(
+    const std::string& vertex_code, const std::string& fragment_code) {
+  const uint64_t key = Fnv1a(MakeKey(vertex_code, fragment_code));
+  std::unique_lock<std::mutex> lock(cache_mu_);
+
+  // Whether the program is cached once linked. Sources whose hash collides
+  // with those of another live program are linked without caching.
+  bool cacheable = true;
+  while (true) {
+    auto iter = programs_.find(key);
+    if (iter == programs_.end()) {
+      break;
+    }
+    Entry& entry = iter->second;
+    if (entry.vertex_code != vertex_code ||
+        entry.fragment_code != fragment_code) {
+      if (entry.in_flight || !entry.program.expired()) {
+        LOG(INFO) << "Program cache hash collision; linking without caching";
+        cacheable = false;
+        break;
+      }
+      programs_.erase(iter);
+      break;
+    }
+    if (entry.in_flight) {
+      entry_cv_.wait(lock);
+      continue;
+    }
+    if (std::shared_ptr<GlProgram> program = entry.program.lock()) {
+      LOG(DEBUG) << "Program cache hit for program "
+                 << program->program_handle();
+      return program;
+    }
+    programs_.erase(iter);
+    break;
+  }
+
+  if (cacheable) {
+    EraseExpiredLocked();
+    programs_[key] = {.vertex_code = vertex_code,
+                      .fragment_code = fragment_code,
+                      .in_flight = true};
+  }
+  const std::string path =
+      (!disk_cache_directory_.empty() && BinariesSupported())
+          ? DiskCachePath(vertex_code, fragment_code)
+          : "";
+  lock.unlock();
+
+  std::shared_ptr<GlProgram> program;
+  if (!path.empty()) {
+    program = LoadBinary(path);
+  }
+  absl::Status status;
+  if (program == nullptr) {
+    auto status_or_program = GlProgram::CompileAndLink(
+        vertex_code, fragment_code, /*binary_retrievable=*/!path.empty());
+    if (status_or_program.ok()) {
+      program = *std::move(status_or_program);
+      if (!path.empty()) {
+        StoreBinary(*program, path);
+      }
+    } else {
+      status = status_or_program.status();
+    }
+  }
+
+  if (cacheable) {
+    lock.lock();
+    if (program != nullptr) {
+      Entry& entry = programs_[key];
+      entry.program = program;
+      entry.in_flight = false;
+    } else {
+      // Threads waiting on the entry compile the program themselves, and
+      // report their own errors.
+      programs_.erase(key);
+    }
+    lock.unlock();
+    entry_cv_.notify_all();
+  }
+  if (program == nullptr) {
+    return status;
+  }
+  return program;
+}
+
+void GlProgramCache::EraseExpiredLocked() {
+  for (auto iter = programs_.begin(); iter != programs_.end();) {
+    if (!iter->second.in_flight && iter->second.program.expired()) {
+      iter = programs_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+std::string GlProgramCache::DiskCachePath(
+    const std::string& vertex_code, const std::string& fragment_code) const {
+  // Binaries are only valid for the driver that produced them.
+  uint64_t hash = Fnv1a(GetGlString(GL_VENDOR));
+  hash = Fnv1a(GetGlString(GL_RENDERER), hash);
+  hash = Fnv1a(GetGlString(GL_VERSION), hash);
+  hash = Fnv1a(MakeKey(vertex_code, fragment_code), hash);
+  return absl::StrFormat("%s/%016x.bin", disk_cache_directory_, hash);
+}
+
+std::shared_ptr<GlProgram> GlProgramCache::LoadBinary(
+    const std::string& path) const {
+  std::ifstream input(path, std::ios::binary);
+  if (!input) {
+    return nullptr;
+  }
+
+  uint32_t format = 0;
+  if (!input.read(reinterpret_cast<char*>(&format), sizeof(format))) {
+    LOG(ERROR) << "Malformed program binary " << path;
+    return nullptr;
+  }
+  std::vector<char> binary((std::istreambuf_iterator<char>(input)),
+                           std::istreambuf_iterator<char>());
+  if (binary.empty()) {
+    LOG(ERROR) << "Malformed program binary " << path;
+    return nullptr;
+  }
+
+  auto program = std::make_shared<GlProgram>();
+  glProgramBinary(program->program_handle(), format, binary.data(),
+                  binary.size());
+  int success = 0;
+  glGetProgramiv(program->program_handle(), GL_LINK_STATUS, &success);
+  if (!success) {
+    // Usually the result of a driver update; the caller recompiles.
+    LOG(INFO) << "Driver rejected program binary " << path;
+    return nullptr;
+  }
+
+  LOG(DEBUG) << "Loaded program binary " << path;
+  return program;
+}
+
+void GlProgramCache::StoreBinary(const GlProgram& program,
+                                 const std::string& path) const {
+  int length = 0;
+  glGetProgramiv(program.program_handle(), GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  std::vector<char> binary(length);
+  unsigned int format = 0;
+  glGetProgramBinary(program.program_handle(), length, nullptr, &format,
+                     binary.data());
+
+  // Write to a temporary file and rename it into place, so that concurrent
+  // processes never observe a partially written binary.
+  const std::string temporary_path = absl::StrCat(path, ".tmp");
+  {
+    std::ofstream output(temporary_path, std::ios::binary | std::ios::trunc);
+    const uint32_t stored_format = format;
+    output.write(reinterpret_cast<const char*>(&stored_format),
+                 sizeof(stored_format));
+    output.write(binary.data(), binary.size());
+    if (!output) {
+      LOG(ERROR) << "Failed to write program binary " << temporary_path;
+      return;
+    }
+  }
+  if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+    LOG(ERROR) << "Failed to move program binary into place at " << path;
+    std::remove(temporary_path.c_str());
+  }
+}
+
+bool GlProgramCache::BinariesSupported() {
+  if (binaries_supported_ < 0) {
+    int num_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+    binaries_supported_ = num_formats > 0;
+    LOG(INFO) << "Program binaries "
+              << (binaries_supported_ ? "are" : "are not") << " supported";
+  }
+  return binaries_supported_;
+}
+
+}  // namespace gl
@@ -0,0 +1,85 @@
+#ifndef UTIL_GRAPHICS_GL_PROGRAM_CACHE_H_
+#define UTIL_GRAPHICS_GL_PROGRAM_CACHE_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "absl/status/statusor.h"
+#include "util/graphics/gl_interface.h"
+
+namespace gl {
+
+// Process-wide cache of linked shader programs, keyed by a hash of their
+// source code.
+//
+// Programs are reference counted: a program stays cached for as long as any
+// caller holds the `GlProgram` returned for it, so presets built from the same
+// sources share a single program object. Callers must set every uniform they
+// depend on before drawing with a cached program, since other holders of the
+// program may have changed them.
+//
+// When a disk cache directory is configured and the driver supports program
+// binaries, linked binaries are persisted to that directory and loaded in
+// place of compiling on subsequent runs. This class is thread-safe. Programs
+// are compiled without holding the cache lock, so threads only wait on each
+// other when they request the same sources at once.
+class GlProgramCache {
+ public:
+  static GlProgramCache& Get();
+
+  // Makes `Get` defer to `get`. Code loaded from a shared library carries its
+  // own copy of this class, and must be pointed at the host's `Get` so that
+  // its programs are shared with the host's.
+  static void SetGetFunction(GlProgramCache& (*get)());
+
+  // Sets the directory that program binaries are persisted to, creating it if
+  // needed. An empty path disables the disk cache.
+  void SetDiskCacheDirectory(std::string directory);
+
+  // Returns a program linked from the given sources, compiling it only if no
+  // program with identical sources is live in the process or cached on disk.
+  absl::StatusOr<std::shared_ptr<GlProgram>> GetOrLink(
+      const std::string& vertex_code, const std::string& fragment_code);
+
+ private:
+  GlProgramCache() = default;
+
+  // Returns the path of the disk cache entry for the given sources.
+  std::string DiskCachePath(const std::string& vertex_code,
+                            const std::string& fragment_code) const;
+
+  // Loads a program from the binary at `path`. Returns null if there is no
+  // such binary or the driver rejects it.
+  std::shared_ptr<GlProgram> LoadBinary(const std::string& path) const;
+  void StoreBinary(const GlProgram& program, const std::string& path) const;
+
+  // Whether or not the current driver supports program binaries.
+  bool BinariesSupported();
+
+  // Removes entries whose programs are no longer held by any caller.
+  void EraseExpiredLocked();
+
+  struct Entry {
+    // Sources of the program, compared on a hash hit to rule out collisions.
+    std::string vertex_code;
+    std::string fragment_code;
+    std::weak_ptr<GlProgram> program;
+    // Whether a thread is compiling the program. Others requesting the same
+    // sources wait on `entry_cv_` rather than compiling it again.
+    bool in_flight = false;
+  };
+
+  std::mutex cache_mu_;
+  std::condition_variable entry_cv_;
+  std::unordered_map<uint64_t, Entry> programs_;
+  std::string disk_cache_directory_;
+  int binaries_supported_ = -1;
+};
+
+}  // namespace gl
+
+#endif  // UTIL_GRAPHICS_GL_PROGRAM_CACHE_H_
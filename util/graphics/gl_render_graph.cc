@@ -0,0 +1,315 @@
+#include "util/graphics/gl_render_graph.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "third_party/gl_helper.h"
+#include "util/graphics/gl_gpu_timer_scope.h"
+#include "util/graphics/gl_state_cache.h"
+#include "util/logging/logging.h"
+
+namespace gl {
+
+std::shared_ptr<GlRenderTarget> GlRenderGraph::PassResources::Get(
+    Resource resource) const {
+  CHECK(resource.valid()) << "Invalid render graph resource";
+  return graph_->resources_[resource.index].render_target;
+}
+
+GlRenderGraph::GlRenderGraph(std::shared_ptr<GlRenderTargetPool> pool)
+    : pool_(std::move(pool)) {}
+
+GlRenderGraph::Resource GlRenderGraph::Import(
+    std::string name, std::shared_ptr<GlRenderTarget> render_target) {
+  CHECK(render_target != nullptr) << "Imported null render target " << name;
+  ResourceState state;
+  state.name = std::move(name);
+  state.render_target = std::move(render_target);
+  resources_.push_back(std::move(state));
+  return Resource{.index = static_cast<int>(resources_.size()) - 1};
+}
+
+GlRenderGraph::Resource GlRenderGraph::CreateTransient(
+    std::string name, int width, int height, GlRenderTarget::Options options) {
+  ResourceState state;
+  state.name = std::move(name);
+  state.transient = true;
+  state.width = width;
+  state.height = height;
+  state.options = options;
+  resources_.push_back(std::move(state));
+  return Resource{.index = static_cast<int>(resources_.size()) - 1};
+}
+
+void GlRenderGraph::AddPass(Pass pass) {
+  CHECK(pass.write.valid()) << "Pass " << pass.name << " writes no resource";
+  std::vector<int> dependencies =
+      AddDependencies(nodes_.size(), pass.reads, {pass.write});
+  nodes_.push_back(
+      Node{.pass = std::move(pass), .dependencies = std::move(dependencies)});
+}
+
+void GlRenderGraph::AddSwap(Resource a, Resource b) {
+  CHECK(a.valid() && b.valid()) << "Invalid render graph resource";
+  CHECK(!resources_[a.index].transient && !resources_[b.index].transient)
+      << "Only imported resources may be swapped";
+  std::vector<int> dependencies = AddDependencies(nodes_.size(), {}, {a, b});
+  nodes_.push_back(Node{.is_swap = true,
+                        .swap_a = a,
+                        .swap_b = b,
+                        .dependencies = std::move(dependencies)});
+}
+
+std::vector<int> GlRenderGraph::AddDependencies(
+    int node, const std::vector<Resource>& reads,
+    const std::vector<Resource>& writes) {
+  std::vector<int> dependencies;
+  for (const Resource& read : reads) {
+    ResourceState& state = resources_[read.index];
+    if (state.last_writer >= 0) {
+      dependencies.push_back(state.last_writer);
+    }
+    state.readers.push_back(node);
+  }
+  for (const Resource& write : writes) {
+    ResourceState& state = resources_[write.index];
+    if (state.last_writer >= 0) {
+      dependencies.push_back(state.last_writer);
+    }
+    for (int reader : state.readers) {
+      if (reader != node) {
+        dependencies.push_back(reader);
+      }
+    }
+    state.last_writer = node;
+    state.readers.clear();
+  }
+
+  std::sort(dependencies.begin(), dependencies.end());
+  dependencies.erase(std::unique(dependencies.begin(), dependencies.end()),
+                     dependencies.end());
+  return dependencies;
+}
+
+std::vector<int> GlRenderGraph::Schedule() const {
+  const int num_nodes = nodes_.size();
+  std::vector<int> num_unmet(num_nodes, 0);
+  std::vector<std::vector<int>> dependents(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    num_unmet[i] = nodes_[i].dependencies.size();
+    for (int dependency : nodes_[i].dependencies) {
+      dependents[dependency].push_back(i);
+    }
+  }
+
+  std::vector<int> ready;
+  for (int i = 0; i < num_nodes; ++i) {
+    if (num_unmet[i] == 0) ready.push_back(i);
+  }
+
+  // Greedily prefer a pass that keeps the current target bound, then one
+  // that keeps the current program active, then declaration order.
+  std::vector<int> order;
+  order.reserve(num_nodes);
+  int last_write = -1;
+  const GlProgram* last_program = nullptr;
+  while (!ready.empty()) {
+    auto score = [&](int i) {
+      const Node& node = nodes_[i];
+      if (node.is_swap) return 0;
+      return (node.pass.write.index == last_write ? 2 : 0) +
+             (node.pass.program != nullptr &&
+                      node.pass.program.get() == last_program
+                  ? 1
+                  : 0);
+    };
+    auto best = ready.begin();
+    for (auto iter = ready.begin(); iter != ready.end(); ++iter) {
+      const int iter_score = score(*iter), best_score = score(*best);
+      if (iter_score > best_score ||
+          (iter_score == best_score && *iter < *best)) {
+        best = iter;
+      }
+    }
+
+    const int i = *best;
+    ready.erase(best);
+    order.push_back(i);
+    if (!nodes_[i].is_swap) {
+      last_write = nodes_[i].pass.write.index;
+      if (nodes_[i].pass.program != nullptr) {
+        last_program = nodes_[i].pass.program.get();
+      }
+    }
+    for (int dependent : dependents[i]) {
+      if (--num_unmet[dependent] == 0) ready.push_back(dependent);
+    }
+  }
+
+  CHECK(order.size() == nodes_.size()) << "Render graph has a cycle";
+  return order;
+}
+
+absl::Status GlRenderGraph::Execute() {
+  stats_ = Stats();
+  const std::vector<int> order = Schedule();
+  for (int position = 0; position < order.size(); ++position) {
+    const Node& node = nodes_[order[position]];
+    if (node.is_swap) {
+      resources_[node.swap_a.index].last_use = position;
+      resources_[node.swap_b.index].last_use = position;
+      continue;
+    }
+    for (const Resource& read : node.pass.reads) {
+      resources_[read.index].last_use = position;
+    }
+    resources_[node.pass.write.index].last_use = position;
+  }
+
+  std::shared_ptr<GlRenderTargetActivation> target_activation;
+  int active_target = -1;
+  std::shared_ptr<GlProgramActivation> program_activation;
+  const GlProgram* active_program = nullptr;
+
+  for (int position = 0; position < order.size(); ++position) {
+    Node& node = nodes_[order[position]];
+    if (node.is_swap) {
+      const int a = node.swap_a.index, b = node.swap_b.index;
+      // A swap undoes a pending swap of the same pair.
+      auto pending = std::find_if(
+          pending_swaps_.begin(), pending_swaps_.end(),
+          [&](const std::pair<int, int>& swap) {
+            return (swap.first == a && swap.second == b) ||
+                   (swap.first == b && swap.second == a);
+          });
+      if (pending != pending_swaps_.end()) {
+        pending_swaps_.erase(pending);
+        stats_.elided_swaps += 2;
+      } else {
+        pending_swaps_.push_back({a, b});
+      }
+      continue;
+    }
+
+    Pass& pass = node.pass;
+    GlGpuTimerScope pass_timer_scope(pass.name);
+    std::vector<int> used;
+    for (const Resource& read : pass.reads) used.push_back(read.index);
+    used.push_back(pass.write.index);
+
+    for (int resource : used) {
+      for (int swapped : FlushSwapsFor(resource)) {
+        // Swapping exchanges the targets' framebuffers (or reattaches their
+        // textures), so the active target must be reactivated to bind the
+        // framebuffer of its new texture.
+        if (swapped == active_target) {
+          target_activation.reset();
+          active_target = -1;
+        }
+      }
+
+      ResourceState& state = resources_[resource];
+      if (state.transient && state.render_target == nullptr) {
+        auto status_or_render_target =
+            pool_->LeaseTransient(state.width, state.height, state.options);
+        if (!status_or_render_target.ok()) {
+          return status_or_render_target.status();
+        }
+        state.render_target = *std::move(status_or_render_target);
+        state.cleared_color.reset();
+        ++stats_.transient_targets;
+      }
+    }
+
+    ResourceState& write = resources_[pass.write.index];
+    if (active_target == pass.write.index) {
+      ++stats_.elided_framebuffer_binds;
+      // Passes may change the viewport; restore the target's.
+      GlStateCache::Current().Viewport(0, 0, write.render_target->width(),
+                                       write.render_target->height());
+    } else {
+      target_activation.reset();
+      target_activation = write.render_target->Activate();
+      active_target = pass.write.index;
+    }
+
+    if (pass.program != nullptr) {
+      if (pass.program.get() == active_program) {
+        ++stats_.elided_program_binds;
+      } else {
+        program_activation.reset();
+        program_activation = pass.program->Activate();
+        active_program = pass.program.get();
+      }
+    }
+
+    if (pass.clear_color.has_value()) {
+      if (write.cleared_color == pass.clear_color) {
+        ++stats_.elided_clears;
+      } else {
+        const glm::vec4& color = *pass.clear_color;
+        glClearColor(color.x, color.y, color.z, color.w);
+        glClear(GL_COLOR_BUFFER_BIT |
+                (write.render_target->options().enable_depth
+                     ? GL_DEPTH_BUFFER_BIT
+                     : 0));
+      }
+    }
+
+    if (pass.execute) {
+      pass.execute(PassResources(this));
+      write.cleared_color.reset();
+    } else {
+      write.cleared_color = pass.clear_color;
+    }
+
+    // Return transients to the pool as soon as they are dead, so that later
+    // transients with the same key can alias them.
+    for (int resource : used) {
+      ResourceState& state = resources_[resource];
+      if (!state.transient || state.last_use != position ||
+          state.render_target == nullptr) {
+        continue;
+      }
+      if (resource == active_target) {
+        target_activation.reset();
+        active_target = -1;
+      }
+      state.render_target.reset();
+    }
+  }
+
+  program_activation.reset();
+  target_activation.reset();
+  for (const auto& [a, b] : pending_swaps_) {
+    Swap(a, b);
+  }
+  pending_swaps_.clear();
+  return absl::OkStatus();
+}
+
+std::vector<int> GlRenderGraph::FlushSwapsFor(int resource) {
+  std::vector<int> swapped;
+  for (auto iter = pending_swaps_.begin(); iter != pending_swaps_.end();) {
+    if (iter->first != resource && iter->second != resource) {
+      ++iter;
+      continue;
+    }
+    Swap(iter->first, iter->second);
+    swapped.push_back(iter->first);
+    swapped.push_back(iter->second);
+    iter = pending_swaps_.erase(iter);
+  }
+  return swapped;
+}
+
+void GlRenderGraph::Swap(int a, int b) {
+  if (!resources_[a].render_target->swap_texture_unit(
+          resources_[b].render_target.get())) {
+    LOG(ERROR) << "Failed to swap " << resources_[a].name << " and "
+               << resources_[b].name;
+  }
+  std::swap(resources_[a].cleared_color, resources_[b].cleared_color);
+}
+
+}  // namespace gl
@@ -0,0 +1,153 @@
+#ifndef UTIL_GRAPHICS_GL_RENDER_GRAPH_H_
+#define UTIL_GRAPHICS_GL_RENDER_GRAPH_H_
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "third_party/glm_helper.h"
+#include "util/graphics/gl_interface.h"
+#include "util/graphics/gl_render_target.h"
+#include "util/graphics/gl_render_target_pool.h"
+
+namespace gl {
+
+// Declarative description of the render passes making up a preset's frame.
+//
+// Rather than activating render targets and programs by hand, callers declare
+// the resources each pass reads and writes, and `Execute` sequences them:
+//
+//  * Transient resources are leased from a `GlRenderTargetPool` immediately
+//    before the first pass that uses them and returned immediately after the
+//    last, so transients with disjoint lifetimes alias the same target.
+//  * Consecutive passes writing the same target share a single framebuffer
+//    binding, consecutive passes using the same program share a single
+//    program activation, clears of targets that are already clear are
+//    dropped, and swaps which cancel out are never performed.
+//  * Passes are reordered, within the constraints of their declared reads and
+//    writes, to maximize the above.
+//
+// A preset builds and executes its graph within `OnDrawFrame`, so passes are
+// scheduled per preset. Transients are still shared between presets, through
+// the pool they are leased from. A graph is built and executed once; it is not
+// thread-safe.
+class GlRenderGraph {
+ public:
+  // Opaque reference to a resource declared on a graph.
+  struct Resource {
+    int index = -1;
+    bool valid() const { return index >= 0; }
+  };
+
+  // Resolves resources to render targets while a pass executes.
+  class PassResources {
+   public:
+    std::shared_ptr<GlRenderTarget> Get(Resource resource) const;
+
+   private:
+    friend class GlRenderGraph;
+    explicit PassResources(const GlRenderGraph* graph) : graph_(graph) {}
+    const GlRenderGraph* graph_;
+  };
+
+  struct Pass {
+    std::string name;
+    // Resources sampled by the pass.
+    std::vector<Resource> reads;
+    // Resource rendered to by the pass. Its render target is active while
+    // `execute` runs.
+    Resource write;
+    // If set, the written target (and its depth buffer, if any) is cleared to
+    // this color before `execute` runs.
+    std::optional<glm::vec4> clear_color;
+    // Program the pass draws with, if any. It is active while `execute` runs.
+    std::shared_ptr<GlProgram> program;
+    std::function<void(const PassResources&)> execute;
+  };
+
+  // Counts of work avoided by the last call to `Execute`.
+  struct Stats {
+    int elided_framebuffer_binds = 0;
+    int elided_program_binds = 0;
+    int elided_clears = 0;
+    int elided_swaps = 0;
+    // Number of distinct render targets leased for transient resources.
+    int transient_targets = 0;
+  };
+
+  explicit GlRenderGraph(std::shared_ptr<GlRenderTargetPool> pool);
+
+  // Declares a resource backed by an existing render target, e.g. a feedback
+  // buffer or the output of the frame.
+  Resource Import(std::string name,
+                  std::shared_ptr<GlRenderTarget> render_target);
+  // Declares a scratch resource of the given size and options. Its contents
+  // are undefined until written, and are discarded after its last use.
+  Resource CreateTransient(std::string name, int width, int height,
+                           GlRenderTarget::Options options);
+
+  void AddPass(Pass pass);
+  // Exchanges the textures of two imported resources, as for
+  // `GlRenderTarget::swap_texture_unit`, once the passes declared before it
+  // that use either resource have executed.
+  void AddSwap(Resource a, Resource b);
+
+  // Schedules and executes every declared pass.
+  absl::Status Execute();
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct ResourceState {
+    std::string name;
+    std::shared_ptr<GlRenderTarget> render_target;
+    bool transient = false;
+    int width = 0, height = 0;
+    GlRenderTarget::Options options;
+    // Position in the execution order of the last node using this resource.
+    int last_use = -1;
+    // Color the target is known to be uniformly cleared to.
+    std::optional<glm::vec4> cleared_color;
+
+    // Bookkeeping for deriving dependencies as nodes are added: the last node
+    // to write this resource, and the nodes which have read it since.
+    int last_writer = -1;
+    std::vector<int> readers;
+  };
+
+  struct Node {
+    Pass pass;
+    // Set for swap nodes, which have no pass.
+    bool is_swap = false;
+    Resource swap_a, swap_b;
+    std::vector<int> dependencies;
+  };
+
+  // Returns the earlier nodes that node `node`, which uses the given
+  // resources, must execute after, and records its uses.
+  std::vector<int> AddDependencies(int node,
+                                   const std::vector<Resource>& reads,
+                                   const std::vector<Resource>& writes);
+  // Returns the node indices in execution order.
+  std::vector<int> Schedule() const;
+  // Performs any pending swaps involving `resource`. Returns the resources
+  // whose textures were exchanged.
+  std::vector<int> FlushSwapsFor(int resource);
+  void Swap(int a, int b);
+
+  std::shared_ptr<GlRenderTargetPool> pool_;
+  std::vector<ResourceState> resources_;
+  std::vector<Node> nodes_;
+  // Swaps that have been scheduled but not yet performed, as pairs of
+  // resource indices.
+  std::vector<std::pair<int, int>> pending_swaps_;
+  Stats stats_;
+};
+
+}  // namespace gl
+
+#endif  // UTIL_GRAPHICS_GL_RENDER_GRAPH_H_
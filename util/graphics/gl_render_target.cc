@@ -1,94 +1,97 @@
 #include "util/graphics/gl_render_target.h"
 
 #include <iostream>
+#include <utility>
 
+#include "absl/status/status.h"
 #include "third_party/gl_helper.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/logging/logging.h"
-#include "util/status/status_macros.h"
 
 namespace gl {
 
+namespace {
+const char* FramebufferStatusString(GLenum framebuffer_status) {
+  switch (framebuffer_status) {
+    case GL_FRAMEBUFFER_COMPLETE:
+      return "GL_FRAMEBUFFER_COMPLETE";
+    case GL_FRAMEBUFFER_UNDEFINED:
+      return "GL_FRAMEBUFFER_UNDEFINED";
+    case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT:
+      return "GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT";
+    case GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT:
+      return "GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT";
+    case GL_FRAMEBUFFER_INCOMPLETE_DRAW_BUFFER:
+      return "GL_FRAMEBUFFER_INCOMPLETE_DRAW_BUFFER";
+    case GL_FRAMEBUFFER_INCOMPLETE_READ_BUFFER:
+      return "GL_FRAMEBUFFER_INCOMPLETE_READ_BUFFER";
+    case GL_FRAMEBUFFER_UNSUPPORTED:
+      return "GL_FRAMEBUFFER_UNSUPPORTED";
+    case GL_FRAMEBUFFER_INCOMPLETE_MULTISAMPLE:
+      return "GL_FRAMEBUFFER_INCOMPLETE_MULTISAMPLE";
+    case GL_FRAMEBUFFER_INCOMPLETE_LAYER_TARGETS:
+      return "GL_FRAMEBUFFER_INCOMPLETE_LAYER_TARGETS";
+    default:
+      return "unknown framebuffer status";
+  }
+}
+
+// Returns true if the bound framebuffer is complete, logging its status
+// otherwise.
+bool CheckFramebufferStatus(unsigned int framebuffer_handle) {
+  const GLenum framebuffer_status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (framebuffer_status == GL_FRAMEBUFFER_COMPLETE) {
+    return true;
+  }
+  LOG(ERROR) << "Framebuffer " << framebuffer_handle << " is incomplete: "
+             << FramebufferStatusString(framebuffer_status);
+  return false;
+}
+}  // namespace
+
 GlRenderTargetActivation::GlRenderTargetActivation(
     std::shared_ptr<GlRenderTarget> render_target)
     : render_target_(render_target) {
-  // Configure the backing texture.
-  glBindFramebuffer(GL_FRAMEBUFFER, render_target_->framebuffer_handle());
-  glBindRenderbuffer(GL_RENDERBUFFER, render_target_->renderbuffer_handle());
-  LOG(DEBUG) << "Bound framebuffer " << render_target_->framebuffer_handle()
-             << " and renderbuffer " << render_target_->renderbuffer_handle();
-
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                         render_target_->texture_handle(), 0);
-  if (render_target_->options().enable_depth) {
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-                           GL_TEXTURE_2D, render_target_->depth_buffer_handle(),
-                           0);
-  }
-
-  LOG(DEBUG) << "Configured framebuffer texture as "
-             << render_target_->texture_handle() << " for framebuffer "
-             << render_target_->framebuffer_handle() << " and renderbuffer "
-             << render_target_->renderbuffer_handle();
-  auto framebuffer_status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-  if (framebuffer_status == GL_FRAMEBUFFER_COMPLETE) {
-    LOG(DEBUG) << "Successfully configured framebuffer";
-  } else {
-    LOG(ERROR) << "Failed to configure framebuffer";
-    switch (framebuffer_status) {
-      case GL_FRAMEBUFFER_UNDEFINED:
-        LOG(ERROR) << "GL_FRAMEBUFFER_UNDEFINED";
-        break;
-      case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT:
-        LOG(ERROR) << "GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT";
-        break;
-      case GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT:
-        LOG(ERROR) << "GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT";
-        break;
-      case GL_FRAMEBUFFER_INCOMPLETE_DRAW_BUFFER:
-        LOG(ERROR) << "GL_FRAMEBUFFER_INCOMPLETE_DRAW_BUFFER";
-        break;
-      case GL_FRAMEBUFFER_INCOMPLETE_READ_BUFFER:
-        LOG(ERROR) << "GL_FRAMEBUFFER_INCOMPLETE_READ_BUFFER";
-        break;
-      case GL_FRAMEBUFFER_UNSUPPORTED:
-        LOG(ERROR) << "GL_FRAMEBUFFER_UNSUPPORTED";
-        break;
-      case GL_FRAMEBUFFER_INCOMPLETE_MULTISAMPLE:
-        LOG(ERROR) << "GL_FRAMEBUFFER_INCOMPLETE_MULTISAMPLE";
-        break;
-      case GL_FRAMEBUFFER_INCOMPLETE_LAYER_TARGETS:
-        LOG(ERROR) << "GL_FRAMEBUFFER_INCOMPLETE_LAYER_TARGETS";
-        break;
-    }
+  GlStateCache& state_cache = GlStateCache::Current();
+  state_cache.BindFramebuffer(render_target_->framebuffer_handle());
+  if (kDebugLoggingEnabled &&
+      !CheckFramebufferStatus(render_target_->framebuffer_handle())) {
+    return;
+  }
+  if (!render_target_->framebuffer_complete()) {
     return;
   }
 
-  glViewport(0, 0, render_target_->width(), render_target_->height());
-  LOG(DEBUG) << "Configured viewport: " << render_target_->width() << "x"
-             << render_target->height();
+  state_cache.Viewport(0, 0, render_target_->width(),
+                       render_target_->height());
 }
 
 GlRenderTargetActivation::~GlRenderTargetActivation() {
-  glBindRenderbuffer(GL_RENDERBUFFER, 0);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  LOG(DEBUG) << "Unbound framebuffer";
+  GlStateCache::Current().BindFramebuffer(0);
 }
 
 GlRenderTarget::GlRenderTarget(
-    int width, int height, int texture_unit,
-    std::shared_ptr<GlTextureManager> texture_manager, Options options)
-    : texture_unit_(texture_unit),
+    int width, int height, std::shared_ptr<GlTextureManager> texture_manager,
+    Options options)
+    : width_(0),
+      height_(0),
+      framebuffer_handle_(0),
+      framebuffer_dirty_(true),
+      framebuffer_complete_(false),
+      texture_handle_(0),
+      depth_buffer_handle_(0),
       texture_manager_(texture_manager),
-      options_(options) {
-  // Create a new renderbuffer.
-  glGenFramebuffers(1, &renderbuffer_handle_);
-  LOG(DEBUG) << "Generated renderbuffer: " << renderbuffer_handle_;
-  // Create a new framebuffer.
-  glGenFramebuffers(1, &framebuffer_handle_);
-  LOG(DEBUG) << "Generated framebuffer: " << framebuffer_handle_;
-  // Generate a backing texture.
-  glGenTextures(1, &texture_handle_);
-  LOG(DEBUG) << "Generated texture: " << texture_handle_;
+      options_(options),
+      color_format_(ResolveColorFormat(options.color_format)),
+      depth_format_(ResolveDepthFormat(options.depth_format)) {
+  // Framebuffers are not shared between contexts, so they are generated on
+  // first activation, in the context that will render to them. Textures are
+  // shared, so they are generated here.
+  if (color_format_ != GlColorFormat::kNone) {
+    glGenTextures(1, &texture_handle_);
+    texture_manager_->AddTexture();
+    LOG(DEBUG) << "Generated texture: " << texture_handle_;
+  }
 
   if (options_.enable_depth) {
     glGenTextures(1, &depth_buffer_handle_);
@@ -100,62 +103,130 @@ GlRenderTarget::GlRenderTarget(
 absl::StatusOr<std::shared_ptr<GlRenderTarget>> GlRenderTarget::MakeShared(
     int width, int height, std::shared_ptr<GlTextureManager> texture_manager,
     Options options) {
-  ASSIGN_OR_RETURN(auto texture_unit, texture_manager->Allocate());
-  auto return_value = std::shared_ptr<GlRenderTarget>(new GlRenderTarget(
-      width, height, texture_unit, texture_manager, options));
-  LOG(INFO) << "GlRenderTarget::MakeShared(): New target has use count "
-            << return_value.use_count();
-  return return_value;
+  if (options.color_format == GlColorFormat::kNone && !options.enable_depth) {
+    return absl::InvalidArgumentError(
+        "Render target must have a color or depth texture.");
+  }
+  return std::shared_ptr<GlRenderTarget>(
+      new GlRenderTarget(width, height, texture_manager, options));
 }
 
 GlRenderTarget::~GlRenderTarget() {
   LOG(DEBUG) << "Disposing render target with texture handle: "
              << texture_handle_;
+  GlStateCache& state_cache = GlStateCache::Current();
   if (options_.enable_depth) {
+    state_cache.ForgetTexture(depth_buffer_handle_);
     glDeleteTextures(1, &depth_buffer_handle_);
   }
 
-  texture_manager_->Deallocate(texture_unit_);
-  glDeleteTextures(1, &texture_handle_);
-  glDeleteFramebuffers(1, &framebuffer_handle_);
-  glDeleteFramebuffers(1, &renderbuffer_handle_);
+  if (texture_handle_ != 0) {
+    state_cache.ForgetTexture(texture_handle_);
+    glDeleteTextures(1, &texture_handle_);
+    texture_manager_->RemoveTexture();
+  }
+  if (framebuffer_handle_ != 0) {
+    state_cache.ForgetFramebuffer(framebuffer_handle_);
+    glDeleteFramebuffers(1, &framebuffer_handle_);
+  }
 }
 
 void GlRenderTarget::UpdateGeometry(int width, int height) {
   std::unique_lock<std::mutex> lock(render_target_mu_);
 
+  // Reallocating storage discards the contents of the render target, so skip
+  // it when the geometry has not changed.
+  if (width == width_ && height == height_) {
+    return;
+  }
+
   width_ = width;
   height_ = height;
+  // The attachments are unchanged, but their completeness must be rechecked.
+  framebuffer_dirty_ = true;
 
   if (width_ == 0 || height_ == 0) {
     return;
   }
 
-  glBindTexture(GL_TEXTURE_2D, texture_handle_);
-  LOG(DEBUG) << "Bound RGBA texture: " << texture_handle_;
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA,
-               GL_UNSIGNED_BYTE, 0);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  GlStateCache& state_cache = GlStateCache::Current();
+  if (texture_handle_ != 0) {
+    const GlTextureFormat& color_format = GetTextureFormat(color_format_);
+    state_cache.BindTexture(texture_handle_);
+    LOG(DEBUG) << "Bound " << color_format.name
+               << " texture: " << texture_handle_;
+    glTexImage2D(GL_TEXTURE_2D, 0, color_format.internal_format, width_,
+                 height_, 0, color_format.format, color_format.type, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    texture_binding_options_.reset();
+  }
   if (options_.enable_depth) {
-    glBindTexture(GL_TEXTURE_2D, depth_buffer_handle_);
-    LOG(DEBUG) << "Bound depth texture: " << depth_buffer_handle_;
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width_, height_, 0,
-                 GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 0);
+    const GlTextureFormat& depth_format = GetTextureFormat(depth_format_);
+    state_cache.BindTexture(depth_buffer_handle_);
+    LOG(DEBUG) << "Bound " << depth_format.name
+               << " texture: " << depth_buffer_handle_;
+    glTexImage2D(GL_TEXTURE_2D, 0, depth_format.internal_format, width_,
+                 height_, 0, depth_format.format, depth_format.type, 0);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   }
-  glBindTexture(GL_TEXTURE_2D, 0);
+  state_cache.BindTexture(0);
   LOG(DEBUG) << "Unbound texture";
 }
 
 std::shared_ptr<GlRenderTargetActivation> GlRenderTarget::Activate() {
-  CHECK(width_ != 0 && height_ != 0)
-      << "Render target size must be nonzero before activation.";
+  {
+    std::unique_lock<std::mutex> lock(render_target_mu_);
+    CHECK(width_ != 0 && height_ != 0)
+        << "Render target size must be nonzero before activation.";
+    if (framebuffer_handle_ == 0) {
+      glGenFramebuffers(1, &framebuffer_handle_);
+      LOG(DEBUG) << "Generated framebuffer: " << framebuffer_handle_;
+      framebuffer_dirty_ = true;
+    }
+    if (framebuffer_dirty_) {
+      AttachLocked();
+    }
+  }
   return std::make_shared<GlRenderTargetActivation>(shared_from_this());
 }
 
+void GlRenderTarget::AttachLocked() {
+  GlStateCache::Current().BindFramebuffer(framebuffer_handle_);
+  if (texture_handle_ != 0) {
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           texture_handle_, 0);
+  } else {
+    // Without a color attachment, the framebuffer is only complete if it
+    // neither draws to nor reads from one.
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+  }
+  if (options_.enable_depth) {
+    glFramebufferTexture2D(GL_FRAMEBUFFER,
+                           GetTextureFormat(depth_format_).attachment,
+                           GL_TEXTURE_2D, depth_buffer_handle_, 0);
+  }
+  framebuffer_complete_ = CheckFramebufferStatus(framebuffer_handle_);
+  framebuffer_dirty_ = false;
+  LOG(DEBUG) << "Attached texture " << texture_handle_ << " to framebuffer "
+             << framebuffer_handle_;
+}
+
+size_t GlRenderTarget::EstimateMemoryUsage() {
+  std::unique_lock<std::mutex> lock(render_target_mu_);
+  size_t bytes_per_pixel = GetTextureFormat(color_format_).bytes_per_pixel;
+  if (options_.enable_depth) {
+    bytes_per_pixel += GetTextureFormat(depth_format_).bytes_per_pixel;
+  }
+  return bytes_per_pixel * width_ * height_;
+}
+
 bool GlRenderTarget::swap_texture_unit(GlRenderTarget* other) {
+  CHECK(color_format_ == other->color_format_ &&
+        depth_format_ == other->depth_format_)
+      << "Cannot swap the textures of render targets with different formats.";
   std::unique_lock<std::mutex> lock(render_target_mu_);
   std::unique_lock<std::mutex> other_lock(other->render_target_mu_,
                                           std::defer_lock);
@@ -163,9 +234,20 @@ bool GlRenderTarget::swap_texture_unit(GlRenderTarget* other) {
     return false;
   }
 
-  int intermediate_texture_handle = other->texture_handle_;
-  other->texture_handle_ = texture_handle_;
-  texture_handle_ = intermediate_texture_handle;
+  std::swap(texture_handle_, other->texture_handle_);
+  // The applied parameters belong to the textures.
+  std::swap(texture_binding_options_, other->texture_binding_options_);
+  if (!options_.enable_depth && !other->options_.enable_depth) {
+    // Without depth attachments, a framebuffer is a function of its color
+    // texture alone, so it can follow the texture. Targets swapped every
+    // frame then never reattach.
+    std::swap(framebuffer_handle_, other->framebuffer_handle_);
+    std::swap(framebuffer_dirty_, other->framebuffer_dirty_);
+    std::swap(framebuffer_complete_, other->framebuffer_complete_);
+  } else {
+    framebuffer_dirty_ = true;
+    other->framebuffer_dirty_ = true;
+  }
   return true;
 }
 
@@ -1,12 +1,16 @@
 #ifndef UTIL_GRAPHICS_GL_RENDER_TARGET_H_
 #define UTIL_GRAPHICS_GL_RENDER_TARGET_H_
 
+#include <cstddef>
 #include <memory>
 #include <mutex>
+#include <optional>
 
 #include "absl/status/statusor.h"
 #include "third_party/glm_helper.h"
 #include "util/graphics/gl_interface.h"
+#include "util/graphics/gl_texture_binding_options.h"
+#include "util/graphics/gl_texture_format.h"
 #include "util/graphics/gl_texture_manager.h"
 
 namespace gl {
@@ -30,6 +34,12 @@ class GlRenderTarget : public std::enable_shared_from_this<GlRenderTarget> {
     // `true`, there will be a depth buffer attachment and associated texture
     // allocated for the render target.
     bool enable_depth = false;
+    // Requested formats of the color and depth textures. Formats that the
+    // implementation cannot render to are replaced by the closest one it can;
+    // see `ResolveColorFormat()`. A target with `GlColorFormat::kNone` has no
+    // color texture, and requires `enable_depth`.
+    GlColorFormat color_format = GlColorFormat::kRgba8;
+    GlDepthFormat depth_format = GlDepthFormat::kDepth24Stencil8;
   };
 
   static absl::StatusOr<std::shared_ptr<GlRenderTarget>> MakeShared(
@@ -44,14 +54,17 @@ class GlRenderTarget : public std::enable_shared_from_this<GlRenderTarget> {
 
   virtual std::shared_ptr<GlRenderTargetActivation> Activate();
 
+  // Reallocates the render target storage at the given dimensions. Does
+  // nothing if the dimensions are unchanged.
   void UpdateGeometry(int width, int height);
 
-  int texture_unit() const { return texture_unit_; }
-  unsigned int renderbuffer_handle() const { return renderbuffer_handle_; }
   unsigned int framebuffer_handle() const { return framebuffer_handle_; }
   unsigned int texture_handle() const { return texture_handle_; }
   unsigned int depth_buffer_handle() const { return depth_buffer_handle_; }
   const Options& options() const { return options_; }
+  // Formats actually allocated, after fallbacks.
+  GlColorFormat color_format() const { return color_format_; }
+  GlDepthFormat depth_format() const { return depth_format_; }
   int width() {
     std::unique_lock<std::mutex> lock(render_target_mu_);
     return width_;
@@ -64,24 +77,56 @@ class GlRenderTarget : public std::enable_shared_from_this<GlRenderTarget> {
     std::unique_lock<std::mutex> lock(render_target_mu_);
     return {width_, height_};
   }
+  // Returns the memory allocated for the target's textures, in bytes.
+  size_t EstimateMemoryUsage();
 
+  // Exchanges the textures backing this target and `other`, which must have
+  // the same formats. Returns false if `other` is in use by another thread.
   bool swap_texture_unit(GlRenderTarget* other);
 
+  // Binding options last applied to the parameters of `texture_handle()`, if
+  // known. Where sampler objects are unavailable, texture parameters are only
+  // reapplied when these differ from the options of a new binding.
+  const std::optional<GlTextureBindingOptions>& texture_binding_options()
+      const {
+    return texture_binding_options_;
+  }
+  void set_texture_binding_options(GlTextureBindingOptions options) {
+    texture_binding_options_ = options;
+  }
+
  private:
-  GlRenderTarget(int width, int height, int texture_unit,
+  GlRenderTarget(int width, int height,
                  std::shared_ptr<GlTextureManager> texture_manager,
                  Options options);
 
+  friend class GlRenderTargetActivation;
+  bool framebuffer_complete() {
+    std::unique_lock<std::mutex> lock(render_target_mu_);
+    return framebuffer_complete_;
+  }
+  // Attaches the target's textures to its framebuffer, leaving it bound, and
+  // checks the framebuffer's completeness.
+  void AttachLocked();
+
   std::mutex render_target_mu_;
   int width_, height_;
-  int texture_unit_;
+  // Framebuffer with `texture_handle_` (and `depth_buffer_handle_`, if depth
+  // is enabled) attached. Framebuffers are not shared between contexts, so it
+  // is generated on first activation, in the context that renders to it.
   unsigned int framebuffer_handle_;
-  unsigned int renderbuffer_handle_;
+  // Whether the attachments of `framebuffer_handle_` must be remade, or their
+  // completeness rechecked, before it is next bound.
+  bool framebuffer_dirty_;
+  bool framebuffer_complete_;
   unsigned int texture_handle_;
   unsigned int depth_buffer_handle_;
+  std::optional<GlTextureBindingOptions> texture_binding_options_;
 
   std::shared_ptr<GlTextureManager> texture_manager_;
   const Options options_;
+  const GlColorFormat color_format_;
+  const GlDepthFormat depth_format_;
 };
 
 }  // namespace gl
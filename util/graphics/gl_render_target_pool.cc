@@ -0,0 +1,190 @@
+#include "util/graphics/gl_render_target_pool.h"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "util/logging/logging.h"
+#include "util/redirect.h"
+#include "util/status/status_macros.h"
+
+namespace gl {
+
+namespace {
+std::shared_ptr<GlRenderTargetPool> (*for_texture_manager_function)(
+    std::shared_ptr<GlTextureManager>) = nullptr;
+}  // namespace
+
+std::shared_ptr<GlRenderTargetPool> GlRenderTargetPool::MakeShared(
+    std::shared_ptr<GlTextureManager> texture_manager, Options options) {
+  return std::shared_ptr<GlRenderTargetPool>(
+      new GlRenderTargetPool(std::move(texture_manager), options));
+}
+
+std::shared_ptr<GlRenderTargetPool> GlRenderTargetPool::ForTextureManager(
+    std::shared_ptr<GlTextureManager> texture_manager) {
+  if (for_texture_manager_function != nullptr) {
+    return for_texture_manager_function(std::move(texture_manager));
+  }
+  // Pools hold their texture manager, so holding them here would keep every
+  // texture manager alive. Instead a pool lives for as long as its users do,
+  // and its entry is dropped once it, and so its texture manager, is gone.
+  static std::mutex* pools_mu = new std::mutex();
+  static auto* pools = new std::unordered_map<
+      GlTextureManager*, std::weak_ptr<GlRenderTargetPool>>();
+
+  std::unique_lock<std::mutex> lock(*pools_mu);
+  for (auto iter = pools->begin(); iter != pools->end();) {
+    if (iter->second.expired()) {
+      iter = pools->erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  std::weak_ptr<GlRenderTargetPool>& weak_pool =
+      (*pools)[texture_manager.get()];
+  std::shared_ptr<GlRenderTargetPool> pool = weak_pool.lock();
+  if (pool == nullptr) {
+    pool = MakeShared(texture_manager, Options());
+    weak_pool = pool;
+  }
+  return pool;
+}
+
+void GlRenderTargetPool::SetForTextureManagerFunction(
+    std::shared_ptr<GlRenderTargetPool> (*for_texture_manager)(
+        std::shared_ptr<GlTextureManager>)) {
+  SetRedirect(&for_texture_manager_function, for_texture_manager,
+              &GlRenderTargetPool::ForTextureManager);
+}
+
+GlRenderTargetPool::GlRenderTargetPool(
+    std::shared_ptr<GlTextureManager> texture_manager, Options options)
+    : texture_manager_(std::move(texture_manager)), options_(options) {}
+
+absl::StatusOr<std::shared_ptr<GlRenderTarget>>
+GlRenderTargetPool::LeasePersistent(int width, int height,
+                                    GlRenderTarget::Options options) {
+  return Lease(width, height, options, /*transient=*/false);
+}
+
+absl::StatusOr<std::shared_ptr<GlRenderTarget>>
+GlRenderTargetPool::LeaseTransient(int width, int height,
+                                   GlRenderTarget::Options options) {
+  return Lease(width, height, options, /*transient=*/true);
+}
+
+void GlRenderTargetPool::ReleaseIdle() {
+  std::list<IdleTarget> released;
+  {
+    std::unique_lock<std::mutex> lock(pool_mu_);
+    released.swap(idle_);
+    idle_memory_bytes_ = 0;
+  }
+  // `released` is destroyed outside of the lock, since disposing of render
+  // targets calls back into the texture manager.
+}
+
+size_t GlRenderTargetPool::num_idle() {
+  std::unique_lock<std::mutex> lock(pool_mu_);
+  return idle_.size();
+}
+
+size_t GlRenderTargetPool::idle_memory_usage() {
+  std::unique_lock<std::mutex> lock(pool_mu_);
+  return idle_memory_bytes_;
+}
+
+int GlRenderTargetPool::num_transient_leases() {
+  std::unique_lock<std::mutex> lock(pool_mu_);
+  return num_transient_leases_;
+}
+
+GlRenderTargetPool::Key GlRenderTargetPool::MakeKey(
+    int width, int height, const GlRenderTarget::Options& options) {
+  return {.width = width,
+          .height = height,
+          .enable_depth = options.enable_depth,
+          .color_format = options.color_format,
+          .depth_format = options.depth_format};
+}
+
+absl::StatusOr<std::shared_ptr<GlRenderTarget>> GlRenderTargetPool::Lease(
+    int width, int height, GlRenderTarget::Options options, bool transient) {
+  const Key key = MakeKey(width, height, options);
+
+  std::shared_ptr<GlRenderTarget> render_target;
+  {
+    std::unique_lock<std::mutex> lock(pool_mu_);
+    for (auto iter = idle_.begin(); iter != idle_.end(); ++iter) {
+      if (iter->key == key) {
+        render_target = std::move(iter->render_target);
+        idle_memory_bytes_ -= iter->memory_bytes;
+        idle_.erase(iter);
+        break;
+      }
+    }
+  }
+
+  if (render_target == nullptr) {
+    ASSIGN_OR_RETURN(render_target,
+                     GlRenderTarget::MakeShared(width, height,
+                                                texture_manager_, options));
+    LOG(DEBUG) << "Render target pool allocated " << width << "x" << height
+               << " target";
+  }
+
+  if (transient) {
+    std::unique_lock<std::mutex> lock(pool_mu_);
+    ++num_transient_leases_;
+  }
+
+  // The lease aliases the pooled target, so `shared_from_this()` on the target
+  // still refers to the pool's reference.
+  GlRenderTarget* raw_render_target = render_target.get();
+  return std::shared_ptr<GlRenderTarget>(
+      raw_render_target,
+      [pool = weak_from_this(), render_target = std::move(render_target),
+       transient](GlRenderTarget*) mutable {
+        if (auto locked_pool = pool.lock()) {
+          locked_pool->Return(std::move(render_target), transient);
+        }
+      });
+}
+
+void GlRenderTargetPool::Return(std::shared_ptr<GlRenderTarget> render_target,
+                                bool transient) {
+  const glm::ivec2 size = render_target->size();
+  const Key key = MakeKey(size.x, size.y, render_target->options());
+  const size_t memory_bytes = render_target->EstimateMemoryUsage();
+
+  std::vector<std::shared_ptr<GlRenderTarget>> evicted;
+  {
+    std::unique_lock<std::mutex> lock(pool_mu_);
+    if (transient) {
+      --num_transient_leases_;
+      idle_.push_front({.key = key,
+                        .memory_bytes = memory_bytes,
+                        .render_target = std::move(render_target)});
+    } else {
+      idle_.push_back({.key = key,
+                       .memory_bytes = memory_bytes,
+                       .render_target = std::move(render_target)});
+    }
+    idle_memory_bytes_ += memory_bytes;
+
+    while (idle_memory_bytes_ > options_.max_idle_memory_bytes &&
+           !idle_.empty()) {
+      idle_memory_bytes_ -= idle_.back().memory_bytes;
+      evicted.push_back(std::move(idle_.back().render_target));
+      idle_.pop_back();
+    }
+  }
+
+  if (!evicted.empty()) {
+    LOG(DEBUG) << "Render target pool released " << evicted.size()
+               << " idle targets";
+  }
+}
+
+}  // namespace gl
@@ -0,0 +1,124 @@
+#ifndef UTIL_GRAPHICS_GL_RENDER_TARGET_POOL_H_
+#define UTIL_GRAPHICS_GL_RENDER_TARGET_POOL_H_
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+
+#include "absl/status/statusor.h"
+#include "util/graphics/gl_render_target.h"
+#include "util/graphics/gl_texture_manager.h"
+
+namespace gl {
+
+// Shares render targets between their users, keyed by size and options.
+//
+// Targets are handed out as leases. A lease is an ordinary `GlRenderTarget`
+// pointer which returns the target to the pool when the last copy of it is
+// dropped, after which the target may be leased again with its contents
+// intact. Nothing is cleared on lease; holders must initialize the contents
+// they depend on.
+//
+// Persistent leases are for targets whose contents must survive from frame to
+// frame, such as feedback buffers, and are held until their owner is destroyed
+// or needs a target of another size. Transient leases are for scratch targets
+// whose contents only matter within a single pass; holders must drop them as
+// soon as the pass is complete, so that successive passes (e.g. the layers of
+// a blend) draw into the same target instead of each holding their own.
+//
+// Returned targets stay allocated, up to a budget, for the next lease with
+// the same key. This class is thread-safe.
+class GlRenderTargetPool
+    : public std::enable_shared_from_this<GlRenderTargetPool> {
+ public:
+  struct Options {
+    // Upper bound on the memory held by targets that are not leased, in bytes.
+    // Idle targets beyond this budget are released, persistent ones first.
+    size_t max_idle_memory_bytes = 32 << 20;
+  };
+
+  static std::shared_ptr<GlRenderTargetPool> MakeShared(
+      std::shared_ptr<GlTextureManager> texture_manager, Options options);
+
+  // Returns the pool shared by every user of `texture_manager`, creating it
+  // with default options if there is none. The pool, along with its idle
+  // targets, is released once the last user drops it.
+  static std::shared_ptr<GlRenderTargetPool> ForTextureManager(
+      std::shared_ptr<GlTextureManager> texture_manager);
+
+  // Makes `ForTextureManager` defer to `for_texture_manager`. Code loaded from
+  // a shared library carries its own copy of this class, and must be pointed
+  // at the host's `ForTextureManager` so that it leases from the host's pools.
+  static void SetForTextureManagerFunction(
+      std::shared_ptr<GlRenderTargetPool> (*for_texture_manager)(
+          std::shared_ptr<GlTextureManager>));
+
+  // Leases a target of the given size and options whose contents are retained
+  // for as long as the lease is held.
+  absl::StatusOr<std::shared_ptr<GlRenderTarget>> LeasePersistent(
+      int width, int height, GlRenderTarget::Options options);
+
+  // Leases a scratch target of the given size and options, to be dropped at
+  // the end of the current pass.
+  absl::StatusOr<std::shared_ptr<GlRenderTarget>> LeaseTransient(
+      int width, int height, GlRenderTarget::Options options);
+
+  // Releases every target that is not currently leased.
+  void ReleaseIdle();
+
+  size_t num_idle();
+  size_t idle_memory_usage();
+  // Number of transient leases currently held. Outside of a pass this should
+  // be zero.
+  int num_transient_leases();
+
+ private:
+  struct Key {
+    int width;
+    int height;
+    bool enable_depth;
+    GlColorFormat color_format;
+    GlDepthFormat depth_format;
+
+    bool operator==(const Key& other) const {
+      return width == other.width && height == other.height &&
+             enable_depth == other.enable_depth &&
+             color_format == other.color_format &&
+             depth_format == other.depth_format;
+    }
+  };
+
+  struct IdleTarget {
+    Key key;
+    size_t memory_bytes;
+    std::shared_ptr<GlRenderTarget> render_target;
+  };
+
+  GlRenderTargetPool(std::shared_ptr<GlTextureManager> texture_manager,
+                     Options options);
+
+  static Key MakeKey(int width, int height,
+                     const GlRenderTarget::Options& options);
+
+  absl::StatusOr<std::shared_ptr<GlRenderTarget>> Lease(
+      int width, int height, GlRenderTarget::Options options, bool transient);
+  // Files `render_target` back into the idle list. Invoked when the last copy
+  // of a lease is dropped.
+  void Return(std::shared_ptr<GlRenderTarget> render_target, bool transient);
+
+  std::shared_ptr<GlTextureManager> texture_manager_;
+  const Options options_;
+
+  std::mutex pool_mu_;
+  // Idle targets in order of eviction priority: transient targets that were
+  // most recently returned are at the front, and targets released by
+  // persistent leases, whose owners have gone away, are at the back.
+  std::list<IdleTarget> idle_;
+  size_t idle_memory_bytes_ = 0;
+  int num_transient_leases_ = 0;
+};
+
+}  // namespace gl
+
+#endif  // UTIL_GRAPHICS_GL_RENDER_TARGET_POOL_H_
@@ -0,0 +1,243 @@
+#include "util/graphics/gl_render_target_readback.h"
+
+#include <cstring>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "third_party/gl_helper.h"
+#include "util/graphics/gl_capabilities.h"
+#include "util/graphics/gl_state_cache.h"
+#include "util/logging/logging.h"
+#include "util/status/status_macros.h"
+
+namespace gl {
+
+namespace {
+constexpr int kBytesPerPixel = 4;
+
+GLsync AsSync(void* fence) { return reinterpret_cast<GLsync>(fence); }
+}  // namespace
+
+absl::StatusOr<std::shared_ptr<GlRenderTargetReadback>>
+GlRenderTargetReadback::MakeShared(
+    Options options, std::shared_ptr<GlTextureManager> texture_manager,
+    Callback callback) {
+  if (options.num_buffers < 1) {
+    return absl::InvalidArgumentError(
+        "A readback requires at least one buffer");
+  }
+  if (options.size.x < 0 || options.size.y < 0) {
+    return absl::InvalidArgumentError("Readback size must not be negative");
+  }
+  std::shared_ptr<GlRenderTarget> downscale_target;
+  if (options.size.x > 0 && options.size.y > 0) {
+    ASSIGN_OR_RETURN(downscale_target,
+                     GlRenderTarget::MakeShared(options.size.x, options.size.y,
+                                                texture_manager));
+  }
+  return std::shared_ptr<GlRenderTargetReadback>(new GlRenderTargetReadback(
+      options, std::move(downscale_target), std::move(callback)));
+}
+
+GlRenderTargetReadback::GlRenderTargetReadback(
+    Options options, std::shared_ptr<GlRenderTarget> downscale_target,
+    Callback callback)
+    : options_(options),
+      pixel_buffer_objects_(GlCapabilities::Get().pixel_buffer_objects()),
+      sync_objects_(GlCapabilities::Get().sync_objects()),
+      downscale_target_(std::move(downscale_target)),
+      buffers_(options.num_buffers),
+      callback_(std::move(callback)) {
+  if (!pixel_buffer_objects_) {
+    LOG(INFO) << "Pixel pack buffers are unsupported; render targets will be "
+                 "read back synchronously";
+  }
+  if (callback_ != nullptr) {
+    worker_ = std::thread([this] { RunCallbacks(); });
+  }
+}
+
+GlRenderTargetReadback::~GlRenderTargetReadback() {
+  if (worker_.joinable()) {
+    {
+      std::unique_lock<std::mutex> lock(frame_mu_);
+      stopping_ = true;
+    }
+    frame_cv_.notify_all();
+    worker_.join();
+  }
+  for (Buffer& buffer : buffers_) {
+    if (buffer.fence != nullptr) glDeleteSync(AsSync(buffer.fence));
+    if (buffer.handle != 0) glDeleteBuffers(1, &buffer.handle);
+  }
+}
+
+void GlRenderTargetReadback::Capture(
+    std::shared_ptr<GlRenderTarget> render_target) {
+  const int64_t capture_index = num_captures_++;
+
+  // Deliver completed captures, oldest first, so that frames stay in order.
+  const int num_buffers = buffers_.size();
+  for (int i = 0; i < num_buffers; ++i) {
+    Buffer& buffer = buffers_[(next_buffer_ + i) % num_buffers];
+    if (!buffer.in_flight) continue;
+    if (!CopyCompleted(buffer)) break;
+    DeliverBuffer(buffer);
+  }
+
+  Buffer& buffer = buffers_[next_buffer_];
+  if (pixel_buffer_objects_ && buffer.in_flight) {
+    std::unique_lock<std::mutex> lock(frame_mu_);
+    ++num_dropped_;
+    return;
+  }
+
+  glm::ivec2 size = render_target->size();
+  std::shared_ptr<GlRenderTargetActivation> activation;
+  if (downscale_target_ != nullptr && size != options_.size) {
+    // Generates the framebuffer of the downscale target, if needed.
+    downscale_target_->Activate();
+    activation = render_target->Activate();
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER,
+                      downscale_target_->framebuffer_handle());
+    glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, options_.size.x,
+                      options_.size.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    // The state cache did not see the draw binding change, but unbinding the
+    // target through it replaces both bindings.
+    activation.reset();
+    activation = downscale_target_->Activate();
+    size = options_.size;
+  } else {
+    activation = render_target->Activate();
+  }
+
+  const size_t frame_bytes =
+      static_cast<size_t>(size.x) * size.y * kBytesPerPixel;
+  if (!pixel_buffer_objects_) {
+    Frame frame = {.capture_index = capture_index,
+                   .width = size.x,
+                   .height = size.y,
+                   .pixels = TakePixels(frame_bytes)};
+    glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE,
+                 frame.pixels.data());
+    Deliver(std::move(frame));
+    return;
+  }
+
+  if (buffer.handle == 0) glGenBuffers(1, &buffer.handle);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.handle);
+  if (buffer.capacity < frame_bytes) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, frame_bytes, nullptr, GL_STREAM_READ);
+    buffer.capacity = frame_bytes;
+  }
+  glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  if (sync_objects_) {
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  buffer.in_flight = true;
+  buffer.capture_index = capture_index;
+  buffer.width = size.x;
+  buffer.height = size.y;
+  next_buffer_ = (next_buffer_ + 1) % num_buffers;
+}
+
+std::optional<GlRenderTargetReadback::Frame> GlRenderTargetReadback::Poll() {
+  CHECK(callback_ == nullptr) << "Readbacks with a callback cannot be polled";
+  std::unique_lock<std::mutex> lock(frame_mu_);
+  std::optional<Frame> frame = std::move(latest_frame_);
+  latest_frame_.reset();
+  return frame;
+}
+
+bool GlRenderTargetReadback::CopyCompleted(const Buffer& buffer) const {
+  if (buffer.fence == nullptr) {
+    // Without fences, a copy is assumed complete when its buffer is about to
+    // be reused.
+    return buffer.capture_index + static_cast<int64_t>(buffers_.size()) <=
+           num_captures_;
+  }
+  const GLenum status = glClientWaitSync(AsSync(buffer.fence),
+                                         GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+  // A failed wait is not retried; mapping the buffer waits instead.
+  return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED ||
+         status == GL_WAIT_FAILED;
+}
+
+void GlRenderTargetReadback::DeliverBuffer(Buffer& buffer) {
+  if (buffer.fence != nullptr) {
+    glDeleteSync(AsSync(buffer.fence));
+    buffer.fence = nullptr;
+  }
+  buffer.in_flight = false;
+
+  const size_t frame_bytes =
+      static_cast<size_t>(buffer.width) * buffer.height * kBytesPerPixel;
+  Frame frame = {.capture_index = buffer.capture_index,
+                 .width = buffer.width,
+                 .height = buffer.height,
+                 .pixels = TakePixels(frame_bytes)};
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.handle);
+  const void* data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+  if (data == nullptr) {
+    LOG(ERROR) << "Failed to map readback buffer " << buffer.handle;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return;
+  }
+  std::memcpy(frame.pixels.data(), data, frame_bytes);
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  Deliver(std::move(frame));
+}
+
+void GlRenderTargetReadback::Deliver(Frame frame) {
+  {
+    std::unique_lock<std::mutex> lock(frame_mu_);
+    if (callback_ == nullptr) {
+      if (latest_frame_.has_value()) {
+        free_pixels_.push_back(std::move(latest_frame_->pixels));
+      }
+      latest_frame_ = std::move(frame);
+      return;
+    }
+    // A callback slower than the frame rate would otherwise queue frames
+    // without bound.
+    if (queued_frames_.size() >= buffers_.size()) {
+      free_pixels_.push_back(std::move(queued_frames_.front().pixels));
+      queued_frames_.pop_front();
+      ++num_dropped_;
+    }
+    queued_frames_.push_back(std::move(frame));
+  }
+  frame_cv_.notify_one();
+}
+
+std::vector<uint8_t> GlRenderTargetReadback::TakePixels(size_t size) {
+  std::vector<uint8_t> pixels;
+  {
+    std::unique_lock<std::mutex> lock(frame_mu_);
+    if (!free_pixels_.empty()) {
+      pixels = std::move(free_pixels_.back());
+      free_pixels_.pop_back();
+    }
+  }
+  pixels.resize(size);
+  return pixels;
+}
+
+void GlRenderTargetReadback::RunCallbacks() {
+  std::unique_lock<std::mutex> lock(frame_mu_);
+  while (true) {
+    frame_cv_.wait(lock,
+                   [this] { return stopping_ || !queued_frames_.empty(); });
+    if (stopping_) return;
+    Frame frame = std::move(queued_frames_.front());
+    queued_frames_.pop_front();
+    lock.unlock();
+    callback_(frame);
+    lock.lock();
+    free_pixels_.push_back(std::move(frame.pixels));
+  }
+}
+
+}  // namespace gl
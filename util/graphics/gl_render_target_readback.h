@@ -0,0 +1,144 @@
+#ifndef UTIL_GRAPHICS_GL_RENDER_TARGET_READBACK_H_
+#define UTIL_GRAPHICS_GL_RENDER_TARGET_READBACK_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "third_party/glm_helper.h"
+#include "util/graphics/gl_render_target.h"
+#include "util/graphics/gl_texture_manager.h"
+
+namespace gl {
+
+// Reads the color texture of render targets back to CPU memory without
+// waiting on the GPU. Each `Capture` starts copying a target into one of a
+// ring of pixel pack buffers and fences the copy. Later captures map the
+// buffers whose copies have completed, so frames arrive one or two captures
+// after they were made. Frames go to a callback, which runs on a worker thread
+// of the readback, or are kept for `Poll`.
+//
+// Where pixel pack buffers are unsupported, each capture reads synchronously.
+// Where fences are unsupported, a copy is assumed complete when its buffer is
+// about to be reused, and mapping the buffer may wait on the GPU.
+//
+// `Capture` and destruction must happen on the thread that renders to the
+// captured targets, with its context current. `Poll` may be called from any
+// thread.
+class GlRenderTargetReadback {
+ public:
+  struct Options {
+    // Size of the frames read back. Targets of another size are downscaled
+    // to it on the GPU, with linear filtering, before they are read. Zero to
+    // read targets at their own size.
+    glm::ivec2 size = glm::ivec2(0);
+    // Number of pixel pack buffers in the ring, which bounds the number of
+    // captures in flight. Captures made while every buffer is in flight are
+    // dropped.
+    int num_buffers = 3;
+  };
+
+  // A frame read back from a render target.
+  struct Frame {
+    // Index of the `Capture` that made the frame, counting from 0.
+    int64_t capture_index;
+    int width;
+    int height;
+    // RGBA pixels with 8 bits per channel, in rows from bottom to top.
+    std::vector<uint8_t> pixels;
+  };
+
+  // Receives each frame read back, in capture order.
+  using Callback = std::function<void(const Frame&)>;
+
+  // Constructs a readback that passes frames to `callback`, or keeps them
+  // for `Poll` if `callback` is null. `texture_manager` accounts for the
+  // texture that frames are downscaled into.
+  static absl::StatusOr<std::shared_ptr<GlRenderTargetReadback>> MakeShared(
+      Options options, std::shared_ptr<GlTextureManager> texture_manager,
+      Callback callback);
+  ~GlRenderTargetReadback();
+
+  GlRenderTargetReadback(const GlRenderTargetReadback&) = delete;
+  GlRenderTargetReadback& operator=(const GlRenderTargetReadback&) = delete;
+
+  // Starts reading back the current contents of `render_target`, and delivers
+  // the frames of earlier captures whose copies have completed.
+  void Capture(std::shared_ptr<GlRenderTarget> render_target);
+
+  // Returns the most recent frame delivered since the last call, if any,
+  // discarding older ones. Only for readbacks without a callback.
+  std::optional<Frame> Poll();
+
+  // Number of captures dropped so far because every buffer was in flight, or
+  // because the callback fell behind.
+  int64_t num_dropped() {
+    std::unique_lock<std::mutex> lock(frame_mu_);
+    return num_dropped_;
+  }
+
+ private:
+  // A pixel pack buffer of the ring, and the capture copied into it.
+  struct Buffer {
+    unsigned int handle = 0;
+    size_t capacity = 0;
+    // Whether the buffer holds a capture that has not been delivered.
+    bool in_flight = false;
+    // The `GLsync` fencing the copy, if fences are supported.
+    void* fence = nullptr;
+    int64_t capture_index = 0;
+    int width = 0;
+    int height = 0;
+  };
+
+  GlRenderTargetReadback(Options options,
+                         std::shared_ptr<GlRenderTarget> downscale_target,
+                         Callback callback);
+
+  // Returns whether the copy into `buffer` has completed, without waiting.
+  bool CopyCompleted(const Buffer& buffer) const;
+  // Maps `buffer` and delivers the frame in it.
+  void DeliverBuffer(Buffer& buffer);
+  void Deliver(Frame frame);
+  // Returns pixel storage of at least `size` bytes, reusing the storage of
+  // delivered frames.
+  std::vector<uint8_t> TakePixels(size_t size);
+  // Body of the worker thread.
+  void RunCallbacks();
+
+  const Options options_;
+  const bool pixel_buffer_objects_;
+  const bool sync_objects_;
+  // Targets are downscaled into this before they are read, if
+  // `options_.size` is set.
+  std::shared_ptr<GlRenderTarget> downscale_target_;
+  std::vector<Buffer> buffers_;
+  // The buffer the next capture is copied into, which holds the oldest
+  // capture if it is in flight.
+  int next_buffer_ = 0;
+  int64_t num_captures_ = 0;
+
+  const Callback callback_;
+  std::mutex frame_mu_;
+  std::condition_variable frame_cv_;
+  bool stopping_ = false;
+  int64_t num_dropped_ = 0;
+  // Frames waiting for the callback, oldest first.
+  std::deque<Frame> queued_frames_;
+  // The latest frame, for `Poll`.
+  std::optional<Frame> latest_frame_;
+  // Storage of delivered frames, for reuse.
+  std::vector<std::vector<uint8_t>> free_pixels_;
+  std::thread worker_;
+};
+
+}  // namespace gl
+
+#endif  // UTIL_GRAPHICS_GL_RENDER_TARGET_READBACK_H_
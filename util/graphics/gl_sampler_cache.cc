@@ -0,0 +1,26 @@
+#include "util/graphics/gl_sampler_cache.h"
+
+#include "third_party/gl_helper.h"
+#include "util/logging/logging.h"
+
+namespace gl {
+
+GlSamplerCache& GlSamplerCache::Get() {
+  static GlSamplerCache* cache = new GlSamplerCache();
+  return *cache;
+}
+
+unsigned int GlSamplerCache::GetOrCreate(
+    const GlTextureBindingOptions& options) {
+  std::unique_lock<std::mutex> lock(sampler_mu_);
+  unsigned int& sampler = samplers_[options];
+  if (sampler == 0) {
+    glGenSamplers(1, &sampler);
+    ApplyBindingOptions(options, sampler);
+    LOG(DEBUG) << "Created sampler " << sampler << "; " << samplers_.size()
+               << " cached";
+  }
+  return sampler;
+}
+
+}  // namespace gl
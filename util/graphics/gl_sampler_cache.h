@@ -0,0 +1,34 @@
+#ifndef UTIL_GRAPHICS_GL_SAMPLER_CACHE_H_
+#define UTIL_GRAPHICS_GL_SAMPLER_CACHE_H_
+
+#include <mutex>
+
+#include "absl/container/flat_hash_map.h"
+#include "util/graphics/gl_texture_binding_options.h"
+
+namespace gl {
+
+// Sampler objects, one per distinct `GlTextureBindingOptions`, created on
+// first use and kept for the life of the process. Sampler objects are shared
+// between contexts, so a single cache serves every context. Binding a cached
+// sampler to a texture unit replaces reconfiguring the bound texture's
+// parameters, which can force the driver to revalidate the texture on the next
+// draw. Requires `GlCapabilities::sampler_objects()`. This class is
+// thread-safe.
+class GlSamplerCache {
+ public:
+  static GlSamplerCache& Get();
+
+  // Returns the sampler configured with `options`, creating it if needed.
+  unsigned int GetOrCreate(const GlTextureBindingOptions& options);
+
+ private:
+  GlSamplerCache() = default;
+
+  std::mutex sampler_mu_;
+  absl::flat_hash_map<GlTextureBindingOptions, unsigned int> samplers_;
+};
+
+}  // namespace gl
+
+#endif  // UTIL_GRAPHICS_GL_SAMPLER_CACHE_H_
@@ -0,0 +1,306 @@
+#include "util/graphics/gl_state_cache.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "third_party/gl_helper.h"
+#include "util/graphics/gl_capabilities.h"
+#include "util/redirect.h"
+
+namespace gl {
+
+namespace {
+std::atomic<int64_t> issued_calls{0};
+std::atomic<int64_t> avoided_calls{0};
+std::atomic<bool> vertex_array_objects_enabled{false};
+// Incremented whenever a texture is forgotten by any cache.
+std::atomic<uint64_t> texture_generation{0};
+
+// Initial size of each context's streaming vertex buffer.
+constexpr size_t kVertexStreamCapacity = 256 << 10;
+
+thread_local GlStateCache* current_cache = nullptr;
+GlStateCache& (*current_function)() = nullptr;
+}  // namespace
+
+GlStateCache::Scope::Scope(GlStateCache* cache) : previous_(current_cache) {
+  current_cache = cache;
+}
+
+GlStateCache::Scope::~Scope() { current_cache = previous_; }
+
+GlStateCache& GlStateCache::Current() {
+  if (current_function != nullptr) {
+    return current_function();
+  }
+  if (current_cache != nullptr) {
+    return *current_cache;
+  }
+  thread_local GlStateCache thread_cache;
+  return thread_cache;
+}
+
+void GlStateCache::SetCurrentFunction(GlStateCache& (*current)()) {
+  SetRedirect(&current_function, current, &GlStateCache::Current);
+}
+
+GlStateCache::Stats GlStateCache::TakeStats() {
+  return Stats{.issued_calls = issued_calls.exchange(0),
+               .avoided_calls = avoided_calls.exchange(0)};
+}
+
+void GlStateCache::EnableVertexArrayObjects(bool enabled) {
+  vertex_array_objects_enabled = enabled;
+}
+
+GlStateCache::GlStateCache()
+    : global_texture_generation_(&texture_generation),
+      texture_generation_(texture_generation.load()),
+      use_vertex_array_object_(vertex_array_objects_enabled),
+      vertex_stream_(GL_ARRAY_BUFFER, kVertexStreamCapacity) {}
+
+template <typename T>
+bool GlStateCache::Unchanged(std::optional<T>& shadow, const T& value) {
+  if (shadow == value) {
+    avoided_calls.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  shadow = value;
+  issued_calls.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void GlStateCache::UseProgram(unsigned int program) {
+  if (Unchanged(program_, program)) return;
+  glUseProgram(program);
+}
+
+unsigned int GlStateCache::program() {
+  if (!program_.has_value()) {
+    int program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    program_ = program;
+  }
+  return *program_;
+}
+
+void GlStateCache::BindFramebuffer(unsigned int framebuffer) {
+  if (Unchanged(framebuffer_, framebuffer)) return;
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+unsigned int GlStateCache::framebuffer() {
+  if (!framebuffer_.has_value()) {
+    int framebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+    framebuffer_ = framebuffer;
+  }
+  return *framebuffer_;
+}
+
+void GlStateCache::Viewport(int x, int y, int width, int height) {
+  if (Unchanged(viewport_, glm::ivec4(x, y, width, height))) return;
+  glViewport(x, y, width, height);
+}
+
+glm::ivec4 GlStateCache::viewport() {
+  if (!viewport_.has_value()) {
+    glm::ivec4 viewport;
+    glGetIntegerv(GL_VIEWPORT, &viewport[0]);
+    viewport_ = viewport;
+  }
+  return *viewport_;
+}
+
+void GlStateCache::SetEnabled(unsigned int capability, bool enabled) {
+  std::optional<bool> shadow;
+  auto iter = capabilities_.begin();
+  for (; iter != capabilities_.end(); ++iter) {
+    if (iter->capability == capability) {
+      shadow = iter->enabled;
+      break;
+    }
+  }
+  if (Unchanged(shadow, enabled)) return;
+  if (iter == capabilities_.end()) {
+    capabilities_.push_back({.capability = capability, .enabled = enabled});
+  } else {
+    iter->enabled = enabled;
+  }
+
+  if (enabled) {
+    glEnable(capability);
+  } else {
+    glDisable(capability);
+  }
+}
+
+void GlStateCache::BlendFunc(unsigned int source_factor,
+                             unsigned int destination_factor) {
+  if (Unchanged(blend_func_, std::make_pair(source_factor, destination_factor)))
+    return;
+  glBlendFunc(source_factor, destination_factor);
+}
+
+void GlStateCache::PolygonMode(unsigned int mode) {
+  if (Unchanged(polygon_mode_, mode)) return;
+  glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void GlStateCache::LineWidth(float width) {
+  if (Unchanged(line_width_, width)) return;
+  glLineWidth(width);
+}
+
+void GlStateCache::ActiveTexture(int texture_unit) {
+  if (Unchanged(active_texture_unit_, texture_unit)) return;
+  glActiveTexture(GL_TEXTURE0 + texture_unit);
+}
+
+void GlStateCache::BindTexture(unsigned int texture) {
+  SyncTextureGeneration();
+  if (!active_texture_unit_.has_value()) {
+    int active_texture = GL_TEXTURE0;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &active_texture);
+    active_texture_unit_ = active_texture - GL_TEXTURE0;
+  }
+  const int texture_unit = *active_texture_unit_;
+  if (texture_unit >= textures_.size()) {
+    textures_.resize(texture_unit + 1);
+  }
+  if (texture_unit < texture_unit_last_use_.size()) {
+    // The unit now holds a texture bound for some other purpose, such as an
+    // upload, so it is the first to be reused.
+    texture_unit_last_use_[texture_unit] = 0;
+  }
+  if (Unchanged(textures_[texture_unit], texture)) return;
+  glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void GlStateCache::BindTexture(int texture_unit, unsigned int texture) {
+  ActiveTexture(texture_unit);
+  BindTexture(texture);
+}
+
+int GlStateCache::BindTextureToAnyUnit(unsigned int texture) {
+  // The search below reuses a unit without any GL calls, so a name deleted
+  // and reused since must not be found there.
+  SyncTextureGeneration();
+  if (texture_unit_last_use_.empty()) {
+    texture_unit_last_use_.resize(
+        std::max(1, GlCapabilities::Get().max_texture_units()), 0);
+  }
+  const int num_texture_units = texture_unit_last_use_.size();
+  if (textures_.size() < num_texture_units) {
+    textures_.resize(num_texture_units);
+  }
+
+  int texture_unit = 0;
+  for (int i = 0; i < num_texture_units; ++i) {
+    if (textures_[i] == texture) {
+      avoided_calls.fetch_add(1, std::memory_order_relaxed);
+      texture_unit_last_use_[i] = ++texture_unit_clock_;
+      return i;
+    }
+    if (texture_unit_last_use_[i] < texture_unit_last_use_[texture_unit]) {
+      texture_unit = i;
+    }
+  }
+
+  BindTexture(texture_unit, texture);
+  texture_unit_last_use_[texture_unit] = ++texture_unit_clock_;
+  return texture_unit;
+}
+
+void GlStateCache::BindSampler(int texture_unit, unsigned int sampler) {
+  if (texture_unit >= samplers_.size()) {
+    samplers_.resize(texture_unit + 1);
+  }
+  if (Unchanged(samplers_[texture_unit], sampler)) return;
+  glBindSampler(texture_unit, sampler);
+}
+
+void GlStateCache::BindBuffer(unsigned int target, unsigned int buffer) {
+  std::optional<unsigned int>& shadow =
+      target == GL_ELEMENT_ARRAY_BUFFER ? element_array_buffer_ : array_buffer_;
+  if (Unchanged(shadow, buffer)) return;
+  glBindBuffer(target, buffer);
+}
+
+void GlStateCache::BindVertexArray(unsigned int vertex_array) {
+  if (Unchanged(vertex_array_, vertex_array)) return;
+  glBindVertexArray(vertex_array);
+  element_array_buffer_.reset();
+}
+
+void GlStateCache::BindOwnVertexArray() {
+  if (!use_vertex_array_object_ ||
+      !GlCapabilities::Get().vertex_array_objects()) {
+    return;
+  }
+  if (vertex_array_object_ == 0) {
+    glGenVertexArrays(1, &vertex_array_object_);
+  }
+  BindVertexArray(vertex_array_object_);
+}
+
+const void* GlStateCache::StreamVertices(const void* data, size_t size) {
+  if (!GlCapabilities::Get().vertex_buffer_objects()) {
+    BindBuffer(GL_ARRAY_BUFFER, 0);
+    return data;
+  }
+  BindOwnVertexArray();
+  BindBuffer(GL_ARRAY_BUFFER, vertex_stream_.handle());
+  return reinterpret_cast<const void*>(vertex_stream_.Write(data, size));
+}
+
+void GlStateCache::UseClientArrays() {
+  if (vertex_array_object_ != 0) {
+    BindVertexArray(0);
+  }
+  BindBuffer(GL_ARRAY_BUFFER, 0);
+  BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void GlStateCache::ForgetTexture(unsigned int texture) {
+  SyncTextureGeneration();
+  for (std::optional<unsigned int>& bound_texture : textures_) {
+    if (bound_texture == texture) bound_texture = 0;
+  }
+  // This cache is already up to date, unless another cache forgot a texture
+  // in the meantime.
+  const uint64_t previous_generation = global_texture_generation_->fetch_add(1);
+  if (previous_generation == texture_generation_) {
+    texture_generation_ = previous_generation + 1;
+  }
+}
+
+void GlStateCache::SyncTextureGeneration() {
+  const uint64_t generation = global_texture_generation_->load();
+  if (generation == texture_generation_) return;
+  texture_generation_ = generation;
+  std::fill(textures_.begin(), textures_.end(), std::nullopt);
+}
+
+void GlStateCache::ForgetFramebuffer(unsigned int framebuffer) {
+  if (framebuffer_ == framebuffer) framebuffer_ = 0;
+}
+
+void GlStateCache::Invalidate() {
+  program_.reset();
+  framebuffer_.reset();
+  viewport_.reset();
+  capabilities_.clear();
+  blend_func_.reset();
+  polygon_mode_.reset();
+  line_width_.reset();
+  active_texture_unit_.reset();
+  textures_.clear();
+  samplers_.clear();
+  texture_unit_last_use_.clear();
+  array_buffer_.reset();
+  element_array_buffer_.reset();
+  vertex_array_.reset();
+}
+
+}  // namespace gl
@@ -0,0 +1,203 @@
+#ifndef UTIL_GRAPHICS_GL_STATE_CACHE_H_
+#define UTIL_GRAPHICS_GL_STATE_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "third_party/glm_helper.h"
+#include "util/graphics/gl_gpu_timer.h"
+#include "util/graphics/gl_streaming_buffer.h"
+
+namespace gl {
+
+// CPU-side shadow of the GL state that rendering code changes most often: the
+// program in use, the framebuffer binding, the viewport, capabilities such as
+// blending and depth testing, the blend function, the polygon mode, the line
+// width, the textures and samplers bound to each texture unit, and the
+// buffer and vertex array bindings. It also owns the objects that rendering
+// code streams vertices through, and the timer of its frames, which are
+// per-context for the same reason.
+//
+// Changes made through the cache are forwarded to GL only when they differ
+// from the shadowed value, and queries of the shadowed state are answered
+// without a round-trip to the driver. State starts out unknown, so the first
+// change of each kind is always forwarded. Any code that changes shadowed
+// state directly, such as a third-party renderer, must be followed by a call
+// to `Invalidate`.
+//
+// GL state belongs to a context, so each context has its own cache, which is
+// made current alongside the context by its `GlContextActivation`. A cache is
+// only used from the thread its context is current on, and is not
+// thread-safe.
+class GlStateCache {
+ public:
+  // Counts of state changes made through any cache.
+  struct Stats {
+    // Changes forwarded to GL.
+    int64_t issued_calls = 0;
+    // Changes dropped because the state already had the requested value.
+    int64_t avoided_calls = 0;
+  };
+
+  // Makes `cache` the current cache on this thread for the lifetime of the
+  // scope. Scopes may be nested.
+  class Scope {
+   public:
+    explicit Scope(GlStateCache* cache);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    GlStateCache* previous_;
+  };
+
+  // Returns the cache of the context current on this thread. On threads with
+  // no current cache, returns a cache private to the thread.
+  static GlStateCache& Current();
+
+  // Makes `Current` defer to `current`. Code loaded from a shared library
+  // carries its own copy of this class, and must be pointed at the host's
+  // `Current` before it renders, so that both keep one shadow per context.
+  // Changes made by such code are not counted in the host's `Stats`.
+  static void SetCurrentFunction(GlStateCache& (*current)());
+
+  // Returns the counts accumulated since the last call, and resets them. The
+  // application calls this once per frame.
+  static Stats TakeStats();
+
+  // Makes caches constructed afterwards stream vertices with a vertex array
+  // object of their own bound, where supported. Off by default. Contexts with
+  // a core profile have no default vertex array object, and require this.
+  static void EnableVertexArrayObjects(bool enabled);
+
+  GlStateCache();
+
+  void UseProgram(unsigned int program);
+  // Returns the program in use, querying the driver if it is unknown.
+  unsigned int program();
+
+  void BindFramebuffer(unsigned int framebuffer);
+  // Returns the bound framebuffer, querying the driver if it is unknown.
+  unsigned int framebuffer();
+
+  void Viewport(int x, int y, int width, int height);
+  // Returns the viewport as (x, y, width, height), querying the driver if it
+  // is unknown.
+  glm::ivec4 viewport();
+
+  void SetEnabled(unsigned int capability, bool enabled);
+  void Enable(unsigned int capability) { SetEnabled(capability, true); }
+  void Disable(unsigned int capability) { SetEnabled(capability, false); }
+
+  void BlendFunc(unsigned int source_factor, unsigned int destination_factor);
+  // Sets the polygon mode of both front and back faces.
+  void PolygonMode(unsigned int mode);
+  void LineWidth(float width);
+
+  void ActiveTexture(int texture_unit);
+  // Binds `texture` to the 2D target of the active texture unit.
+  void BindTexture(unsigned int texture);
+  // Activates `texture_unit` and binds `texture` to its 2D target.
+  void BindTexture(int texture_unit, unsigned int texture);
+  // Binds `texture` to the 2D target of some texture unit for sampling, and
+  // returns the unit. A unit the texture is already bound to is reused without
+  // any GL calls; otherwise the least recently used unit is rebound, which
+  // may leave another unit active. The textures of a draw call remain bound
+  // as long as it samples from no more than
+  // `GlCapabilities::max_texture_units()` of them.
+  int BindTextureToAnyUnit(unsigned int texture);
+  // Binds `sampler` to `texture_unit`. Requires sampler object support.
+  void BindSampler(int texture_unit, unsigned int sampler);
+
+  // Binds `buffer` to `target`, which is `GL_ARRAY_BUFFER` or
+  // `GL_ELEMENT_ARRAY_BUFFER`.
+  void BindBuffer(unsigned int target, unsigned int buffer);
+  void BindVertexArray(unsigned int vertex_array);
+  // Binds this context's own vertex array object, if vertex array objects are
+  // enabled and supported. Draws from buffer objects do this before binding
+  // their buffers.
+  void BindOwnVertexArray();
+
+  // Copies `size` bytes of vertex data into this context's streaming vertex
+  // buffer, binds it, and returns the pointer to pass to `glVertexPointer`
+  // and its kin for the data. Where buffer objects are unsupported, returns
+  // `data` itself, which must then remain valid until the draw is issued.
+  const void* StreamVertices(const void* data, size_t size);
+  // Unbinds the vertex array object and buffer objects, so that vertex and
+  // index pointers refer to client memory, as code that predates buffer
+  // objects expects.
+  void UseClientArrays();
+
+  // Times sections of the frames rendered in this context.
+  GlGpuTimer& gpu_timer() { return gpu_timer_; }
+
+  // Records that `texture` is being deleted. GL unbinds a deleted texture
+  // from every unit of the current context, and its name may be reused. Other
+  // contexts keep the deleted texture bound under the old name, so every
+  // other cache forgets its texture bindings before its next bind.
+  void ForgetTexture(unsigned int texture);
+  // Records that `framebuffer` is being deleted, which unbinds it if bound.
+  void ForgetFramebuffer(unsigned int framebuffer);
+
+  // Forgets all shadowed state, so that the next change of each kind is
+  // forwarded to GL. Objects owned by the cache are kept.
+  void Invalidate();
+
+ private:
+  struct Capability {
+    unsigned int capability;
+    bool enabled;
+  };
+
+  // Returns true, and counts an avoided call, if `shadow` already holds
+  // `value`. Otherwise stores `value` in `shadow` and counts an issued call.
+  template <typename T>
+  static bool Unchanged(std::optional<T>& shadow, const T& value);
+
+  // Forgets the texture bindings if any cache has forgotten a texture since
+  // this cache last checked.
+  void SyncTextureGeneration();
+
+  std::optional<unsigned int> program_;
+  std::optional<unsigned int> framebuffer_;
+  std::optional<glm::ivec4> viewport_;
+  std::vector<Capability> capabilities_;
+  std::optional<std::pair<unsigned int, unsigned int>> blend_func_;
+  std::optional<unsigned int> polygon_mode_;
+  std::optional<float> line_width_;
+  std::optional<int> active_texture_unit_;
+  // Texture bound to the 2D target of each unit, indexed by unit.
+  std::vector<std::optional<unsigned int>> textures_;
+  // Sampler bound to each unit, indexed by unit.
+  std::vector<std::optional<unsigned int>> samplers_;
+  // Value of `texture_unit_clock_` when each unit was last handed out by
+  // `BindTextureToAnyUnit`, indexed by unit. Units bound otherwise are
+  // considered unused.
+  std::vector<uint64_t> texture_unit_last_use_;
+  uint64_t texture_unit_clock_ = 0;
+  // Count of textures forgotten by any cache, and its value when `textures_`
+  // was last brought up to date. Held by pointer so that code loaded from a
+  // shared library, which carries its own copy of the count, updates the
+  // host's count through the host's caches.
+  std::atomic<uint64_t>* const global_texture_generation_;
+  uint64_t texture_generation_;
+  std::optional<unsigned int> array_buffer_;
+  // Part of the state of the bound vertex array object.
+  std::optional<unsigned int> element_array_buffer_;
+  std::optional<unsigned int> vertex_array_;
+
+  const bool use_vertex_array_object_;
+  // Generated on first use; see `GlStreamingBuffer` for the lifetime.
+  unsigned int vertex_array_object_ = 0;
+  GlStreamingBuffer vertex_stream_;
+  GlGpuTimer gpu_timer_;
+};
+
+}  // namespace gl
+
+#endif  // UTIL_GRAPHICS_GL_STATE_CACHE_H_
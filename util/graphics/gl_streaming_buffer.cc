@@ -0,0 +1,50 @@
+#include "util/graphics/gl_streaming_buffer.h"
+
+#include "third_party/gl_helper.h"
+#include "util/logging/logging.h"
+
+namespace gl {
+
+namespace {
+// Writes start at multiples of this, which satisfies the alignment of every
+// vertex attribute and index type.
+constexpr size_t kWriteAlignment = 16;
+}  // namespace
+
+GlStreamingBuffer::GlStreamingBuffer(unsigned int target, size_t capacity)
+    : target_(target), capacity_(capacity), offset_(capacity) {
+  CHECK(capacity > 0) << "Streaming buffer capacity must be nonzero.";
+}
+
+unsigned int GlStreamingBuffer::handle() {
+  if (handle_ == 0) {
+    glGenBuffers(1, &handle_);
+    LOG(DEBUG) << "Generated streaming buffer: " << handle_;
+  }
+  return handle_;
+}
+
+size_t GlStreamingBuffer::Write(const void* data, size_t size) {
+  if (size > capacity_) {
+    while (capacity_ < size) {
+      capacity_ *= 2;
+    }
+    LOG(DEBUG) << "Growing streaming buffer " << handle_ << " to "
+               << capacity_ << " bytes";
+    offset_ = capacity_;
+  }
+  if (offset_ + size > capacity_) {
+    // Orphan the storage: the driver allocates new storage, and frees the old
+    // once no pending draw reads it.
+    glBufferData(target_, capacity_, nullptr, GL_STREAM_DRAW);
+    offset_ = 0;
+  }
+
+  const size_t offset = offset_;
+  glBufferSubData(target_, offset, size, data);
+  offset_ = (offset + size + kWriteAlignment - 1) / kWriteAlignment *
+            kWriteAlignment;
+  return offset;
+}
+
+}  // namespace gl
@@ -0,0 +1,42 @@
+#ifndef UTIL_GRAPHICS_GL_STREAMING_BUFFER_H_
+#define UTIL_GRAPHICS_GL_STREAMING_BUFFER_H_
+
+#include <cstddef>
+
+namespace gl {
+
+// A buffer object that data drawn once is streamed through. Each write is
+// appended after the previous one; when the buffer is full, its storage is
+// orphaned and writing restarts at the beginning of fresh storage. Orphaned
+// storage is kept by the driver until the draws that read it complete, so
+// writes never wait on the GPU and never overwrite data a pending draw reads.
+//
+// The buffer object is generated on first write. It is not deleted on
+// destruction, since the owner may not have its context current; it is
+// released with the context. This class is not thread-safe.
+class GlStreamingBuffer {
+ public:
+  // `target` is the binding point the buffer is written through, e.g.
+  // `GL_ARRAY_BUFFER`. `capacity` is the initial size of its storage, which
+  // grows to fit the largest write.
+  GlStreamingBuffer(unsigned int target, size_t capacity);
+
+  // Returns the buffer object, generating it if needed.
+  unsigned int handle();
+
+  // Copies `size` bytes from `data` into the buffer, which must be bound to
+  // the target, and returns the offset they were copied to.
+  size_t Write(const void* data, size_t size);
+
+ private:
+  const unsigned int target_;
+  unsigned int handle_ = 0;
+  size_t capacity_;
+  // Offset of the next write, or `capacity_` if the storage has not been
+  // allocated.
+  size_t offset_;
+};
+
+}  // namespace gl
+
+#endif  // UTIL_GRAPHICS_GL_STREAMING_BUFFER_H_
@@ -0,0 +1,59 @@
+#include "util/graphics/gl_texture_binding_options.h"
+
+#include "third_party/gl_helper.h"
+
+namespace gl {
+
+void ApplyBindingOptions(const GlTextureBindingOptions& options,
+                         unsigned int sampler) {
+  auto set_parameter = [sampler](GLenum name, GLint value) {
+    if (sampler != 0) {
+      glSamplerParameteri(sampler, name, value);
+    } else {
+      glTexParameteri(GL_TEXTURE_2D, name, value);
+    }
+  };
+
+  switch (options.sampling_mode) {
+    case GlTextureSamplingMode::kClamp:
+      set_parameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      set_parameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      break;
+
+    case GlTextureSamplingMode::kWrap:
+      set_parameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
+      set_parameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
+      break;
+
+    case GlTextureSamplingMode::kMirrorWrap:
+      set_parameter(GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
+      set_parameter(GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+      break;
+
+    case GlTextureSamplingMode::kClampToBorder:
+      set_parameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+      set_parameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+      if (sampler != 0) {
+        glSamplerParameterfv(sampler, GL_TEXTURE_BORDER_COLOR,
+                             &options.border_color[0]);
+      } else {
+        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR,
+                         &options.border_color[0]);
+      }
+      break;
+  }
+
+  switch (options.filtering_mode) {
+    case GlTextureFilteringMode::kNearest:
+      set_parameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      set_parameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      break;
+
+    case GlTextureFilteringMode::kLinear:
+      set_parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      set_parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      break;
+  }
+}
+
+}  // namespace gl
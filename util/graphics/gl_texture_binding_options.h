@@ -0,0 +1,64 @@
+#ifndef UTIL_GRAPHICS_GL_TEXTURE_BINDING_OPTIONS_H_
+#define UTIL_GRAPHICS_GL_TEXTURE_BINDING_OPTIONS_H_
+
+#include <utility>
+
+#include "third_party/glm_helper.h"
+
+namespace gl {
+
+// Sampling mode for a bound texture.
+enum class GlTextureSamplingMode {
+  // Clamp UVs that fall outside of the texture boundaries to the boundary.
+  kClamp = 0,
+  // Wrap UVs that fall outside of the texture boundaries as if sampling from an
+  // infinitely tiled texture in all directions.
+  kWrap,
+  // Similar to `kWrap`, but as if each alternating column is mirrored
+  // left-to-right, and each alternating row is mirrored top-to-bottom.
+  kMirrorWrap,
+  // UVs that fall outside of the texture boundaries sample a separate border
+  // color, instead of sampling the texture.
+  kClampToBorder,
+};
+
+// Filtering mode for a bound texture.
+enum class GlTextureFilteringMode {
+  // Nearest-neighbor interpolation.
+  kNearest = 0,
+  // Linear interpolation between the four closest pixels to the UV.
+  kLinear,
+};
+
+// Aggregates sampling mode, filtering mode, and border color.
+struct GlTextureBindingOptions {
+  GlTextureSamplingMode sampling_mode = GlTextureSamplingMode::kClamp;
+  GlTextureFilteringMode filtering_mode = GlTextureFilteringMode::kLinear;
+  glm::vec4 border_color = glm::vec4(0, 0, 0, 0);
+
+  bool operator==(const GlTextureBindingOptions& other) const {
+    return sampling_mode == other.sampling_mode &&
+           filtering_mode == other.filtering_mode &&
+           border_color == other.border_color;
+  }
+  bool operator!=(const GlTextureBindingOptions& other) const {
+    return !(*this == other);
+  }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const GlTextureBindingOptions& options) {
+    return H::combine(std::move(h), options.sampling_mode,
+                      options.filtering_mode, options.border_color.x,
+                      options.border_color.y, options.border_color.z,
+                      options.border_color.w);
+  }
+};
+
+// Configures `sampler` as specified by `options`. If `sampler` is 0, instead
+// configures the texture bound to the 2D target of the active texture unit.
+void ApplyBindingOptions(const GlTextureBindingOptions& options,
+                         unsigned int sampler);
+
+}  // namespace gl
+
+#endif  // UTIL_GRAPHICS_GL_TEXTURE_BINDING_OPTIONS_H_
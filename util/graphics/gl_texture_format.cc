@@ -0,0 +1,181 @@
+#include "util/graphics/gl_texture_format.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <optional>
+
+#include "third_party/gl_helper.h"
+#include "util/graphics/gl_capabilities.h"
+#include "util/graphics/gl_state_cache.h"
+#include "util/logging/logging.h"
+
+namespace gl {
+
+namespace {
+std::atomic<bool> high_precision_feedback{false};
+
+// Indexed by `GlColorFormat`. Float formats are allocated without data, so
+// their pixel transfer type is only required to be valid.
+constexpr std::array<GlTextureFormat, 7> kColorFormats = {{
+    {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0, 4, "RGBA8"},
+    {GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_COLOR_ATTACHMENT0, 8, "RGBA16F"},
+    {GL_RG16F, GL_RG, GL_FLOAT, GL_COLOR_ATTACHMENT0, 4, "RG16F"},
+    {GL_R8, GL_RED, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0, 1, "R8"},
+    {GL_RG8, GL_RG, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0, 2, "RG8"},
+    {GL_RGB565, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, GL_COLOR_ATTACHMENT0, 2,
+     "RGB565"},
+    {0, GL_NONE, GL_NONE, GL_NONE, 0, "none"},
+}};
+
+// Indexed by `GlDepthFormat`.
+constexpr std::array<GlTextureFormat, 2> kDepthFormats = {{
+    {GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8,
+     GL_DEPTH_STENCIL_ATTACHMENT, 4, "DEPTH24_STENCIL8"},
+    {GL_DEPTH_COMPONENT16, GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT,
+     GL_DEPTH_ATTACHMENT, 2, "DEPTH16"},
+}};
+
+// Format to try when the implementation cannot render to a color format.
+// Every chain ends at `kRgba8`.
+GlColorFormat ColorFallback(GlColorFormat format) {
+  switch (format) {
+    case GlColorFormat::kRg16f:
+      return GlColorFormat::kRgba16f;
+    case GlColorFormat::kR8:
+      return GlColorFormat::kRg8;
+    default:
+      return GlColorFormat::kRgba8;
+  }
+}
+
+// Whether the implementation claims support for sampling from `format`.
+bool ColorFormatSupported(GlColorFormat format) {
+  const GlCapabilities& capabilities = GlCapabilities::Get();
+  const bool texture_rg = capabilities.AtLeastVersion(3, 0) ||
+                          capabilities.HasExtension("GL_ARB_texture_rg");
+  const bool float_render_targets = capabilities.float_render_targets();
+  switch (format) {
+    case GlColorFormat::kRgba8:
+    case GlColorFormat::kNone:
+      return true;
+    case GlColorFormat::kRgba16f:
+      return float_render_targets;
+    case GlColorFormat::kRg16f:
+      return float_render_targets && texture_rg;
+    case GlColorFormat::kR8:
+    case GlColorFormat::kRg8:
+      return texture_rg;
+    case GlColorFormat::kRgb565:
+      return capabilities.AtLeastVersion(4, 1) ||
+             capabilities.HasExtension("GL_ARB_ES2_compatibility");
+  }
+  return false;
+}
+
+// Allocates a 1x1 texture of `format` and checks that a framebuffer with it
+// attached is complete. Drivers may advertise a format that they can sample
+// from but not render to, which only this reveals.
+bool ColorFormatRenderable(GlColorFormat format) {
+  const GlTextureFormat& texture_format = GetTextureFormat(format);
+  GlStateCache& state_cache = GlStateCache::Current();
+  const unsigned int old_framebuffer = state_cache.framebuffer();
+
+  while (glGetError() != GL_NO_ERROR) {
+  }
+
+  unsigned int texture_handle = 0;
+  unsigned int framebuffer_handle = 0;
+  glGenTextures(1, &texture_handle);
+  glGenFramebuffers(1, &framebuffer_handle);
+  state_cache.BindTexture(texture_handle);
+  glTexImage2D(GL_TEXTURE_2D, 0, texture_format.internal_format, 1, 1, 0,
+               texture_format.format, texture_format.type, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  bool renderable = glGetError() == GL_NO_ERROR;
+  if (renderable) {
+    state_cache.BindFramebuffer(framebuffer_handle);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, texture_format.attachment,
+                           GL_TEXTURE_2D, texture_handle, 0);
+    renderable =
+        glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  }
+
+  state_cache.BindFramebuffer(old_framebuffer);
+  state_cache.BindTexture(0);
+  state_cache.ForgetFramebuffer(framebuffer_handle);
+  state_cache.ForgetTexture(texture_handle);
+  glDeleteFramebuffers(1, &framebuffer_handle);
+  glDeleteTextures(1, &texture_handle);
+  return renderable;
+}
+}  // namespace
+
+const GlTextureFormat& GetTextureFormat(GlColorFormat format) {
+  return kColorFormats[static_cast<int>(format)];
+}
+
+const GlTextureFormat& GetTextureFormat(GlDepthFormat format) {
+  return kDepthFormats[static_cast<int>(format)];
+}
+
+GlColorFormat ResolveColorFormat(GlColorFormat requested) {
+  static std::mutex* resolve_mu = new std::mutex();
+  static auto* renderable =
+      new std::array<std::optional<bool>, kColorFormats.size()>();
+
+  std::unique_lock<std::mutex> lock(*resolve_mu);
+  GlColorFormat format = requested;
+  while (true) {
+    std::optional<bool>& format_renderable =
+        (*renderable)[static_cast<int>(format)];
+    if (!format_renderable.has_value()) {
+      format_renderable =
+          format == GlColorFormat::kRgba8 || format == GlColorFormat::kNone ||
+          (ColorFormatSupported(format) && ColorFormatRenderable(format));
+      if (!*format_renderable) {
+        LOG(INFO) << "Render targets cannot use "
+                  << GetTextureFormat(format).name << "; falling back to "
+                  << GetTextureFormat(ColorFallback(format)).name;
+      }
+    }
+    if (*format_renderable) {
+      return format;
+    }
+    format = ColorFallback(format);
+  }
+}
+
+void SetHighPrecisionFeedback(bool enable) {
+  high_precision_feedback.store(enable);
+}
+
+GlColorFormat FeedbackColorFormat() {
+  if (high_precision_feedback.load() &&
+      GlCapabilities::Get().float_render_targets()) {
+    return GlColorFormat::kRgba16f;
+  }
+  return GlColorFormat::kRgba8;
+}
+
+GlDepthFormat ResolveDepthFormat(GlDepthFormat requested) {
+  if (requested == GlDepthFormat::kDepth16) {
+    return requested;
+  }
+  static const bool packed_depth_stencil = [] {
+    const GlCapabilities& capabilities = GlCapabilities::Get();
+    const bool supported =
+        capabilities.AtLeastVersion(3, 0) ||
+        capabilities.HasExtension("GL_ARB_framebuffer_object") ||
+        capabilities.HasExtension("GL_EXT_packed_depth_stencil");
+    if (!supported) {
+      LOG(INFO) << "Render targets cannot use DEPTH24_STENCIL8; falling back "
+                   "to DEPTH16";
+    }
+    return supported;
+  }();
+  return packed_depth_stencil ? requested : GlDepthFormat::kDepth16;
+}
+
+}  // namespace gl
@@ -0,0 +1,70 @@
+#ifndef UTIL_GRAPHICS_GL_TEXTURE_FORMAT_H_
+#define UTIL_GRAPHICS_GL_TEXTURE_FORMAT_H_
+
+namespace gl {
+
+// Storage format of the color texture of a render target.
+enum class GlColorFormat {
+  // 8-bit unsigned normalized RGBA. Supported everywhere.
+  kRgba8 = 0,
+  // 16-bit floating point RGBA, for feedback buffers which band at 8 bits.
+  kRgba16f,
+  // 16-bit floating point RG, e.g. for high precision displacement fields.
+  kRg16f,
+  // 8-bit unsigned normalized single channel, e.g. for masks. Samples as
+  // (r, 0, 0, 1).
+  kR8,
+  // 8-bit unsigned normalized RG, e.g. for low precision displacement fields.
+  // Samples as (r, g, 0, 1).
+  kRg8,
+  // 16-bit packed RGB without alpha, for memory bandwidth limited devices.
+  kRgb565,
+  // No color texture. Only valid alongside a depth texture.
+  kNone,
+};
+
+// Storage format of the depth texture of a render target.
+enum class GlDepthFormat {
+  // 24-bit depth packed with 8-bit stencil.
+  kDepth24Stencil8 = 0,
+  // 16-bit depth without stencil. Supported everywhere.
+  kDepth16,
+};
+
+// Arguments for allocating and attaching a texture of a given format.
+struct GlTextureFormat {
+  int internal_format;
+  unsigned int format;
+  unsigned int type;
+  // Framebuffer attachment point of a texture with this format.
+  unsigned int attachment;
+  int bytes_per_pixel;
+  const char* name;
+};
+
+const GlTextureFormat& GetTextureFormat(GlColorFormat format);
+const GlTextureFormat& GetTextureFormat(GlDepthFormat format);
+
+// Returns `requested` if the implementation can render to it, and otherwise
+// the closest format it can render to, falling back to `kRgba8` (or
+// `kDepth16`) at worst. Support is probed on the first request for each
+// format, which must happen with a context current; later requests are
+// answered from a cache. This function is thread-safe.
+GlColorFormat ResolveColorFormat(GlColorFormat requested);
+GlDepthFormat ResolveDepthFormat(GlDepthFormat requested);
+
+// Enables or disables half float feedback render targets. Disabled by default,
+// since they take twice the memory of `kRgba8` targets, which devices short on
+// video memory, such as the Raspberry Pi, cannot spare. Only affects presets
+// linked into the host binary. This function is thread-safe.
+void SetHighPrecisionFeedback(bool enable);
+
+// Returns the color format for feedback render targets whose contents fade
+// gradually, and so band at 8 bits per channel: `kRgba16f` if high precision
+// feedback is enabled and the implementation can render to float targets, and
+// `kRgba8` otherwise. Must first be called with a context current.
+GlColorFormat FeedbackColorFormat();
+
+}  // namespace gl
+
+#endif  // UTIL_GRAPHICS_GL_TEXTURE_FORMAT_H_
@@ -1,28 +1,28 @@
 #ifndef UTIL_GRAPHICS_GL_TEXTURE_MANAGER_H_
 #define UTIL_GRAPHICS_GL_TEXTURE_MANAGER_H_
 
-#include <mutex>
-#include <queue>
-#include <vector>
-
-#include "absl/status/statusor.h"
+#include <atomic>
 
 namespace gl {
 
+// Tracks the textures of the render targets that share it. Textures do not
+// own texture units; they are bound to a unit when sampled, by
+// `GlStateCache::BindTextureToAnyUnit`, so the number of live textures is
+// not limited by the number of units. This class is thread-safe.
 class GlTextureManager {
  public:
-  GlTextureManager();
+  GlTextureManager() = default;
+
+  // Record the creation and disposal of a texture.
+  void AddTexture();
+  void RemoveTexture();
 
-  absl::StatusOr<int> Allocate();
-  void Deallocate(int texture_unit);
+  int num_textures() const { return num_textures_; }
 
   void PrintState() const;
 
  private:
-  int total_texture_units_;
-  std::mutex texture_unit_mu_;
-  std::queue<int> free_texture_units_;
-  std::vector<bool> allocated_texture_units_;
+  std::atomic<int> num_textures_{0};
 };
 
 }  // namespace gl
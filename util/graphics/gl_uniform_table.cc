@@ -0,0 +1,118 @@
+#include "util/graphics/gl_uniform_table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "absl/strings/strip.h"
+#include "third_party/gl_helper.h"
+#include "util/graphics/gl_state_cache.h"
+#include "util/logging/logging.h"
+
+namespace gl {
+
+GlUniformTable::GlUniformTable(unsigned int program_handle)
+    : program_handle_(program_handle) {
+  int num_uniforms = 0, max_name_length = 0;
+  glGetProgramiv(program_handle, GL_ACTIVE_UNIFORMS, &num_uniforms);
+  glGetProgramiv(program_handle, GL_ACTIVE_UNIFORM_MAX_LENGTH,
+                 &max_name_length);
+
+  std::string name(std::max(max_name_length, 1), '\0');
+  for (int i = 0; i < num_uniforms; ++i) {
+    int length = 0, array_size = 0;
+    GLenum type;
+    glGetActiveUniform(program_handle, i, name.size(), &length, &array_size,
+                       &type, name.data());
+    absl::string_view bare_name(name.data(), length);
+    // Members of uniform blocks have no location.
+    const int location = glGetUniformLocation(program_handle, name.c_str());
+    if (location < 0) continue;
+    // Arrays are reported by their first element.
+    absl::ConsumeSuffix(&bare_name, "[0]");
+    uniforms_.push_back(
+        {.name_hash = HashUniformName(bare_name), .location = location});
+  }
+
+  std::sort(uniforms_.begin(), uniforms_.end(),
+            [](const Uniform& a, const Uniform& b) {
+              return a.name_hash < b.name_hash;
+            });
+  LOG(DEBUG) << "Reflected " << uniforms_.size() << " uniforms of program "
+             << program_handle;
+}
+
+int GlUniformTable::Find(uint64_t name_hash) const {
+  auto iter = std::lower_bound(uniforms_.begin(), uniforms_.end(), name_hash,
+                               [](const Uniform& uniform, uint64_t hash) {
+                                 return uniform.name_hash < hash;
+                               });
+  if (iter == uniforms_.end() || iter->name_hash != name_hash) return -1;
+  return iter - uniforms_.begin();
+}
+
+int64_t GlUniformTable::uploads() {
+  std::unique_lock<std::mutex> lock(table_mu_);
+  return uploads_;
+}
+
+int64_t GlUniformTable::skipped_uploads() {
+  std::unique_lock<std::mutex> lock(table_mu_);
+  return skipped_uploads_;
+}
+
+bool GlUniformTable::InUse() const {
+  return GlStateCache::Current().program() == program_handle_;
+}
+
+bool GlUniformTable::UpdateLocked(int slot, const void* data, size_t bytes) {
+  std::vector<unsigned char>& value = uniforms_[slot].value;
+  if (value.size() == bytes && std::memcmp(value.data(), data, bytes) == 0) {
+    ++skipped_uploads_;
+    return false;
+  }
+  value.assign(static_cast<const unsigned char*>(data),
+               static_cast<const unsigned char*>(data) + bytes);
+  ++uploads_;
+  return true;
+}
+
+#define DEFINE_UNIFORM_TABLE_SET(type, upload_expr)                          \
+  void GlUniformTable::Set(int slot, const type* values, int count) {        \
+    if (slot < 0) return;                                                    \
+    if (!InUse()) {                                                          \
+      LOG_N_SEC(1, WARNING) << "Ignoring upload to uniform " << slot         \
+                            << " of program " << program_handle_             \
+                            << ", which is not in use; missing Use()?";      \
+      return;                                                                \
+    }                                                                        \
+    std::unique_lock<std::mutex> lock(table_mu_);                            \
+    if (!UpdateLocked(slot, values, sizeof(type) * count)) return;           \
+    const int location = uniforms_[slot].location;                           \
+    upload_expr;                                                             \
+  }
+
+DEFINE_UNIFORM_TABLE_SET(float, glUniform1fv(location, count, values));
+DEFINE_UNIFORM_TABLE_SET(int, glUniform1iv(location, count, values));
+DEFINE_UNIFORM_TABLE_SET(glm::vec2,
+                         glUniform2fv(location, count, &values[0].x));
+DEFINE_UNIFORM_TABLE_SET(glm::vec3,
+                         glUniform3fv(location, count, &values[0].x));
+DEFINE_UNIFORM_TABLE_SET(glm::vec4,
+                         glUniform4fv(location, count, &values[0].x));
+DEFINE_UNIFORM_TABLE_SET(glm::ivec2,
+                         glUniform2iv(location, count, &values[0].x));
+DEFINE_UNIFORM_TABLE_SET(glm::ivec3,
+                         glUniform3iv(location, count, &values[0].x));
+DEFINE_UNIFORM_TABLE_SET(glm::ivec4,
+                         glUniform4iv(location, count, &values[0].x));
+DEFINE_UNIFORM_TABLE_SET(glm::mat3, glUniformMatrix3fv(location, count,
+                                                       GL_FALSE,
+                                                       &values[0][0][0]));
+DEFINE_UNIFORM_TABLE_SET(glm::mat4, glUniformMatrix4fv(location, count,
+                                                       GL_FALSE,
+                                                       &values[0][0][0]));
+
+#undef DEFINE_UNIFORM_TABLE_SET
+
+}  // namespace gl
@@ -0,0 +1,113 @@
+#ifndef UTIL_GRAPHICS_GL_UNIFORM_TABLE_H_
+#define UTIL_GRAPHICS_GL_UNIFORM_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "third_party/glm_helper.h"
+
+namespace gl {
+
+// 64-bit FNV-1a hash of a uniform name. Usable in constant expressions, so
+// that names known at compile time are hashed at compile time.
+constexpr uint64_t HashUniformName(const char* name, size_t length) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= static_cast<unsigned char>(name[i]);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+inline uint64_t HashUniformName(absl::string_view name) {
+  return HashUniformName(name.data(), name.size());
+}
+
+// Table of the active uniforms of a linked program, reflected with
+// `glGetActiveUniform`, together with the values last uploaded to each.
+//
+// Uniforms are addressed by slot, an index into the table resolved once from
+// the uniform name. Uploads through the table skip values that are unchanged
+// since the last upload, so every upload to the program's uniforms must go
+// through its table. Uniform state belongs to the program object, so one
+// table is shared by every context the program is used from. Since cached
+// programs are shared between threads, the table is thread-safe; an upload
+// holds the table's lock until the value has been sent to the driver, so
+// that the shadow always matches what was uploaded last.
+class GlUniformTable {
+ public:
+  // Reflects the active uniforms of `program_handle`, which must be linked.
+  explicit GlUniformTable(unsigned int program_handle);
+
+  // Returns the slot of the active uniform with the given name (or name hash),
+  // or -1 if there is none. Array uniforms are found by their bare name.
+  int Find(uint64_t name_hash) const;
+  int Find(absl::string_view name) const { return Find(HashUniformName(name)); }
+
+  int location(int slot) const { return uniforms_[slot].location; }
+  size_t size() const { return uniforms_.size(); }
+
+  // Uploads `count` consecutive values to the uniform in `slot`, unless they
+  // equal the values last uploaded. The program must be in use in the current
+  // `GlStateCache`; otherwise the upload would land in another program, so
+  // nothing is uploaded or recorded and a rate-limited warning is logged.
+  // Does nothing for slot -1, so that uniforms optimized out of a program are
+  // ignored.
+#define DECLARE_UNIFORM_TABLE_SET(type) \
+  void Set(int slot, const type* values, int count);
+
+  DECLARE_UNIFORM_TABLE_SET(float);
+  DECLARE_UNIFORM_TABLE_SET(int);
+  DECLARE_UNIFORM_TABLE_SET(glm::vec2);
+  DECLARE_UNIFORM_TABLE_SET(glm::vec3);
+  DECLARE_UNIFORM_TABLE_SET(glm::vec4);
+  DECLARE_UNIFORM_TABLE_SET(glm::ivec2);
+  DECLARE_UNIFORM_TABLE_SET(glm::ivec3);
+  DECLARE_UNIFORM_TABLE_SET(glm::ivec4);
+  DECLARE_UNIFORM_TABLE_SET(glm::mat3);
+  DECLARE_UNIFORM_TABLE_SET(glm::mat4);
+
+#undef DECLARE_UNIFORM_TABLE_SET
+
+  template <typename T>
+  void Set(int slot, const T& value) {
+    Set(slot, &value, 1);
+  }
+  void Set(int slot, bool value) { Set(slot, static_cast<int>(value)); }
+
+  // Number of uploads made, and skipped as redundant, through this table.
+  int64_t uploads();
+  int64_t skipped_uploads();
+
+ private:
+  struct Uniform {
+    uint64_t name_hash;
+    int location;
+    // Shadow of the last uploaded value, empty until the first upload.
+    std::vector<unsigned char> value;
+  };
+
+  // Records `bytes` bytes of `data` as the value of the uniform in `slot`.
+  // Returns whether they differ from the previous value, i.e. whether they
+  // must be uploaded. Must be called with `table_mu_` held.
+  bool UpdateLocked(int slot, const void* data, size_t bytes);
+
+  // Returns whether the program is in use in the current `GlStateCache`.
+  bool InUse() const;
+
+  const unsigned int program_handle_;
+  // Sorted by name hash. Only the shadowed values change after construction.
+  std::vector<Uniform> uniforms_;
+
+  // Guards the shadowed values and the counts below.
+  std::mutex table_mu_;
+  int64_t uploads_ = 0;
+  int64_t skipped_uploads_ = 0;
+};
+
+}  // namespace gl
+
+#endif  // UTIL_GRAPHICS_GL_UNIFORM_TABLE_H_
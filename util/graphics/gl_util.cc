@@ -2,49 +2,33 @@
 
 #include "third_party/gl_helper.h"
 #include "third_party/glm_helper.h"
+#include "util/graphics/gl_capabilities.h"
+#include "util/graphics/gl_sampler_cache.h"
+#include "util/graphics/gl_state_cache.h"
 #include "util/logging/logging.h"
 
 namespace gl {
 namespace {
 
-// Parses the provided binding options and invokes the corresponding GL
-// functions to configure the active texture as specified.
-void ConfigureBindingOptions(GlTextureBindingOptions binding_options) {
-  switch (binding_options.sampling_mode) {
-    case GlTextureSamplingMode::kClamp:
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-      break;
-
-    case GlTextureSamplingMode::kWrap:
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-      break;
-
-    case GlTextureSamplingMode::kMirrorWrap:
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-      break;
-
-    case GlTextureSamplingMode::kClampToBorder:
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-      glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR,
-                       &binding_options.border_color[0]);
-      break;
+// Binds the texture backing `render_target` to a texture unit, configures
+// sampling from it with the provided binding options, and returns the unit.
+int BindRenderTargetTexture(GlRenderTarget& render_target,
+                            GlTextureBindingOptions binding_options) {
+  GlStateCache& state_cache = GlStateCache::Current();
+  const int texture_unit =
+      state_cache.BindTextureToAnyUnit(render_target.texture_handle());
+  if (GlCapabilities::Get().sampler_objects()) {
+    state_cache.BindSampler(
+        texture_unit, GlSamplerCache::Get().GetOrCreate(binding_options));
+    return texture_unit;
   }
-
-  switch (binding_options.filtering_mode) {
-    case GlTextureFilteringMode::kNearest:
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-      break;
-
-    case GlTextureFilteringMode::kLinear:
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-      break;
+  if (render_target.texture_binding_options() != binding_options) {
+    // Texture parameters apply to the texture bound to the active unit.
+    state_cache.ActiveTexture(texture_unit);
+    ApplyBindingOptions(binding_options, /*sampler=*/0);
+    render_target.set_texture_binding_options(binding_options);
   }
+  return texture_unit;
 }
 }  // namespace
 
@@ -54,7 +38,8 @@ void GlClear(glm::vec4 color) {
 }
 
 void GlBindRenderTargetTextureToUniform(
-    std::shared_ptr<GlProgram> program, std::string texture_uniform_name,
+    const std::shared_ptr<GlProgram>& program,
+    absl::string_view texture_uniform_name,
     std::shared_ptr<GlRenderTarget> render_target,
     GlTextureBindingOptions binding_options) {
   if (render_target == nullptr) {
@@ -62,48 +47,48 @@ void GlBindRenderTargetTextureToUniform(
         << "GlBindRenderTargetTextureToUniform(): render_target is nullptr";
     return;
   }
-  glActiveTexture(GL_TEXTURE0 + render_target->texture_unit());
-  glBindTexture(GL_TEXTURE_2D, render_target->texture_handle());
-
-  ConfigureBindingOptions(binding_options);
-
-  glUniform1i(glGetUniformLocation(program->program_handle(),
-                                   texture_uniform_name.c_str()),
-              render_target->texture_unit());
+  const int texture_unit =
+      BindRenderTargetTexture(*render_target, binding_options);
+  GlUniformTable& uniforms = program->uniforms();
+  uniforms.Set(uniforms.Find(texture_uniform_name), texture_unit);
 }
 
-#define DEFINE_BIND_UNIFORM(type, uniform_func, value_expr)                    \
-  void GlBindUniform(std::shared_ptr<GlProgram> program,                       \
-                     std::string uniform_name, type value) {                   \
-    uniform_func(                                                              \
-        glGetUniformLocation(program->program_handle(), uniform_name.c_str()), \
-        value_expr);                                                           \
-  }
-#define DEFINE_BIND_UNIFORM_V(v_type, uniform_v_func, value_expr)              \
-  void GlBindUniform(std::shared_ptr<GlProgram> program,                       \
-                     std::string uniform_name, v_type value) {                 \
-    uniform_v_func(                                                            \
-        glGetUniformLocation(program->program_handle(), uniform_name.c_str()), \
-        1, value_expr);                                                        \
+void GlBindRenderTargetTextureToUniform(
+    const GlUniformHandle<int>& texture_uniform,
+    std::shared_ptr<GlRenderTarget> render_target,
+    GlTextureBindingOptions binding_options) {
+  if (render_target == nullptr) {
+    LOG(DEBUG)
+        << "GlBindRenderTargetTextureToUniform(): render_target is nullptr";
+    return;
   }
-#define DEFINE_BIND_UNIFORM_M(m_type, uniform_m_func, value_expr)              \
-  void GlBindUniform(std::shared_ptr<GlProgram> program,                       \
-                     std::string uniform_name, m_type value) {                 \
-    uniform_m_func(                                                            \
-        glGetUniformLocation(program->program_handle(), uniform_name.c_str()), \
-        1, GL_FALSE, value_expr);                                              \
+  texture_uniform.Set(BindRenderTargetTexture(*render_target, binding_options));
+}
+
+#define DEFINE_BIND_UNIFORM(type)                                         \
+  void GlBindUniform(const std::shared_ptr<GlProgram>& program,           \
+                     absl::string_view uniform_name, type value) {        \
+    GlUniformTable& uniforms = program->uniforms();                       \
+    uniforms.Set(uniforms.Find(uniform_name), value);                     \
+  }                                                                       \
+  void GlBindUniform(const std::shared_ptr<GlProgram>& program,           \
+                     GlUniformName uniform_name, type value) {            \
+    GlUniformTable& uniforms = program->uniforms();                       \
+    uniforms.Set(uniforms.Find(uniform_name.hash), value);                \
   }
 
-DEFINE_BIND_UNIFORM(float, glUniform1f, value);
-DEFINE_BIND_UNIFORM(int, glUniform1i, value);
-DEFINE_BIND_UNIFORM(bool, glUniform1i, value);
-DEFINE_BIND_UNIFORM_V(glm::vec2, glUniform2fv, &value.x);
-DEFINE_BIND_UNIFORM_V(glm::vec3, glUniform3fv, &value.x);
-DEFINE_BIND_UNIFORM_V(glm::vec4, glUniform4fv, &value.x);
-DEFINE_BIND_UNIFORM_V(glm::ivec2, glUniform2iv, &value.x);
-DEFINE_BIND_UNIFORM_V(glm::ivec3, glUniform3iv, &value.x);
-DEFINE_BIND_UNIFORM_V(glm::ivec4, glUniform3iv, &value.x);
-DEFINE_BIND_UNIFORM_M(glm::mat3, glUniformMatrix3fv, &value[0][0]);
-DEFINE_BIND_UNIFORM_M(glm::mat4, glUniformMatrix4fv, &value[0][0]);
+DEFINE_BIND_UNIFORM(float);
+DEFINE_BIND_UNIFORM(int);
+DEFINE_BIND_UNIFORM(bool);
+DEFINE_BIND_UNIFORM(glm::vec2);
+DEFINE_BIND_UNIFORM(glm::vec3);
+DEFINE_BIND_UNIFORM(glm::vec4);
+DEFINE_BIND_UNIFORM(glm::ivec2);
+DEFINE_BIND_UNIFORM(glm::ivec3);
+DEFINE_BIND_UNIFORM(glm::ivec4);
+DEFINE_BIND_UNIFORM(glm::mat3);
+DEFINE_BIND_UNIFORM(glm::mat4);
+
+#undef DEFINE_BIND_UNIFORM
 
 }  // namespace gl
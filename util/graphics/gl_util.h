@@ -1,58 +1,88 @@
 #ifndef UTIL_GRAPHICS_GL_UTIL_H_
 #define UTIL_GRAPHICS_GL_UTIL_H_
 
+#include <cstdint>
 #include <memory>
+#include <type_traits>
+#include <utility>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "third_party/glm_helper.h"
 #include "util/graphics/gl_interface.h"
 #include "util/graphics/gl_render_target.h"
+#include "util/graphics/gl_texture_binding_options.h"
+#include "util/graphics/gl_uniform_table.h"
 
 namespace gl {
 
-// Sampling mode for a bound texture.
-enum class GlTextureSamplingMode {
-  // Clamp UVs that fall outside of the texture boundaries to the boundary.
-  kClamp = 0,
-  // Wrap UVs that fall outside of the texture boundaries as if sampling from an
-  // infinitely tiled texture in all directions.
-  kWrap,
-  // Similar to `kWrap`, but as if each alternating column is mirrored
-  // left-to-right, and each alternating row is mirrored top-to-bottom.
-  kMirrorWrap,
-  // UVs that fall outside of the texture boundaries sample a separate border
-  // color, instead of sampling the texture.
-  kClampToBorder,
-};
+void GlClear(glm::vec4 color);
 
-// Filtering mode for a bound texture.
-enum class GlTextureFilteringMode {
-  // Nearest-neighbor interpolation.
-  kNearest = 0,
-  // Linear interpolation between the four closest pixels to the UV.
-  kLinear,
-};
+// A uniform of a program, resolved by name once, for setting repeatedly.
+// Values are uploaded through the program's `GlUniformTable`, so unchanged
+// values are skipped. A handle to a uniform the program does not have is
+// valid to set, and does nothing.
+template <typename T>
+class GlUniformHandle {
+ public:
+  GlUniformHandle() = default;
+  GlUniformHandle(std::shared_ptr<const GlProgram> program,
+                  absl::string_view name)
+      : program_(std::move(program)),
+        slot_(program_->uniforms().Find(name)) {}
 
-// Aggregates sampling mode, filtering mode, and border color.
-struct GlTextureBindingOptions {
-  GlTextureSamplingMode sampling_mode = GlTextureSamplingMode::kClamp;
-  GlTextureFilteringMode filtering_mode = GlTextureFilteringMode::kLinear;
-  glm::vec4 border_color = glm::vec4(0, 0, 0, 0);
+  // Sets the uniform's value in the program, which must be in use.
+  void Set(const T& value) const {
+    if (program_ != nullptr) program_->uniforms().Set(slot_, value);
+  }
+  // Sets consecutive elements of an array uniform, starting at the first.
+  void Set(absl::Span<const T> values) const {
+    static_assert(!std::is_same<T, bool>::value,
+                  "bool array uniforms are not supported");
+    if (program_ != nullptr) {
+      program_->uniforms().Set(slot_, values.data(), values.size());
+    }
+  }
+
+  bool valid() const { return slot_ >= 0; }
+
+ private:
+  std::shared_ptr<const GlProgram> program_;
+  int slot_ = -1;
 };
 
-void GlClear(glm::vec4 color);
+// Uniform name whose hash was computed at compile time. See `GL_BIND_LOCAL`.
+struct GlUniformName {
+  uint64_t hash;
+};
 
 // Binds the texture backing a gl::GlRenderTarget to a sampler uniform in a
 // gl::GlProgram. Configures the bound texture with the provided binding
-// options.
+// options. The texture unit is chosen at bind time, so textures should be
+// bound just before the draw calls that sample them.
+void GlBindRenderTargetTextureToUniform(
+    const std::shared_ptr<GlProgram>& program,
+    absl::string_view texture_uniform_name,
+    std::shared_ptr<GlRenderTarget> render_target,
+    GlTextureBindingOptions binding_options);
+
+// Binds the texture backing a gl::GlRenderTarget to the sampler uniform
+// `texture_uniform` of the currently used program. Configures the bound
+// texture with the provided binding options.
 void GlBindRenderTargetTextureToUniform(
-    std::shared_ptr<GlProgram> program, std::string texture_uniform_name,
+    const GlUniformHandle<int>& texture_uniform,
     std::shared_ptr<GlRenderTarget> render_target,
     GlTextureBindingOptions binding_options);
 
-// Binds a value by name in a gl::GlProgram.
-#define DECLARE_BIND_UNIFORM(type)                       \
-  void GlBindUniform(std::shared_ptr<GlProgram> program, \
-                     std::string uniform_name, type value);
+// Binds a value by name in a gl::GlProgram, which must be in use. Names are
+// looked up in the program's `GlUniformTable` rather than with
+// `glGetUniformLocation`, and unchanged values are not uploaded. Uniforms
+// set every frame are cheaper still through a `GlUniformHandle`.
+#define DECLARE_BIND_UNIFORM(type)                                     \
+  void GlBindUniform(const std::shared_ptr<GlProgram>& program,        \
+                     absl::string_view uniform_name, type value);      \
+  void GlBindUniform(const std::shared_ptr<GlProgram>& program,        \
+                     GlUniformName uniform_name, type value);
 
 DECLARE_BIND_UNIFORM(float);
 DECLARE_BIND_UNIFORM(int);
@@ -68,8 +98,14 @@ DECLARE_BIND_UNIFORM(glm::mat4);
 
 #undef DECLARE_BIND_UNIFORM
 
-#define GL_BIND_LOCAL(program, value) \
-  GlBindUniform(program, "" #value "", value)
+// Binds a local variable to the uniform of the same name. The name is hashed
+// at compile time.
+#define GL_BIND_LOCAL(program, local)                                   \
+  GlBindUniform(program,                                                \
+                ::gl::GlUniformName{std::integral_constant<             \
+                    uint64_t, ::gl::HashUniformName(                    \
+                                  #local, sizeof(#local) - 1)>::value}, \
+                local)
 
 }  // namespace gl
 
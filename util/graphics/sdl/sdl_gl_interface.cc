@@ -9,16 +9,22 @@ namespace gl {
 // SdlGlContextActivation implementation
 // ============================================================================
 SdlGlContextActivation::SdlGlContextActivation(
-    std::shared_ptr<SdlGlInterface> interface, SDL_GLContext context)
-    : interface_(interface), context_(context) {
+    std::shared_ptr<SdlGlInterface> interface, SDL_GLContext context,
+    GlStateCache* state_cache)
+    : interface_(interface),
+      context_(context),
+      previous_window_(SDL_GL_GetCurrentWindow()),
+      previous_context_(SDL_GL_GetCurrentContext()),
+      state_cache_scope_(state_cache) {
   // Activate the GL context.
   if (SDL_GL_MakeCurrent(interface_->GetWindow().get(), context_) != 0)
     LOG(FATAL) << "SDL_GL_MakeCurrent failed: " << SDL_GetError();
 }
 
 SdlGlContextActivation::~SdlGlContextActivation() {
-  // Deactivate the GL context.
-  if (SDL_GL_MakeCurrent(interface_->GetWindow().get(), 0) != 0)
+  // Restore the previously active GL context. If there was none, this
+  // deactivates the GL context.
+  if (SDL_GL_MakeCurrent(previous_window_, previous_context_) != 0)
     LOG(FATAL) << "SDL_GL_MakeCurrent failed: " << SDL_GetError();
 }
 
@@ -31,14 +37,18 @@ SdlGlContext::SdlGlContext(std::shared_ptr<SdlGlInterface> interface,
 SdlGlContext::~SdlGlContext() { SDL_GL_DeleteContext(context_); }
 
 std::shared_ptr<GlContextActivation> SdlGlContext::Activate() {
-  return std::make_shared<SdlGlContextActivation>(interface_, context_);
+  return std::make_shared<SdlGlContextActivation>(interface_, context_,
+                                                  &state_cache());
 }
 
 // SdlGlInterface implementation
 // ============================================================================
 SdlGlInterface::SdlGlInterface(SDL_Window* window)
     : window_(window, SdlWindowDestroyer()) {
-  // SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+  // Contexts created while another context is current share its textures,
+  // programs and buffers. This lets multiple windows render from the same set
+  // of GL objects.
+  SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
 }
 
 std::shared_ptr<GlContext> SdlGlInterface::AllocateSharedContext() {
@@ -20,17 +20,22 @@ struct SdlWindowDestroyer {
 
 class SdlGlInterface;
 
-// RAII wrapper for an activated GLContext. The GLContext is made active on
-// construction, and made inactive on destruction.
+// RAII wrapper for an activated GLContext. The GLContext, and its state cache,
+// are made active on construction. On destruction, the context that was
+// current before construction (if any) is made active again, so activations
+// may be nested.
 class SdlGlContextActivation : public GlContextActivation {
  public:
   SdlGlContextActivation(std::shared_ptr<SdlGlInterface> interface,
-                         SDL_GLContext context);
+                         SDL_GLContext context, GlStateCache* state_cache);
   virtual ~SdlGlContextActivation();
 
  private:
   std::shared_ptr<SdlGlInterface> interface_;
   SDL_GLContext context_;
+  SDL_Window* previous_window_;
+  SDL_GLContext previous_context_;
+  GlStateCache::Scope state_cache_scope_;
 };
 
 // Represents a GLContext.
@@ -58,7 +63,8 @@ class SdlGlInterface : public GlInterface,
   SdlGlInterface(SDL_Window* window);
   virtual ~SdlGlInterface() {}
 
-  // Allocates a new shared GLContext.
+  // Allocates a new GLContext. If a context is current at the time of the
+  // call, the new context shares its object namespaces with it.
   std::shared_ptr<GlContext> AllocateSharedContext() override;
 
   void SetVsync(bool enable) override;
@@ -0,0 +1,59 @@
+#include "util/math/alias_table.h"
+
+#include "util/logging/logging.h"
+
+namespace opendrop {
+
+AliasTable::AliasTable(absl::Span<const float> weights) {
+  double total_weight = 0;
+  for (const float weight : weights) {
+    CHECK(weight >= 0) << "Provided weights contain negative values.";
+    total_weight += weight;
+  }
+  if (total_weight <= 0) return;
+
+  const size_t n = weights.size();
+  probabilities_.resize(n);
+  aliases_.resize(n);
+
+  // Scale the weights so that the mean is 1, and partition the columns into
+  // those under and over-full.
+  std::vector<double> scaled(n);
+  std::vector<size_t> small, large;
+  for (size_t i = 0; i < n; ++i) {
+    scaled[i] = weights[i] * n / total_weight;
+    (scaled[i] < 1.0 ? small : large).push_back(i);
+  }
+
+  // Top up each under-full column from an over-full one.
+  while (!small.empty() && !large.empty()) {
+    const size_t less = small.back(), more = large.back();
+    small.pop_back();
+    probabilities_[less] = scaled[less];
+    aliases_[less] = more;
+    scaled[more] -= 1.0 - scaled[less];
+    if (scaled[more] < 1.0) {
+      large.pop_back();
+      small.push_back(more);
+    }
+  }
+
+  // Whatever remains is full, up to rounding error.
+  for (const size_t i : large) {
+    probabilities_[i] = 1.0f;
+    aliases_[i] = i;
+  }
+  for (const size_t i : small) {
+    probabilities_[i] = 1.0f;
+    aliases_[i] = i;
+  }
+}
+
+size_t AliasTable::Sample(RandomStream& stream) const {
+  CHECK(!empty()) << "Cannot sample from an empty alias table";
+  const size_t column = stream.Index(probabilities_.size());
+  if (stream.Uniform(0.0f, 1.0f) < probabilities_[column]) return column;
+  return aliases_[column];
+}
+
+}  // namespace opendrop
@@ -0,0 +1,38 @@
+#ifndef UTIL_MATH_ALIAS_TABLE_H_
+#define UTIL_MATH_ALIAS_TABLE_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "util/math/random.h"
+
+namespace opendrop {
+
+// Walker/Vose alias table for sampling from a discrete distribution in
+// constant time, independent of the number of outcomes.
+class AliasTable {
+ public:
+  AliasTable() = default;
+  // Builds a table over outcomes [0, weights.size()) where the probability of
+  // drawing index `i` is `weights[i] / sum(weights)`. Weights must be
+  // non-negative.
+  explicit AliasTable(absl::Span<const float> weights);
+
+  // Returns an index drawn from the distribution. The table must not be
+  // empty.
+  size_t Sample(RandomStream& stream) const;
+
+  // Whether or not no outcome has a positive weight.
+  bool empty() const { return probabilities_.empty(); }
+  size_t size() const { return probabilities_.size(); }
+
+ private:
+  // Probability of keeping the column drawn, rather than taking its alias.
+  std::vector<float> probabilities_;
+  std::vector<size_t> aliases_;
+};
+
+}  // namespace opendrop
+
+#endif  // UTIL_MATH_ALIAS_TABLE_H_
@@ -0,0 +1,47 @@
+#include "util/math/alias_table.h"
+
+#include <vector>
+
+#include "googlemock/include/gmock/gmock.h"
+#include "googletest/include/gtest/gtest.h"
+
+namespace opendrop {
+namespace {
+
+TEST(AliasTableTest, EmptyWithoutPositiveWeights) {
+  EXPECT_TRUE(AliasTable().empty());
+  EXPECT_TRUE(AliasTable(absl::Span<const float>()).empty());
+  EXPECT_TRUE(AliasTable({0.0f, 0.0f}).empty());
+  EXPECT_FALSE(AliasTable({0.0f, 1.0f}).empty());
+}
+
+TEST(AliasTableTest, NeverSamplesZeroWeights) {
+  AliasTable table({0.0f, 2.0f, 0.0f, 1.0f});
+  RandomStream stream(1);
+  for (int i = 0; i < 1000; ++i) {
+    const size_t index = table.Sample(stream);
+    EXPECT_TRUE(index == 1 || index == 3) << index;
+  }
+}
+
+TEST(AliasTableTest, SamplesInProportionToWeights) {
+  const std::vector<float> weights = {1.0f, 2.0f, 3.0f, 4.0f};
+  AliasTable table(weights);
+  RandomStream stream(2);
+  constexpr int kSamples = 100000;
+  std::vector<int> counts(weights.size(), 0);
+  for (int i = 0; i < kSamples; ++i) {
+    ++counts[table.Sample(stream)];
+  }
+  for (size_t i = 0; i < weights.size(); ++i) {
+    EXPECT_NEAR(static_cast<float>(counts[i]) / kSamples, weights[i] / 10.0f,
+                0.01f);
+  }
+}
+
+TEST(AliasTableTest, DiesOnNegativeWeights) {
+  EXPECT_DEATH({ AliasTable({1.0f, -1.0f}); }, "negative");
+}
+
+}  // namespace
+}  // namespace opendrop
@@ -2,30 +2,42 @@
 #define UTIL_MATH_COEFFICIENTS_H_
 
 #include <array>
-#include <random>
 #include <type_traits>
+#include <utility>
 
+#include "absl/types/span.h"
 #include "util/logging/logging.h"
+#include "util/math/random.h"
+#include "util/redirect.h"
 
 namespace opendrop {
 
 class Coefficients {
  public:
+  // Redirects the coefficients drawn on the calling thread to `stream` for the
+  // life of this object, so that what one preset draws does not depend on what
+  // other presets and threads have drawn before it.
+  class ScopedStream {
+   public:
+    explicit ScopedStream(RandomStream& stream)
+        : previous_stream_(std::exchange(current_stream_, &stream)) {}
+    ~ScopedStream() { current_stream_ = previous_stream_; }
+
+    ScopedStream(const ScopedStream&) = delete;
+    ScopedStream& operator=(const ScopedStream&) = delete;
+
+   private:
+    RandomStream* previous_stream_;
+  };
+
   // Returns random coefficients distributed in the given range.
   template <int N, typename T = float,
             std::enable_if_t<std::is_floating_point<T>::value, void*> = nullptr>
   static std::array<T, N> Random(T minimum, T maximum) {
-    static std::random_device device;
-    static std::default_random_engine random_engine(device());
     CHECK(minimum <= maximum)
         << "minimum must be less than or equal to maximum";
-    std::uniform_real_distribution<T> distribution(minimum, maximum);
-
     std::array<T, N> return_coefficients;
-    for (int i = 0; i < N; ++i) {
-      return_coefficients[i] = distribution(random_engine);
-    }
-
+    Stream().Fill(absl::MakeSpan(return_coefficients), minimum, maximum);
     return return_coefficients;
   }
 
@@ -33,19 +45,32 @@ class Coefficients {
   template <int N, typename T = int,
             std::enable_if_t<std::is_integral<T>::value, void*> = nullptr>
   static std::array<T, N> Random(T minimum, T maximum) {
-    static std::random_device device;
-    static std::default_random_engine random_engine(device());
     CHECK(minimum <= maximum)
         << "minimum must be less than or equal to maximum";
-    std::uniform_int_distribution<T> distribution(minimum, maximum);
-
     std::array<T, N> return_coefficients;
-    for (int i = 0; i < N; ++i) {
-      return_coefficients[i] = distribution(random_engine);
-    }
-
+    Stream().Fill(absl::MakeSpan(return_coefficients), minimum, maximum);
     return return_coefficients;
   }
+
+  // Returns the stream coefficients are drawn from on the calling thread: that
+  // of the innermost `ScopedStream`, or else the shared "coefficients" stream.
+  static RandomStream& Stream() {
+    if (stream_function_ != nullptr) return stream_function_();
+    if (current_stream_ != nullptr) return *current_stream_;
+    static RandomStream* stream = &opendrop::Random::Stream("coefficients");
+    return *stream;
+  }
+
+  // Makes `Stream` defer to `stream`. Code loaded from a shared library
+  // carries its own copy of this class, and must be pointed at the host's
+  // `Stream` so that its draws honor the host's seed and `ScopedStream`s.
+  static void SetStreamFunction(RandomStream& (*stream)()) {
+    SetRedirect(&stream_function_, stream, &Coefficients::Stream);
+  }
+
+ private:
+  static inline RandomStream& (*stream_function_)() = nullptr;
+  static inline thread_local RandomStream* current_stream_ = nullptr;
 };
 
 }  // namespace opendrop
@@ -0,0 +1,133 @@
+#include "util/math/random.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "util/logging/logging.h"
+
+namespace opendrop {
+
+namespace {
+uint64_t SplitMix64(uint64_t* state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+uint64_t RotateLeft(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+}  // namespace
+
+Xoshiro256::Xoshiro256(uint64_t seed) {
+  for (uint64_t& word : state_) {
+    word = SplitMix64(&seed);
+  }
+}
+
+Xoshiro256::result_type Xoshiro256::operator()() {
+  const uint64_t result = RotateLeft(state_[1] * 5, 7) * 9;
+  const uint64_t t = state_[1] << 17;
+
+  state_[2] ^= state_[0];
+  state_[3] ^= state_[1];
+  state_[1] ^= state_[2];
+  state_[0] ^= state_[3];
+  state_[2] ^= t;
+  state_[3] = RotateLeft(state_[3], 45);
+
+  return result;
+}
+
+void RandomStream::Reseed(uint64_t seed) {
+  std::unique_lock<std::mutex> lock(stream_mu_);
+  engine_ = Xoshiro256(seed);
+}
+
+uint64_t RandomStream::NextUint64() {
+  std::unique_lock<std::mutex> lock(stream_mu_);
+  return engine_();
+}
+
+size_t RandomStream::Index(size_t size) {
+  CHECK(size > 0) << "Cannot draw an index into an empty range";
+  std::unique_lock<std::mutex> lock(stream_mu_);
+  return BoundedLocked(size - 1);
+}
+
+uint64_t RandomStream::BoundedLocked(uint64_t bound) {
+  const uint64_t range = bound + 1;
+  if (range == 0) {
+    return engine_();
+  }
+  // Reject the low values which would otherwise make the modulo biased.
+  const uint64_t threshold = (0 - range) % range;
+  while (true) {
+    const uint64_t value = engine_();
+    if (value >= threshold) {
+      return value % range;
+    }
+  }
+}
+
+struct Random::State {
+  std::mutex mu;
+  bool seeded = false;
+  uint64_t seed = 0;
+  std::unordered_map<std::string, std::unique_ptr<RandomStream>> streams;
+
+  void EnsureSeeded() {
+    if (seeded) return;
+    std::random_device device;
+    seed = (static_cast<uint64_t>(device()) << 32) | device();
+    seeded = true;
+    LOG(INFO) << "Random seed: " << seed;
+  }
+};
+
+Random::State& Random::GetState() {
+  static State* state = new State();
+  return *state;
+}
+
+void Random::SetSeed(uint64_t seed) {
+  State& state = GetState();
+  std::unique_lock<std::mutex> lock(state.mu);
+  state.seed = seed;
+  state.seeded = true;
+  for (auto& [name, stream] : state.streams) {
+    stream->Reseed(StreamSeed(seed, name));
+  }
+  LOG(INFO) << "Random seed: " << seed;
+}
+
+uint64_t Random::seed() {
+  State& state = GetState();
+  std::unique_lock<std::mutex> lock(state.mu);
+  state.EnsureSeeded();
+  return state.seed;
+}
+
+RandomStream& Random::Stream(absl::string_view name) {
+  State& state = GetState();
+  std::unique_lock<std::mutex> lock(state.mu);
+  state.EnsureSeeded();
+  std::unique_ptr<RandomStream>& stream = state.streams[std::string(name)];
+  if (stream == nullptr) {
+    stream = std::make_unique<RandomStream>(StreamSeed(state.seed, name));
+  }
+  return *stream;
+}
+
+uint64_t Random::StreamSeed(uint64_t seed, absl::string_view name) {
+  // FNV-1a of the name, mixed with the seed.
+  uint64_t hash = 0xcbf29ce484222325;
+  for (const char c : name) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3;
+  }
+  uint64_t state = seed ^ hash;
+  return SplitMix64(&state);
+}
+
+}  // namespace opendrop
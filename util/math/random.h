@@ -0,0 +1,131 @@
+#ifndef UTIL_MATH_RANDOM_H_
+#define UTIL_MATH_RANDOM_H_
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace opendrop {
+
+// xoshiro256** pseudo-random number generator. Satisfies the
+// UniformRandomBitGenerator requirements, so it may be used with the standard
+// library distributions, though the helpers on `RandomStream` should be
+// preferred since their output does not vary between standard libraries.
+class Xoshiro256 {
+ public:
+  using result_type = uint64_t;
+
+  // Expands `seed` into the generator state with SplitMix64, so that similar
+  // seeds produce unrelated sequences.
+  explicit Xoshiro256(uint64_t seed);
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()();
+
+ private:
+  std::array<uint64_t, 4> state_;
+};
+
+// A named sequence of random numbers. See `Random`. This class is thread-safe.
+class RandomStream {
+ public:
+  explicit RandomStream(uint64_t seed) : engine_(seed) {}
+
+  // Restarts the sequence from `seed`.
+  void Reseed(uint64_t seed);
+
+  uint64_t NextUint64();
+
+  // Returns a value uniformly distributed in [minimum, maximum).
+  template <typename T,
+            std::enable_if_t<std::is_floating_point<T>::value, void*> = nullptr>
+  T Uniform(T minimum, T maximum) {
+    std::unique_lock<std::mutex> lock(stream_mu_);
+    return UniformLocked(minimum, maximum);
+  }
+
+  // Returns a value uniformly distributed in [minimum, maximum].
+  template <typename T,
+            std::enable_if_t<std::is_integral<T>::value, void*> = nullptr>
+  T Uniform(T minimum, T maximum) {
+    std::unique_lock<std::mutex> lock(stream_mu_);
+    return UniformLocked(minimum, maximum);
+  }
+
+  // Returns an index uniformly distributed in [0, size).
+  size_t Index(size_t size);
+
+  // Fills `values` with values distributed as for `Uniform`, taking the lock
+  // once for the whole batch.
+  template <typename T>
+  void Fill(absl::Span<T> values, T minimum, T maximum) {
+    std::unique_lock<std::mutex> lock(stream_mu_);
+    for (T& value : values) {
+      value = UniformLocked(minimum, maximum);
+    }
+  }
+
+ private:
+  template <typename T,
+            std::enable_if_t<std::is_floating_point<T>::value, void*> = nullptr>
+  T UniformLocked(T minimum, T maximum) {
+    // The top 53 bits give a double uniformly distributed in [0, 1).
+    const double unit = (engine_() >> 11) * 0x1.0p-53;
+    const T value = minimum + static_cast<T>(unit) * (maximum - minimum);
+    // Rounding to a narrower type may land on `maximum`.
+    return value < maximum ? value : minimum;
+  }
+
+  template <typename T,
+            std::enable_if_t<std::is_integral<T>::value, void*> = nullptr>
+  T UniformLocked(T minimum, T maximum) {
+    const uint64_t range =
+        static_cast<uint64_t>(maximum) - static_cast<uint64_t>(minimum);
+    return static_cast<T>(static_cast<uint64_t>(minimum) +
+                          BoundedLocked(range));
+  }
+
+  // Returns a value uniformly distributed in [0, bound].
+  uint64_t BoundedLocked(uint64_t bound);
+
+  std::mutex stream_mu_;
+  Xoshiro256 engine_;
+};
+
+// Process-wide source of random numbers.
+//
+// Randomness is drawn from named streams, each seeded from the global seed and
+// its name. A stream's sequence therefore depends only on the seed and on how
+// many values were drawn from that stream, so runs with the same seed make the
+// same choices, and drawing more values in one subsystem does not perturb the
+// choices made by another. Unless `SetSeed` is called, the seed is drawn from
+// `std::random_device` on first use. This class is thread-safe.
+class Random {
+ public:
+  // Sets the global seed and restarts every stream from it.
+  static void SetSeed(uint64_t seed);
+  static uint64_t seed();
+
+  // Returns the stream named `name`, creating it on first use. The returned
+  // reference is valid for the life of the process.
+  static RandomStream& Stream(absl::string_view name);
+
+ private:
+  struct State;
+  static State& GetState();
+  // Returns the seed for the stream named `name` under global seed `seed`.
+  static uint64_t StreamSeed(uint64_t seed, absl::string_view name);
+};
+
+}  // namespace opendrop
+
+#endif  // UTIL_MATH_RANDOM_H_
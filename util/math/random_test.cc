@@ -0,0 +1,93 @@
+#include "util/math/random.h"
+
+#include <vector>
+
+#include "googlemock/include/gmock/gmock.h"
+#include "googletest/include/gtest/gtest.h"
+
+namespace opendrop {
+namespace {
+
+TEST(RandomTest, SameSeedProducesSameSequence) {
+  RandomStream a(1234), b(1234);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(a.NextUint64(), b.NextUint64());
+  }
+}
+
+TEST(RandomTest, DifferentSeedsProduceDifferentSequences) {
+  RandomStream a(1), b(2);
+  int num_equal = 0;
+  for (int i = 0; i < 100; ++i) {
+    if (a.NextUint64() == b.NextUint64()) ++num_equal;
+  }
+  EXPECT_EQ(num_equal, 0);
+}
+
+TEST(RandomTest, ReseedRestartsSequence) {
+  RandomStream stream(42);
+  const uint64_t first = stream.NextUint64();
+  stream.NextUint64();
+  stream.Reseed(42);
+  EXPECT_EQ(stream.NextUint64(), first);
+}
+
+TEST(RandomTest, UniformFloatIsInRange) {
+  RandomStream stream(7);
+  for (int i = 0; i < 10000; ++i) {
+    const float value = stream.Uniform(-2.0f, 3.0f);
+    EXPECT_GE(value, -2.0f);
+    EXPECT_LT(value, 3.0f);
+  }
+}
+
+TEST(RandomTest, UniformIntCoversInclusiveRange) {
+  RandomStream stream(7);
+  std::vector<int> counts(5, 0);
+  for (int i = 0; i < 10000; ++i) {
+    const int value = stream.Uniform(-2, 2);
+    ASSERT_GE(value, -2);
+    ASSERT_LE(value, 2);
+    ++counts[value + 2];
+  }
+  for (int count : counts) {
+    EXPECT_GT(count, 1500);
+  }
+}
+
+TEST(RandomTest, IndexIsInRange) {
+  RandomStream stream(7);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_LT(stream.Index(3), 3);
+  }
+  EXPECT_EQ(stream.Index(1), 0);
+}
+
+TEST(RandomTest, FillMatchesSequentialDraws) {
+  RandomStream a(99), b(99);
+  std::vector<float> batch(16);
+  a.Fill(absl::MakeSpan(batch), 0.0f, 1.0f);
+  for (float value : batch) {
+    EXPECT_EQ(value, b.Uniform(0.0f, 1.0f));
+  }
+}
+
+TEST(RandomTest, StreamsAreReproducibleAndIndependent) {
+  Random::SetSeed(5);
+  RandomStream& a = Random::Stream("a");
+  const uint64_t a_first = a.NextUint64();
+  const uint64_t b_first = Random::Stream("b").NextUint64();
+  EXPECT_NE(a_first, b_first);
+
+  // Reseeding restarts every stream, and draws from one stream do not affect
+  // another.
+  Random::SetSeed(5);
+  Random::Stream("a").NextUint64();
+  Random::Stream("a").NextUint64();
+  EXPECT_EQ(Random::Stream("b").NextUint64(), b_first);
+  EXPECT_EQ(&Random::Stream("a"), &a);
+  EXPECT_EQ(Random::seed(), 5);
+}
+
+}  // namespace
+}  // namespace opendrop
@@ -2,14 +2,24 @@
 
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
 
 #include "util/logging/logging.h"
 
 namespace util {
 
+UdpServer::~UdpServer() {
+  if (socket_fd_ >= 0) close(socket_fd_);
+}
+
 bool UdpServer::Start() {
+  if (socket_fd_ >= 0) close(socket_fd_);
   socket_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
   if (socket_fd_ < 0) {
+    LOG(ERROR) << "Failed to create UDP socket: " << std::strerror(errno);
     return false;
   }
 
@@ -24,6 +34,10 @@ bool UdpServer::Start() {
 
   if (bind(socket_fd_, reinterpret_cast<const struct sockaddr*>(&servaddr),
            sizeof(servaddr)) < 0) {
+    LOG(ERROR) << "Failed to bind UDP port " << port_ << ": "
+               << std::strerror(errno);
+    close(socket_fd_);
+    socket_fd_ = -1;
     return false;
   }
 
@@ -31,6 +45,9 @@ bool UdpServer::Start() {
 }
 
 bool UdpServer::Read(std::vector<uint8_t>* buffer) {
+  if (socket_fd_ < 0) {
+    return false;
+  }
   int actual_bytes = recv(socket_fd_, receive_buffer_.data(),
                           receive_buffer_.size(), MSG_DONTWAIT);
   if (actual_bytes <= 0) {
@@ -10,14 +10,21 @@ namespace util {
 class UdpServer {
  public:
   UdpServer(int port) : port_(port), receive_buffer_(65536) {}
+  ~UdpServer();
 
+  // Owns its socket, so cannot be copied.
+  UdpServer(const UdpServer&) = delete;
+  UdpServer& operator=(const UdpServer&) = delete;
+
+  // Binds the server's socket to its port. Returns false, and logs the reason,
+  // if the socket cannot be bound.
   bool Start();
 
   bool Read(std::vector<uint8_t>* buffer);
 
  private:
   int port_;
-  int socket_fd_;
+  int socket_fd_ = -1;
 
   std::vector<uint8_t> receive_buffer_;
 };
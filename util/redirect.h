@@ -0,0 +1,18 @@
+#ifndef UTIL_REDIRECT_H_
+#define UTIL_REDIRECT_H_
+
+// Points `*redirect`, the function that a process-wide accessor defers to, at
+// `function`.
+//
+// Code loaded from a shared library carries its own copy of every such
+// accessor, and its copy must defer to the host's so that both share one
+// instance. The host hands its accessor to the library, and the library passes
+// its own copy as `self`. When host and library are the same copy, as when a
+// library is linked in statically, deferring to `function` would recurse
+// forever, so the redirect is cleared instead.
+template <typename Function>
+void SetRedirect(Function* redirect, Function function, Function self) {
+  *redirect = function == self ? nullptr : function;
+}
+
+#endif  // UTIL_REDIRECT_H_